@@ -1,4 +1,9 @@
 #include "company.hpp"
 #include <ref/DescriptorsImpl.ipp>
+#include <ref/utils/Initializer.hpp>
 
 template struct ref::ClassDescriptorImpl< example::Company >;
+
+// Keep the construction of the model descriptors at load time
+static const ref::DescriptorInitializer initializer(
+    example::Company::getClassDescriptorInstance());
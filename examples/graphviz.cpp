@@ -1,5 +1,5 @@
 #include <iostream>
-#include <ref/utils/StructuralContext.hpp>
+#include <ref/utils/StaticStructure.hpp>
 #include "company.hpp"
 
 using namespace ref;
@@ -29,7 +29,7 @@ int main(int argc, char **argv)
 {
     auto companyDesc =
         example::Company::getClassDescriptorInstance();
-    const StructuralContext ctx(companyDesc);
+    const StructuralContext ctx(StaticStructure< Company >::table);
 
     cout << "digraph " << companyDesc->getName();
     cout << endl << "{" << endl;
@@ -1,10 +1,16 @@
 #ifndef REF_CLASS_HPP
 #define REF_CLASS_HPP
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <boost/cstdint.hpp>
-#include <boost/mpl/joint_view.hpp>
 #include <ref/mpl.hpp>
+#include <ref/Observer.hpp>
+#include <ref/Lazy.hpp>
 #include <ref/DescriptorsImpl.hpp>
 
 namespace ref
@@ -18,6 +24,227 @@ namespace ref
         virtual const ClassDescriptor * getClassDescriptor() const = 0;
     };
 
+    /**
+     * @brief Root for classes whose features can be decoded on first
+     * access. Pending values are decoded by Class::get, and therefore by
+     * FeatureDescriptor::getValue, and discarded by Class::set. Copies
+     * decode every pending value of the source.
+     *
+     * Features accessed directly through Feature::value are not decoded.
+     * As with any other cache, lazy objects must not be accessed from
+     * several threads without synchronization, even through const
+     * functions.
+     */
+    struct LazyModelClass : ModelClass
+    {
+        LazyModelClass() {}
+
+        LazyModelClass(const LazyModelClass& other) : ModelClass(other)
+        {
+            other.materialize();
+        }
+
+        LazyModelClass& operator=(const LazyModelClass& other)
+        {
+            other.materialize();
+            m_lazy.reset();
+            return *this;
+        }
+
+        bool isMaterialized() const { return !m_lazy; }
+
+        /**
+         * @brief Decodes every pending value.
+         */
+        void materialize() const
+        {
+            if (!m_lazy) return;
+
+            // Detached first, as decoding accesses the features
+            std::unique_ptr< LazyState > lazy(std::move(m_lazy));
+            lazy->materializeAll(const_cast< LazyModelClass * >(this));
+        }
+
+        void materialize(const FeatureDescriptor * feature) const
+        {
+            if (!m_lazy || !m_lazy->isPending(feature)) return;
+
+            m_lazy->materialize(const_cast< LazyModelClass * >(this), feature);
+            if (m_lazy->empty()) m_lazy.reset();
+        }
+
+        void discard(const FeatureDescriptor * feature)
+        {
+            if (m_lazy) m_lazy->discard(feature);
+        }
+
+        /**
+         * @brief Replaces the pending values, if any.
+         */
+        void setLazyState(std::unique_ptr< LazyState > lazy)
+        {
+            m_lazy = std::move(lazy);
+        }
+
+    protected:
+        mutable std::unique_ptr< LazyState > m_lazy;
+    };
+
+    /**
+     * @brief Root for classes whose features are read from many threads
+     * while another one writes them, without locks.
+     *
+     * Each object has a sequence number, odd while a write is in
+     * progress. Readers copy values and retry if the sequence changed
+     * meanwhile, so they never block each other nor the writers, which
+     * exclude each other through the sequence itself. Features must be
+     * trivially copyable.
+     *
+     * Class::get returns copies of the values, and Class::set and update
+     * are single writes. Several features are read or written together
+     * through read and write, accessing Feature::value directly.
+     * FeatureDescriptor::setValue is also a write, and
+     * ClassDescriptor::copy copies a consistent snapshot of every feature.
+     * FeatureDescriptor::getValue still refers to the value in place, so
+     * it is only safe for the thread that writes the object. Readers of
+     * other threads read the copy returned by ClassDescriptor::snapshot,
+     * as the serializers, MemoryUsage, ColumnarWriter and TransactionLog
+     * do.
+     *
+     * Copies of objects through their copy constructor do not take a
+     * consistent snapshot.
+     */
+    struct SeqLockModelClass : ModelClass
+    {
+        SeqLockModelClass() : m_sequence(0) {}
+
+        // The sequence belongs to each object
+        SeqLockModelClass(const SeqLockModelClass& other)
+            : ModelClass(other), m_sequence(0)
+        {
+        }
+
+        SeqLockModelClass& operator=(const SeqLockModelClass&)
+        {
+            return *this;
+        }
+
+        /**
+         * @brief Number of writes started, twice, plus one while a write
+         * is in progress.
+         */
+        std::uint32_t getSequence() const
+        {
+            return m_sequence.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Waits for the write in progress, if any, and returns
+         * the sequence to validate the values read after it.
+         */
+        std::uint32_t readBegin() const
+        {
+            std::uint32_t sequence;
+            while ((sequence = m_sequence.load(std::memory_order_acquire)) & 1)
+                std::this_thread::yield();
+            return sequence;
+        }
+
+        /**
+         * @brief True if no write started since readBegin returned
+         * sequence, so that the values read in between are consistent.
+         */
+        bool readValidate(std::uint32_t sequence) const
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return m_sequence.load(std::memory_order_relaxed) == sequence;
+        }
+
+        void writeBegin()
+        {
+            std::uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+            while ((sequence & 1) ||
+                   !m_sequence.compare_exchange_weak(
+                       sequence, sequence + 1, std::memory_order_acquire,
+                       std::memory_order_relaxed))
+            {
+                std::this_thread::yield();
+                sequence = m_sequence.load(std::memory_order_relaxed);
+            }
+
+            // Values are written after the sequence becomes odd
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        void writeEnd() { m_sequence.fetch_add(1, std::memory_order_release); }
+
+        /**
+         * @brief Calls f until it runs without a concurrent write, and
+         * returns its last result. f must only copy values.
+         */
+        template < typename F >
+        auto read(F&& f) const
+        {
+            for (;;)
+            {
+                const std::uint32_t sequence = readBegin();
+                auto result = f();
+                if (readValidate(sequence)) return result;
+            }
+        }
+
+        /**
+         * @brief Calls f as a single write.
+         */
+        template < typename F >
+        void write(F&& f)
+        {
+            struct Guard
+            {
+                SeqLockModelClass& obj;
+                ~Guard() { obj.writeEnd(); }
+            };
+
+            writeBegin();
+            Guard guard{*this};
+            f();
+        }
+
+    protected:
+        mutable std::atomic< std::uint32_t > m_sequence;
+    };
+
+    namespace detail
+    {
+        /**
+         * @brief Returns the class in the hierarchy of Class that
+         * defines Feature.
+         */
+        template < typename Class, typename Feature, typename Enabled = void >
+        struct FeatureDefinedIn
+        {
+            typedef typename FeatureDefinedIn<
+                typename Class::base_class, Feature >::type type;
+        };
+
+        template < typename Class, typename Feature >
+        struct FeatureDefinedIn< Class, Feature,
+            typename std::enable_if< detail::Contains<
+                typename Class::features_type, Feature >::value >::type >
+        {
+            typedef Class type;
+        };
+
+        /**
+         * @brief Type returned by Class::get for a feature of type T: a
+         * reference to the value, or a copy for classes with a seqlock.
+         */
+        template < typename BaseClass, typename T >
+        using GetResult = typename std::conditional<
+            std::is_base_of< SeqLockModelClass, BaseClass >::value,
+            typename std::remove_const< T >::type, T& >::type;
+    } // namespace detail
+
     template < class Impl,
                typename FeaturesList = EmptyList,
                class BaseClass = ModelClass >
@@ -27,7 +254,7 @@ namespace ref
     {
         typedef BaseClass base_class;
         typedef FeaturesList features_type;
-        typedef typename boost::mpl::joint_view<
+        typedef typename detail::Concat<
                 typename BaseClass::all_features_type,
                 features_type
             >::type all_features_type;
@@ -35,21 +262,108 @@ namespace ref
         // Attributes
 
         template < typename Feature >
-        const typename Feature::type& get() const
+        detail::GetResult< BaseClass, const typename Feature::type >
+        get() const
         {
-            return Feature::value;
+            if constexpr (is_seqlocked::value)
+            {
+                return loadFeature< Feature >();
+            }
+            else
+            {
+                materializeFeature< Feature >();
+                return Feature::value;
+            }
         }
 
         template < typename Feature >
-        typename Feature::type& get()
+        detail::GetResult< BaseClass, typename Feature::type > get()
         {
-            return Feature::value;
+            if constexpr (is_seqlocked::value)
+            {
+                return loadFeature< Feature >();
+            }
+            else
+            {
+                materializeFeature< Feature >();
+                return Feature::value;
+            }
         }
 
+        /**
+         * @brief Sets the value of a feature, notifying the registered
+         * feature observers, if any.
+         */
         template < typename Feature, typename T >
         void set(T t)
         {
-            Feature::value = t;
+            if constexpr (is_lazy::value)
+                this->discard(getFeatureDescriptor< Feature >());
+
+            if (detail::hasFeatureObservers())
+            {
+                const FeatureDescriptor * feature =
+                    getFeatureDescriptor< Feature >();
+                ModelClass * obj = static_cast< Impl * >(this);
+
+                detail::notifyBeforeSet(obj, feature);
+                storeFeature< Feature >([&] { Feature::value = t; });
+                detail::notifyAfterSet(obj, feature);
+                return;
+            }
+
+            storeFeature< Feature >([&] { Feature::value = t; });
+        }
+
+        /**
+         * @brief Calls f with a reference to the value of a feature, to
+         * modify it in place, notifying the registered feature observers.
+         * A single write for classes with a seqlock.
+         */
+        template < typename Feature, typename F >
+        void update(F&& f)
+        {
+            if constexpr (is_lazy::value)
+                this->materialize(getFeatureDescriptor< Feature >());
+
+            if (detail::hasFeatureObservers())
+            {
+                const FeatureDescriptor * feature =
+                    getFeatureDescriptor< Feature >();
+                ModelClass * obj = static_cast< Impl * >(this);
+
+                detail::notifyBeforeSet(obj, feature);
+                storeFeature< Feature >([&] { f(Feature::value); });
+                detail::notifyAfterSet(obj, feature);
+                return;
+            }
+
+            storeFeature< Feature >([&] { f(Feature::value); });
+        }
+
+        /**
+         * @brief Calls f(feature, value) for every feature, inherited ones
+         * first, with its descriptor and a reference to its value. Each
+         * call is resolved at compile time, with the type of the feature.
+         */
+        template < typename F >
+        void forEachFeature(F&& f)
+        {
+            ref::for_each< all_features_type >([&](auto * tag) {
+                typedef typename std::remove_pointer<
+                    decltype(tag) >::type Feature;
+                f(getFeatureDescriptor< Feature >(), get< Feature >());
+            });
+        }
+
+        template < typename F >
+        void forEachFeature(F&& f) const
+        {
+            ref::for_each< all_features_type >([&](auto * tag) {
+                typedef typename std::remove_pointer<
+                    decltype(tag) >::type Feature;
+                f(getFeatureDescriptor< Feature >(), get< Feature >());
+            });
         }
 
         static const ClassDescriptor * getClassDescriptorInstance()
@@ -61,6 +375,53 @@ namespace ref
         {
             return getClassDescriptorInstance();
         }
+
+    protected:
+        typedef std::is_base_of< LazyModelClass, BaseClass > is_lazy;
+        typedef std::is_base_of< SeqLockModelClass, BaseClass > is_seqlocked;
+
+        template < typename Feature >
+        static const FeatureDescriptor * getFeatureDescriptor()
+        {
+            typedef typename detail::FeatureDefinedIn<
+                Impl, Feature >::type DefinedIn;
+            return FeatureDescriptorImpl< DefinedIn, Feature >::instance();
+        }
+
+        template < typename Feature >
+        void materializeFeature() const
+        {
+            if constexpr (is_lazy::value)
+                this->materialize(getFeatureDescriptor< Feature >());
+        }
+
+        template < typename Feature >
+        typename Feature::type loadFeature() const
+        {
+            static_assert(
+                std::is_trivially_copyable< typename Feature::type >::value,
+                "Features of classes with a seqlock must be trivially "
+                "copyable");
+
+            return this->read([this] { return Feature::value; });
+        }
+
+        template < typename Feature, typename F >
+        void storeFeature(F&& store)
+        {
+            if constexpr (is_seqlocked::value)
+            {
+                static_assert(std::is_trivially_copyable<
+                                  typename Feature::type >::value,
+                              "Features of classes with a seqlock must be "
+                              "trivially copyable");
+                this->write(store);
+            }
+            else
+            {
+                store();
+            }
+        }
     };
 
     template < typename T >
@@ -88,7 +449,7 @@ namespace ref
     typedef Feature< std::string > String;
 
     template < typename... FeatureTypes >
-    using Features = boost::mpl::vector< FeatureTypes... >;
+    using Features = TypeList< FeatureTypes... >;
 
 } // namespace ref
 
@@ -0,0 +1,223 @@
+#ifndef REF_DESCRIPTOR_REGISTRY_HPP
+#define REF_DESCRIPTOR_REGISTRY_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <unordered_map>
+#include <ref/Descriptors.hpp>
+
+namespace ref
+{
+    /**
+     * @brief Process-wide registry of class descriptors.
+     *
+     * Every ClassDescriptorImpl registers itself when constructed, which
+     * happens at load time for every class whose descriptor is used.
+     *
+     * Lookups lock a mutex until freeze is called. After that they read
+     * an immutable snapshot without locking. Descriptors registered after
+     * freeze are batched: lookups that depend on them lock until the
+     * batch is as large as the current snapshot, and is then published in
+     * a new one. Previous snapshots are kept alive for the lifetime of
+     * the registry, so concurrent readers never see a table being
+     * modified or released. As snapshots at least double in size, they
+     * take less than twice the memory and copying time of the last one.
+     */
+    struct DescriptorRegistry
+    {
+        static DescriptorRegistry& instance()
+        {
+            static DescriptorRegistry instance_;
+            return instance_;
+        }
+
+        DescriptorRegistry(const DescriptorRegistry&) = delete;
+
+        void add(const ClassDescriptor* desc)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (!m_tables.add(desc)) return;
+
+            const Tables* snapshot = m_snapshot.load(std::memory_order_relaxed);
+            if (!snapshot) return;
+
+            const std::size_t pending =
+                m_pending.load(std::memory_order_relaxed) + 1;
+            if (pending >= snapshot->all.size())
+                publish();
+            else
+                m_pending.store(pending, std::memory_order_release);
+        }
+
+        /**
+         * @brief Makes subsequent lookups lock-free, including lookups of
+         * the descriptors registered since the previous call.
+         */
+        void freeze()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            publish();
+        }
+
+        bool isFrozen() const
+        {
+            return m_snapshot.load(std::memory_order_acquire) != nullptr;
+        }
+
+        const ClassDescriptor* findByFqn(const std::string& fqn) const
+        {
+            return find(&Tables::byFqn, fqn, true);
+        }
+
+        /**
+         * @brief Finds a class descriptor by its short name.
+         *
+         * @return A null pointer if not found or if the name is shared by
+         * several classes.
+         */
+        const ClassDescriptor* findByName(const std::string& name) const
+        {
+            return find(&Tables::byName, name, false);
+        }
+
+        /**
+         * @brief Finds a class descriptor by its XML tag.
+         *
+         * @return A null pointer if not found or if the tag is shared by
+         * several classes.
+         */
+        const ClassDescriptor* findByXmlTag(const std::string& tag) const
+        {
+            return find(&Tables::byXmlTag, tag, false);
+        }
+
+        const ClassDescriptor* findById(std::uint64_t id) const
+        {
+            return find(&Tables::byId, id, true);
+        }
+
+        std::vector<const ClassDescriptor*> getClassDescriptors() const
+        {
+            if (const Tables* snapshot = getCompleteSnapshot())
+                return snapshot->all;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_tables.all;
+        }
+
+    protected:
+        struct Tables
+        {
+            typedef std::unordered_map<std::string, const ClassDescriptor*>
+                StringMap;
+            typedef std::unordered_map<std::uint64_t, const ClassDescriptor*>
+                IdMap;
+
+            StringMap byFqn;
+            StringMap byName;
+            StringMap byXmlTag;
+            IdMap byId;
+            std::vector<const ClassDescriptor*> all;
+
+            /**
+             * @brief Adds a descriptor, unless one with the same FQN is
+             * already there. Throws if another class has its type id,
+             * leaving the tables unchanged.
+             */
+            bool add(const ClassDescriptor* desc)
+            {
+                if (byFqn.count(desc->getFqn())) return false;
+
+                auto it = byId.find(desc->getTypeId());
+                if (it != byId.end())
+                {
+                    throw std::runtime_error("Type id collision between " +
+                                             it->second->getFqn() + " and " +
+                                             desc->getFqn());
+                }
+
+                byFqn.insert(std::make_pair(desc->getFqn(), desc));
+                byId.insert(std::make_pair(desc->getTypeId(), desc));
+                all.push_back(desc);
+                addAmbiguous(byName, desc->getName(), desc);
+                addAmbiguous(byXmlTag, desc->getXmlTag(), desc);
+                return true;
+            }
+
+            static void addAmbiguous(StringMap& map, const std::string& key,
+                                     const ClassDescriptor* desc)
+            {
+                auto res = map.insert(std::make_pair(key, desc));
+                if (!res.second) res.first->second = nullptr;
+            }
+        };
+
+        mutable std::mutex m_mutex;
+        Tables m_tables;
+        std::atomic<const Tables*> m_snapshot;
+        std::vector<std::unique_ptr<const Tables> > m_snapshots;
+
+        // Descriptors registered since the last snapshot
+        std::atomic<std::size_t> m_pending;
+
+        DescriptorRegistry() : m_snapshot(nullptr), m_pending(0) {}
+
+        void publish()
+        {
+            m_snapshots.emplace_back(new Tables(m_tables));
+            m_snapshot.store(m_snapshots.back().get(),
+                             std::memory_order_release);
+
+            // Readers that see no pending descriptors see the snapshot
+            m_pending.store(0, std::memory_order_release);
+        }
+
+        /**
+         * @brief Returns the last snapshot if no descriptor is pending.
+         */
+        const Tables* getCompleteSnapshot() const
+        {
+            if (m_pending.load(std::memory_order_acquire)) return nullptr;
+            return m_snapshot.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Looks a key up in the last snapshot, and in the locked
+         * tables if pending descriptors could change the result. Keys of
+         * stable maps are never rebound once found.
+         */
+        template <typename Map, typename Key>
+        const ClassDescriptor* find(Map Tables::*map, const Key& key,
+                                    bool stable) const
+        {
+            const bool pending = m_pending.load(std::memory_order_acquire);
+
+            if (const Tables* snapshot =
+                    m_snapshot.load(std::memory_order_acquire))
+            {
+                const ClassDescriptor* desc = lookup(snapshot->*map, key);
+                if (!pending || (stable && desc)) return desc;
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return lookup(m_tables.*map, key);
+        }
+
+        template <typename Map, typename Key>
+        static const ClassDescriptor* lookup(const Map& map, const Key& key)
+        {
+            auto it = map.find(key);
+            return it == map.end() ? nullptr : it->second;
+        }
+    };
+
+}  // namespace ref
+
+#endif  // REF_DESCRIPTOR_REGISTRY_HPP
@@ -1,15 +1,26 @@
 #ifndef REF_DESCRIPTORS_HPP
 #define REF_DESCRIPTORS_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
+#include <type_traits>
 
 namespace ref
 {
     struct ModelClass;
     struct Holder;
     struct ClassDescriptor;
+    struct PrimitiveTypeDescriptor;
+    struct ListTypeDescriptor;
+    struct SetTypeDescriptor;
+    struct MapTypeDescriptor;
+    struct PairTypeDescriptor;
+    struct PointerTypeDescriptor;
+    struct UnsupportedTypeDescriptor;
 
     struct Descriptor
     {
@@ -18,8 +29,66 @@ namespace ref
         virtual std::string getFqn() const = 0;
 
         virtual std::string getXmlTag() const = 0;
+
+        /**
+         * @brief Returns a numeric identifier computed from the FQN, stable
+         * across processes built with the same compiler.
+         */
+        virtual std::uint64_t getTypeId() const = 0;
+    };
+
+    /**
+     * @brief Receives a type descriptor from TypeDescriptor::accept, as a
+     * pointer to its concrete kind.
+     *
+     * Every kind has its own pure virtual method, so that a new kind does
+     * not compile until every visitor handles it.
+     */
+    struct TypeVisitor
+    {
+        virtual ~TypeVisitor() {}
+
+        virtual void visit(const ClassDescriptor * desc) = 0;
+        virtual void visit(const PrimitiveTypeDescriptor * desc) = 0;
+        virtual void visit(const ListTypeDescriptor * desc) = 0;
+        virtual void visit(const SetTypeDescriptor * desc) = 0;
+        virtual void visit(const MapTypeDescriptor * desc) = 0;
+        virtual void visit(const PairTypeDescriptor * desc) = 0;
+        virtual void visit(const PointerTypeDescriptor * desc) = 0;
+        virtual void visit(const UnsupportedTypeDescriptor * desc) = 0;
     };
 
+    namespace detail
+    {
+        // Final, so that the calls to the function object are resolved
+        // statically and can be inlined
+        template < typename F >
+        struct FunctionTypeVisitor final : TypeVisitor
+        {
+            F& f;
+
+            FunctionTypeVisitor(F& f_) : f(f_) {}
+
+            void visit(const ClassDescriptor * desc) override { f(desc); }
+            void visit(const PrimitiveTypeDescriptor * desc) override
+            {
+                f(desc);
+            }
+            void visit(const ListTypeDescriptor * desc) override { f(desc); }
+            void visit(const SetTypeDescriptor * desc) override { f(desc); }
+            void visit(const MapTypeDescriptor * desc) override { f(desc); }
+            void visit(const PairTypeDescriptor * desc) override { f(desc); }
+            void visit(const PointerTypeDescriptor * desc) override
+            {
+                f(desc);
+            }
+            void visit(const UnsupportedTypeDescriptor * desc) override
+            {
+                f(desc);
+            }
+        };
+    } // namespace detail
+
     struct TypeDescriptor : Descriptor
     {
         enum Kind
@@ -30,6 +99,12 @@ namespace ref
 
         virtual Kind getKind() const = 0;
 
+        /**
+         * @brief Calls the method of the visitor for the kind of this
+         * descriptor. See also visitType.
+         */
+        virtual void accept(TypeVisitor& visitor) const = 0;
+
         /**
          * @brief Creates an instance of the type associated with this
          * descriptor and returns it inside a holder.
@@ -50,6 +125,22 @@ namespace ref
          */
         virtual void copy(Holder src, Holder dst) const = 0;
 
+        /**
+         * @brief Returns the size of an instance of the type, as given
+         * by sizeof.
+         */
+        virtual std::size_t getTypeSize() const = 0;
+
+        /**
+         * @brief Estimates the memory allocated by the value contained in
+         * h outside of itself: string buffers, container storage and
+         * nodes. The memory allocated by its elements and pointed-to
+         * values is not included.
+         *
+         * @param h A valid holder.
+         */
+        virtual std::size_t getHeapSize(Holder h) const = 0;
+
         /**
          * @brief Returns a concrete instance of an implementation
          * for the given type.
@@ -71,18 +162,37 @@ namespace ref
     struct UnsupportedTypeDescriptor : TypeDescriptor
     {
         Kind getKind() const { return kUnsupported; }
+
+        void accept(TypeVisitor& visitor) const { visitor.visit(this); }
     };
 
     /**
      * @brief Interface for descriptors assocated with primitive types.
      *
      * @todo Add get and set method for every primitive type supported.
-     * @todo Add PrimitiveKind enum and getPrimitiveKind method.
      */
     struct PrimitiveTypeDescriptor : TypeDescriptor
     {
+        /**
+         * @brief Representation of the associated type. Integral types
+         * other than bool and char are classified by size and signedness.
+         * kInternedString is ref::InternedString and kSharedString is
+         * ref::SharedString, a string that can live in shared memory.
+         */
+        enum PrimitiveKind
+        {
+            kBool, kChar,
+            kInt8, kUInt8, kInt16, kUInt16, kInt32, kUInt32, kInt64, kUInt64,
+            kFloat, kDouble, kLongDouble,
+            kString, kInternedString, kSharedString
+        };
+
         Kind getKind() const { return kPrimitive; }
 
+        void accept(TypeVisitor& visitor) const { visitor.visit(this); }
+
+        virtual PrimitiveKind getPrimitiveKind() const = 0;
+
         /**
          * @brief Converts the value contained in a holder into a string
          * using boost::lexical_cast.
@@ -110,6 +220,10 @@ namespace ref
         /**
          * @brief Returns the value of the structural feature.
          *
+         * The value is borrowed in place, so that decoders can write
+         * through it: for classes with a seqlock, readers take it from
+         * ClassDescriptor::snapshot instead.
+         *
          * @param obj A valid instance.
          *
          * @return A holder object that contains a pointer to the
@@ -117,8 +231,28 @@ namespace ref
          */
         virtual Holder getValue(ModelClass * obj) const = 0;
 
+        /**
+         * @brief Copies a value into the structural feature, notifying
+         * the registered feature observers.
+         *
+         * @param obj A valid instance.
+         * @param value A holder containing a value of the type associated
+         * with the feature.
+         */
+        virtual void setValue(ModelClass * obj, Holder value) const = 0;
+
         virtual ModelClass * getObject(Holder h) const = 0;
 
+        /**
+         * @brief Returns the byte offset of the value of the feature
+         * relative to the ModelClass sub-object of an instance.
+         *
+         * The offset is the same for any class that inherits the feature.
+         *
+         * @return An offset in bytes.
+         */
+        virtual std::size_t getOffset() const = 0;
+
         /**
          * @brief Returns the class descriptor for the class this feature
          * is defined in.
@@ -131,6 +265,38 @@ namespace ref
     typedef std::vector< const FeatureDescriptor * > FeatureDescriptorVector;
     typedef std::vector< std::pair< const FeatureDescriptor *, Holder > > FeatureValueVector;
 
+    /**
+     * @brief Receives the features of an object from
+     * ClassDescriptor::forEachFeature.
+     */
+    struct FeatureVisitor
+    {
+        virtual ~FeatureVisitor() {}
+
+        /**
+         * @param value A holder that borrows the value of the feature.
+         */
+        virtual void visit(const FeatureDescriptor * feature,
+                           Holder value) = 0;
+    };
+
+    namespace detail
+    {
+        // Holder is a parameter, as it is incomplete in this header
+        template < typename F, typename H = Holder >
+        struct FunctionFeatureVisitor : FeatureVisitor
+        {
+            F& f;
+
+            FunctionFeatureVisitor(F& f_) : f(f_) {}
+
+            void visit(const FeatureDescriptor * feature, H value) override
+            {
+                f(feature, value);
+            }
+        };
+    } // namespace detail
+
     struct ClassDescriptor : TypeDescriptor
     {
         /**
@@ -188,7 +354,48 @@ namespace ref
          */
         virtual FeatureValueVector getFeatureValues(ModelClass * obj) const = 0;
 
+        /**
+         * @brief Returns an object whose features can be read while other
+         * threads write the given one: the object itself, borrowed, or
+         * for classes with a seqlock, an owned copy taken as a consistent
+         * snapshot. Paths that only read objects go through it.
+         *
+         * @param obj A non-null pointer to an instance of the class
+         * associated to this descriptor.
+         */
+        virtual Holder snapshot(ModelClass * obj) const = 0;
+
+        /**
+         * @brief Passes every feature of an object and its value to a
+         * visitor, in the order of getAllFeatureDescriptors.
+         *
+         * Unlike getFeatureValues, allocates nothing: it takes a single
+         * virtual call per feature. Values are borrowed in place, as
+         * getValue does.
+         *
+         * @param obj A non-null pointer to an instance of the class
+         * associated to this descriptor.
+         */
+        virtual void forEachFeature(ModelClass * obj,
+                                    FeatureVisitor& visitor) const = 0;
+
+        /**
+         * @brief Same as above, for a function object called with the
+         * feature descriptor and a holder borrowing its value.
+         */
+        template < typename F,
+                   typename = typename std::enable_if< !std::is_base_of<
+                       FeatureVisitor,
+                       typename std::decay< F >::type >::value >::type >
+        void forEachFeature(ModelClass * obj, F&& f) const
+        {
+            detail::FunctionFeatureVisitor< F > visitor(f);
+            forEachFeature(obj, static_cast< FeatureVisitor& >(visitor));
+        }
+
         Kind getKind() const { return kClass; }
+
+        void accept(TypeVisitor& visitor) const { visitor.visit(this); }
     };
 
     struct ContainerTypeDescriptor : TypeDescriptor
@@ -219,12 +426,36 @@ namespace ref
 
     struct ListTypeDescriptor : ContainerTypeDescriptor
     {
+        virtual std::size_t getSize(Holder h) const = 0;
+
+        /**
+         * @brief Resizes the list in place. The remaining elements and the
+         * capacity of the list are kept, so a list can be refilled element
+         * by element without allocating.
+         *
+         * Fixed-size lists, such as std::array, keep their size: elements
+         * past the requested size are reset to their default value. Lists
+         * of fixed capacity, such as boost::container::static_vector, do
+         * not grow past it.
+         */
+        virtual void resize(Holder h, std::size_t size) const = 0;
+
+        /**
+         * @brief Returns a holder pointing to the element at the given
+         * index, which must be lower than the size of the list.
+         */
+        virtual Holder getElement(Holder h, std::size_t index) const = 0;
+
         Kind getKind() const { return kList; }
+
+        void accept(TypeVisitor& visitor) const { visitor.visit(this); }
     };
 
     struct SetTypeDescriptor : ContainerTypeDescriptor
     {
         Kind getKind() const { return kSet; }
+
+        void accept(TypeVisitor& visitor) const { visitor.visit(this); }
     };
 
     struct PairTypeDescriptor : TypeDescriptor
@@ -236,6 +467,8 @@ namespace ref
         virtual std::pair< Holder, Holder > getValue(Holder h) const = 0;
 
         Kind getKind() const { return kPair; }
+
+        void accept(TypeVisitor& visitor) const { visitor.visit(this); }
     };
 
     struct MapTypeDescriptor : ContainerTypeDescriptor
@@ -245,23 +478,134 @@ namespace ref
         virtual const TypeDescriptor * getMappedTypeDescriptor() const = 0;
 
         Kind getKind() const { return kMap; }
+
+        void accept(TypeVisitor& visitor) const { visitor.visit(this); }
     };
 
     struct PointerTypeDescriptor : TypeDescriptor
     {
-        enum PointerType { kRaw, kUnique, kShared, kWeak };
+        /**
+         * @brief Kind of pointer. std::optional is described as a pointer
+         * of kind kOptional, which owns the value it contains, if any.
+         */
+        enum PointerType { kRaw, kUnique, kShared, kWeak, kOptional };
 
         virtual PointerType getPointerType() const = 0;
 
+        /**
+         * @brief True if the pointer owns the instance it points to, so
+         * that it is part of the value of the pointer.
+         */
+        bool isOwner() const
+        {
+            const PointerType type = getPointerType();
+            return type == kUnique || type == kShared || type == kOptional;
+        }
+
         virtual const TypeDescriptor * getPointedTypeDescriptor() const = 0;
 
         virtual bool isNull(Holder h) const = 0;
 
         virtual Holder dereference(Holder h) const = 0;
 
+        /**
+         * @brief Creates a new instance and makes the pointer contained
+         * in h point to it.
+         *
+         * Shared and unique pointers take ownership of the new instance.
+         * For raw pointers the caller is responsible for deleting it.
+         * Optional values construct it in place, so it must be of the
+         * pointed type.
+         *
+         * @param h A holder containing a pointer of the associated type.
+         * @param desc The type of the new instance: either the pointed
+         * type or, for classes, a subclass of it. The pointed type if null.
+         *
+         * @return A holder referencing the new instance. An invalid holder
+         * for weak pointers, abstract classes and incompatible types.
+         */
+        virtual Holder emplace(Holder h, const TypeDescriptor * desc) const = 0;
+
+        /**
+         * @brief Makes the pointer contained in h null, releasing the
+         * instance it owns, if any.
+         */
+        virtual void reset(Holder h) const = 0;
+
+        /**
+         * @brief Returns the number of shared pointers that own the
+         * instance the pointer contained in h points to. For pointers
+         * other than shared and weak ones, 1 if not null.
+         */
+        virtual std::size_t getUseCount(Holder h) const = 0;
+
+        /**
+         * @brief Returns the ownership of the instance a shared pointer
+         * points to, so that other shared pointers can share it, whatever
+         * their type. Null for other pointers and for null ones.
+         */
+        virtual std::shared_ptr<void> getOwnership(Holder h) const = 0;
+
+        /**
+         * @brief Makes the shared pointer contained in h point to the
+         * instance in value, sharing an ownership of it returned by
+         * getOwnership.
+         *
+         * @return false if the pointer is not a shared pointer or value
+         * is neither an instance of the pointed type nor, for classes, of
+         * a subclass of it.
+         */
+        virtual bool share(Holder h, const std::shared_ptr<void>& ownership,
+                           Holder value) const = 0;
+
         Kind getKind() const { return kPointer; }
+
+        void accept(TypeVisitor& visitor) const { visitor.visit(this); }
     };
 
+    /**
+     * @brief Calls f with desc as a pointer to its concrete kind: one of
+     * the descriptors that TypeVisitor receives.
+     *
+     * If the static type of desc is already one of them, or derives from
+     * one, f is called directly. Otherwise a single virtual call to accept
+     * finds the kind, and f is called from a final visitor, without a
+     * switch on getKind nor a cast in the caller.
+     *
+     * @param desc A non-null descriptor.
+     * @param f A function object callable with every concrete kind, such
+     * as a generic lambda or an object with overloads of operator().
+     */
+    template < typename D, typename F >
+    void visitType(const D * desc, F&& f)
+    {
+        static_assert(std::is_base_of< TypeDescriptor, D >::value,
+                      "Not a type descriptor");
+
+        if constexpr (std::is_base_of< ClassDescriptor, D >::value)
+            f(static_cast< const ClassDescriptor * >(desc));
+        else if constexpr (std::is_base_of< PrimitiveTypeDescriptor, D >::value)
+            f(static_cast< const PrimitiveTypeDescriptor * >(desc));
+        else if constexpr (std::is_base_of< ListTypeDescriptor, D >::value)
+            f(static_cast< const ListTypeDescriptor * >(desc));
+        else if constexpr (std::is_base_of< SetTypeDescriptor, D >::value)
+            f(static_cast< const SetTypeDescriptor * >(desc));
+        else if constexpr (std::is_base_of< MapTypeDescriptor, D >::value)
+            f(static_cast< const MapTypeDescriptor * >(desc));
+        else if constexpr (std::is_base_of< PairTypeDescriptor, D >::value)
+            f(static_cast< const PairTypeDescriptor * >(desc));
+        else if constexpr (std::is_base_of< PointerTypeDescriptor, D >::value)
+            f(static_cast< const PointerTypeDescriptor * >(desc));
+        else if constexpr (std::is_base_of< UnsupportedTypeDescriptor,
+                                            D >::value)
+            f(static_cast< const UnsupportedTypeDescriptor * >(desc));
+        else
+        {
+            detail::FunctionTypeVisitor< F > visitor(f);
+            desc->accept(visitor);
+        }
+    }
+
 } // namespace ref
 
 #endif // REF_DESCRIPTORS_HPP
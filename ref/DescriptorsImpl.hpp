@@ -1,10 +1,18 @@
 #ifndef REF_DESCRIPTORS_IMPL_HPP
 #define REF_DESCRIPTORS_IMPL_HPP
 
+#include <array>
+#include <deque>
 #include <map>
 #include <set>
 #include <memory>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
 #include <ref/Descriptors.hpp>
+#include <ref/InternedString.hpp>
+#include <boost/container/small_vector.hpp>
+#include <boost/container/static_vector.hpp>
 #include <boost/type_traits.hpp>
 #include <boost/utility.hpp>
 
@@ -20,11 +28,22 @@ namespace ref
         std::string getFqn() const override;
 
         std::string getXmlTag() const override;
+
+        std::uint64_t getTypeId() const override;
+    };
+
+    template <typename Descriptor, typename Impl, typename T>
+    struct TypeDescriptorImplBase : DescriptorImplBase<Descriptor, Impl, T>
+    {
+        std::size_t getTypeSize() const override;
+
+        std::size_t getHeapSize(Holder h) const override;
     };
 
     template <typename Class>
     struct ClassDescriptorImpl
-        : DescriptorImplBase<ClassDescriptor, ClassDescriptorImpl<Class>, Class>
+        : TypeDescriptorImplBase<ClassDescriptor, ClassDescriptorImpl<Class>,
+                                 Class>
     {
         ClassDescriptorImpl();
 
@@ -50,17 +69,40 @@ namespace ref
 
         FeatureValueVector getFeatureValues(ModelClass* obj) const override;
 
+        Holder snapshot(ModelClass* obj) const override;
+
+        void forEachFeature(ModelClass* obj,
+                            FeatureVisitor& visitor) const override;
+
+        using ClassDescriptor::forEachFeature;
+
         static const ClassDescriptorImpl* instance();
 
     protected:
         struct Initializer;
+        struct CopyPlanBuilder;
 
         typedef std::map<std::string, const FeatureDescriptor*>
             FeatureDescriptorMap;
 
+        /**
+         * @brief Copies a feature value located at the same offset in
+         * two objects. Trivially copyable runs of features have no copy
+         * function and are copied as a single block of size bytes.
+         */
+        struct CopyStep
+        {
+            std::size_t offset;
+            std::size_t size;
+            void (*copy)(const char* src, char* dst);
+        };
+
+        typedef std::vector<CopyStep> CopyPlan;
+
         FeatureDescriptorVector m_featureVec;
         FeatureDescriptorVector m_allFeatureVec;
         FeatureDescriptorMap m_featureMap;
+        CopyPlan m_copyPlan;
     };
 
     template <typename Class, typename Feature>
@@ -72,20 +114,27 @@ namespace ref
 
         Holder getValue(ModelClass* obj) const override;
 
+        void setValue(ModelClass* obj, Holder value) const override;
+
         ModelClass * getObject(Holder h) const override;
 
+        std::size_t getOffset() const override;
+
         const ClassDescriptor* getDefinedIn() const override;
     };
 
     template <typename T>
     struct PrimitiveTypeDescriptorImpl
-        : DescriptorImplBase<PrimitiveTypeDescriptor,
-                             PrimitiveTypeDescriptorImpl<T>, T>
+        : TypeDescriptorImplBase<PrimitiveTypeDescriptor,
+                                 PrimitiveTypeDescriptorImpl<T>, T>
     {
         Holder create() const override;
 
         void copy(Holder src, Holder dst) const override;
 
+        PrimitiveTypeDescriptor::PrimitiveKind getPrimitiveKind()
+            const override;
+
         std::string getString(Holder h) const override;
 
         void setString(Holder h, const std::string& value) const override;
@@ -93,7 +142,8 @@ namespace ref
 
     template <typename T>
     struct ListTypeDescriptorImpl
-        : DescriptorImplBase<ListTypeDescriptor, ListTypeDescriptorImpl<T>, T>
+        : TypeDescriptorImplBase<ListTypeDescriptor,
+                                 ListTypeDescriptorImpl<T>, T>
     {
         Holder create() const override;
 
@@ -105,11 +155,18 @@ namespace ref
 
         void setValue(Holder h,
                       const std::vector<Holder>& value) const override;
+
+        std::size_t getSize(Holder h) const override;
+
+        void resize(Holder h, std::size_t size) const override;
+
+        Holder getElement(Holder h, std::size_t index) const override;
     };
 
     template <typename T>
     struct SetTypeDescriptorImpl
-        : DescriptorImplBase<SetTypeDescriptor, SetTypeDescriptorImpl<T>, T>
+        : TypeDescriptorImplBase<SetTypeDescriptor,
+                                 SetTypeDescriptorImpl<T>, T>
     {
         Holder create() const override;
 
@@ -125,7 +182,8 @@ namespace ref
 
     template <typename T>
     struct MapTypeDescriptorImpl
-        : DescriptorImplBase<MapTypeDescriptor, MapTypeDescriptorImpl<T>, T>
+        : TypeDescriptorImplBase<MapTypeDescriptor,
+                                 MapTypeDescriptorImpl<T>, T>
     {
         typedef std::pair<typename T::key_type, typename T::mapped_type>
             value_type;
@@ -148,7 +206,8 @@ namespace ref
 
     template <typename T>
     struct PairTypeDescriptorImpl
-        : DescriptorImplBase<PairTypeDescriptor, PairTypeDescriptorImpl<T>, T>
+        : TypeDescriptorImplBase<PairTypeDescriptor,
+                                 PairTypeDescriptorImpl<T>, T>
     {
         Holder create() const override;
 
@@ -163,8 +222,8 @@ namespace ref
 
     template <typename T>
     struct PointerTypeDescriptorImpl
-        : DescriptorImplBase<PointerTypeDescriptor,
-                             PointerTypeDescriptorImpl<T>, T>
+        : TypeDescriptorImplBase<PointerTypeDescriptor,
+                                 PointerTypeDescriptorImpl<T>, T>
     {
         Holder create() const override;
 
@@ -177,12 +236,23 @@ namespace ref
         bool isNull(Holder h) const override;
 
         Holder dereference(Holder h) const override;
+
+        Holder emplace(Holder h, const TypeDescriptor* desc) const override;
+
+        void reset(Holder h) const override;
+
+        std::size_t getUseCount(Holder h) const override;
+
+        std::shared_ptr<void> getOwnership(Holder h) const override;
+
+        bool share(Holder h, const std::shared_ptr<void>& ownership,
+                   Holder value) const override;
     };
 
     template <typename T>
     struct UnsupportedTypeDescriptorImpl
-        : DescriptorImplBase<UnsupportedTypeDescriptor,
-                             UnsupportedTypeDescriptorImpl<T>, T>
+        : TypeDescriptorImplBase<UnsupportedTypeDescriptor,
+                                 UnsupportedTypeDescriptorImpl<T>, T>
     {
         Holder create() const override;
 
@@ -211,6 +281,12 @@ namespace ref
             typedef PrimitiveTypeDescriptorImpl<std::string> type;
         };
 
+        template <>
+        struct GetDescriptorType<InternedString>
+        {
+            typedef PrimitiveTypeDescriptorImpl<InternedString> type;
+        };
+
         template <typename T>
         struct GetDescriptorType<
             T, typename boost::enable_if<
@@ -237,12 +313,58 @@ namespace ref
             typedef ListTypeDescriptorImpl<std::vector<T> > type;
         };
 
+        template <typename K, typename T>
+        struct GetDescriptorType<std::unordered_map<K, T> >
+        {
+            typedef MapTypeDescriptorImpl<std::unordered_map<K, T> > type;
+        };
+
+        template <typename T>
+        struct GetDescriptorType<std::deque<T> >
+        {
+            typedef ListTypeDescriptorImpl<std::deque<T> > type;
+        };
+
+        template <typename T, std::size_t N>
+        struct GetDescriptorType<std::array<T, N> >
+        {
+            typedef ListTypeDescriptorImpl<std::array<T, N> > type;
+        };
+
+        /**
+         * Small vectors keep up to N elements inline, without allocating.
+         */
+        template <typename T, std::size_t N, typename A, typename O>
+        struct GetDescriptorType<boost::container::small_vector<T, N, A, O> >
+        {
+            typedef ListTypeDescriptorImpl<
+                boost::container::small_vector<T, N, A, O> >
+                type;
+        };
+
+        /**
+         * Static vectors never allocate and hold at most N elements.
+         */
+        template <typename T, std::size_t N, typename O>
+        struct GetDescriptorType<boost::container::static_vector<T, N, O> >
+        {
+            typedef ListTypeDescriptorImpl<
+                boost::container::static_vector<T, N, O> >
+                type;
+        };
+
         template <typename T>
         struct GetDescriptorType<std::set<T> >
         {
             typedef SetTypeDescriptorImpl<std::set<T> > type;
         };
 
+        template <typename T>
+        struct GetDescriptorType<std::unordered_set<T> >
+        {
+            typedef SetTypeDescriptorImpl<std::unordered_set<T> > type;
+        };
+
         template <typename T>
         struct GetDescriptorType<T*>
         {
@@ -266,6 +388,12 @@ namespace ref
         {
             typedef PointerTypeDescriptorImpl<std::weak_ptr<T> > type;
         };
+
+        template <typename T>
+        struct GetDescriptorType<std::optional<T> >
+        {
+            typedef PointerTypeDescriptorImpl<std::optional<T> > type;
+        };
     }  // namespace detail
 
 }  // namespace ref
@@ -4,12 +4,16 @@
 #include <ref/Class.hpp>
 #include <ref/DescriptorsImpl.hpp>
 #include <ref/Holder.hpp>
+#include <ref/DescriptorRegistry.hpp>
+#include <ref/Instrumentation.hpp>
 #include <ref/detail/Name.hpp>
 #include <iterator>
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
-#include <boost/mpl/for_each.hpp>
+#include <cstring>
+#include <utility>
+#include <type_traits>
 #include <boost/lexical_cast.hpp>
 
 namespace ref
@@ -24,22 +28,141 @@ namespace ref
     template <typename Descriptor, typename Impl, typename T>
     std::string DescriptorImplBase<Descriptor, Impl, T>::getName() const
     {
-        static const std::string name = detail::get_name<T>();
-        return name;
+        return detail::get_name<T>();
     }
 
     template <typename Descriptor, typename Impl, typename T>
     std::string DescriptorImplBase<Descriptor, Impl, T>::getFqn() const
     {
-        static const std::string fqn = detail::get_fqn<T>();
-        return fqn;
+        return detail::get_fqn<T>();
     }
 
     template <typename Descriptor, typename Impl, typename T>
     std::string DescriptorImplBase<Descriptor, Impl, T>::getXmlTag() const
     {
-        static const std::string tag = detail::convert_to_xmltag(getName());
-        return tag;
+        return detail::get_xmltag<T>();
+    }
+
+    template <typename Descriptor, typename Impl, typename T>
+    std::uint64_t DescriptorImplBase<Descriptor, Impl, T>::getTypeId() const
+    {
+        return detail::TypeName<T>::id;
+    }
+
+    namespace detail
+    {
+        /**
+         * @brief Estimates of the memory allocated by the standard
+         * containers, after the layout of libstdc++. Allocator overhead is
+         * not included.
+         */
+        template <typename T>
+        struct heap_size
+        {
+            static std::size_t get(const T&) { return 0; }
+        };
+
+        template <>
+        struct heap_size<std::string>
+        {
+            static std::size_t get(const std::string& s)
+            {
+                // Short strings are stored within the object
+                const char* begin = reinterpret_cast<const char*>(&s);
+                if (s.data() >= begin && s.data() < begin + sizeof(s))
+                    return 0;
+                return s.capacity() + 1;
+            }
+        };
+
+        template <typename T>
+        struct heap_size<std::vector<T> >
+        {
+            static std::size_t get(const std::vector<T>& v)
+            {
+                return v.capacity() * sizeof(T);
+            }
+        };
+
+        template <typename T>
+        struct heap_size<std::deque<T> >
+        {
+            static std::size_t get(const std::deque<T>& v)
+            {
+                // Blocks of 512 bytes and the map of blocks, of at least 8
+                const std::size_t perBlock =
+                    sizeof(T) < 512 ? 512 / sizeof(T) : 1;
+                const std::size_t blocks = v.size() / perBlock + 1;
+                return blocks * perBlock * sizeof(T) +
+                       std::max<std::size_t>(8, blocks + 2) * sizeof(void*);
+            }
+        };
+
+        template <typename T, std::size_t N, typename A, typename O>
+        struct heap_size<boost::container::small_vector<T, N, A, O> >
+        {
+            static std::size_t get(
+                const boost::container::small_vector<T, N, A, O>& v)
+            {
+                return v.capacity() > N ? v.capacity() * sizeof(T) : 0;
+            }
+        };
+
+        // Color and three links per node of the red-black tree
+        template <typename Value>
+        struct tree_heap_size
+        {
+            template <typename C>
+            static std::size_t get(const C& c)
+            {
+                return c.size() * (sizeof(Value) + 4 * sizeof(void*));
+            }
+        };
+
+        // A link and the cached hash per node, and the buckets
+        template <typename Value>
+        struct hash_heap_size
+        {
+            template <typename C>
+            static std::size_t get(const C& c)
+            {
+                const std::size_t node =
+                    sizeof(Value) + sizeof(void*) + sizeof(std::size_t);
+                return c.size() * node + c.bucket_count() * sizeof(void*);
+            }
+        };
+
+        template <typename T>
+        struct heap_size<std::set<T> > : tree_heap_size<T>
+        {};
+
+        template <typename K, typename T>
+        struct heap_size<std::map<K, T> >
+            : tree_heap_size<std::pair<const K, T> >
+        {};
+
+        template <typename T>
+        struct heap_size<std::unordered_set<T> > : hash_heap_size<T>
+        {};
+
+        template <typename K, typename T>
+        struct heap_size<std::unordered_map<K, T> >
+            : hash_heap_size<std::pair<const K, T> >
+        {};
+    }  // namespace detail
+
+    template <typename Descriptor, typename Impl, typename T>
+    std::size_t TypeDescriptorImplBase<Descriptor, Impl, T>::getTypeSize()
+        const
+    {
+        return sizeof(T);
+    }
+
+    template <typename Descriptor, typename Impl, typename T>
+    std::size_t TypeDescriptorImplBase<Descriptor, Impl, T>::getHeapSize(
+        Holder h) const
+    {
+        return detail::heap_size<T>::get(*h.get<T>());
     }
 
     // ClassDescriptorImpl
@@ -65,6 +188,32 @@ namespace ref
         {
             static const ClassDescriptor* get() { return nullptr; }
         };
+
+        template <>
+        struct BaseClassDescriptor<LazyModelClass>
+        {
+            static const ClassDescriptor* get() { return nullptr; }
+        };
+
+        template <>
+        struct BaseClassDescriptor<SeqLockModelClass>
+        {
+            static const ClassDescriptor* get() { return nullptr; }
+        };
+
+        /**
+         * @brief Its dynamic initialization constructs, and thereby
+         * registers, the descriptor of Class at load time.
+         */
+        template <typename Class>
+        struct ClassRegistration
+        {
+            static const bool registered;
+        };
+
+        template <typename Class>
+        const bool ClassRegistration<Class>::registered =
+            (ClassDescriptorImpl<Class>::instance(), true);
     }  // namespace detail
 
     template <typename Class>
@@ -75,7 +224,7 @@ namespace ref
         Initializer(ClassDescriptorImpl& d_) : d(d_) {}
 
         template <typename Feature>
-        void operator()(Feature) const
+        void operator()(Feature*) const
         {
             const FeatureDescriptor* feature =
                 FeatureDescriptorImpl<Class, Feature>::instance();
@@ -84,10 +233,122 @@ namespace ref
         }
     };
 
+    namespace detail
+    {
+        template <typename Feature>
+        struct IsTriviallyCopyableFeature
+            : boost::integral_constant<
+                  bool,
+                  std::is_trivially_copyable<typename Feature::type>::value>
+        {
+        };
+
+        template <typename Features>
+        struct AreTriviallyCopyableFeatures;
+
+        template <typename... Features>
+        struct AreTriviallyCopyableFeatures<TypeList<Features...> >
+            : boost::integral_constant<
+                  bool, (IsTriviallyCopyableFeature<Features>::value && ...)>
+        {
+        };
+
+        /**
+         * @brief True if every feature of Class, including inherited ones,
+         * is trivially copyable.
+         */
+        template <typename Class>
+        struct IsTriviallyCopyableClass
+            : AreTriviallyCopyableFeatures<typename Class::all_features_type>
+        {
+        };
+
+        /**
+         * @brief Returns the offset of the value of Feature within Feature.
+         *
+         * Same as offsetof, which is not supported for features whose
+         * type is not standard-layout.
+         */
+        template <typename Feature>
+        std::size_t getValueOffset()
+        {
+            typename std::aligned_storage<sizeof(Feature),
+                                          alignof(Feature)>::type storage;
+            Feature* feature = reinterpret_cast<Feature*>(&storage);
+
+            return reinterpret_cast<const char*>(&feature->value) -
+                   reinterpret_cast<const char*>(feature);
+        }
+
+        /**
+         * @brief Returns the offset of the value of Feature relative to
+         * the ModelClass sub-object of Class.
+         */
+        template <typename Class, typename Feature>
+        std::size_t getFeatureOffset()
+        {
+            // Only derived-to-base conversions are performed on the
+            // storage, no object is ever accessed.
+            typename std::aligned_storage<sizeof(Class),
+                                          alignof(Class)>::type storage;
+            Class* obj = reinterpret_cast<Class*>(&storage);
+
+            const char* base =
+                reinterpret_cast<const char*>(static_cast<ModelClass*>(obj));
+            const char* value =
+                reinterpret_cast<const char*>(static_cast<Feature*>(obj)) +
+                getValueOffset<Feature>();
+
+            return value - base;
+        }
+
+        /**
+         * @brief Returns a reference to the value of Feature in obj, as
+         * Class::get does, except for classes with a seqlock, for which
+         * get returns copies.
+         */
+        template <typename Feature, typename Class>
+        typename Feature::type& getValueInPlace(Class* obj)
+        {
+            if constexpr (std::is_base_of<SeqLockModelClass, Class>::value)
+                return static_cast<Feature*>(obj)->value;
+            else
+                return obj->template get<Feature>();
+        }
+
+        template <typename T>
+        void copyValue(const char* src, char* dst)
+        {
+            *reinterpret_cast<T*>(dst) = *reinterpret_cast<const T*>(src);
+        }
+    }  // namespace detail
+
+    template <typename Class>
+    struct ClassDescriptorImpl<Class>::CopyPlanBuilder
+    {
+        ClassDescriptorImpl& d;
+
+        CopyPlanBuilder(ClassDescriptorImpl& d_) : d(d_) {}
+
+        template <typename Feature>
+        void operator()(Feature*) const
+        {
+            typedef typename Feature::type type;
+
+            CopyStep step;
+            step.offset = detail::getFeatureOffset<Class, Feature>();
+            step.size = sizeof(type);
+            step.copy = detail::IsTriviallyCopyableFeature<Feature>::value
+                            ? nullptr
+                            : &detail::copyValue<type>;
+            d.m_copyPlan.push_back(step);
+        }
+    };
+
     template <typename Class>
     ClassDescriptorImpl<Class>::ClassDescriptorImpl()
     {
-        boost::mpl::for_each<typename Class::features_type>(Initializer(*this));
+        ref::for_each<typename Class::features_type>(Initializer(*this));
 
         const ClassDescriptor* parent =
             detail::BaseClassDescriptor<Class>::get();
@@ -105,6 +366,32 @@ namespace ref
 
         std::copy(m_featureVec.begin(), m_featureVec.end(),
                   std::back_inserter(m_allFeatureVec));
+
+        DescriptorRegistry::instance().add(this);
+        static_cast<void>(&detail::ClassRegistration<Class>::registered);
+
+        ref::for_each<typename Class::all_features_type>(
+            CopyPlanBuilder(*this));
+        std::sort(m_copyPlan.begin(), m_copyPlan.end(),
+                  [](const CopyStep& a, const CopyStep& b) {
+                      return a.offset < b.offset;
+                  });
+
+        // Merge contiguous trivially copyable features into blocks
+        CopyPlan plan;
+        for (const auto& step : m_copyPlan)
+        {
+            if (!plan.empty() && !step.copy && !plan.back().copy &&
+                plan.back().offset + plan.back().size == step.offset)
+            {
+                plan.back().size += step.size;
+            }
+            else
+            {
+                plan.push_back(step);
+            }
+        }
+        m_copyPlan.swap(plan);
     }
 
     namespace detail
@@ -142,15 +429,61 @@ namespace ref
         if (pSrc == pDst) return;
 
         const ClassDescriptor* classDesc = pSrc->getClassDescriptor();
-        const FeatureDescriptorVector features =
-            classDesc->getAllFeatureDescriptors();
 
-        for (const auto& feature : features)
+        // The copy plan is only valid for instances of Class
+        if (classDesc != this)
+        {
+            classDesc->copy(src, dst);
+            return;
+        }
+
+        REF_INSTRUMENT(this, kCopy, 1);
+
+        // The plan copies the values as they are in memory
+        if constexpr (std::is_base_of<LazyModelClass, Class>::value)
+        {
+            static_cast<const Class*>(pSrc)->materialize();
+            static_cast<Class*>(pDst)->setLazyState(nullptr);
+        }
+
+        const char* s = reinterpret_cast<const char*>(pSrc);
+        char* d = reinterpret_cast<char*>(pDst);
+
+        const auto apply = [&] {
+            if (detail::IsTriviallyCopyableClass<Class>::value &&
+                m_copyPlan.size() == 1)
+            {
+                const CopyStep& block = m_copyPlan.front();
+                std::memcpy(d + block.offset, s + block.offset, block.size);
+                return;
+            }
+
+            for (const auto& step : m_copyPlan)
+            {
+                if (step.copy)
+                    step.copy(s + step.offset, d + step.offset);
+                else
+                    std::memcpy(d + step.offset, s + step.offset, step.size);
+            }
+        };
+
+        // A consistent snapshot of the source, published as a single
+        // write. The destination is not held while waiting for the source,
+        // so that copies in opposite directions cannot block each other.
+        if constexpr (std::is_base_of<SeqLockModelClass, Class>::value)
         {
-            Holder hSrc = feature->getValue(pSrc);
-            Holder hDst = feature->getValue(pDst);
+            const Class* source = static_cast<const Class*>(pSrc);
 
-            feature->getTypeDescriptor()->copy(hSrc, hDst);
+            for (;;)
+            {
+                const std::uint32_t sequence = source->readBegin();
+                static_cast<Class*>(pDst)->write(apply);
+                if (source->readValidate(sequence)) return;
+            }
+        }
+        else
+        {
+            apply();
         }
     }
 
@@ -220,6 +553,44 @@ namespace ref
         return values;
     }
 
+    template <typename Class>
+    Holder ClassDescriptorImpl<Class>::snapshot(ModelClass* obj) const
+    {
+        if constexpr (std::is_base_of<SeqLockModelClass, Class>::value)
+        {
+            // Copies take a consistent snapshot of the source
+            Holder res = this->create();
+            copy(Holder(obj, this), res);
+            return res;
+        }
+        else
+        {
+            return Holder(obj, this);
+        }
+    }
+
+    template <typename Class>
+    void ClassDescriptorImpl<Class>::forEachFeature(
+        ModelClass* obj, FeatureVisitor& visitor) const
+    {
+        Class* realObj = static_cast<Class*>(obj);
+
+        ref::for_each<typename Class::all_features_type>([&](auto* tag) {
+            typedef typename std::remove_pointer<decltype(tag)>::type Feature;
+            typedef typename Feature::type type;
+            typedef typename detail::FeatureDefinedIn<Class, Feature>::type
+                DefinedIn;
+
+            const FeatureDescriptor* feature =
+                FeatureDescriptorImpl<DefinedIn, Feature>::instance();
+            REF_INSTRUMENT(feature, kGetValue, 1);
+
+            visitor.visit(feature,
+                          Holder(&detail::getValueInPlace<Feature>(realObj),
+                                 TypeDescriptor::getDescriptor<type>()));
+        });
+    }
+
     // FeatureDescriptorImpl
 
     template <typename Class, typename Feature>
@@ -233,8 +604,37 @@ namespace ref
     Holder FeatureDescriptorImpl<Class, Feature>::getValue(
         ModelClass* obj) const
     {
+        REF_INSTRUMENT(this, kGetValue, 1);
+
         Class* realObj = static_cast<Class*>(obj);
-        return Holder(&realObj->template get<Feature>(), getTypeDescriptor());
+        return Holder(&detail::getValueInPlace<Feature>(realObj),
+                      getTypeDescriptor());
+    }
+
+    template <typename Class, typename Feature>
+    void FeatureDescriptorImpl<Class, Feature>::setValue(ModelClass* obj,
+                                                         Holder value) const
+    {
+        assert(obj && value.isValid());
+        assert(value.descriptor() == getTypeDescriptor());
+
+        REF_INSTRUMENT(this, kSetValue, 1);
+
+        const bool notify = detail::hasFeatureObservers();
+
+        if (notify) detail::notifyBeforeSet(obj, this);
+
+        if constexpr (std::is_base_of<SeqLockModelClass, Class>::value)
+        {
+            static_cast<Class*>(obj)->write(
+                [&] { getTypeDescriptor()->copy(value, getValue(obj)); });
+        }
+        else
+        {
+            getTypeDescriptor()->copy(value, getValue(obj));
+        }
+
+        if (notify) detail::notifyAfterSet(obj, this);
     }
 
     template <typename Class, typename Feature>
@@ -249,11 +649,17 @@ namespace ref
         type* value = h.get<type>();
 
         Feature* feature = reinterpret_cast<Feature*>(
-            reinterpret_cast<char*>(value) - offsetof(Feature, value));
+            reinterpret_cast<char*>(value) - detail::getValueOffset<Feature>());
 
         return static_cast<Class*>(feature);
     }
 
+    template <typename Class, typename Feature>
+    std::size_t FeatureDescriptorImpl<Class, Feature>::getOffset() const
+    {
+        return detail::getFeatureOffset<Class, Feature>();
+    }
+
     template <typename Class, typename Feature>
     const ClassDescriptor* FeatureDescriptorImpl<Class, Feature>::getDefinedIn()
         const
@@ -272,6 +678,8 @@ namespace ref
     template <typename T>
     void PrimitiveTypeDescriptorImpl<T>::copy(Holder src, Holder dst) const
     {
+        REF_INSTRUMENT(this, kCopy, 1);
+
         assert(src.descriptor() == this && src.get<T>());
         assert(dst.descriptor() == this && dst.get<T>());
 
@@ -284,17 +692,56 @@ namespace ref
         }
     }
 
+    namespace detail
+    {
+        template <typename T>
+        constexpr PrimitiveTypeDescriptor::PrimitiveKind getPrimitiveKind()
+        {
+            typedef PrimitiveTypeDescriptor P;
+
+            if (std::is_same<T, std::string>::value) return P::kString;
+            if (std::is_same<T, InternedString>::value)
+                return P::kInternedString;
+            if (std::is_same<T, bool>::value) return P::kBool;
+            if (std::is_same<T, char>::value) return P::kChar;
+
+            if (std::is_floating_point<T>::value)
+                return sizeof(T) == sizeof(float)
+                           ? P::kFloat
+                           : sizeof(T) == sizeof(double) ? P::kDouble
+                                                         : P::kLongDouble;
+
+            const bool s = std::is_signed<T>::value;
+            switch (sizeof(T))
+            {
+                case 1: return s ? P::kInt8 : P::kUInt8;
+                case 2: return s ? P::kInt16 : P::kUInt16;
+                case 4: return s ? P::kInt32 : P::kUInt32;
+                default: return s ? P::kInt64 : P::kUInt64;
+            }
+        }
+    }  // namespace detail
+
+    template <typename T>
+    PrimitiveTypeDescriptor::PrimitiveKind
+    PrimitiveTypeDescriptorImpl<T>::getPrimitiveKind() const
+    {
+        return detail::getPrimitiveKind<T>();
+    }
+
     template <typename T>
     std::string PrimitiveTypeDescriptorImpl<T>::getString(Holder h) const
     {
+        REF_INSTRUMENT(this, kGetString, 1);
         assert(h.descriptor() == this && h.get<T>());
         return boost::lexical_cast<std::string>(*h.get<T>());
     }
 
     template <>
-    std::string PrimitiveTypeDescriptorImpl<std::string>::getString(
+    inline std::string PrimitiveTypeDescriptorImpl<std::string>::getString(
         Holder h) const
     {
+        REF_INSTRUMENT(this, kGetString, 1);
         assert(h.descriptor() == this && h.get<std::string>());
         return *h.get<std::string>();
     }
@@ -303,18 +750,38 @@ namespace ref
     void PrimitiveTypeDescriptorImpl<T>::setString(
         Holder h, const std::string& value) const
     {
+        REF_INSTRUMENT(this, kSetString, 1);
         assert(h.descriptor() == this && h.get<T>());
         *h.get<T>() = boost::lexical_cast<T>(value);
     }
 
     template <>
-    void PrimitiveTypeDescriptorImpl<std::string>::setString(
+    inline void PrimitiveTypeDescriptorImpl<std::string>::setString(
         Holder h, const std::string& value) const
     {
+        REF_INSTRUMENT(this, kSetString, 1);
         assert(h.descriptor() == this && h.get<std::string>());
         *h.get<std::string>() = value;
     }
 
+    template <>
+    inline std::string PrimitiveTypeDescriptorImpl<InternedString>::getString(
+        Holder h) const
+    {
+        REF_INSTRUMENT(this, kGetString, 1);
+        assert(h.descriptor() == this && h.get<InternedString>());
+        return h.get<InternedString>()->str();
+    }
+
+    template <>
+    inline void PrimitiveTypeDescriptorImpl<InternedString>::setString(
+        Holder h, const std::string& value) const
+    {
+        REF_INSTRUMENT(this, kSetString, 1);
+        assert(h.descriptor() == this && h.get<InternedString>());
+        *h.get<InternedString>() = InternedString(value);
+    }
+
     // ListTypeDescriptor
 
     template <typename T>
@@ -334,6 +801,8 @@ namespace ref
     template <typename T>
     void ListTypeDescriptorImpl<T>::copy(Holder src, Holder dst) const
     {
+        REF_INSTRUMENT(this, kCopy, 1);
+
         assert(src.descriptor() == this && src.get<T>());
         assert(dst.descriptor() == this && dst.get<T>());
 
@@ -358,9 +827,68 @@ namespace ref
             value.push_back(Holder(&i, getValueTypeDescriptor()));
         }
 
+        REF_INSTRUMENT(this, kMaterializations, 1);
+        REF_INSTRUMENT(this, kMaterializedElements, value.size());
+
         return value;
     }
 
+    namespace detail
+    {
+        template <typename T>
+        struct list_traits
+        {
+            static void resize(T& t, std::size_t size) { t.resize(size); }
+        };
+
+        /**
+         * Arrays keep their size: elements past the new size are reset.
+         */
+        template <typename T, std::size_t N>
+        struct list_traits<std::array<T, N> >
+        {
+            static void resize(std::array<T, N>& t, std::size_t size)
+            {
+                for (std::size_t i = size; i < N; i++)
+                    t[i] = T();
+            }
+        };
+
+        /**
+         * Static vectors grow up to their capacity.
+         */
+        template <typename T, std::size_t N, typename O>
+        struct list_traits<boost::container::static_vector<T, N, O> >
+        {
+            static void resize(boost::container::static_vector<T, N, O>& t,
+                               std::size_t size)
+            {
+                t.resize(std::min(size, N));
+            }
+        };
+
+        template <typename T, typename = void>
+        struct has_reserve : std::false_type
+        {
+        };
+
+        template <typename T>
+        struct has_reserve<T, decltype(std::declval<T&>().reserve(0), void())>
+            : std::true_type
+        {
+        };
+
+        /**
+         * Reserves room for size elements in containers that support it,
+         * such as hashed ones, so that filling them does not rehash.
+         */
+        template <typename T>
+        void reserve(T& t, std::size_t size)
+        {
+            if constexpr (has_reserve<T>::value) t.reserve(size);
+        }
+    }  // namespace detail
+
     template <typename T>
     void ListTypeDescriptorImpl<T>::setValue(
         Holder h, const std::vector<Holder>& value) const
@@ -368,16 +896,40 @@ namespace ref
         T* t = h.get<T>();
         assert(t);
 
-        t->resize(value.size());
+        detail::list_traits<T>::resize(*t, value.size());
 
         auto valueDesc = getValueTypeDescriptor();
+        const size_t size = std::min(value.size(), t->size());
 
-        for (size_t i = 0; i < value.size(); i++)
+        for (size_t i = 0; i < size; i++)
         {
             valueDesc->copy(value[i], Holder(&(*t)[i], valueDesc));
         }
     }
 
+    template <typename T>
+    std::size_t ListTypeDescriptorImpl<T>::getSize(Holder h) const
+    {
+        assert(h.descriptor() == this && h.get<T>());
+        return h.get<T>()->size();
+    }
+
+    template <typename T>
+    void ListTypeDescriptorImpl<T>::resize(Holder h, std::size_t size) const
+    {
+        assert(h.descriptor() == this && h.get<T>());
+        detail::list_traits<T>::resize(*h.get<T>(), size);
+    }
+
+    template <typename T>
+    Holder ListTypeDescriptorImpl<T>::getElement(Holder h,
+                                                 std::size_t index) const
+    {
+        T* t = h.get<T>();
+        assert(h.descriptor() == this && t && index < t->size());
+        return Holder(&(*t)[index], getValueTypeDescriptor());
+    }
+
     // SetTypeDescriptor
 
     template <typename T>
@@ -397,6 +949,8 @@ namespace ref
     template <typename T>
     void SetTypeDescriptorImpl<T>::copy(Holder src, Holder dst) const
     {
+        REF_INSTRUMENT(this, kCopy, 1);
+
         assert(src.descriptor() == this && src.get<T>());
         assert(dst.descriptor() == this && dst.get<T>());
 
@@ -421,6 +975,9 @@ namespace ref
             value.push_back(Holder(&i, getValueTypeDescriptor()));
         }
 
+        REF_INSTRUMENT(this, kMaterializations, 1);
+        REF_INSTRUMENT(this, kMaterializedElements, value.size());
+
         return value;
     }
 
@@ -431,6 +988,7 @@ namespace ref
         T* t = h.get<T>();
         assert(t);
         t->clear();
+        detail::reserve(*t, value.size());
 
         auto valueDesc = getValueTypeDescriptor();
 
@@ -438,7 +996,7 @@ namespace ref
         {
             typename T::value_type v;
             valueDesc->copy(i, Holder(&v, valueDesc));
-            t->insert(v);
+            t->insert(std::move(v));
         }
     }
 
@@ -453,6 +1011,8 @@ namespace ref
     template <typename T>
     void MapTypeDescriptorImpl<T>::copy(Holder src, Holder dst) const
     {
+        REF_INSTRUMENT(this, kCopy, 1);
+
         assert(src.descriptor() == this && src.get<T>());
         assert(dst.descriptor() == this && dst.get<T>());
 
@@ -499,6 +1059,9 @@ namespace ref
             value.push_back(Holder(&i, getValueTypeDescriptor()));
         }
 
+        REF_INSTRUMENT(this, kMaterializations, 1);
+        REF_INSTRUMENT(this, kMaterializedElements, value.size());
+
         return value;
     }
 
@@ -509,6 +1072,7 @@ namespace ref
         T* t = h.get<T>();
         assert(t);
         t->clear();
+        detail::reserve(*t, value.size());
 
         auto valueDesc = getValueTypeDescriptor();
 
@@ -516,7 +1080,7 @@ namespace ref
         {
             value_type v;
             valueDesc->copy(i, Holder(&v, valueDesc));
-            t->insert(v);
+            t->insert(std::move(v));
         }
     }
 
@@ -531,6 +1095,8 @@ namespace ref
     template <typename T>
     void PairTypeDescriptorImpl<T>::copy(Holder src, Holder dst) const
     {
+        REF_INSTRUMENT(this, kCopy, 1);
+
         assert(src.descriptor() == this && src.get<T>());
         assert(dst.descriptor() == this && dst.get<T>());
 
@@ -577,12 +1143,14 @@ namespace ref
     template <typename T>
     Holder PointerTypeDescriptorImpl<T>::create() const
     {
-        return Holder(new T, this, true);
+        return Holder(new T(), this, true);
     }
 
     template <typename T>
     void PointerTypeDescriptorImpl<T>::copy(Holder src, Holder dst) const
     {
+        REF_INSTRUMENT(this, kCopy, 1);
+
         assert(src.descriptor() == this && src.get<T>());
         assert(dst.descriptor() == this && dst.get<T>());
 
@@ -610,6 +1178,16 @@ namespace ref
             };
 
             static T* get(T* t) { return t; }
+
+            static bool reset(T*& p, T* t)
+            {
+                p = t;
+                return true;
+            }
+
+            static void clear(T*& p) { p = nullptr; }
+
+            static std::size_t use_count(T* p) { return p ? 1 : 0; }
         };
 
         template <typename T>
@@ -621,7 +1199,20 @@ namespace ref
                 pointer_type = PointerTypeDescriptor::kShared
             };
 
-            static T* get(std::shared_ptr<T> t) { return t.get(); }
+            static T* get(const std::shared_ptr<T>& t) { return t.get(); }
+
+            static bool reset(std::shared_ptr<T>& p, T* t)
+            {
+                p.reset(t);
+                return true;
+            }
+
+            static void clear(std::shared_ptr<T>& p) { p.reset(); }
+
+            static std::size_t use_count(const std::shared_ptr<T>& p)
+            {
+                return p.use_count();
+            }
         };
 
         template <typename T>
@@ -633,7 +1224,17 @@ namespace ref
                 pointer_type = PointerTypeDescriptor::kWeak
             };
 
-            static T* get(std::weak_ptr<T> t) { return t.lock().get(); }
+            static T* get(const std::weak_ptr<T>& t) { return t.lock().get(); }
+
+            // Weak pointers cannot own a new instance
+            static bool reset(std::weak_ptr<T>&, T*) { return false; }
+
+            static void clear(std::weak_ptr<T>& p) { p.reset(); }
+
+            static std::size_t use_count(const std::weak_ptr<T>& p)
+            {
+                return p.use_count();
+            }
         };
 
         template <typename T>
@@ -642,10 +1243,178 @@ namespace ref
             typedef T element_type;
             enum
             {
-                pointer_type = PointerTypeDescriptor::kShared
+                pointer_type = PointerTypeDescriptor::kUnique
             };
 
-            static T* get(std::unique_ptr<T> t) { return t.get(); }
+            static T* get(const std::unique_ptr<T>& t) { return t.get(); }
+
+            static bool reset(std::unique_ptr<T>& p, T* t)
+            {
+                p.reset(t);
+                return true;
+            }
+
+            static void clear(std::unique_ptr<T>& p) { p.reset(); }
+
+            static std::size_t use_count(const std::unique_ptr<T>& p)
+            {
+                return p ? 1 : 0;
+            }
+        };
+
+        template <typename T>
+        struct pointer_traits<std::optional<T> >
+        {
+            typedef T element_type;
+            enum
+            {
+                pointer_type = PointerTypeDescriptor::kOptional
+            };
+
+            static T* get(std::optional<T>& t) { return t ? &*t : nullptr; }
+
+            static const T* get(const std::optional<T>& t)
+            {
+                return t ? &*t : nullptr;
+            }
+
+            static void clear(std::optional<T>& p) { p.reset(); }
+
+            static std::size_t use_count(const std::optional<T>& p)
+            {
+                return p ? 1 : 0;
+            }
+        };
+
+        template <typename T, typename Enabled = void>
+        struct NewInstance
+        {
+            static T* call(const TypeDescriptor* desc)
+            {
+                return desc == TypeDescriptor::getDescriptor<T>() ? new T()
+                                                                 : nullptr;
+            }
+        };
+
+        template <typename T>
+        struct NewInstance<T, typename boost::enable_if<typename boost::is_base_of<
+                                  ModelClass, T>::type>::type>
+        {
+            static T* call(const TypeDescriptor* desc)
+            {
+                if (desc->getKind() != TypeDescriptor::kClass) return nullptr;
+
+                const ClassDescriptor* base = ClassDescriptorImpl<T>::instance();
+                const ClassDescriptor* classDesc = desc->as<ClassDescriptor>();
+                const ClassDescriptor* current = classDesc;
+
+                while (current && current != base)
+                    current = current->getParentClassDescriptor();
+
+                if (!current) return nullptr;
+
+                Holder h = classDesc->create();
+                return static_cast<T*>(h.release<ModelClass>());
+            }
+        };
+
+        /**
+         * Points p to a new instance of the type described by desc.
+         */
+        template <typename T>
+        struct EmplacePointer
+        {
+            typedef typename pointer_traits<T>::element_type element_type;
+
+            static element_type* call(T& p, const TypeDescriptor* desc)
+            {
+                element_type* t = NewInstance<element_type>::call(desc);
+                if (t) pointer_traits<T>::reset(p, t);
+                return t;
+            }
+        };
+
+        /**
+         * Returns the instance in h as a T, or null if it is not one.
+         */
+        template <typename T, typename Enabled = void>
+        struct CastInstance
+        {
+            static T* call(Holder h)
+            {
+                return h.descriptor() == TypeDescriptor::getDescriptor<T>()
+                           ? h.get<T>()
+                           : nullptr;
+            }
+        };
+
+        template <typename T>
+        struct CastInstance<T, typename boost::enable_if<typename boost::is_base_of<
+                                   ModelClass, T>::type>::type>
+        {
+            static T* call(Holder h)
+            {
+                if (h.descriptor()->getKind() != TypeDescriptor::kClass)
+                    return nullptr;
+
+                const ClassDescriptor* base = ClassDescriptorImpl<T>::instance();
+                const ClassDescriptor* classDesc =
+                    h.descriptor()->as<ClassDescriptor>();
+                const ClassDescriptor* current = classDesc;
+
+                while (current && current != base)
+                    current = current->getParentClassDescriptor();
+
+                return current ? static_cast<T*>(classDesc->get(h)) : nullptr;
+            }
+        };
+
+        /**
+         * Ownership shared among shared pointers of any type.
+         */
+        template <typename T>
+        struct SharedOwnership
+        {
+            static std::shared_ptr<void> get(const T&) { return nullptr; }
+
+            template <typename U>
+            static bool share(T&, const std::shared_ptr<void>&, U*)
+            {
+                return false;
+            }
+        };
+
+        template <typename T>
+        struct SharedOwnership<std::shared_ptr<T> >
+        {
+            static std::shared_ptr<void> get(const std::shared_ptr<T>& p)
+            {
+                return p;
+            }
+
+            static bool share(std::shared_ptr<T>& p,
+                              const std::shared_ptr<void>& ownership, T* t)
+            {
+                p = std::shared_ptr<T>(ownership, t);
+                return true;
+            }
+        };
+
+        /**
+         * Optional values are constructed in place, so they cannot hold
+         * instances of derived types.
+         */
+        template <typename T>
+        struct EmplacePointer<std::optional<T> >
+        {
+            static T* call(std::optional<T>& p, const TypeDescriptor* desc)
+            {
+                if (desc != GetDescriptorType<T>::type::instance())
+                    return nullptr;
+
+                p.emplace();
+                return &*p;
+            }
         };
     }  // namespace detail
 
@@ -671,7 +1440,7 @@ namespace ref
         assert(h.descriptor() == this && h.get<T>());
 
         T* ph = h.get<T>();
-        return detail::pointer_traits<T>::get(*ph);
+        return !detail::pointer_traits<T>::get(*ph);
     }
 
     template <typename T>
@@ -684,6 +1453,59 @@ namespace ref
                       getPointedTypeDescriptor());
     }
 
+    template <typename T>
+    Holder PointerTypeDescriptorImpl<T>::emplace(Holder h,
+                                                 const TypeDescriptor* desc) const
+    {
+        assert(h.descriptor() == this && h.get<T>());
+
+        if (getPointerType() == PointerTypeDescriptor::kWeak) return Holder();
+
+        if (!desc) desc = getPointedTypeDescriptor();
+
+        auto t = detail::EmplacePointer<T>::call(*h.get<T>(), desc);
+        if (!t) return Holder();
+
+        return Holder(t, desc);
+    }
+
+    template <typename T>
+    void PointerTypeDescriptorImpl<T>::reset(Holder h) const
+    {
+        assert(h.descriptor() == this && h.get<T>());
+
+        detail::pointer_traits<T>::clear(*h.get<T>());
+    }
+
+    template <typename T>
+    std::size_t PointerTypeDescriptorImpl<T>::getUseCount(Holder h) const
+    {
+        assert(h.descriptor() == this && h.get<T>());
+
+        return detail::pointer_traits<T>::use_count(*h.get<T>());
+    }
+
+    template <typename T>
+    std::shared_ptr<void> PointerTypeDescriptorImpl<T>::getOwnership(
+        Holder h) const
+    {
+        assert(h.descriptor() == this && h.get<T>());
+
+        return detail::SharedOwnership<T>::get(*h.get<T>());
+    }
+
+    template <typename T>
+    bool PointerTypeDescriptorImpl<T>::share(
+        Holder h, const std::shared_ptr<void>& ownership, Holder value) const
+    {
+        assert(h.descriptor() == this && h.get<T>());
+
+        typedef typename detail::pointer_traits<T>::element_type element_type;
+        element_type* t = detail::CastInstance<element_type>::call(value);
+        return t && ownership &&
+               detail::SharedOwnership<T>::share(*h.get<T>(), ownership, t);
+    }
+
     // UnsupportedTypeDescriptor
 
     template <typename T>
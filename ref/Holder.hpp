@@ -2,63 +2,104 @@
 #define REF_HOLDER_HPP
 
 #include <memory>
+#include <ref/Instrumentation.hpp>
+
+#ifdef REF_ENABLE_INSTRUMENTATION
+#include <ref/Descriptors.hpp>
+#endif
 
 namespace ref
 {
     struct TypeDescriptor;
 
+    /**
+     * @brief Type-erased pointer to a value, described by a type
+     * descriptor.
+     *
+     * Holders that borrow the value, such as those returned by
+     * FeatureDescriptor::getValue, are a pair of pointers and allocate
+     * nothing. Holders that own the value share it among their copies
+     * and delete it with the last one.
+     */
     struct Holder
     {
         /**
          * @brief Creates an invalid holder.
          */
-        Holder() : m_descriptor(nullptr) {}
+        Holder() : m_ptr(nullptr), m_descriptor(nullptr), m_valid(false) {}
 
-        Holder(const Holder& h) : m_impl(h.m_impl), m_descriptor(h.m_descriptor)
+        Holder(const Holder& h)
+            : m_ptr(h.m_ptr),
+              m_impl(h.m_impl),
+              m_descriptor(h.m_descriptor),
+              m_valid(h.m_valid)
         {
         }
 
         template <typename T>
         Holder(T* t, const TypeDescriptor* descriptor, bool release = false)
-            : m_impl(new Impl<T>(t, release)), m_descriptor(descriptor)
+            : m_ptr(const_cast<void*>(static_cast<const void*>(t))),
+              m_descriptor(descriptor),
+              m_valid(true)
         {
+            if (release)
+            {
+                m_impl.reset(new Impl<T>(t));
+                REF_INSTRUMENT(descriptor, kHolderAllocations, 1);
+            }
         }
 
+        Holder& operator=(const Holder& h) = default;
+
         template <typename T>
         T* get()
         {
-            return static_cast<Impl<T>*>(m_impl.get())->t;
+            return static_cast<T*>(m_ptr);
+        }
+
+        /**
+         * @brief Transfers the ownership of a contained value to the
+         * caller, for this holder and all of its copies.
+         */
+        template <typename T>
+        T* release()
+        {
+            if (m_impl) m_impl->release = false;
+            return static_cast<T*>(m_ptr);
         }
 
         const TypeDescriptor* descriptor() const { return m_descriptor; }
 
-        bool isValid() const { return !!m_impl; }
+        bool isValid() const { return m_valid; }
 
-        bool isContained() const { return isValid() && m_impl->isContained(); }
+        bool isContained() const { return m_impl && m_impl->release; }
 
     protected:
         struct ImplBase
         {
-            virtual bool isContained() const = 0;
+            bool release;
+
+            ImplBase() : release(true) {}
+            virtual ~ImplBase() {}
         };
 
         template <typename T>
         struct Impl : ImplBase
         {
             T* t;
-            bool release;
-            Impl(T* t_, bool release_) : t(t_), release(release_) {}
+
+            Impl(T* t_) : t(t_) {}
 
             ~Impl()
             {
                 if (release) delete t;
             }
-
-            bool isContained() const override { return release; }
         };
 
+        void* m_ptr;
         std::shared_ptr<ImplBase> m_impl;
         const TypeDescriptor* m_descriptor;
+        bool m_valid;
     };
 
 }  // namespace ref
@@ -0,0 +1,249 @@
+#ifndef REF_INSTRUMENTATION_HPP
+#define REF_INSTRUMENTATION_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace ref
+{
+    struct Descriptor;
+
+    /**
+     * @brief Number of reflection operations performed through a
+     * descriptor.
+     */
+    struct InstrumentationCounters
+    {
+        enum Counter
+        {
+            // Holders created for values of the type (type descriptors)
+            kHolderAllocations,
+            // Feature reads and writes (feature descriptors)
+            kGetValue,
+            kSetValue,
+            // Copies (type descriptors)
+            kCopy,
+            // Conversions from and to strings (primitive descriptors)
+            kGetString,
+            kSetString,
+            // Containers converted into vectors of holders, and the
+            // number of elements in them (container descriptors)
+            kMaterializations,
+            kMaterializedElements,
+            kCounterCount
+        };
+
+        std::array<std::uint64_t, kCounterCount> values;
+
+        InstrumentationCounters() : values() {}
+
+        std::uint64_t operator[](Counter counter) const
+        {
+            return values[counter];
+        }
+
+        std::uint64_t& operator[](Counter counter) { return values[counter]; }
+
+        bool empty() const
+        {
+            for (auto value : values)
+                if (value) return false;
+            return true;
+        }
+    };
+
+    typedef std::unordered_map<const Descriptor*, InstrumentationCounters>
+        InstrumentationSnapshot;
+
+    /**
+     * @brief True if the library was built with REF_ENABLE_INSTRUMENTATION.
+     * When disabled, operations are not counted and snapshots are empty.
+     */
+    constexpr bool isInstrumentationEnabled()
+    {
+#ifdef REF_ENABLE_INSTRUMENTATION
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    namespace detail
+    {
+        /**
+         * @brief Counters of a thread. Only the owner thread writes them,
+         * so updates are plain loads and stores. Other threads read them
+         * while taking a snapshot, which locks the mutex to keep new
+         * descriptors from being inserted concurrently.
+         */
+        struct ThreadCounters
+        {
+            typedef std::array<std::atomic<std::uint64_t>,
+                               InstrumentationCounters::kCounterCount>
+                Values;
+
+            std::mutex mutex;
+            std::unordered_map<const Descriptor*, Values> counters;
+            const Descriptor* lastDescriptor;
+            Values* lastValues;
+
+            ThreadCounters();
+            ~ThreadCounters();
+
+            Values& get(const Descriptor* desc)
+            {
+                if (desc == lastDescriptor) return *lastValues;
+
+                auto it = counters.find(desc);
+                if (it == counters.end())
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    it = counters.emplace(std::piecewise_construct,
+                                          std::forward_as_tuple(desc),
+                                          std::forward_as_tuple())
+                             .first;
+                    for (auto& value : it->second)
+                        value.store(0, std::memory_order_relaxed);
+                }
+
+                lastDescriptor = desc;
+                lastValues = &it->second;
+                return it->second;
+            }
+
+            void addTo(InstrumentationSnapshot& snapshot)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto& entry : counters)
+                {
+                    InstrumentationCounters& res = snapshot[entry.first];
+                    for (std::size_t i = 0; i < res.values.size(); i++)
+                        res.values[i] +=
+                            entry.second[i].load(std::memory_order_relaxed);
+                }
+            }
+
+            void clear()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto& entry : counters)
+                    for (auto& value : entry.second)
+                        value.store(0, std::memory_order_relaxed);
+            }
+        };
+
+        /**
+         * @brief Counters of every live thread, plus those accumulated by
+         * threads that have already exited.
+         */
+        struct InstrumentationRegistry
+        {
+            std::mutex mutex;
+            std::vector<ThreadCounters*> threads;
+            InstrumentationSnapshot exited;
+
+            static InstrumentationRegistry& instance()
+            {
+                static InstrumentationRegistry instance_;
+                return instance_;
+            }
+        };
+
+        inline ThreadCounters::ThreadCounters()
+            : lastDescriptor(nullptr), lastValues(nullptr)
+        {
+            InstrumentationRegistry& registry =
+                InstrumentationRegistry::instance();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.threads.push_back(this);
+        }
+
+        inline ThreadCounters::~ThreadCounters()
+        {
+            InstrumentationRegistry& registry =
+                InstrumentationRegistry::instance();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+
+            addTo(registry.exited);
+            for (auto it = registry.threads.begin();
+                 it != registry.threads.end(); ++it)
+            {
+                if (*it == this)
+                {
+                    registry.threads.erase(it);
+                    break;
+                }
+            }
+        }
+
+        inline ThreadCounters& getThreadCounters()
+        {
+            // Makes sure the registry outlives the counters of every thread
+            InstrumentationRegistry::instance();
+
+            thread_local ThreadCounters counters;
+            return counters;
+        }
+
+        inline void count(const Descriptor* desc,
+                          InstrumentationCounters::Counter counter,
+                          std::uint64_t n = 1)
+        {
+            std::atomic<std::uint64_t>& value =
+                getThreadCounters().get(desc)[counter];
+            value.store(value.load(std::memory_order_relaxed) + n,
+                        std::memory_order_relaxed);
+        }
+    }  // namespace detail
+
+    /**
+     * @brief Aggregates the counters of all threads.
+     */
+    inline InstrumentationSnapshot getInstrumentationSnapshot()
+    {
+        detail::InstrumentationRegistry& registry =
+            detail::InstrumentationRegistry::instance();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        InstrumentationSnapshot snapshot = registry.exited;
+        for (auto thread : registry.threads)
+            thread->addTo(snapshot);
+
+        // Descriptors counted at some point but not since the last reset
+        for (auto it = snapshot.begin(); it != snapshot.end();)
+            it = it->second.empty() ? snapshot.erase(it) : std::next(it);
+
+        return snapshot;
+    }
+
+    /**
+     * @brief Sets the counters of all threads to zero. Operations counted
+     * concurrently with a reset may be lost.
+     */
+    inline void resetInstrumentation()
+    {
+        detail::InstrumentationRegistry& registry =
+            detail::InstrumentationRegistry::instance();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        registry.exited.clear();
+        for (auto thread : registry.threads)
+            thread->clear();
+    }
+
+}  // namespace ref
+
+#ifdef REF_ENABLE_INSTRUMENTATION
+#define REF_INSTRUMENT(desc, counter, n) \
+    ::ref::detail::count((desc), ::ref::InstrumentationCounters::counter, (n))
+#else
+#define REF_INSTRUMENT(desc, counter, n) static_cast<void>(0)
+#endif
+
+#endif  // REF_INSTRUMENTATION_HPP
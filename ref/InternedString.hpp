@@ -0,0 +1,187 @@
+#ifndef REF_INTERNED_STRING_HPP
+#define REF_INTERNED_STRING_HPP
+
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace ref
+{
+    /**
+     * @brief Process-wide set of unique strings, shared by every
+     * InternedString.
+     *
+     * Strings are split into shards by hash, each one guarded by its own
+     * reader-writer lock, so that threads interning different strings
+     * seldom contend and lookups of existing strings proceed in parallel.
+     * Interned strings are never released: the pool is meant for values
+     * repeated across many objects, such as names of departments, cities
+     * or roles, not for unique values.
+     */
+    struct StringPool
+    {
+        static StringPool& instance()
+        {
+            static StringPool instance_;
+            return instance_;
+        }
+
+        StringPool(const StringPool&) = delete;
+        StringPool& operator=(const StringPool&) = delete;
+
+        /**
+         * @brief Returns the unique copy of a string, which lives as long
+         * as the process.
+         */
+        const std::string* intern(std::string_view value)
+        {
+            if (value.empty()) return &empty();
+
+            Shard& shard = m_shards[std::hash<std::string_view>()(value) %
+                                    kShardCount];
+
+            {
+                std::shared_lock<std::shared_mutex> lock(shard.mutex);
+                auto it = shard.index.find(value);
+                if (it != shard.index.end()) return it->second;
+            }
+
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            auto it = shard.index.find(value);
+            if (it != shard.index.end()) return it->second;
+
+            // Elements of a deque do not move when it grows, so the index
+            // can refer to them
+            shard.strings.emplace_back(value);
+            const std::string* res = &shard.strings.back();
+            shard.index.emplace(std::string_view(*res), res);
+            return res;
+        }
+
+        /**
+         * @brief Number of distinct non-empty strings interned so far.
+         */
+        std::size_t size() const
+        {
+            std::size_t res = 0;
+            for (auto& shard : m_shards)
+            {
+                std::shared_lock<std::shared_mutex> lock(shard.mutex);
+                res += shard.strings.size();
+            }
+            return res;
+        }
+
+        static const std::string& empty()
+        {
+            static const std::string empty_;
+            return empty_;
+        }
+
+    protected:
+        StringPool() {}
+
+        enum
+        {
+            kShardCount = 64
+        };
+
+        struct Shard
+        {
+            mutable std::shared_mutex mutex;
+            std::deque<std::string> strings;
+            std::unordered_map<std::string_view, const std::string*> index;
+        };
+
+        std::array<Shard, kShardCount> m_shards;
+    };
+
+    /**
+     * @brief Immutable string stored once in the StringPool.
+     *
+     * An interned string is a single pointer: copies are free, equality
+     * compares pointers and hashing hashes the pointer. Ordering compares
+     * the characters, so ordered containers keep a stable, readable order.
+     * Supported as a primitive type by the descriptors, which convert it
+     * from and to std::string.
+     */
+    struct InternedString
+    {
+        InternedString() : m_value(&StringPool::empty()) {}
+
+        InternedString(std::string_view value)
+            : m_value(StringPool::instance().intern(value))
+        {
+        }
+
+        InternedString(const std::string& value)
+            : InternedString(std::string_view(value))
+        {
+        }
+
+        InternedString(const char* value)
+            : InternedString(std::string_view(value))
+        {
+        }
+
+        const std::string& str() const { return *m_value; }
+
+        operator const std::string&() const { return *m_value; }
+
+        const char* c_str() const { return m_value->c_str(); }
+
+        std::size_t size() const { return m_value->size(); }
+
+        bool empty() const { return m_value->empty(); }
+
+        std::size_t hash() const
+        {
+            return std::hash<const std::string*>()(m_value);
+        }
+
+        bool operator==(const InternedString& other) const
+        {
+            return m_value == other.m_value;
+        }
+
+        bool operator!=(const InternedString& other) const
+        {
+            return m_value != other.m_value;
+        }
+
+        bool operator<(const InternedString& other) const
+        {
+            return m_value != other.m_value && *m_value < *other.m_value;
+        }
+
+    protected:
+        const std::string* m_value;
+    };
+
+    inline std::ostream& operator<<(std::ostream& os,
+                                    const InternedString& value)
+    {
+        return os << value.str();
+    }
+}  // namespace ref
+
+namespace std
+{
+    template <>
+    struct hash<ref::InternedString>
+    {
+        std::size_t operator()(const ref::InternedString& value) const
+        {
+            return value.hash();
+        }
+    };
+}  // namespace std
+
+#endif  // REF_INTERNED_STRING_HPP
@@ -0,0 +1,44 @@
+#ifndef REF_LAZY_HPP
+#define REF_LAZY_HPP
+
+namespace ref
+{
+    struct ModelClass;
+    struct FeatureDescriptor;
+
+    /**
+     * @brief Values of the features of an object that have been loaded
+     * but not decoded yet. Attached to instances of LazyModelClass by
+     * readers that support lazy loading, such as BinaryDeserializer.
+     *
+     * A feature is no longer pending once it is materialized or discarded,
+     * which must happen before its value is decoded into the object.
+     */
+    struct LazyState
+    {
+        virtual ~LazyState() {}
+
+        virtual bool empty() const = 0;
+
+        virtual bool isPending(const FeatureDescriptor* feature) const = 0;
+
+        /**
+         * @brief Decodes the value of a pending feature into obj.
+         */
+        virtual void materialize(ModelClass* obj,
+                                 const FeatureDescriptor* feature) = 0;
+
+        /**
+         * @brief Decodes the value of every pending feature into obj.
+         */
+        virtual void materializeAll(ModelClass* obj) = 0;
+
+        /**
+         * @brief Forgets the value of a feature, which is about to be
+         * overwritten.
+         */
+        virtual void discard(const FeatureDescriptor* feature) = 0;
+    };
+}  // namespace ref
+
+#endif  // REF_LAZY_HPP
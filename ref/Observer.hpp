@@ -0,0 +1,207 @@
+#ifndef REF_OBSERVER_HPP
+#define REF_OBSERVER_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+namespace ref
+{
+    struct ModelClass;
+    struct FeatureDescriptor;
+
+    /**
+     * @brief Receives notifications about features being set through
+     * Class::set or FeatureDescriptor::setValue.
+     *
+     * Changes made through the references returned by Class::get are
+     * not notified.
+     */
+    struct FeatureObserver
+    {
+        virtual ~FeatureObserver() {}
+
+        virtual void beforeSet(ModelClass* obj,
+                               const FeatureDescriptor* feature) = 0;
+
+        virtual void afterSet(ModelClass* obj,
+                              const FeatureDescriptor* feature) = 0;
+    };
+
+    namespace detail
+    {
+        /**
+         * Observers are kept in an immutable table, replaced on every
+         * registration, so that notifying never takes a lock and
+         * observers may register others while being notified.
+         */
+        struct FeatureObserverTable
+        {
+            // Observers of every feature
+            std::vector<FeatureObserver*> all;
+
+            std::unordered_map<const FeatureDescriptor*,
+                               std::vector<FeatureObserver*> >
+                byFeature;
+        };
+
+        template <typename Dummy = void>
+        struct FeatureObservers
+        {
+            // Constant-initialized, so checking it costs a single load
+            static std::atomic<std::size_t> count;
+
+            static std::shared_ptr<const FeatureObserverTable>& table()
+            {
+                static std::shared_ptr<const FeatureObserverTable> table_ =
+                    std::make_shared<const FeatureObserverTable>();
+                return table_;
+            }
+
+            static std::shared_ptr<const FeatureObserverTable> load()
+            {
+                return std::atomic_load(&table());
+            }
+
+            // Serializes registrations
+            static std::mutex& mutex()
+            {
+                static std::mutex mutex_;
+                return mutex_;
+            }
+
+            /**
+             * @brief Replaces the table by a modified copy of it.
+             */
+            template <typename F>
+            static void modify(F f)
+            {
+                std::lock_guard<std::mutex> lock(mutex());
+
+                auto copy = std::make_shared<FeatureObserverTable>(*load());
+                f(*copy);
+
+                std::size_t size = copy->all.size();
+                for (const auto& observers : copy->byFeature)
+                    size += observers.second.size();
+
+                std::atomic_store(
+                    &table(),
+                    std::shared_ptr<const FeatureObserverTable>(copy));
+                count.store(size, std::memory_order_release);
+            }
+        };
+
+        template <typename Dummy>
+        std::atomic<std::size_t> FeatureObservers<Dummy>::count(0);
+
+        inline bool hasFeatureObservers()
+        {
+            return FeatureObservers<>::count.load(std::memory_order_acquire) >
+                   0;
+        }
+
+        template <typename F>
+        void notify(const FeatureDescriptor* feature, F f)
+        {
+            const auto table = FeatureObservers<>::load();
+
+            for (auto observer : table->all)
+                f(observer);
+
+            auto it = table->byFeature.find(feature);
+            if (it != table->byFeature.end())
+                for (auto observer : it->second)
+                    f(observer);
+        }
+
+        inline void notifyBeforeSet(ModelClass* obj,
+                                    const FeatureDescriptor* feature)
+        {
+            notify(feature, [=](FeatureObserver* observer) {
+                observer->beforeSet(obj, feature);
+            });
+        }
+
+        inline void notifyAfterSet(ModelClass* obj,
+                                   const FeatureDescriptor* feature)
+        {
+            notify(feature, [=](FeatureObserver* observer) {
+                observer->afterSet(obj, feature);
+            });
+        }
+    }  // namespace detail
+
+    /**
+     * @brief Registers an observer for every feature of every class.
+     *
+     * Registration may happen concurrently with feature changes. Changes
+     * in progress while registering may or may not be notified.
+     */
+    inline void addFeatureObserver(FeatureObserver* observer)
+    {
+        detail::FeatureObservers<>::modify(
+            [=](detail::FeatureObserverTable& table) {
+                table.all.push_back(observer);
+            });
+    }
+
+    /**
+     * @brief Registers an observer for a single feature, so that changes
+     * of other features do not reach it.
+     */
+    inline void addFeatureObserver(FeatureObserver* observer,
+                                   const FeatureDescriptor* feature)
+    {
+        detail::FeatureObservers<>::modify(
+            [=](detail::FeatureObserverTable& table) {
+                table.byFeature[feature].push_back(observer);
+            });
+    }
+
+    /**
+     * @brief Unregisters an observer from every feature it observes.
+     */
+    inline void removeFeatureObserver(FeatureObserver* observer)
+    {
+        detail::FeatureObservers<>::modify(
+            [=](detail::FeatureObserverTable& table) {
+                auto erase = [=](std::vector<FeatureObserver*>& list) {
+                    list.erase(std::remove(list.begin(), list.end(), observer),
+                               list.end());
+                };
+
+                erase(table.all);
+                for (auto it = table.byFeature.begin();
+                     it != table.byFeature.end();)
+                {
+                    erase(it->second);
+                    if (it->second.empty())
+                        it = table.byFeature.erase(it);
+                    else
+                        ++it;
+                }
+            });
+    }
+
+    /**
+     * @brief Returns the registered observers, whatever the features
+     * they observe.
+     */
+    inline std::vector<FeatureObserver*> getFeatureObservers()
+    {
+        const auto table = detail::FeatureObservers<>::load();
+
+        std::vector<FeatureObserver*> res(table->all);
+        for (const auto& observers : table->byFeature)
+            res.insert(res.end(), observers.second.begin(),
+                       observers.second.end());
+        return res;
+    }
+
+}  // namespace ref
+
+#endif  // REF_OBSERVER_HPP
@@ -1,25 +1,128 @@
 #ifndef REF_DETAIL_NAME_HPP
 #define REF_DETAIL_NAME_HPP
 
-#include <cstdlib>
-#include <boost/units/detail/utility.hpp>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
 
 namespace ref
 {
 namespace detail
 {
+    /**
+     * @brief Extracts the name of T from the signature of this function,
+     * as printed by GCC and Clang.
+     */
+    template < typename T >
+    constexpr std::string_view get_raw_type_name()
+    {
+        const std::string_view signature = __PRETTY_FUNCTION__;
+        const std::size_t begin = signature.find("T = ") + 4;
+        std::size_t end = signature.find(';', begin);
+        if (end == std::string_view::npos)
+            end = signature.rfind(']');
+        return signature.substr(begin, end - begin);
+    }
+
+    constexpr std::string_view get_short_name(std::string_view fqn)
+    {
+        const std::size_t pos = fqn.rfind(':');
+        return pos == std::string_view::npos? fqn : fqn.substr(pos + 1);
+    }
+
+    constexpr std::size_t get_xmltag_size(std::string_view name)
+    {
+        std::size_t size = 0;
+        for (std::size_t i = 0; i < name.size(); ++i)
+            size += (i && name[i] >= 'A' && name[i] <= 'Z')? 2 : 1;
+        return size;
+    }
+
+    template < std::size_t N >
+    constexpr std::array< char, N + 1 > make_xmltag(std::string_view name)
+    {
+        std::array< char, N + 1 > res{};
+        std::size_t j = 0;
+        for (std::size_t i = 0; i < name.size(); ++i)
+        {
+            const char c = name[i];
+            if (c >= 'A' && c <= 'Z')
+            {
+                if (i)
+                    res[j++] = '-';
+                res[j++] = (c - 'A' + 'a');
+            }
+            else if (c >= 'a' && c <= 'z')
+                res[j++] = c;
+            else if (c >= '0' && c <= '9')
+                res[j++] = c;
+            else
+                res[j++] = '-';
+        }
+        return res;
+    }
+
+    /**
+     * @brief 64-bit FNV-1a hash.
+     */
+    constexpr std::uint64_t get_hash(std::string_view str)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (std::size_t i = 0; i < str.size(); ++i)
+        {
+            hash ^= static_cast< unsigned char >(str[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    template < std::size_t N >
+    constexpr std::array< char, N + 1 > make_storage(std::string_view str)
+    {
+        std::array< char, N + 1 > res{};
+        for (std::size_t i = 0; i < N; ++i)
+            res[i] = str[i];
+        return res;
+    }
+
+    /**
+     * @brief Names of T computed at compile time and kept in static
+     * storage, so reading them needs neither demangling nor guards.
+     */
+    template < typename T >
+    struct TypeName
+    {
+        static constexpr std::string_view raw = get_raw_type_name< T >();
+        static constexpr auto fqn_storage = make_storage< raw.size() >(raw);
+        static constexpr std::string_view fqn{fqn_storage.data(), raw.size()};
+
+        static constexpr std::string_view name = get_short_name(fqn);
+
+        static constexpr std::uint64_t id = get_hash(fqn);
+
+        static constexpr auto xmltag_storage =
+            make_xmltag< get_xmltag_size(name) >(name);
+        static constexpr std::string_view xmltag{
+            xmltag_storage.data(), xmltag_storage.size() - 1};
+    };
+
     template < typename T >
     std::string get_fqn()
     {
-        return boost::units::detail::demangle(typeid(T).name());
+        return std::string(TypeName< T >::fqn);
     }
 
     template < typename T >
     std::string get_name()
     {
-        const std::string res = get_fqn< T >();
-        size_t pos = res.rfind(':');
-        return pos == std::string::npos? res : res.substr(pos + 1);
+        return std::string(TypeName< T >::name);
+    }
+
+    template < typename T >
+    std::string get_xmltag()
+    {
+        return std::string(TypeName< T >::xmltag);
     }
 
     inline std::string convert_to_xmltag(const std::string& name)
@@ -1,26 +1,72 @@
 #ifndef REF_MPL_HPP
 #define REF_MPL_HPP
 
-#include <boost/mpl/vector.hpp>
-#include <boost/mpl/empty.hpp>
-#include <boost/mpl/front.hpp>
-#include <boost/mpl/pop_front.hpp>
-#include <boost/utility.hpp>
+#include <cstddef>
+#include <type_traits>
 
 namespace ref
 {
-    typedef boost::mpl::vector<> EmptyList;
+    /**
+     * @brief Compile-time list of types.
+     */
+    template < typename... Ts >
+    struct TypeList
+    {
+        static constexpr std::size_t size = sizeof...(Ts);
+    };
 
-    template < typename T, typename Enabled = void >
-    struct InheritFromList :
-        public boost::mpl::front< T >::type,
-        public InheritFromList< typename boost::mpl::pop_front< T >::type >
-    {};
+    typedef TypeList<> EmptyList;
+
+    template < typename List >
+    struct InheritFromList;
 
-    template < typename T >
-    struct InheritFromList< T,
-        typename boost::enable_if< typename boost::mpl::empty< T >::type >::type >
+    template < typename... Ts >
+    struct InheritFromList< TypeList< Ts... > > : public Ts...
     {};
+
+    namespace detail
+    {
+        template < typename List1, typename List2 >
+        struct Concat;
+
+        template < typename... Ts, typename... Us >
+        struct Concat< TypeList< Ts... >, TypeList< Us... > >
+        {
+            typedef TypeList< Ts..., Us... > type;
+        };
+
+        template < typename List, typename T >
+        struct Contains;
+
+        template < typename... Ts, typename T >
+        struct Contains< TypeList< Ts... >, T > :
+            std::integral_constant< bool,
+                (std::is_same< Ts, T >::value || ...) >
+        {};
+
+        template < typename List >
+        struct ForEach;
+
+        template < typename... Ts >
+        struct ForEach< TypeList< Ts... > >
+        {
+            template < typename F >
+            static void apply(F& f)
+            {
+                (f(static_cast< Ts * >(nullptr)), ...);
+            }
+        };
+    } // namespace detail
+
+    /**
+     * @brief Calls f with a null pointer to each type of the list, in
+     * order. Types are never instantiated.
+     */
+    template < typename List, typename F >
+    void for_each(F f)
+    {
+        detail::ForEach< List >::apply(f);
+    }
 } // namespace ref
 
 #endif // REF_MPL_HPP
@@ -0,0 +1,596 @@
+#include "BinaryDeserializer.hpp"
+#include <ref/Descriptors.hpp>
+#include <ref/DescriptorRegistry.hpp>
+#include <ref/Class.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace ref;
+using namespace std;
+using namespace ref::detail;
+
+namespace
+{
+    const char magic[] = {'R', 'E', 'F', 'B'};
+    const char version = 1;
+
+    bool isSubclass(const ClassDescriptor* classDesc,
+                    const ClassDescriptor* base)
+    {
+        for (; classDesc; classDesc = classDesc->getParentClassDescriptor())
+            if (classDesc == base) return true;
+        return false;
+    }
+} // namespace
+
+/**
+ * Decodes values from a record, or from a part of it for lazy objects.
+ */
+struct BinaryDeserializer::Decoder
+{
+    shared_ptr<const StreamClassVector> classes;
+    shared_ptr<const string> buffer;
+    BinaryCursor cursor;
+    bool lazy;
+
+    Decoder(shared_ptr<const StreamClassVector> classes_,
+            shared_ptr<const string> buffer_, BinaryCursor cursor_,
+            bool lazy_)
+        : classes(move(classes_)),
+          buffer(move(buffer_)),
+          cursor(cursor_),
+          lazy(lazy_)
+    {
+    }
+
+    const StreamClass& readClassIndex();
+
+    void readObject(const StreamClass& streamClass, ModelClass * obj);
+    void readLazyObject(const Plan& plan, LazyModelClass * obj);
+    void skipObject(const StreamClass& streamClass);
+    void resetMissing(const Plan& missing, Holder prototype,
+                      ModelClass * obj);
+    uint64_t readCount(const ContainerTypeDescriptor* desc);
+    void readValue(Holder h);
+};
+
+/**
+ * Location in the record of the value of each pending feature.
+ */
+struct BinaryDeserializer::LazyFeatures : LazyState
+{
+    struct Range
+    {
+        const FeatureDescriptor* feature;
+        const char* pos;
+        uint32_t size;
+    };
+
+    shared_ptr<const StreamClassVector> classes;
+    shared_ptr<const string> buffer;
+    vector<Range> pending;
+
+    LazyFeatures(const Decoder& decoder)
+        : classes(decoder.classes), buffer(decoder.buffer)
+    {
+    }
+
+    bool empty() const override { return pending.empty(); }
+
+    bool isPending(const FeatureDescriptor* feature) const override
+    {
+        for (const auto& range : pending)
+            if (range.feature == feature) return true;
+        return false;
+    }
+
+    void materialize(ModelClass * obj,
+                     const FeatureDescriptor* feature) override
+    {
+        for (auto& range : pending)
+        {
+            if (range.feature != feature)
+                continue;
+
+            const Range current = range;
+            range = pending.back();
+            pending.pop_back();
+
+            decode(obj, current);
+            return;
+        }
+    }
+
+    void materializeAll(ModelClass * obj) override
+    {
+        vector<Range> ranges;
+        ranges.swap(pending);
+
+        for (const auto& range : ranges)
+            decode(obj, range);
+    }
+
+    void discard(const FeatureDescriptor* feature) override
+    {
+        for (auto& range : pending)
+        {
+            if (range.feature == feature)
+            {
+                range = pending.back();
+                pending.pop_back();
+                return;
+            }
+        }
+    }
+
+    void decode(ModelClass * obj, const Range& range) const
+    {
+        Decoder decoder(classes, buffer,
+                        BinaryCursor(range.pos, range.pos + range.size), true);
+        decoder.readValue(range.feature->getValue(obj));
+
+        if (decoder.cursor.pos != decoder.cursor.end)
+            throw runtime_error("Corrupted binary record");
+    }
+};
+
+BinaryDeserializer::BinaryDeserializer(istream& is)
+    : m_is(is),
+      m_header(false),
+      m_lazy(false),
+      m_classes(make_shared<StreamClassVector>()),
+      m_buffer(make_shared<string>())
+{
+}
+
+void BinaryDeserializer::setLazy(bool lazy)
+{
+    m_lazy = lazy;
+}
+
+Holder BinaryDeserializer::next()
+{
+    if (!readRecord())
+        return Holder();
+
+    Decoder decoder(m_classes, m_buffer, m_cursor, m_lazy);
+
+    const StreamClass& streamClass = decoder.readClassIndex();
+    if (!streamClass.local)
+        throw runtime_error("Unknown class: " + streamClass.schema.fqn);
+
+    Holder h = streamClass.local->create();
+    if (!h.isValid())
+        throw runtime_error("Cannot create " + streamClass.schema.fqn);
+
+    decoder.readObject(streamClass, streamClass.local->get(h));
+    return h;
+}
+
+bool BinaryDeserializer::next(ModelClass * obj)
+{
+    if (!readRecord())
+        return false;
+
+    Decoder decoder(m_classes, m_buffer, m_cursor, m_lazy);
+    decoder.readObject(decoder.readClassIndex(), obj);
+    return true;
+}
+
+BinaryDeserializer::Plan BinaryDeserializer::makePlan(
+    const ClassSchema& schema, const ClassDescriptor* classDesc)
+{
+    unordered_map<string, const FeatureDescriptor*> features;
+    for (auto feature : classDesc->getAllFeatureDescriptors())
+        features[feature->getName()] = feature;
+
+    Plan plan;
+
+    for (const auto& field : schema.fields)
+    {
+        auto it = features.find(field.name);
+        const bool matches =
+            it != features.end() &&
+            getTypeSignature(it->second->getTypeDescriptor()) ==
+                field.signature;
+
+        plan.push_back(matches ? it->second : nullptr);
+    }
+
+    return plan;
+}
+
+BinaryDeserializer::Plan BinaryDeserializer::findMissing(
+    const Plan& plan, const ClassDescriptor* classDesc)
+{
+    Plan missing;
+
+    for (auto feature : classDesc->getAllFeatureDescriptors())
+    {
+        if (find(plan.begin(), plan.end(), feature) == plan.end())
+            missing.push_back(feature);
+    }
+
+    return missing;
+}
+
+bool BinaryDeserializer::readRecord()
+{
+    if (!m_header)
+    {
+        char header[sizeof(magic) + 1];
+        m_is.read(header, sizeof(header));
+
+        if (m_is.gcount() == 0)
+            return false;
+
+        if (m_is.gcount() != sizeof(header) ||
+            !equal(magic, magic + sizeof(magic), header) ||
+            header[sizeof(magic)] != version)
+        {
+            throw runtime_error("Invalid binary stream header");
+        }
+
+        m_header = true;
+    }
+
+    uint32_t size;
+    m_is.read(reinterpret_cast<char*>(&size), sizeof(size));
+
+    if (m_is.gcount() == 0)
+        return false;
+
+    if (m_is.gcount() != sizeof(size))
+        throw runtime_error("Truncated binary record");
+
+    // Lazy objects may still refer to the previous record
+    if (m_buffer.use_count() > 1)
+        m_buffer = make_shared<string>();
+
+    string& buffer = *m_buffer;
+    buffer.resize(size);
+    m_is.read(&buffer[0], size);
+
+    if (static_cast<size_t>(m_is.gcount()) != size)
+        throw runtime_error("Truncated binary record");
+
+    m_cursor = BinaryCursor(buffer.data(), buffer.data() + size);
+
+    for (uint64_t count = m_cursor.readVarint(); count; --count)
+    {
+        StreamClass streamClass;
+        ClassSchema& schema = streamClass.schema;
+
+        schema.fqn = m_cursor.readString();
+        const uint64_t fingerprint = m_cursor.readFixed<uint64_t>();
+
+        for (uint64_t fields = m_cursor.readVarint(); fields; --fields)
+        {
+            ClassSchema::Field field;
+            field.name = m_cursor.readString();
+            field.signature = m_cursor.readString();
+            schema.fields.push_back(field);
+        }
+
+        schema.fingerprint = fingerprint;
+
+        streamClass.local =
+            DescriptorRegistry::instance().findByFqn(schema.fqn);
+        streamClass.identical =
+            streamClass.local &&
+            ClassSchema(streamClass.local).fingerprint == fingerprint;
+
+        if (streamClass.local)
+        {
+            streamClass.plan = makePlan(schema, streamClass.local);
+            streamClass.missing = findMissing(streamClass.plan,
+                                              streamClass.local);
+            if (!streamClass.missing.empty())
+                streamClass.prototype = streamClass.local->create();
+        }
+
+        m_classes->push_back(streamClass);
+    }
+
+    return true;
+}
+
+const BinaryDeserializer::StreamClass&
+BinaryDeserializer::Decoder::readClassIndex()
+{
+    const uint64_t index = cursor.readVarint();
+    if (index >= classes->size())
+        throw runtime_error("Invalid class index");
+
+    return (*classes)[index];
+}
+
+void BinaryDeserializer::Decoder::readObject(const StreamClass& streamClass,
+                                             ModelClass * obj)
+{
+    const ClassDescriptor* classDesc = obj->getClassDescriptor();
+
+    LazyModelClass * lazyObj =
+        lazy ? dynamic_cast<LazyModelClass *>(obj) : nullptr;
+
+    if (streamClass.identical && classDesc == streamClass.local)
+    {
+        if (lazyObj)
+        {
+            // Every feature is in the stream, so the pending values of a
+            // previous record are all replaced
+            lazyObj->setLazyState(nullptr);
+            readLazyObject(streamClass.plan, lazyObj);
+            return;
+        }
+
+
+        // Same layout: every field maps to the feature at the same position
+        for (auto feature : streamClass.plan)
+        {
+            cursor.take(sizeof(uint32_t));
+            readValue(feature->getValue(obj));
+        }
+        return;
+    }
+
+    Plan otherPlan;
+    Plan otherMissing;
+    const Plan* plan = &streamClass.plan;
+    const Plan* missing = &streamClass.missing;
+    Holder prototype = streamClass.prototype;
+
+    if (classDesc != streamClass.local)
+    {
+        otherPlan = makePlan(streamClass.schema, classDesc);
+        otherMissing = findMissing(otherPlan, classDesc);
+        plan = &otherPlan;
+        missing = &otherMissing;
+        prototype = otherMissing.empty() ? Holder() : classDesc->create();
+    }
+
+    if (lazyObj)
+    {
+        // Features missing in the stream get their default value
+        lazyObj->materialize();
+        resetMissing(*missing, prototype, obj);
+        readLazyObject(*plan, lazyObj);
+        return;
+    }
+
+    resetMissing(*missing, prototype, obj);
+
+    for (auto feature : *plan)
+    {
+        const uint32_t size = cursor.readFixed<uint32_t>();
+
+        if (!feature)
+        {
+            cursor.take(size);
+            continue;
+        }
+
+        const char* end = cursor.pos + size;
+        if (size > static_cast<size_t>(cursor.end - cursor.pos))
+            throw runtime_error("Truncated binary record");
+
+        readValue(feature->getValue(obj));
+
+        if (cursor.pos != end)
+            throw runtime_error("Corrupted binary record");
+    }
+}
+
+/**
+ * Records where the value of each feature is, to be decoded on first
+ * access.
+ */
+void BinaryDeserializer::Decoder::readLazyObject(const Plan& plan,
+                                                 LazyModelClass * obj)
+{
+    unique_ptr<LazyFeatures> features(new LazyFeatures(*this));
+    features->pending.reserve(plan.size());
+
+    for (auto feature : plan)
+    {
+        const uint32_t size = cursor.readFixed<uint32_t>();
+        const char* pos = cursor.take(size);
+
+        if (feature)
+        {
+            LazyFeatures::Range range = {feature, pos, size};
+            features->pending.push_back(range);
+        }
+    }
+
+    obj->setLazyState(move(features));
+}
+
+void BinaryDeserializer::Decoder::skipObject(const StreamClass& streamClass)
+{
+    for (size_t i = 0; i < streamClass.schema.fields.size(); i++)
+        cursor.take(cursor.readFixed<uint32_t>());
+}
+
+/**
+ * Resets the features missing in the stream to their value in the
+ * prototype. Pointers are reset to null instead, so that no record shares
+ * the objects of the prototype.
+ */
+void BinaryDeserializer::Decoder::resetMissing(const Plan& missing,
+                                               Holder prototype,
+                                               ModelClass * obj)
+{
+    ModelClass * defaults =
+        prototype.isValid()
+            ? prototype.descriptor()->as<ClassDescriptor>()->get(prototype)
+            : nullptr;
+
+    for (auto feature : missing)
+    {
+        Holder value = feature->getValue(obj);
+        auto desc = value.descriptor();
+
+        if (desc->getKind() == TypeDescriptor::kPointer)
+        {
+            desc->as<PointerTypeDescriptor>()->reset(value);
+        }
+        else if (defaults)
+        {
+            desc->copy(feature->getValue(defaults), value);
+        }
+        else
+        {
+            const Holder empty = desc->create();
+            if (empty.isValid()) desc->copy(empty, value);
+        }
+    }
+}
+
+uint64_t BinaryDeserializer::Decoder::readCount(
+    const ContainerTypeDescriptor* desc)
+{
+    // Every value takes at least one byte
+    const uint64_t count = cursor.readVarint();
+    if (count > static_cast<uint64_t>(cursor.end - cursor.pos) &&
+        desc->getValueTypeDescriptor()->getKind() !=
+            TypeDescriptor::kUnsupported)
+    {
+        throw runtime_error("Truncated binary record");
+    }
+    return count;
+}
+
+void BinaryDeserializer::Decoder::readValue(Holder h)
+{
+    auto desc = h.descriptor();
+
+    switch (desc->getKind())
+    {
+    case TypeDescriptor::kPrimitive:
+        decodePrimitive(cursor, h);
+        break;
+    case TypeDescriptor::kClass:
+        readObject(readClassIndex(), desc->as<ClassDescriptor>()->get(h));
+        break;
+    case TypeDescriptor::kPair:
+        {
+            const auto value = desc->as<PairTypeDescriptor>()->getValue(h);
+            readValue(value.first);
+            readValue(value.second);
+        }
+        break;
+    case TypeDescriptor::kList:
+        {
+            auto listDesc = desc->as<ListTypeDescriptor>();
+            const uint64_t count = readCount(listDesc);
+
+            // Elements are read in place, so a list read into the same
+            // object again keeps its capacity and its elements theirs
+            listDesc->resize(h, count);
+            const uint64_t size = min<uint64_t>(count, listDesc->getSize(h));
+
+            for (uint64_t i = 0; i < size; i++)
+                readValue(listDesc->getElement(h, i));
+
+            // Fixed-size lists drop the elements they have no room for
+            if (size < count)
+            {
+                Holder scratch = listDesc->getValueTypeDescriptor()->create();
+                for (uint64_t i = size; i < count; i++)
+                    readValue(scratch);
+            }
+        }
+        break;
+    case TypeDescriptor::kMap:
+    case TypeDescriptor::kSet:
+        {
+            auto containerDesc = desc->as<ContainerTypeDescriptor>();
+            auto valueDesc = containerDesc->getValueTypeDescriptor();
+            const uint64_t count = readCount(containerDesc);
+
+            vector<Holder> values;
+            values.reserve(count);
+
+            for (uint64_t i = 0; i < count; i++)
+            {
+                Holder value = valueDesc->create();
+                readValue(value);
+                values.push_back(value);
+            }
+
+            containerDesc->setValue(h, values);
+        }
+        break;
+    case TypeDescriptor::kPointer:
+        {
+            auto ptrDesc = desc->as<PointerTypeDescriptor>();
+
+            // Objects owned by the pointer are reused if they have the
+            // same type as the value in the stream and no other pointer
+            // shares them
+            const bool owned = ptrDesc->isOwner();
+            Holder current = (owned && ptrDesc->getUseCount(h) == 1)
+                                 ? ptrDesc->dereference(h)
+                                 : Holder();
+
+            if (!cursor.readFixed<uint8_t>())
+            {
+                if (!ptrDesc->isNull(h))
+                    desc->copy(desc->create(), h);
+                break;
+            }
+
+            auto pointedDesc = ptrDesc->getPointedTypeDescriptor();
+
+            if (pointedDesc->getKind() != TypeDescriptor::kClass)
+            {
+                Holder value = current;
+                if (!value.isValid())
+                {
+                    desc->copy(desc->create(), h);
+                    value = ptrDesc->emplace(h, pointedDesc);
+                }
+
+                if (!value.isValid())
+                    throw runtime_error("Cannot create " +
+                                        pointedDesc->getFqn());
+
+                readValue(value);
+                break;
+            }
+
+            const StreamClass& streamClass = readClassIndex();
+            const ClassDescriptor* classDesc = streamClass.local;
+
+            if (current.isValid())
+            {
+                ModelClass * obj =
+                    pointedDesc->as<ClassDescriptor>()->get(current);
+                if (classDesc && obj->getClassDescriptor() == classDesc)
+                {
+                    readObject(streamClass, obj);
+                    break;
+                }
+            }
+
+            desc->copy(desc->create(), h);
+
+            Holder value;
+            if (classDesc &&
+                isSubclass(classDesc, pointedDesc->as<ClassDescriptor>()))
+            {
+                value = ptrDesc->emplace(h, classDesc);
+            }
+
+            if (value.isValid())
+                readObject(streamClass, classDesc->get(value));
+            else
+                skipObject(streamClass);
+        }
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef REFCPP_BINARY_DESERIALIZER_HPP
+#define REFCPP_BINARY_DESERIALIZER_HPP
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ref/Holder.hpp>
+#include "BinarySchema.hpp"
+
+namespace ref
+{
+    struct ModelClass;
+    struct FeatureDescriptor;
+
+    /**
+     * @brief Reads objects written by BinarySerializer, one record at a
+     * time.
+     *
+     * The schema of each class in the stream is compared with the local
+     * class of the same FQN once, when it is first described. If their
+     * fingerprints match, objects are read feature by feature without any
+     * further check. Otherwise features are mapped by name: those whose
+     * type signature matches are read, and the rest are skipped by size
+     * without being decoded. Local features missing in the stream get
+     * the value they have in a default instance of their class, as with
+     * JsonRecordReader. Objects of classes unknown locally are skipped.
+     *
+     * Malformed streams throw std::runtime_error.
+     */
+    struct BinaryDeserializer
+    {
+        BinaryDeserializer(std::istream& is);
+
+        /**
+         * @brief Enables lazy loading. Objects of classes derived from
+         * LazyModelClass then only record where the value of each feature
+         * is in the record, and decode it when the feature is first
+         * accessed. Values of nested objects of such classes, such as
+         * those in containers or owned by pointers, are recorded as well
+         * when their container or pointer is decoded.
+         *
+         * Lazy objects keep the record they were read from, and the
+         * schemas of the stream, until all of their values are decoded.
+         * Malformed values throw std::runtime_error when decoded.
+         */
+        void setLazy(bool lazy);
+
+        /**
+         * @brief Reads the next record into a new instance of its class.
+         *
+         * @return A holder that owns the new instance. An invalid holder
+         * at the end of the stream.
+         */
+        Holder next();
+
+        /**
+         * @brief Reads the next record into an existing object.
+         *
+         * Strings, lists and the objects owned by pointers are read in
+         * place, so reading every record of a stream into the same object
+         * reuses their memory. Objects also owned by other shared
+         * pointers, such as objects kept by the caller, are replaced by
+         * new ones instead. Features missing in the stream, which only
+         * happens when its schema differs from the local one, are reset
+         * rather than keeping the value of the previous record.
+         *
+         * @return false at the end of the stream.
+         */
+        bool next(ModelClass * obj);
+
+    protected:
+        typedef std::vector<const FeatureDescriptor*> Plan;
+
+        struct StreamClass
+        {
+            ClassSchema schema;
+            const ClassDescriptor* local;
+            bool identical;
+            // Local feature for each field of the schema, null to skip it
+            Plan plan;
+            // Local features without a field, and the default instance
+            // they are reset from
+            Plan missing;
+            Holder prototype;
+        };
+
+        typedef std::vector<StreamClass> StreamClassVector;
+
+        struct Decoder;
+        struct LazyFeatures;
+
+        std::istream& m_is;
+        bool m_header;
+        bool m_lazy;
+        // Shared with lazy objects, which decode their values later on
+        std::shared_ptr<StreamClassVector> m_classes;
+        std::shared_ptr<std::string> m_buffer;
+        detail::BinaryCursor m_cursor;
+
+        static Plan makePlan(const ClassSchema& schema,
+                             const ClassDescriptor* classDesc);
+        static Plan findMissing(const Plan& plan,
+                                const ClassDescriptor* classDesc);
+
+        bool readRecord();
+    };
+} // namespace ref
+
+#endif // REFCPP_BINARY_DESERIALIZER_HPP
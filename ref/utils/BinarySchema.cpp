@@ -0,0 +1,246 @@
+#include "BinarySchema.hpp"
+#include <ref/Descriptors.hpp>
+#include <ref/InternedString.hpp>
+#include <ref/detail/Name.hpp>
+
+using namespace ref;
+using namespace std;
+using namespace ref::detail;
+
+namespace
+{
+    template <typename T>
+    void encodeFixed(string& out, Holder h)
+    {
+        appendFixed(out, *h.get<T>());
+    }
+
+    template <typename T>
+    void decodeFixed(BinaryCursor& cursor, Holder h)
+    {
+        *h.get<T>() = cursor.readFixed<T>();
+    }
+
+    const char* getPrimitiveSignature(
+        PrimitiveTypeDescriptor::PrimitiveKind kind)
+    {
+        switch (kind)
+        {
+        case PrimitiveTypeDescriptor::kBool: return "b";
+        case PrimitiveTypeDescriptor::kChar: return "c";
+        case PrimitiveTypeDescriptor::kInt8: return "i1";
+        case PrimitiveTypeDescriptor::kUInt8: return "u1";
+        case PrimitiveTypeDescriptor::kInt16: return "i2";
+        case PrimitiveTypeDescriptor::kUInt16: return "u2";
+        case PrimitiveTypeDescriptor::kInt32: return "i4";
+        case PrimitiveTypeDescriptor::kUInt32: return "u4";
+        case PrimitiveTypeDescriptor::kInt64: return "i8";
+        case PrimitiveTypeDescriptor::kUInt64: return "u8";
+        case PrimitiveTypeDescriptor::kFloat: return "f4";
+        case PrimitiveTypeDescriptor::kDouble: return "f8";
+        case PrimitiveTypeDescriptor::kLongDouble: return "fl";
+        // Same encoding, so either type can read the other
+        case PrimitiveTypeDescriptor::kString:
+        case PrimitiveTypeDescriptor::kInternedString:
+        case PrimitiveTypeDescriptor::kSharedString: return "s";
+        }
+        return "?";
+    }
+
+    const char* getPointerSignature(PointerTypeDescriptor::PointerType type)
+    {
+        switch (type)
+        {
+        case PointerTypeDescriptor::kRaw: return "R";
+        case PointerTypeDescriptor::kUnique: return "U";
+        case PointerTypeDescriptor::kShared: return "H";
+        case PointerTypeDescriptor::kWeak: return "W";
+        case PointerTypeDescriptor::kOptional: return "O";
+        }
+        return "?";
+    }
+} // namespace
+
+string ref::getTypeSignature(const TypeDescriptor* desc)
+{
+    switch (desc->getKind())
+    {
+    case TypeDescriptor::kClass:
+        return "C" + desc->getFqn() + ";";
+    case TypeDescriptor::kPrimitive:
+        return getPrimitiveSignature(
+            desc->as<PrimitiveTypeDescriptor>()->getPrimitiveKind());
+    case TypeDescriptor::kList:
+        return "L" + getTypeSignature(
+                         desc->as<ContainerTypeDescriptor>()
+                             ->getValueTypeDescriptor());
+    case TypeDescriptor::kSet:
+        return "S" + getTypeSignature(
+                         desc->as<ContainerTypeDescriptor>()
+                             ->getValueTypeDescriptor());
+    case TypeDescriptor::kMap:
+        {
+            auto mapDesc = desc->as<MapTypeDescriptor>();
+            return "M" + getTypeSignature(mapDesc->getKeyTypeDescriptor()) +
+                   getTypeSignature(mapDesc->getMappedTypeDescriptor());
+        }
+    case TypeDescriptor::kPair:
+        {
+            auto pairDesc = desc->as<PairTypeDescriptor>();
+            return "P" + getTypeSignature(pairDesc->getFirstTypeDescriptor()) +
+                   getTypeSignature(pairDesc->getSecondTypeDescriptor());
+        }
+    case TypeDescriptor::kPointer:
+        {
+            auto ptrDesc = desc->as<PointerTypeDescriptor>();
+            return getPointerSignature(ptrDesc->getPointerType()) +
+                   getTypeSignature(ptrDesc->getPointedTypeDescriptor());
+        }
+    default:
+        break;
+    }
+
+    return "X";
+}
+
+ClassSchema::ClassSchema(const ClassDescriptor* classDesc)
+    : fqn(classDesc->getFqn())
+{
+    for (auto feature : classDesc->getAllFeatureDescriptors())
+    {
+        Field field;
+        field.name = feature->getName();
+        field.signature = getTypeSignature(feature->getTypeDescriptor());
+        fields.push_back(field);
+    }
+
+    updateFingerprint();
+}
+
+void ClassSchema::updateFingerprint()
+{
+    string str;
+    for (const auto& field : fields)
+    {
+        str += field.name;
+        str += '\0';
+        str += field.signature;
+        str += '\0';
+    }
+
+    fingerprint = detail::get_hash(str);
+}
+
+void ref::detail::encodePrimitive(string& out, Holder h)
+{
+    auto desc = h.descriptor()->as<PrimitiveTypeDescriptor>();
+
+    switch (desc->getPrimitiveKind())
+    {
+    case PrimitiveTypeDescriptor::kBool:
+        encodeFixed<bool>(out, h);
+        break;
+    case PrimitiveTypeDescriptor::kChar:
+        encodeFixed<char>(out, h);
+        break;
+    case PrimitiveTypeDescriptor::kInt8:
+        encodeFixed<int8_t>(out, h);
+        break;
+    case PrimitiveTypeDescriptor::kUInt8:
+        encodeFixed<uint8_t>(out, h);
+        break;
+    case PrimitiveTypeDescriptor::kInt16:
+        encodeFixed<int16_t>(out, h);
+        break;
+    case PrimitiveTypeDescriptor::kUInt16:
+        encodeFixed<uint16_t>(out, h);
+        break;
+    case PrimitiveTypeDescriptor::kInt32:
+        encodeFixed<int32_t>(out, h);
+        break;
+    case PrimitiveTypeDescriptor::kUInt32:
+        encodeFixed<uint32_t>(out, h);
+        break;
+    case PrimitiveTypeDescriptor::kInt64:
+        encodeFixed<int64_t>(out, h);
+        break;
+    case PrimitiveTypeDescriptor::kUInt64:
+        encodeFixed<uint64_t>(out, h);
+        break;
+    case PrimitiveTypeDescriptor::kFloat:
+        encodeFixed<float>(out, h);
+        break;
+    case PrimitiveTypeDescriptor::kDouble:
+        encodeFixed<double>(out, h);
+        break;
+    case PrimitiveTypeDescriptor::kLongDouble:
+        encodeFixed<long double>(out, h);
+        break;
+    case PrimitiveTypeDescriptor::kString:
+        appendString(out, *h.get<string>());
+        break;
+    case PrimitiveTypeDescriptor::kInternedString:
+        appendString(out, h.get<InternedString>()->str());
+        break;
+    case PrimitiveTypeDescriptor::kSharedString:
+        appendString(out, desc->getString(h));
+        break;
+    }
+}
+
+void ref::detail::decodePrimitive(BinaryCursor& cursor, Holder h)
+{
+    auto desc = h.descriptor()->as<PrimitiveTypeDescriptor>();
+
+    switch (desc->getPrimitiveKind())
+    {
+    case PrimitiveTypeDescriptor::kBool:
+        decodeFixed<bool>(cursor, h);
+        break;
+    case PrimitiveTypeDescriptor::kChar:
+        decodeFixed<char>(cursor, h);
+        break;
+    case PrimitiveTypeDescriptor::kInt8:
+        decodeFixed<int8_t>(cursor, h);
+        break;
+    case PrimitiveTypeDescriptor::kUInt8:
+        decodeFixed<uint8_t>(cursor, h);
+        break;
+    case PrimitiveTypeDescriptor::kInt16:
+        decodeFixed<int16_t>(cursor, h);
+        break;
+    case PrimitiveTypeDescriptor::kUInt16:
+        decodeFixed<uint16_t>(cursor, h);
+        break;
+    case PrimitiveTypeDescriptor::kInt32:
+        decodeFixed<int32_t>(cursor, h);
+        break;
+    case PrimitiveTypeDescriptor::kUInt32:
+        decodeFixed<uint32_t>(cursor, h);
+        break;
+    case PrimitiveTypeDescriptor::kInt64:
+        decodeFixed<int64_t>(cursor, h);
+        break;
+    case PrimitiveTypeDescriptor::kUInt64:
+        decodeFixed<uint64_t>(cursor, h);
+        break;
+    case PrimitiveTypeDescriptor::kFloat:
+        decodeFixed<float>(cursor, h);
+        break;
+    case PrimitiveTypeDescriptor::kDouble:
+        decodeFixed<double>(cursor, h);
+        break;
+    case PrimitiveTypeDescriptor::kLongDouble:
+        decodeFixed<long double>(cursor, h);
+        break;
+    case PrimitiveTypeDescriptor::kString:
+        cursor.readString(*h.get<string>());
+        break;
+    case PrimitiveTypeDescriptor::kInternedString:
+        *h.get<InternedString>() = InternedString(cursor.readStringView());
+        break;
+    case PrimitiveTypeDescriptor::kSharedString:
+        desc->setString(h, string(cursor.readStringView()));
+        break;
+    }
+}
@@ -0,0 +1,169 @@
+#ifndef REFCPP_BINARY_SCHEMA_HPP
+#define REFCPP_BINARY_SCHEMA_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ref/Holder.hpp>
+
+namespace ref
+{
+    struct TypeDescriptor;
+    struct ClassDescriptor;
+
+    /**
+     * @brief Returns a string that identifies the structure of a type.
+     *
+     * Classes are identified by their FQN only, so the signature of a
+     * type does not change when the features of a class it refers to do.
+     */
+    std::string getTypeSignature(const TypeDescriptor* desc);
+
+    /**
+     * @brief Layout of a class as written by BinarySerializer: the name
+     * and type signature of all its features, in order.
+     */
+    struct ClassSchema
+    {
+        struct Field
+        {
+            std::string name;
+            std::string signature;
+        };
+
+        std::string fqn;
+        std::vector<Field> fields;
+
+        /**
+         * @brief Hash of the fields. Two classes with the same fingerprint
+         * are read and written the same way.
+         */
+        std::uint64_t fingerprint;
+
+        ClassSchema() : fingerprint(0) {}
+
+        explicit ClassSchema(const ClassDescriptor* classDesc);
+
+        void updateFingerprint();
+    };
+
+    namespace detail
+    {
+        /**
+         * @brief Write helpers for the binary format. Fixed-size values
+         * are written in the byte order of the host.
+         */
+        template <typename T>
+        void appendFixed(std::string& out, T value)
+        {
+            out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        inline void appendVarint(std::string& out, std::uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                out += static_cast<char>((value & 0x7F) | 0x80);
+                value >>= 7;
+            }
+            out += static_cast<char>(value);
+        }
+
+        inline void appendString(std::string& out, const std::string& str)
+        {
+            appendVarint(out, str.size());
+            out += str;
+        }
+
+        /**
+         * @brief Bounds-checked cursor over an in-memory record.
+         */
+        struct BinaryCursor
+        {
+            const char* pos;
+            const char* end;
+
+            BinaryCursor() : pos(nullptr), end(nullptr) {}
+
+            BinaryCursor(const char* pos_, const char* end_)
+                : pos(pos_), end(end_)
+            {
+            }
+
+            const char* take(std::size_t size)
+            {
+                if (static_cast<std::size_t>(end - pos) < size)
+                    throw std::runtime_error("Truncated binary record");
+
+                const char* res = pos;
+                pos += size;
+                return res;
+            }
+
+            template <typename T>
+            T readFixed()
+            {
+                T value;
+                std::memcpy(&value, take(sizeof(T)), sizeof(T));
+                return value;
+            }
+
+            std::uint64_t readVarint()
+            {
+                std::uint64_t value = 0;
+                for (unsigned shift = 0; shift < 64; shift += 7)
+                {
+                    const unsigned char byte = *take(1);
+                    value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                    if (!(byte & 0x80)) return value;
+                }
+                throw std::runtime_error("Invalid varint");
+            }
+
+            std::string readString()
+            {
+                std::string value;
+                readString(value);
+                return value;
+            }
+
+            /**
+             * @brief Reads a string into an existing one, reusing its
+             * capacity.
+             */
+            void readString(std::string& value)
+            {
+                const std::string_view view = readStringView();
+                value.assign(view.data(), view.size());
+            }
+
+            /**
+             * @brief Reads a string without copying it out of the record.
+             */
+            std::string_view readStringView()
+            {
+                const std::uint64_t size = readVarint();
+                if (size > static_cast<std::uint64_t>(end - pos))
+                    throw std::runtime_error("Truncated binary record");
+                return std::string_view(take(size), size);
+            }
+        };
+
+        /**
+         * @brief Writes a primitive value: fixed-size values as in memory,
+         * and strings of every kind as their size and bytes, so that they
+         * can be read into any other kind of string.
+         */
+        void encodePrimitive(std::string& out, Holder h);
+
+        /**
+         * @brief Reads a primitive value written by encodePrimitive.
+         */
+        void decodePrimitive(BinaryCursor& cursor, Holder h);
+    }  // namespace detail
+}  // namespace ref
+
+#endif  // REFCPP_BINARY_SCHEMA_HPP
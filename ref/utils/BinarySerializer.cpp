@@ -0,0 +1,154 @@
+#include "BinarySerializer.hpp"
+#include <ref/Descriptors.hpp>
+#include <ref/Class.hpp>
+#include <limits>
+#include <stdexcept>
+
+using namespace ref;
+using namespace std;
+using namespace ref::detail;
+
+namespace
+{
+    const char magic[] = {'R', 'E', 'F', 'B'};
+    const uint8_t version = 1;
+
+    void patchSize(string& out, size_t pos)
+    {
+        const size_t size = out.size() - pos - sizeof(uint32_t);
+        if (size > numeric_limits<uint32_t>::max())
+            throw length_error("Binary value too large");
+
+        const uint32_t size32 = static_cast<uint32_t>(size);
+        out.replace(pos, sizeof(size32),
+                    reinterpret_cast<const char*>(&size32), sizeof(size32));
+    }
+} // namespace
+
+BinarySerializer::BinarySerializer(ostream& os)
+    : m_os(os), m_header(false)
+{
+}
+
+void BinarySerializer::serialize(ModelClass * obj)
+{
+    if (!m_header)
+    {
+        m_os.write(magic, sizeof(magic));
+        m_os.put(static_cast<char>(version));
+        m_header = true;
+    }
+
+    m_body.clear();
+    m_newClasses.clear();
+    writeObject(obj);
+
+    m_record.assign(sizeof(uint32_t), '\0');
+    appendVarint(m_record, m_newClasses.size());
+
+    for (auto classDesc : m_newClasses)
+    {
+        const ClassSchema schema(classDesc);
+
+        appendString(m_record, schema.fqn);
+        appendFixed(m_record, schema.fingerprint);
+        appendVarint(m_record, schema.fields.size());
+
+        for (const auto& field : schema.fields)
+        {
+            appendString(m_record, field.name);
+            appendString(m_record, field.signature);
+        }
+    }
+
+    m_record += m_body;
+    patchSize(m_record, 0);
+
+    m_os.write(m_record.data(), m_record.size());
+}
+
+const BinarySerializer::ClassInfo& BinarySerializer::getClassInfo(
+    const ClassDescriptor* classDesc)
+{
+    auto it = m_classes.find(classDesc);
+
+    if (it == m_classes.end())
+    {
+        ClassInfo info;
+        info.index = m_classes.size();
+
+        it = m_classes.insert(make_pair(classDesc, info)).first;
+        m_newClasses.push_back(classDesc);
+    }
+
+    return it->second;
+}
+
+void BinarySerializer::writeObject(ModelClass * obj)
+{
+    const ClassDescriptor * classDesc = obj->getClassDescriptor();
+    const ClassInfo& info = getClassInfo(classDesc);
+
+    appendVarint(m_body, info.index);
+
+    const Holder snapshot = classDesc->snapshot(obj);
+    classDesc->forEachFeature(
+        classDesc->get(snapshot),
+        [this](const FeatureDescriptor * feature, Holder value) {
+            const size_t pos = m_body.size();
+            m_body.append(sizeof(uint32_t), '\0');
+
+            writeValue(value);
+            patchSize(m_body, pos);
+        });
+}
+
+void BinarySerializer::writeValue(Holder h)
+{
+    auto desc = h.descriptor();
+
+    switch (desc->getKind())
+    {
+    case TypeDescriptor::kPrimitive:
+        encodePrimitive(m_body, h);
+        break;
+    case TypeDescriptor::kClass:
+        writeObject(desc->as<ClassDescriptor>()->get(h));
+        break;
+    case TypeDescriptor::kPair:
+        {
+            const auto value = desc->as<PairTypeDescriptor>()->getValue(h);
+            writeValue(value.first);
+            writeValue(value.second);
+        }
+        break;
+    case TypeDescriptor::kMap:
+    case TypeDescriptor::kList:
+    case TypeDescriptor::kSet:
+        {
+            const auto values = desc->as<ContainerTypeDescriptor>()->getValue(h);
+
+            appendVarint(m_body, values.size());
+            for (const auto& value : values)
+                writeValue(value);
+        }
+        break;
+    case TypeDescriptor::kPointer:
+        {
+            auto ptrDesc = desc->as<PointerTypeDescriptor>();
+
+            if (ptrDesc->isOwner() && !ptrDesc->isNull(h))
+            {
+                m_body += '\1';
+                writeValue(ptrDesc->dereference(h));
+            }
+            else
+            {
+                m_body += '\0';
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef REFCPP_BINARY_SERIALIZER_HPP
+#define REFCPP_BINARY_SERIALIZER_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <ref/Holder.hpp>
+#include "BinarySchema.hpp"
+
+namespace ref
+{
+    struct ModelClass;
+    struct FeatureDescriptor;
+
+    /**
+     * @brief Writes objects in a compact binary format that carries the
+     * schema of their classes, so it can be read by a different version
+     * of the model.
+     *
+     * A stream is a header followed by one record per serialized object:
+     *
+     *     stream   := "REFB" version:u8 record*
+     *     record   := size:u32 count:varint class{count} object
+     *     class    := fqn:string fingerprint:u64 count:varint
+     *                 (name:string signature:string){count}
+     *     object   := class-index:varint (size:u32 value)*
+     *
+     * Each class is described in the first record that uses it and then
+     * referred to by index. Every feature value is prefixed with its size
+     * so readers can skip features they do not know. Objects in
+     * collections and shared or unique pointers are written inline. Raw
+     * and weak pointers are written as null.
+     */
+    struct BinarySerializer
+    {
+        BinarySerializer(std::ostream& os);
+
+        void serialize(ModelClass * obj);
+
+    protected:
+        struct ClassInfo
+        {
+            std::size_t index;
+        };
+
+        std::ostream& m_os;
+        bool m_header;
+        std::unordered_map<const ClassDescriptor*, ClassInfo> m_classes;
+        std::vector<const ClassDescriptor*> m_newClasses;
+        std::string m_body;
+        std::string m_record;
+
+        const ClassInfo& getClassInfo(const ClassDescriptor* classDesc);
+
+        void writeObject(ModelClass * obj);
+        void writeValue(Holder h);
+    };
+} // namespace ref
+
+#endif // REFCPP_BINARY_SERIALIZER_HPP
@@ -0,0 +1,334 @@
+#include "ColumnarFormat.hpp"
+#include <ref/Descriptors.hpp>
+#include <ref/DescriptorRegistry.hpp>
+#include <ref/InternedString.hpp>
+#include <ref/Class.hpp>
+#include <stdexcept>
+
+using namespace ref;
+using namespace std;
+using namespace ref::detail;
+
+namespace
+{
+    template <typename T>
+    uint64_t load(Holder h)
+    {
+        // Converted through the 64-bit type of the same signedness
+        typedef typename conditional<is_signed<T>::value, int64_t,
+                                     uint64_t>::type Wide;
+        return static_cast<uint64_t>(static_cast<Wide>(*h.get<T>()));
+    }
+
+    template <typename T>
+    void store(Holder h, uint64_t value)
+    {
+        *h.get<T>() = static_cast<T>(value);
+    }
+}  // namespace
+
+ColumnKind ref::detail::getColumnKind(const TypeDescriptor* desc)
+{
+    if (desc->getKind() != TypeDescriptor::kPrimitive) return kPlainColumn;
+
+    switch (desc->as<PrimitiveTypeDescriptor>()->getPrimitiveKind())
+    {
+    case PrimitiveTypeDescriptor::kBool:
+        return kBoolColumn;
+    case PrimitiveTypeDescriptor::kChar:
+    case PrimitiveTypeDescriptor::kInt8:
+    case PrimitiveTypeDescriptor::kUInt8:
+    case PrimitiveTypeDescriptor::kInt16:
+    case PrimitiveTypeDescriptor::kUInt16:
+    case PrimitiveTypeDescriptor::kInt32:
+    case PrimitiveTypeDescriptor::kUInt32:
+    case PrimitiveTypeDescriptor::kInt64:
+    case PrimitiveTypeDescriptor::kUInt64:
+        return kIntegerColumn;
+    case PrimitiveTypeDescriptor::kString:
+    case PrimitiveTypeDescriptor::kInternedString:
+        return kStringColumn;
+    default:
+        break;
+    }
+    return kPlainColumn;
+}
+
+uint64_t ref::detail::loadInteger(Holder h)
+{
+    switch (h.descriptor()->as<PrimitiveTypeDescriptor>()->getPrimitiveKind())
+    {
+    case PrimitiveTypeDescriptor::kChar: return load<char>(h);
+    case PrimitiveTypeDescriptor::kInt8: return load<int8_t>(h);
+    case PrimitiveTypeDescriptor::kUInt8: return load<uint8_t>(h);
+    case PrimitiveTypeDescriptor::kInt16: return load<int16_t>(h);
+    case PrimitiveTypeDescriptor::kUInt16: return load<uint16_t>(h);
+    case PrimitiveTypeDescriptor::kInt32: return load<int32_t>(h);
+    case PrimitiveTypeDescriptor::kUInt32: return load<uint32_t>(h);
+    case PrimitiveTypeDescriptor::kInt64: return load<int64_t>(h);
+    case PrimitiveTypeDescriptor::kUInt64: return load<uint64_t>(h);
+    default: break;
+    }
+    throw logic_error("Not an integer column");
+}
+
+void ref::detail::storeInteger(Holder h, uint64_t value)
+{
+    switch (h.descriptor()->as<PrimitiveTypeDescriptor>()->getPrimitiveKind())
+    {
+    case PrimitiveTypeDescriptor::kChar: return store<char>(h, value);
+    case PrimitiveTypeDescriptor::kInt8: return store<int8_t>(h, value);
+    case PrimitiveTypeDescriptor::kUInt8: return store<uint8_t>(h, value);
+    case PrimitiveTypeDescriptor::kInt16: return store<int16_t>(h, value);
+    case PrimitiveTypeDescriptor::kUInt16: return store<uint16_t>(h, value);
+    case PrimitiveTypeDescriptor::kInt32: return store<int32_t>(h, value);
+    case PrimitiveTypeDescriptor::kUInt32: return store<uint32_t>(h, value);
+    case PrimitiveTypeDescriptor::kInt64: return store<int64_t>(h, value);
+    case PrimitiveTypeDescriptor::kUInt64: return store<uint64_t>(h, value);
+    default: break;
+    }
+    throw logic_error("Not an integer column");
+}
+
+void ref::detail::storeString(Holder h, string_view value)
+{
+    if (h.descriptor()->as<PrimitiveTypeDescriptor>()->getPrimitiveKind() ==
+        PrimitiveTypeDescriptor::kInternedString)
+    {
+        *h.get<InternedString>() = InternedString(value);
+    }
+    else
+    {
+        h.get<string>()->assign(value.data(), value.size());
+    }
+}
+
+unsigned ref::detail::bitWidth(uint64_t value)
+{
+    unsigned width = 0;
+    for (; value; value >>= 1)
+        ++width;
+    return width;
+}
+
+void ref::detail::appendBits(string& out, const vector<uint64_t>& values,
+                             unsigned width)
+{
+    unsigned char current = 0;
+    unsigned used = 0;
+
+    for (uint64_t value : values)
+    {
+        for (unsigned left = width; left;)
+        {
+            const unsigned take = min(left, 8 - used);
+            current |= static_cast<unsigned char>(
+                (value & ((1u << take) - 1)) << used);
+
+            value >>= take;
+            left -= take;
+            used += take;
+
+            if (used == 8)
+            {
+                out += static_cast<char>(current);
+                current = 0;
+                used = 0;
+            }
+        }
+    }
+
+    if (used) out += static_cast<char>(current);
+}
+
+BitReader::BitReader(BinaryCursor& cursor, uint64_t count, unsigned width)
+    : data(), bit(0)
+{
+    if (width > 64) throw runtime_error("Invalid bit width");
+
+    const uint64_t available = static_cast<uint64_t>(cursor.end - cursor.pos);
+    if (width && count > available * 8 / width)
+        throw runtime_error("Truncated column chunk");
+
+    data = reinterpret_cast<const unsigned char*>(
+        cursor.take((count * width + 7) / 8));
+}
+
+uint64_t BitReader::read(unsigned width)
+{
+    uint64_t value = 0;
+
+    for (unsigned done = 0; done < width;)
+    {
+        const unsigned offset = bit & 7;
+        const unsigned take = min(width - done, 8 - offset);
+        const uint64_t bits = (data[bit >> 3] >> offset) & ((1u << take) - 1);
+
+        value |= bits << done;
+        done += take;
+        bit += take;
+    }
+    return value;
+}
+
+void ref::detail::encodePlainValue(string& out, Holder h)
+{
+    auto desc = h.descriptor();
+
+    switch (desc->getKind())
+    {
+    case TypeDescriptor::kPrimitive:
+        encodePrimitive(out, h);
+        break;
+    case TypeDescriptor::kClass:
+        {
+            ModelClass* obj = desc->as<ClassDescriptor>()->get(h);
+            const ClassDescriptor* classDesc = obj->getClassDescriptor();
+            const Holder snapshot = classDesc->snapshot(obj);
+            classDesc->forEachFeature(
+                classDesc->get(snapshot),
+                [&](const FeatureDescriptor*, Holder value) {
+                    encodePlainValue(out, value);
+                });
+        }
+        break;
+    case TypeDescriptor::kPair:
+        {
+            const auto value = desc->as<PairTypeDescriptor>()->getValue(h);
+            encodePlainValue(out, value.first);
+            encodePlainValue(out, value.second);
+        }
+        break;
+    case TypeDescriptor::kList:
+    case TypeDescriptor::kSet:
+    case TypeDescriptor::kMap:
+        {
+            const auto values =
+                desc->as<ContainerTypeDescriptor>()->getValue(h);
+
+            appendVarint(out, values.size());
+            for (const auto& value : values)
+                encodePlainValue(out, value);
+        }
+        break;
+    case TypeDescriptor::kPointer:
+        {
+            // Pointers that do not own their value are written as null
+            auto ptrDesc = desc->as<PointerTypeDescriptor>();
+            if (!ptrDesc->isOwner() || ptrDesc->isNull(h))
+            {
+                out += '\0';
+                break;
+            }
+
+            out += '\1';
+            Holder value = ptrDesc->dereference(h);
+
+            if (value.descriptor()->getKind() == TypeDescriptor::kClass)
+            {
+                // Objects are written with their dynamic class
+                ModelClass* obj =
+                    value.descriptor()->as<ClassDescriptor>()->get(value);
+                appendFixed(out, obj->getClassDescriptor()->getTypeId());
+            }
+            encodePlainValue(out, value);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void ref::detail::decodePlainValue(BinaryCursor& cursor, Holder h)
+{
+    auto desc = h.descriptor();
+
+    switch (desc->getKind())
+    {
+    case TypeDescriptor::kPrimitive:
+        decodePrimitive(cursor, h);
+        break;
+    case TypeDescriptor::kClass:
+        {
+            ModelClass* obj = desc->as<ClassDescriptor>()->get(h);
+            obj->getClassDescriptor()->forEachFeature(
+                obj, [&](const FeatureDescriptor*, Holder value) {
+                    decodePlainValue(cursor, value);
+                });
+        }
+        break;
+    case TypeDescriptor::kPair:
+        {
+            const auto value = desc->as<PairTypeDescriptor>()->getValue(h);
+            decodePlainValue(cursor, value.first);
+            decodePlainValue(cursor, value.second);
+        }
+        break;
+    case TypeDescriptor::kList:
+        {
+            auto listDesc = desc->as<ListTypeDescriptor>();
+            const uint64_t count = cursor.readVarint();
+
+            listDesc->resize(h, count);
+            const uint64_t size = min<uint64_t>(count, listDesc->getSize(h));
+
+            for (uint64_t i = 0; i < size; i++)
+                decodePlainValue(cursor, listDesc->getElement(h, i));
+
+            // Beyond the capacity of fixed-size lists
+            if (size < count)
+            {
+                Holder scratch = listDesc->getValueTypeDescriptor()->create();
+                for (uint64_t i = size; i < count; i++)
+                    decodePlainValue(cursor, scratch);
+            }
+        }
+        break;
+    case TypeDescriptor::kSet:
+    case TypeDescriptor::kMap:
+        {
+            auto containerDesc = desc->as<ContainerTypeDescriptor>();
+            auto valueDesc = containerDesc->getValueTypeDescriptor();
+            const uint64_t count = cursor.readVarint();
+
+            vector<Holder> values;
+            for (uint64_t i = 0; i < count; i++)
+            {
+                values.push_back(valueDesc->create());
+                decodePlainValue(cursor, values.back());
+            }
+
+            containerDesc->setValue(h, values);
+        }
+        break;
+    case TypeDescriptor::kPointer:
+        {
+            auto ptrDesc = desc->as<PointerTypeDescriptor>();
+            if (!cursor.readFixed<uint8_t>())
+            {
+                ptrDesc->reset(h);
+                break;
+            }
+
+            const TypeDescriptor* valueDesc =
+                ptrDesc->getPointedTypeDescriptor();
+
+            if (valueDesc->getKind() == TypeDescriptor::kClass)
+            {
+                const auto id = cursor.readFixed<uint64_t>();
+                valueDesc = DescriptorRegistry::instance().findById(id);
+                if (!valueDesc)
+                    throw runtime_error("Unknown class in column chunk");
+            }
+
+            Holder value = ptrDesc->emplace(h, valueDesc);
+            if (!value.isValid())
+                throw runtime_error("Cannot create " + valueDesc->getFqn());
+
+            decodePlainValue(cursor, value);
+        }
+        break;
+    default:
+        break;
+    }
+}
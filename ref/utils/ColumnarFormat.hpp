@@ -0,0 +1,115 @@
+#ifndef REFCPP_COLUMNAR_FORMAT_HPP
+#define REFCPP_COLUMNAR_FORMAT_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ref/Holder.hpp>
+#include "BinarySchema.hpp"
+
+namespace ref
+{
+    struct TypeDescriptor;
+
+    namespace detail
+    {
+        /**
+         * @brief Layout shared by ColumnarWriter and ColumnarReader:
+         *
+         *     file    := "REFC" version:u8 group* footer size:u32 "REFC"
+         *     group   := chunk*
+         *     chunk   := encoding:u8 data
+         *     footer  := fqn:string fingerprint:u64 count:varint
+         *                (name:string signature:string){count}
+         *                groups:varint
+         *                (rows:varint (offset:varint size:varint){count})*
+         *
+         * Each row group holds a chunk per feature of the class, in the
+         * order of the schema. The footer gives the offset of every chunk,
+         * so readers only read the row groups and columns they need.
+         */
+        const char columnarMagic[] = {'R', 'E', 'F', 'C'};
+        const std::uint8_t columnarVersion = 1;
+
+        enum ColumnEncoding : std::uint8_t
+        {
+            // Every value in turn, as the transaction log writes them
+            kPlainEncoding = 0,
+            // First value, then bit-packed deltas over the smallest one
+            kDeltaEncoding = 1,
+            // Distinct strings, then bit-packed indices into them
+            kDictionaryEncoding = 2,
+            // Lengths of alternating runs of false and true
+            kRunLengthEncoding = 3
+        };
+
+        enum ColumnKind
+        {
+            kIntegerColumn, kBoolColumn, kStringColumn, kPlainColumn
+        };
+
+        ColumnKind getColumnKind(const TypeDescriptor* desc);
+
+        struct ColumnChunk
+        {
+            std::uint64_t offset;
+            std::uint64_t size;
+        };
+
+        struct RowGroup
+        {
+            std::uint64_t rows;
+            std::vector<ColumnChunk> chunks;
+        };
+
+        /**
+         * @brief Integers of any size as 64 bits, sign-extended for signed
+         * types, so deltas wrap around the same way for all of them.
+         */
+        std::uint64_t loadInteger(Holder h);
+        void storeInteger(Holder h, std::uint64_t value);
+
+        void storeString(Holder h, std::string_view value);
+
+        inline std::uint64_t zigzag(std::int64_t value)
+        {
+            return (static_cast<std::uint64_t>(value) << 1) ^
+                   static_cast<std::uint64_t>(value >> 63);
+        }
+
+        inline std::int64_t unzigzag(std::uint64_t value)
+        {
+            return static_cast<std::int64_t>((value >> 1) ^ (0 - (value & 1)));
+        }
+
+        unsigned bitWidth(std::uint64_t value);
+
+        /**
+         * @brief Appends the lowest width bits of each value, least
+         * significant first.
+         */
+        void appendBits(std::string& out,
+                        const std::vector<std::uint64_t>& values,
+                        unsigned width);
+
+        struct BitReader
+        {
+            const unsigned char* data;
+            std::uint64_t bit;
+
+            /**
+             * @brief Takes the bits of count values from the cursor.
+             */
+            BitReader(BinaryCursor& cursor, std::uint64_t count,
+                      unsigned width);
+
+            std::uint64_t read(unsigned width);
+        };
+
+        void encodePlainValue(std::string& out, Holder h);
+        void decodePlainValue(BinaryCursor& cursor, Holder h);
+    }  // namespace detail
+}  // namespace ref
+
+#endif  // REFCPP_COLUMNAR_FORMAT_HPP
@@ -0,0 +1,372 @@
+#include "ColumnarReader.hpp"
+#include <ref/Descriptors.hpp>
+#include <ref/DescriptorRegistry.hpp>
+#include <ref/Class.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace ref;
+using namespace std;
+using namespace ref::detail;
+
+namespace
+{
+    // Size and magic at the end of the file
+    const size_t trailerSize = sizeof(uint32_t) + sizeof(columnarMagic);
+    const size_t headerSize = sizeof(columnarMagic) + 1;
+}  // namespace
+
+ColumnarReader::ColumnarReader(istream& is)
+    : m_is(is), m_classDesc(nullptr)
+{
+    readFooter();
+}
+
+ColumnarReader::ColumnarReader(istream& is, const ClassDescriptor* classDesc)
+    : m_is(is), m_classDesc(classDesc)
+{
+    readFooter();
+}
+
+const ClassSchema& ColumnarReader::getSchema() const
+{
+    return m_schema;
+}
+
+size_t ColumnarReader::getRowCount() const
+{
+    size_t rows = 0;
+    for (const auto& group : m_groups)
+        rows += group.rows;
+    return rows;
+}
+
+size_t ColumnarReader::getRowGroupCount() const
+{
+    return m_groups.size();
+}
+
+size_t ColumnarReader::getRowCount(size_t group) const
+{
+    return m_groups.at(group).rows;
+}
+
+void ColumnarReader::readFooter()
+{
+    m_is.seekg(0, ios::end);
+    const streamoff size = m_is.tellg();
+    if (size < static_cast<streamoff>(headerSize + trailerSize))
+        throw runtime_error("Invalid columnar file");
+
+    char header[headerSize];
+    m_is.seekg(0);
+    m_is.read(header, sizeof(header));
+    const uint8_t version = header[sizeof(columnarMagic)];
+    if (!m_is || memcmp(header, columnarMagic, sizeof(columnarMagic)) ||
+        version != columnarVersion)
+    {
+        throw runtime_error("Invalid columnar file header");
+    }
+
+    char trailer[trailerSize];
+    m_is.seekg(size - static_cast<streamoff>(trailerSize));
+    m_is.read(trailer, sizeof(trailer));
+
+    uint32_t footerSize;
+    memcpy(&footerSize, trailer, sizeof(footerSize));
+    if (!m_is || memcmp(trailer + sizeof(footerSize), columnarMagic,
+                        sizeof(columnarMagic)))
+    {
+        throw runtime_error("Invalid columnar file trailer");
+    }
+
+    const uint64_t dataEnd = size - trailerSize;
+    if (footerSize > dataEnd - headerSize)
+        throw runtime_error("Invalid columnar file trailer");
+
+    string footer(footerSize, '\0');
+    m_is.seekg(dataEnd - footerSize);
+    m_is.read(&footer[0], footerSize);
+    if (!m_is) throw runtime_error("Truncated columnar file");
+
+    BinaryCursor cursor(footer.data(), footer.data() + footer.size());
+
+    m_schema.fqn = cursor.readString();
+    const uint64_t fingerprint = cursor.readFixed<uint64_t>();
+
+    for (uint64_t fields = cursor.readVarint(); fields; --fields)
+    {
+        ClassSchema::Field field;
+        field.name = cursor.readString();
+        field.signature = cursor.readString();
+        m_schema.fields.push_back(field);
+    }
+    m_schema.fingerprint = fingerprint;
+
+    const uint64_t chunksEnd = dataEnd - footerSize;
+    for (uint64_t groups = cursor.readVarint(); groups; --groups)
+    {
+        RowGroup group;
+        group.rows = cursor.readVarint();
+
+        for (size_t i = 0; i < m_schema.fields.size(); i++)
+        {
+            ColumnChunk chunk;
+            chunk.offset = cursor.readVarint();
+            chunk.size = cursor.readVarint();
+
+            if (chunk.offset < headerSize || chunk.offset > chunksEnd ||
+                chunk.size > chunksEnd - chunk.offset)
+            {
+                throw runtime_error("Invalid column chunk");
+            }
+            group.chunks.push_back(chunk);
+        }
+        m_groups.push_back(group);
+    }
+
+    if (cursor.pos != cursor.end)
+        throw runtime_error("Invalid columnar file footer");
+
+    if (!m_classDesc)
+        m_classDesc = DescriptorRegistry::instance().findByFqn(m_schema.fqn);
+    if (!m_classDesc) throw runtime_error("Unknown class: " + m_schema.fqn);
+
+    unordered_map<string, const FeatureDescriptor*> features;
+    for (auto feature : m_classDesc->getAllFeatureDescriptors())
+        features[feature->getName()] = feature;
+
+    for (const auto& field : m_schema.fields)
+    {
+        auto it = features.find(field.name);
+        const bool matches =
+            it != features.end() &&
+            getTypeSignature(it->second->getTypeDescriptor()) ==
+                field.signature;
+
+        m_plan.push_back(matches ? it->second : nullptr);
+    }
+
+    m_projection = m_plan;
+}
+
+void ColumnarReader::project(const vector<string>& features)
+{
+    if (features.empty())
+    {
+        m_projection = m_plan;
+        return;
+    }
+
+    const unordered_set<string> names(features.begin(), features.end());
+    for (size_t i = 0; i < m_plan.size(); i++)
+    {
+        m_projection[i] =
+            names.count(m_schema.fields[i].name) ? m_plan[i] : nullptr;
+    }
+}
+
+/**
+ * Reads the projected chunks of a row group, seeking only between those
+ * that are not contiguous in the file.
+ */
+string ColumnarReader::readChunks(size_t group, vector<ColumnChunk>& chunks)
+{
+    const RowGroup& info = m_groups.at(group);
+
+    string data;
+    uint64_t position = numeric_limits<uint64_t>::max();
+    chunks.assign(info.chunks.size(), ColumnChunk{0, 0});
+
+    for (size_t i = 0; i < info.chunks.size(); i++)
+    {
+        if (!m_projection[i]) continue;
+
+        const ColumnChunk& chunk = info.chunks[i];
+        if (chunk.offset != position) m_is.seekg(chunk.offset);
+
+        chunks[i] = ColumnChunk{data.size(), chunk.size};
+        data.resize(data.size() + chunk.size);
+        m_is.read(&data[chunks[i].offset], chunk.size);
+        if (!m_is) throw runtime_error("Truncated columnar file");
+
+        position = chunk.offset + chunk.size;
+    }
+
+    return data;
+}
+
+vector<Holder> ColumnarReader::readRowGroup(size_t group)
+{
+    vector<ColumnChunk> chunks;
+    const string data = readChunks(group, chunks);
+
+    vector<Holder> objects(m_groups[group].rows);
+    for (auto& obj : objects)
+        obj = m_classDesc->create();
+
+    decodeRowGroup(group, data, chunks, objects.data());
+    return objects;
+}
+
+vector<Holder> ColumnarReader::readAll(unsigned threads)
+{
+    const size_t count = m_groups.size();
+
+    vector<string> data(count);
+    vector<vector<ColumnChunk> > chunks(count);
+    vector<size_t> begin(count + 1, 0);
+
+    for (size_t group = 0; group < count; group++)
+    {
+        data[group] = readChunks(group, chunks[group]);
+        begin[group + 1] = begin[group] + m_groups[group].rows;
+    }
+
+    vector<Holder> objects(begin[count]);
+
+    atomic<size_t> next(0);
+    exception_ptr error;
+    mutex errorMutex;
+
+    const auto decode = [&]() {
+        for (size_t group; (group = next++) < count;)
+        {
+            try
+            {
+                for (size_t i = begin[group]; i < begin[group + 1]; i++)
+                    objects[i] = m_classDesc->create();
+
+                decodeRowGroup(group, data[group], chunks[group],
+                               objects.data() + begin[group]);
+            }
+            catch (...)
+            {
+                lock_guard<mutex> lock(errorMutex);
+                if (!error) error = current_exception();
+            }
+
+            // Decoded chunks are no longer needed
+            string().swap(data[group]);
+        }
+    };
+
+    vector<thread> workers;
+    const size_t extra = min<size_t>(max(threads, 1u), count) - (count ? 1 : 0);
+    for (size_t i = 0; i < extra; i++)
+        workers.emplace_back(decode);
+
+    decode();
+    for (auto& worker : workers)
+        worker.join();
+
+    if (error) rethrow_exception(error);
+    return objects;
+}
+
+void ColumnarReader::decodeRowGroup(size_t group, const string& data,
+                                    const vector<ColumnChunk>& chunks,
+                                    Holder * objects) const
+{
+    for (size_t i = 0; i < m_projection.size(); i++)
+    {
+        if (!m_projection[i]) continue;
+
+        const char* pos = data.data() + chunks[i].offset;
+        decodeColumn(m_projection[i], BinaryCursor(pos, pos + chunks[i].size),
+                     m_groups[group].rows, objects);
+    }
+}
+
+void ColumnarReader::decodeColumn(const FeatureDescriptor* feature,
+                                  BinaryCursor cursor, uint64_t rows,
+                                  Holder * objects) const
+{
+    const auto value = [&](uint64_t row) {
+        return feature->getValue(m_classDesc->get(objects[row]));
+    };
+
+    const ColumnKind kind = getColumnKind(feature->getTypeDescriptor());
+    const auto encoding = cursor.readFixed<uint8_t>();
+
+    switch (encoding)
+    {
+    case kPlainEncoding:
+        for (uint64_t row = 0; row < rows; row++)
+            decodePlainValue(cursor, value(row));
+        break;
+    case kDeltaEncoding:
+        {
+            if (kind != kIntegerColumn || !rows) break;
+
+            uint64_t current = unzigzag(cursor.readVarint());
+            const uint64_t minDelta = unzigzag(cursor.readVarint());
+            const unsigned width = cursor.readFixed<uint8_t>();
+
+            BitReader bits(cursor, rows - 1, width);
+
+            storeInteger(value(0), current);
+            for (uint64_t row = 1; row < rows; row++)
+            {
+                current += minDelta + bits.read(width);
+                storeInteger(value(row), current);
+            }
+        }
+        break;
+    case kDictionaryEncoding:
+        {
+            if (kind != kStringColumn) break;
+
+            // Every entry takes at least one byte
+            const uint64_t size = cursor.readVarint();
+            if (size > static_cast<uint64_t>(cursor.end - cursor.pos))
+                throw runtime_error("Truncated column chunk");
+
+            vector<string_view> dictionary;
+            dictionary.reserve(size);
+            for (uint64_t i = 0; i < size; i++)
+                dictionary.push_back(cursor.readStringView());
+
+            const unsigned width = cursor.readFixed<uint8_t>();
+            BitReader bits(cursor, rows, width);
+
+            for (uint64_t row = 0; row < rows; row++)
+            {
+                const uint64_t index = bits.read(width);
+                if (index >= size) throw runtime_error("Invalid column chunk");
+                storeString(value(row), dictionary[index]);
+            }
+        }
+        break;
+    case kRunLengthEncoding:
+        {
+            if (kind != kBoolColumn) break;
+
+            bool current = false;
+            for (uint64_t row = 0; row < rows; current = !current)
+            {
+                const uint64_t run = cursor.readVarint();
+                if (run > rows - row)
+                    throw runtime_error("Invalid column chunk");
+
+                for (const uint64_t end = row + run; row < end; row++)
+                    *value(row).get<bool>() = current;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (cursor.pos != cursor.end)
+        throw runtime_error("Corrupted column chunk");
+}
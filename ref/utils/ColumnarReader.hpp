@@ -0,0 +1,94 @@
+#ifndef REFCPP_COLUMNAR_READER_HPP
+#define REFCPP_COLUMNAR_READER_HPP
+
+#include <istream>
+#include <string>
+#include <vector>
+#include <ref/Holder.hpp>
+#include "BinarySchema.hpp"
+#include "ColumnarFormat.hpp"
+
+namespace ref
+{
+    struct ModelClass;
+    struct ClassDescriptor;
+    struct FeatureDescriptor;
+
+    /**
+     * @brief Reads files written by ColumnarWriter.
+     *
+     * The footer is read first, so the stream must be seekable. Row
+     * groups can then be read in any order, and only the chunks of the
+     * projected features are read from the stream and decoded.
+     *
+     * Columns are mapped to the features of the local class of the same
+     * FQN by name, as BinaryDeserializer does: those whose type signature
+     * differs are skipped. Features that are not read keep the value they
+     * have in a new instance of the class.
+     *
+     * Malformed files throw std::runtime_error.
+     */
+    struct ColumnarReader
+    {
+        ColumnarReader(std::istream& is);
+
+        /**
+         * @param classDesc The class to read into, instead of the one of
+         * the same FQN in the registry.
+         */
+        ColumnarReader(std::istream& is, const ClassDescriptor* classDesc);
+
+        const ClassSchema& getSchema() const;
+
+        std::size_t getRowCount() const;
+
+        std::size_t getRowGroupCount() const;
+
+        std::size_t getRowCount(std::size_t group) const;
+
+        /**
+         * @brief Restricts reading to the features with the given names.
+         * An empty list reads every feature again.
+         */
+        void project(const std::vector<std::string>& features);
+
+        /**
+         * @brief Reads the objects of a row group into new instances.
+         */
+        std::vector<Holder> readRowGroup(std::size_t group);
+
+        /**
+         * @brief Reads every row group into new instances, in order.
+         *
+         * Chunks are read from the stream by the calling thread, and row
+         * groups are decoded by up to the given number of threads.
+         */
+        std::vector<Holder> readAll(unsigned threads = 1);
+
+    protected:
+        typedef std::vector<const FeatureDescriptor*> Plan;
+
+        std::istream& m_is;
+        ClassSchema m_schema;
+        const ClassDescriptor* m_classDesc;
+        std::vector<detail::RowGroup> m_groups;
+        // Local feature for each column, null to skip it
+        Plan m_plan;
+        Plan m_projection;
+
+        void readFooter();
+
+        std::string readChunks(std::size_t group,
+                               std::vector<detail::ColumnChunk>& chunks);
+
+        void decodeRowGroup(std::size_t group, const std::string& data,
+                            const std::vector<detail::ColumnChunk>& chunks,
+                            Holder * objects) const;
+
+        void decodeColumn(const FeatureDescriptor* feature,
+                          detail::BinaryCursor cursor, std::uint64_t rows,
+                          Holder * objects) const;
+    };
+}  // namespace ref
+
+#endif  // REFCPP_COLUMNAR_READER_HPP
@@ -0,0 +1,263 @@
+#include "ColumnarWriter.hpp"
+#include <ref/Descriptors.hpp>
+#include <ref/InternedString.hpp>
+#include <ref/Class.hpp>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+using namespace ref;
+using namespace std;
+using namespace ref::detail;
+
+struct ColumnarWriter::Column
+{
+    ColumnKind kind;
+    bool interned;
+
+    // Values of the pending rows, by kind
+    vector<uint64_t> integers;
+    vector<bool> bools;
+    vector<string> strings;
+    string plain;
+
+    Column(const TypeDescriptor* desc)
+        : kind(getColumnKind(desc)),
+          interned(kind == kStringColumn &&
+                   desc->as<PrimitiveTypeDescriptor>()->getPrimitiveKind() ==
+                       PrimitiveTypeDescriptor::kInternedString)
+    {
+    }
+
+    void append(Holder h)
+    {
+        switch (kind)
+        {
+        case kIntegerColumn:
+            integers.push_back(loadInteger(h));
+            break;
+        case kBoolColumn:
+            bools.push_back(*h.get<bool>());
+            break;
+        case kStringColumn:
+            if (interned)
+                strings.push_back(h.get<InternedString>()->str());
+            else
+                strings.push_back(*h.get<string>());
+            break;
+        case kPlainColumn:
+            encodePlainValue(plain, h);
+            break;
+        }
+    }
+
+    void encode(string& out)
+    {
+        switch (kind)
+        {
+        case kIntegerColumn:
+            encodeIntegers(out);
+            integers.clear();
+            break;
+        case kBoolColumn:
+            encodeBools(out);
+            bools.clear();
+            break;
+        case kStringColumn:
+            encodeStrings(out);
+            strings.clear();
+            break;
+        case kPlainColumn:
+            out += static_cast<char>(kPlainEncoding);
+            out += plain;
+            plain.clear();
+            break;
+        }
+    }
+
+    void encodeIntegers(string& out)
+    {
+        out += static_cast<char>(kDeltaEncoding);
+        appendVarint(out, zigzag(static_cast<int64_t>(integers[0])));
+
+        int64_t minDelta = numeric_limits<int64_t>::max();
+        for (size_t i = 1; i < integers.size(); i++)
+        {
+            minDelta = min(minDelta,
+                           static_cast<int64_t>(integers[i] - integers[i - 1]));
+        }
+        if (integers.size() == 1) minDelta = 0;
+
+        // Deltas over the smallest one, which no longer need a sign
+        vector<uint64_t> deltas;
+        deltas.reserve(integers.size() - 1);
+        uint64_t maxDelta = 0;
+
+        for (size_t i = 1; i < integers.size(); i++)
+        {
+            const uint64_t delta = integers[i] - integers[i - 1] -
+                                   static_cast<uint64_t>(minDelta);
+            deltas.push_back(delta);
+            maxDelta = max(maxDelta, delta);
+        }
+
+        const unsigned width = bitWidth(maxDelta);
+        appendVarint(out, zigzag(minDelta));
+        out += static_cast<char>(width);
+        appendBits(out, deltas, width);
+    }
+
+    void encodeBools(string& out)
+    {
+        out += static_cast<char>(kRunLengthEncoding);
+
+        bool current = false;
+        uint64_t run = 0;
+        for (bool value : bools)
+        {
+            if (value != current)
+            {
+                appendVarint(out, run);
+                current = value;
+                run = 0;
+            }
+            ++run;
+        }
+        appendVarint(out, run);
+    }
+
+    void encodeStrings(string& out)
+    {
+        unordered_map<string_view, uint64_t> ids;
+        vector<uint64_t> indices;
+        indices.reserve(strings.size());
+
+        for (const auto& value : strings)
+            indices.push_back(ids.emplace(value, ids.size()).first->second);
+
+        // A dictionary of mostly distinct values only adds the indices
+        if (ids.size() * 2 > strings.size())
+        {
+            out += static_cast<char>(kPlainEncoding);
+            for (const auto& value : strings)
+                appendString(out, value);
+            return;
+        }
+
+        vector<string_view> dictionary(ids.size());
+        for (const auto& id : ids)
+            dictionary[id.second] = id.first;
+
+        out += static_cast<char>(kDictionaryEncoding);
+        appendVarint(out, dictionary.size());
+        for (const auto& value : dictionary)
+        {
+            appendVarint(out, value.size());
+            out.append(value.data(), value.size());
+        }
+
+        const unsigned width = bitWidth(dictionary.size() - 1);
+        out += static_cast<char>(width);
+        appendBits(out, indices, width);
+    }
+};
+
+ColumnarWriter::ColumnarWriter(ostream& os, const ClassDescriptor* classDesc,
+                               size_t rowGroupSize)
+    : m_os(os), m_classDesc(classDesc),
+      m_rowGroupSize(max<size_t>(rowGroupSize, 1)), m_schema(classDesc),
+      m_features(classDesc->getAllFeatureDescriptors()), m_rows(0),
+      m_offset(0), m_closed(false)
+{
+    for (auto feature : m_features)
+        m_columns.emplace_back(feature->getTypeDescriptor());
+
+    m_os.write(columnarMagic, sizeof(columnarMagic));
+    m_os.put(static_cast<char>(columnarVersion));
+    m_offset = sizeof(columnarMagic) + 1;
+}
+
+ColumnarWriter::~ColumnarWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+    }
+}
+
+void ColumnarWriter::write(ModelClass * obj)
+{
+    if (m_closed) throw logic_error("Columnar writer already closed");
+
+    const ClassDescriptor * classDesc = obj->getClassDescriptor();
+    const Holder snapshot = classDesc->snapshot(obj);
+    ModelClass * row = classDesc->get(snapshot);
+
+    for (size_t i = 0; i < m_features.size(); i++)
+        m_columns[i].append(m_features[i]->getValue(row));
+
+    if (++m_rows == m_rowGroupSize) flush();
+}
+
+void ColumnarWriter::flush()
+{
+    if (!m_rows) return;
+
+    RowGroup group;
+    group.rows = m_rows;
+
+    for (auto& column : m_columns)
+    {
+        m_chunk.clear();
+        column.encode(m_chunk);
+
+        group.chunks.push_back(ColumnChunk{m_offset, m_chunk.size()});
+        m_os.write(m_chunk.data(), m_chunk.size());
+        m_offset += m_chunk.size();
+    }
+
+    m_groups.push_back(group);
+    m_rows = 0;
+}
+
+void ColumnarWriter::close()
+{
+    if (m_closed) return;
+
+    flush();
+    m_closed = true;
+
+    string footer;
+    appendString(footer, m_schema.fqn);
+    appendFixed(footer, m_schema.fingerprint);
+    appendVarint(footer, m_schema.fields.size());
+
+    for (const auto& field : m_schema.fields)
+    {
+        appendString(footer, field.name);
+        appendString(footer, field.signature);
+    }
+
+    appendVarint(footer, m_groups.size());
+    for (const auto& group : m_groups)
+    {
+        appendVarint(footer, group.rows);
+        for (const auto& chunk : group.chunks)
+        {
+            appendVarint(footer, chunk.offset);
+            appendVarint(footer, chunk.size);
+        }
+    }
+
+    if (footer.size() > numeric_limits<uint32_t>::max())
+        throw length_error("Columnar footer too large");
+
+    appendFixed(footer, static_cast<uint32_t>(footer.size()));
+    footer.append(columnarMagic, sizeof(columnarMagic));
+    m_os.write(footer.data(), footer.size());
+}
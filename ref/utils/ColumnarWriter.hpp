@@ -0,0 +1,79 @@
+#ifndef REFCPP_COLUMNAR_WRITER_HPP
+#define REFCPP_COLUMNAR_WRITER_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "BinarySchema.hpp"
+#include "ColumnarFormat.hpp"
+
+namespace ref
+{
+    struct ModelClass;
+    struct ClassDescriptor;
+    struct FeatureDescriptor;
+
+    /**
+     * @brief Writes objects of a class column by column, for analytical
+     * exports of large collections of records.
+     *
+     * Objects are buffered into row groups of a fixed number of rows.
+     * Within a row group each feature is written as a column chunk, with
+     * an encoding chosen for its type and values:
+     *
+     * - integers as deltas, bit-packed with the width of the largest
+     *   one after subtracting the smallest, so sorted or constant
+     *   columns take a few bits per row,
+     * - strings as a dictionary and bit-packed indices into it, unless
+     *   most of them are distinct,
+     * - booleans as run lengths,
+     * - anything else, such as floating point numbers, containers and
+     *   nested objects, as plain values.
+     *
+     * Objects owned by pointers are written inline; raw and weak pointers
+     * are written as null. The footer written by close() describes the
+     * schema of the class and where every chunk is, see ColumnarReader.
+     */
+    struct ColumnarWriter
+    {
+        ColumnarWriter(std::ostream& os, const ClassDescriptor* classDesc,
+                       std::size_t rowGroupSize = 64 * 1024);
+
+        /**
+         * @brief Closes the file, if close() was not called.
+         */
+        ~ColumnarWriter();
+
+        /**
+         * @brief Appends an object of the class of the writer, or of a
+         * subclass of it. Only the features of the class are written.
+         */
+        void write(ModelClass * obj);
+
+        /**
+         * @brief Writes the pending rows and the footer. Nothing can be
+         * written afterwards.
+         */
+        void close();
+
+    protected:
+        struct Column;
+
+        std::ostream& m_os;
+        const ClassDescriptor* m_classDesc;
+        const std::size_t m_rowGroupSize;
+        ClassSchema m_schema;
+        std::vector<const FeatureDescriptor*> m_features;
+        std::vector<Column> m_columns;
+        std::vector<detail::RowGroup> m_groups;
+        std::size_t m_rows;
+        std::uint64_t m_offset;
+        bool m_closed;
+        std::string m_chunk;
+
+        void flush();
+    };
+}  // namespace ref
+
+#endif  // REFCPP_COLUMNAR_WRITER_HPP
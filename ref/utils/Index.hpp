@@ -0,0 +1,308 @@
+#ifndef REFCPP_INDEX_HPP
+#define REFCPP_INDEX_HPP
+
+#include <map>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include <unordered_map>
+#include <ref/Class.hpp>
+#include <ref/Holder.hpp>
+#include <ref/Observer.hpp>
+#include <ref/DescriptorsImpl.ipp>
+
+namespace ref
+{
+    /**
+     * @brief Secondary index over the objects of a collection feature,
+     * keyed by the value of one of their features.
+     *
+     * Indexes observe changes of their key feature only, so entries are
+     * rekeyed when it is modified through Class::set or
+     * FeatureDescriptor::setValue, and other changes do not reach them.
+     * Changes to the collection itself are not observed: objects added or
+     * removed after attaching the index must be inserted or erased
+     * explicitly, or the index rebuilt.
+     */
+    struct Index : FeatureObserver
+    {
+        Index(const FeatureDescriptor* keyFeature)
+            : m_keyFeature(keyFeature), m_owner(), m_collection()
+        {
+            addFeatureObserver(this, keyFeature);
+        }
+
+        Index(const Index&) = delete;
+
+        virtual ~Index() { removeFeatureObserver(this); }
+
+        const FeatureDescriptor* getKeyFeatureDescriptor() const
+        {
+            return m_keyFeature;
+        }
+
+        const FeatureDescriptor* getCollectionFeatureDescriptor() const
+        {
+            return m_collection;
+        }
+
+        ModelClass* getOwner() const { return m_owner; }
+
+        /**
+         * @brief Indexes the elements of a collection feature of owner and
+         * keeps track of it for rebuild.
+         *
+         * @throw std::invalid_argument if the collection does not contain
+         * instances of the indexed class.
+         */
+        void attach(ModelClass* owner, const FeatureDescriptor* collection)
+        {
+            const std::vector<ModelClass*> objs =
+                getCollectionObjects(collection->getValue(owner));
+
+            m_owner = owner;
+            m_collection = collection;
+            reset(objs);
+        }
+
+        void rebuild()
+        {
+            if (m_owner)
+                reset(getCollectionObjects(m_collection->getValue(m_owner)));
+        }
+
+        /**
+         * @brief Finds the objects whose key equals the value contained in
+         * the passed holder.
+         */
+        virtual std::vector<ModelClass*> find(Holder key) const = 0;
+
+        virtual std::size_t size() const = 0;
+
+        virtual void clear() = 0;
+
+    protected:
+        const FeatureDescriptor* m_keyFeature;
+        ModelClass* m_owner;
+        const FeatureDescriptor* m_collection;
+
+        virtual const ClassDescriptor* getIndexedClassDescriptor() const = 0;
+
+        virtual void insertObject(ModelClass* obj) = 0;
+
+        void reset(const std::vector<ModelClass*>& objs)
+        {
+            clear();
+            for (auto obj : objs)
+                insertObject(obj);
+        }
+
+        bool isIndexedClass(const TypeDescriptor* desc) const
+        {
+            if (desc->getKind() != TypeDescriptor::kClass) return false;
+
+            const ClassDescriptor* indexed = getIndexedClassDescriptor();
+            const ClassDescriptor* classDesc = desc->as<ClassDescriptor>();
+
+            for (; classDesc; classDesc = classDesc->getParentClassDescriptor())
+                if (classDesc == indexed) return true;
+            return false;
+        }
+
+        std::vector<ModelClass*> getCollectionObjects(Holder h) const
+        {
+            const TypeDescriptor* desc = h.descriptor();
+            if (desc->getKind() != TypeDescriptor::kList &&
+                desc->getKind() != TypeDescriptor::kSet)
+            {
+                throw std::invalid_argument("Not a collection: " +
+                                            desc->getFqn());
+            }
+
+            auto containerDesc = desc->as<ContainerTypeDescriptor>();
+            const TypeDescriptor* valueDesc =
+                containerDesc->getValueTypeDescriptor();
+            const PointerTypeDescriptor* ptrDesc = nullptr;
+
+            if (valueDesc->getKind() == TypeDescriptor::kPointer)
+            {
+                ptrDesc = valueDesc->as<PointerTypeDescriptor>();
+                valueDesc = ptrDesc->getPointedTypeDescriptor();
+            }
+
+            if (!isIndexedClass(valueDesc))
+            {
+                throw std::invalid_argument("Invalid collection: " +
+                                            desc->getFqn());
+            }
+
+            auto classDesc = valueDesc->as<ClassDescriptor>();
+            const std::vector<Holder> values = containerDesc->getValue(h);
+            std::vector<ModelClass*> objs;
+
+            for (const auto& value : values)
+            {
+                Holder obj = ptrDesc ? ptrDesc->dereference(value) : value;
+                if (ModelClass* o = classDesc->get(obj)) objs.push_back(o);
+            }
+
+            return objs;
+        }
+    };
+
+    template <typename Class, typename KeyFeature, typename Map>
+    struct IndexImpl : Index
+    {
+        typedef typename KeyFeature::type key_type;
+        typedef typename detail::FeatureDefinedIn<Class, KeyFeature>::type
+            DefinedIn;
+
+        IndexImpl()
+            : Index(FeatureDescriptorImpl<DefinedIn, KeyFeature>::instance())
+        {
+        }
+
+        void insert(Class* obj)
+        {
+            m_map.insert(std::make_pair(obj->template get<KeyFeature>(), obj));
+        }
+
+        void erase(Class* obj) { erase(static_cast<ModelClass*>(obj)); }
+
+        std::vector<Class*> find(const key_type& key) const
+        {
+            std::vector<Class*> res;
+            auto range = m_map.equal_range(key);
+            for (auto it = range.first; it != range.second; ++it)
+                res.push_back(it->second);
+            return res;
+        }
+
+        std::vector<ModelClass*> find(Holder key) const override
+        {
+            assert(key.descriptor() == m_keyFeature->getTypeDescriptor());
+
+            std::vector<ModelClass*> res;
+            auto range = m_map.equal_range(*key.get<key_type>());
+            for (auto it = range.first; it != range.second; ++it)
+                res.push_back(it->second);
+            return res;
+        }
+
+        std::size_t size() const override { return m_map.size(); }
+
+        void clear() override { m_map.clear(); }
+
+        void beforeSet(ModelClass* obj,
+                       const FeatureDescriptor* feature) override
+        {
+            if (feature == m_keyFeature && erase(obj))
+                m_pending.push_back(obj);
+        }
+
+        void afterSet(ModelClass* obj,
+                      const FeatureDescriptor* feature) override
+        {
+            if (feature != m_keyFeature) return;
+
+            auto it = std::find(m_pending.begin(), m_pending.end(), obj);
+            if (it == m_pending.end()) return;
+
+            m_pending.erase(it);
+            insertObject(obj);
+        }
+
+    protected:
+        Map m_map;
+        std::vector<ModelClass*> m_pending;
+
+        static detail::GetResult<DefinedIn, const key_type> getKey(
+            ModelClass* obj)
+        {
+            return static_cast<DefinedIn*>(obj)->template get<KeyFeature>();
+        }
+
+        bool erase(ModelClass* obj)
+        {
+            auto range = m_map.equal_range(getKey(obj));
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (static_cast<ModelClass*>(it->second) == obj)
+                {
+                    m_map.erase(it);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        const ClassDescriptor* getIndexedClassDescriptor() const override
+        {
+            return ClassDescriptorImpl<Class>::instance();
+        }
+
+        void insertObject(ModelClass* obj) override
+        {
+            insert(static_cast<Class*>(obj));
+        }
+    };
+
+    /**
+     * @brief Index for equality lookups.
+     */
+    template <typename Class, typename KeyFeature>
+    struct HashIndex
+        : IndexImpl<Class, KeyFeature,
+                    std::unordered_multimap<typename KeyFeature::type, Class*> >
+    {
+    };
+
+    /**
+     * @brief Index for equality and range lookups.
+     */
+    template <typename Class, typename KeyFeature>
+    struct OrderedIndex
+        : IndexImpl<Class, KeyFeature,
+                    std::multimap<typename KeyFeature::type, Class*> >
+    {
+        typedef typename KeyFeature::type key_type;
+
+        /**
+         * @brief Returns the objects whose key is in [first, last].
+         */
+        std::vector<Class*> range(const key_type& first,
+                                  const key_type& last) const
+        {
+            std::vector<Class*> res;
+            auto it = this->m_map.lower_bound(first);
+            auto end = this->m_map.upper_bound(last);
+            for (; it != end; ++it)
+                res.push_back(it->second);
+            return res;
+        }
+    };
+
+    /**
+     * @brief Returns the index attached to the collection feature of owner
+     * and keyed by keyFeature, if any.
+     */
+    inline Index* findIndex(ModelClass* owner,
+                            const FeatureDescriptor* collection,
+                            const FeatureDescriptor* keyFeature)
+    {
+        for (auto observer : getFeatureObservers())
+        {
+            Index* index = dynamic_cast<Index*>(observer);
+            if (index && index->getOwner() == owner &&
+                index->getCollectionFeatureDescriptor() == collection &&
+                index->getKeyFeatureDescriptor() == keyFeature)
+            {
+                return index;
+            }
+        }
+        return nullptr;
+    }
+
+}  // namespace ref
+
+#endif  // REFCPP_INDEX_HPP
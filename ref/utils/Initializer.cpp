@@ -0,0 +1,71 @@
+#include <ref/Descriptors.hpp>
+#include "Initializer.hpp"
+#include <unordered_set>
+#include <vector>
+
+using namespace ref;
+using namespace std;
+
+size_t ref::initializeDescriptors(const TypeDescriptor* root)
+{
+    unordered_set<const TypeDescriptor*> processed;
+    vector<const TypeDescriptor*> pending = {root};
+
+    while (!pending.empty())
+    {
+        const TypeDescriptor* current = pending.back();
+        pending.pop_back();
+
+        if (!current || !processed.insert(current).second)
+        {
+            continue;
+        }
+
+        switch (current->getKind())
+        {
+            case TypeDescriptor::kClass:
+            {
+                auto classDesc = current->as<ClassDescriptor>();
+                pending.push_back(classDesc->getParentClassDescriptor());
+
+                for (auto feature : classDesc->getFeatureDescriptors())
+                {
+                    pending.push_back(feature->getTypeDescriptor());
+                }
+            }
+            break;
+            case TypeDescriptor::kPointer:
+            {
+                auto ptrDesc = current->as<PointerTypeDescriptor>();
+                pending.push_back(ptrDesc->getPointedTypeDescriptor());
+            }
+            break;
+            case TypeDescriptor::kPair:
+            {
+                auto pairDesc = current->as<PairTypeDescriptor>();
+                pending.push_back(pairDesc->getFirstTypeDescriptor());
+                pending.push_back(pairDesc->getSecondTypeDescriptor());
+            }
+            break;
+            case TypeDescriptor::kMap:
+            {
+                auto mapDesc = current->as<MapTypeDescriptor>();
+                pending.push_back(mapDesc->getKeyTypeDescriptor());
+                pending.push_back(mapDesc->getMappedTypeDescriptor());
+                pending.push_back(mapDesc->getValueTypeDescriptor());
+            }
+            break;
+            case TypeDescriptor::kList:
+            case TypeDescriptor::kSet:
+            {
+                auto containerDesc = current->as<ContainerTypeDescriptor>();
+                pending.push_back(containerDesc->getValueTypeDescriptor());
+            }
+            break;
+            default:
+                break;
+        }
+    }
+
+    return processed.size();
+}
@@ -0,0 +1,36 @@
+#ifndef REFCPP_INITIALIZER_HPP
+#define REFCPP_INITIALIZER_HPP
+
+#include <cstddef>
+
+namespace ref
+{
+    struct TypeDescriptor;
+
+    /**
+     * @brief Constructs every descriptor reachable from root: parent
+     * classes, features, and the types of their values.
+     *
+     * Descriptors are otherwise constructed on first use, so calling this
+     * at load time keeps their initialization off the request path.
+     *
+     * @return The number of type descriptors reachable from root.
+     */
+    std::size_t initializeDescriptors(const TypeDescriptor* root);
+
+    /**
+     * @brief Initializes the descriptors of a model when constructed.
+     * Meant to be used as a static object to initialize them at load time.
+     */
+    struct DescriptorInitializer
+    {
+        explicit DescriptorInitializer(const TypeDescriptor* root)
+            : count(initializeDescriptors(root))
+        {
+        }
+
+        const std::size_t count;
+    };
+}  // namespace ref
+
+#endif  // REFCPP_INITIALIZER_HPP
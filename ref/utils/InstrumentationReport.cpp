@@ -0,0 +1,152 @@
+#include "InstrumentationReport.hpp"
+#include <ref/Descriptors.hpp>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace ref;
+using namespace std;
+
+namespace
+{
+    typedef InstrumentationCounters Counters;
+
+    struct ClassEntry
+    {
+        const ClassDescriptor* classDesc;
+        Counters counters;
+        vector<pair<const FeatureDescriptor*, Counters> > features;
+        uint64_t total;
+
+        ClassEntry() : classDesc(), total(0) {}
+    };
+
+    uint64_t getTotal(const Counters& counters)
+    {
+        // Elements are a measure of the materializations, not operations
+        uint64_t total = 0;
+        for (size_t i = 0; i < counters.values.size(); i++)
+            if (i != Counters::kMaterializedElements)
+                total += counters.values[i];
+        return total;
+    }
+
+    void printCounters(ostream& os, const Counters& counters)
+    {
+        bool first = true;
+        for (size_t i = 0; i < counters.values.size(); i++)
+        {
+            if (!counters.values[i]) continue;
+
+            if (!first) os << ", ";
+            os << getCounterName(static_cast<Counters::Counter>(i)) << ": "
+               << counters.values[i];
+            first = false;
+        }
+        os << endl;
+    }
+
+    string getName(const Descriptor* desc)
+    {
+        return desc ? desc->getFqn() : "<unknown>";
+    }
+}  // namespace
+
+const char* ref::getCounterName(InstrumentationCounters::Counter counter)
+{
+    switch (counter)
+    {
+    case Counters::kHolderAllocations: return "holders";
+    case Counters::kGetValue: return "get value";
+    case Counters::kSetValue: return "set value";
+    case Counters::kCopy: return "copy";
+    case Counters::kGetString: return "get string";
+    case Counters::kSetString: return "set string";
+    case Counters::kMaterializations: return "materializations";
+    case Counters::kMaterializedElements: return "elements";
+    default: break;
+    }
+    return "";
+}
+
+void ref::printInstrumentationReport(ostream& os,
+                                     const InstrumentationSnapshot& snapshot)
+{
+    map<const ClassDescriptor*, ClassEntry> classes;
+    vector<pair<const Descriptor*, Counters> > types;
+
+    for (const auto& entry : snapshot)
+    {
+        const Descriptor* desc = entry.first;
+
+        if (auto feature = dynamic_cast<const FeatureDescriptor*>(desc))
+        {
+            ClassEntry& classEntry = classes[feature->getDefinedIn()];
+            classEntry.features.push_back(make_pair(feature, entry.second));
+            classEntry.total += getTotal(entry.second);
+            continue;
+        }
+
+        auto type = dynamic_cast<const TypeDescriptor*>(desc);
+        if (type && type->getKind() == TypeDescriptor::kClass)
+        {
+            ClassEntry& classEntry = classes[type->as<ClassDescriptor>()];
+            classEntry.counters = entry.second;
+            classEntry.total += getTotal(entry.second);
+            continue;
+        }
+
+        types.push_back(entry);
+    }
+
+    vector<ClassEntry> sortedClasses;
+    for (auto& entry : classes)
+    {
+        entry.second.classDesc = entry.first;
+        sortedClasses.push_back(entry.second);
+    }
+
+    sort(sortedClasses.begin(), sortedClasses.end(),
+         [](const ClassEntry& a, const ClassEntry& b) {
+             return a.total > b.total;
+         });
+
+    for (auto& classEntry : sortedClasses)
+    {
+        os << getName(classEntry.classDesc) << ": " << classEntry.total
+           << " operations" << endl;
+
+        if (!classEntry.counters.empty())
+        {
+            os << "    ";
+            printCounters(os, classEntry.counters);
+        }
+
+        sort(classEntry.features.begin(), classEntry.features.end(),
+             [](const pair<const FeatureDescriptor*, Counters>& a,
+                const pair<const FeatureDescriptor*, Counters>& b) {
+                 return getTotal(a.second) > getTotal(b.second);
+             });
+
+        for (const auto& feature : classEntry.features)
+        {
+            os << "    " << feature.first->getName() << ": ";
+            printCounters(os, feature.second);
+        }
+    }
+
+    if (types.empty()) return;
+
+    sort(types.begin(), types.end(),
+         [](const pair<const Descriptor*, Counters>& a,
+            const pair<const Descriptor*, Counters>& b) {
+             return getTotal(a.second) > getTotal(b.second);
+         });
+
+    os << "Types:" << endl;
+    for (const auto& type : types)
+    {
+        os << "    " << getName(type.first) << ": ";
+        printCounters(os, type.second);
+    }
+}
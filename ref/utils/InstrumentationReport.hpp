@@ -0,0 +1,24 @@
+#ifndef REFCPP_INSTRUMENTATION_REPORT_HPP
+#define REFCPP_INSTRUMENTATION_REPORT_HPP
+
+#include <ostream>
+#include <ref/Instrumentation.hpp>
+
+namespace ref
+{
+    /**
+     * @brief Prints the counters of a snapshot grouped by class.
+     *
+     * Each class is listed with its own counters, followed by those of the
+     * features defined in it. Classes are sorted by their total number of
+     * operations, features included, so the most expensive ones come
+     * first. The remaining type descriptors (primitives, containers,
+     * pointers...) are listed afterwards, sorted the same way.
+     */
+    void printInstrumentationReport(std::ostream& os,
+                                    const InstrumentationSnapshot& snapshot);
+
+    const char* getCounterName(InstrumentationCounters::Counter counter);
+}  // namespace ref
+
+#endif  // REFCPP_INSTRUMENTATION_REPORT_HPP
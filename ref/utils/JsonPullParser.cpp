@@ -0,0 +1,282 @@
+#include "JsonPullParser.hpp"
+#include <cstdio>
+#include <stdexcept>
+
+using namespace ref;
+using namespace std;
+
+namespace
+{
+    bool isSpace(int c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    bool isNumberChar(int c)
+    {
+        return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+               c == 'e' || c == 'E';
+    }
+
+    int hexValue(int c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    void appendUtf8(string& out, unsigned long cp)
+    {
+        if (cp < 0x80)
+        {
+            out += static_cast<char>(cp);
+        }
+        else if (cp < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+}  // namespace
+
+JsonPullParser::JsonPullParser(istream& is)
+    : m_buf(is.rdbuf()),
+      m_event(kEndDocument),
+      m_state(kExpectValue),
+      m_line(1)
+{
+}
+
+int JsonPullParser::get()
+{
+    const int c = m_buf->sbumpc();
+    if (c == '\n') ++m_line;
+    return c == char_traits<char>::eof() ? EOF : c;
+}
+
+int JsonPullParser::peek()
+{
+    const int c = m_buf->sgetc();
+    return c == char_traits<char>::eof() ? EOF : c;
+}
+
+void JsonPullParser::error(const string& msg) const
+{
+    throw runtime_error("JSON error at line " + to_string(m_line) + ": " +
+                        msg);
+}
+
+int JsonPullParser::skipSpaces()
+{
+    while (isSpace(peek())) get();
+    return peek();
+}
+
+void JsonPullParser::endValue()
+{
+    m_state = m_stack.empty() ? kExpectValue : kExpectSeparator;
+}
+
+JsonPullParser::Event JsonPullParser::next()
+{
+    int c = skipSpaces();
+
+    if (c == EOF)
+    {
+        if (!m_stack.empty()) error("unexpected end of document");
+        return m_event = kEndDocument;
+    }
+
+    if (!m_stack.empty())
+    {
+        const bool object = m_stack.back() == '{';
+
+        // Closing an empty container, or after one of its values
+        if (c == (object ? '}' : ']') &&
+            (m_state == kExpectSeparator || m_event == kObjectStart ||
+             m_event == kArrayStart))
+        {
+            get();
+            m_stack.pop_back();
+            endValue();
+            return m_event = object ? kObjectEnd : kArrayEnd;
+        }
+
+        if (m_state == kExpectSeparator)
+        {
+            if (c != ',') error(object ? "expected ',' or '}'"
+                                       : "expected ',' or ']'");
+            get();
+            m_state = object ? kExpectKey : kExpectValue;
+            c = skipSpaces();
+        }
+
+        if (m_state == kExpectKey)
+        {
+            if (c != '"') error("expected a key");
+            readString();
+
+            if (skipSpaces() != ':') error("expected ':'");
+            get();
+
+            m_state = kExpectValue;
+            return m_event = kKey;
+        }
+    }
+
+    switch (c)
+    {
+    case '{':
+        get();
+        m_stack.push_back('{');
+        m_state = kExpectKey;
+        return m_event = kObjectStart;
+    case '[':
+        get();
+        m_stack.push_back('[');
+        m_state = kExpectValue;
+        return m_event = kArrayStart;
+    case '"':
+        readString();
+        endValue();
+        return m_event = kString;
+    case 't':
+        readLiteral("true");
+        endValue();
+        return m_event = kTrue;
+    case 'f':
+        readLiteral("false");
+        endValue();
+        return m_event = kFalse;
+    case 'n':
+        readLiteral("null");
+        endValue();
+        return m_event = kNull;
+    default:
+        if (c != '-' && (c < '0' || c > '9'))
+            error(string("unexpected character '") + static_cast<char>(c) +
+                  "'");
+        readNumber();
+        endValue();
+        return m_event = kNumber;
+    }
+}
+
+void JsonPullParser::skipValue()
+{
+    if (m_event == kKey) next();
+
+    if (m_event != kObjectStart && m_event != kArrayStart) return;
+
+    const size_t depth = m_stack.size();
+    while (m_stack.size() >= depth) next();
+}
+
+void JsonPullParser::readString()
+{
+    get();  // opening quote
+    m_text.clear();
+
+    for (;;)
+    {
+        int c = get();
+
+        if (c == EOF) error("unexpected end of document");
+        if (c == '"') break;
+
+        if (c != '\\')
+        {
+            m_text += static_cast<char>(c);
+            continue;
+        }
+
+        switch (c = get())
+        {
+        case '"':
+        case '\\':
+        case '/':
+            m_text += static_cast<char>(c);
+            break;
+        case 'b':
+            m_text += '\b';
+            break;
+        case 'f':
+            m_text += '\f';
+            break;
+        case 'n':
+            m_text += '\n';
+            break;
+        case 'r':
+            m_text += '\r';
+            break;
+        case 't':
+            m_text += '\t';
+            break;
+        case 'u':
+            {
+                unsigned long cp = 0;
+                for (int i = 0; i < 4; i++)
+                {
+                    const int v = hexValue(get());
+                    if (v < 0) error("invalid unicode escape");
+                    cp = cp * 16 + v;
+                }
+
+                // Surrogate pair
+                if (cp >= 0xD800 && cp < 0xDC00 && peek() == '\\')
+                {
+                    get();
+                    if (get() != 'u') error("invalid unicode escape");
+
+                    unsigned long low = 0;
+                    for (int i = 0; i < 4; i++)
+                    {
+                        const int v = hexValue(get());
+                        if (v < 0) error("invalid unicode escape");
+                        low = low * 16 + v;
+                    }
+
+                    if (low < 0xDC00 || low >= 0xE000)
+                        error("invalid surrogate pair");
+
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+
+                appendUtf8(m_text, cp);
+            }
+            break;
+        default:
+            error("invalid escape sequence");
+        }
+    }
+}
+
+void JsonPullParser::readNumber()
+{
+    m_text.clear();
+    while (isNumberChar(peek())) m_text += static_cast<char>(get());
+}
+
+void JsonPullParser::readLiteral(const char* literal)
+{
+    for (const char* p = literal; *p; ++p)
+        if (get() != *p) error(string("expected '") + literal + "'");
+
+    const int c = peek();
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+        error(string("expected '") + literal + "'");
+}
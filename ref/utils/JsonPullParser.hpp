@@ -0,0 +1,88 @@
+#ifndef REFCPP_JSON_PULL_PARSER_HPP
+#define REFCPP_JSON_PULL_PARSER_HPP
+
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace ref
+{
+    /**
+     * @brief Minimal streaming JSON parser.
+     *
+     * Reads its input one character at a time through the stream buffer
+     * and keeps no more than the current token and the kind of the open
+     * containers in memory. Its buffers are reused between tokens, so once
+     * they have grown to the longest token parsing allocates nothing.
+     * Several top-level values may follow each other, as in JSON Lines.
+     *
+     * Malformed input throws std::runtime_error.
+     */
+    struct JsonPullParser
+    {
+        enum Event
+        {
+            kObjectStart,
+            kObjectEnd,
+            kArrayStart,
+            kArrayEnd,
+            kKey,
+            kString,
+            kNumber,
+            kTrue,
+            kFalse,
+            kNull,
+            kEndDocument
+        };
+
+        JsonPullParser(std::istream& is);
+
+        Event next();
+
+        Event getEvent() const { return m_event; }
+
+        /**
+         * @brief Decoded text, for key, string and number events.
+         */
+        const std::string& getText() const { return m_text; }
+
+        /**
+         * @brief Number of containers currently open.
+         */
+        std::size_t getDepth() const { return m_stack.size(); }
+
+        /**
+         * @brief Skips the value that starts with the current event,
+         * including its children. After a key event, skips the value of
+         * the key.
+         */
+        void skipValue();
+
+    protected:
+        enum State
+        {
+            kExpectValue,
+            kExpectKey,
+            kExpectSeparator
+        };
+
+        std::streambuf* m_buf;
+        Event m_event;
+        State m_state;
+        std::string m_text;
+        std::vector<char> m_stack;
+        std::size_t m_line;
+
+        int get();
+        int peek();
+        void error(const std::string& msg) const;
+
+        int skipSpaces();
+        void endValue();
+        void readString();
+        void readNumber();
+        void readLiteral(const char* literal);
+    };
+}  // namespace ref
+
+#endif  // REFCPP_JSON_PULL_PARSER_HPP
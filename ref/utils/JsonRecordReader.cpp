@@ -0,0 +1,351 @@
+#include "JsonRecordReader.hpp"
+#include <ref/Descriptors.hpp>
+#include <ref/Class.hpp>
+#include <stdexcept>
+#include <typeinfo>
+
+using namespace ref;
+using namespace std;
+
+JsonRecordReader::JsonRecordReader(istream& is)
+    : m_parser(is), m_started(false), m_array(false), m_level(0)
+{
+}
+
+bool JsonRecordReader::next(ModelClass * obj)
+{
+    auto event = m_parser.next();
+
+    if (!m_started)
+    {
+        m_started = true;
+
+        if (event == JsonPullParser::kArrayStart)
+        {
+            m_array = true;
+            event = m_parser.next();
+        }
+    }
+
+    if (event == JsonPullParser::kEndDocument ||
+        (m_array && event == JsonPullParser::kArrayEnd))
+    {
+        return false;
+    }
+
+    if (event != JsonPullParser::kObjectStart)
+        throw runtime_error("Expected an object");
+
+    readObject(obj);
+    return true;
+}
+
+const JsonRecordReader::ClassInfo& JsonRecordReader::getClassInfo(
+    const ClassDescriptor* classDesc)
+{
+    auto it = m_classes.find(classDesc);
+    if (it != m_classes.end())
+        return it->second;
+
+    ClassInfo& info = m_classes[classDesc];
+    info.features = classDesc->getAllFeatureDescriptors();
+
+    for (size_t i = 0; i < info.features.size(); i++)
+        info.tags[info.features[i]->getXmlTag()] = i;
+
+    info.prototype = classDesc->create();
+    return info;
+}
+
+/**
+ * Reads the features of an object, from its start event up to its end
+ * event, and resets the features it does not contain.
+ */
+void JsonRecordReader::readObject(ModelClass * obj)
+{
+    auto classDesc = obj->getClassDescriptor();
+    const ClassInfo& info = getClassInfo(classDesc);
+
+    // Nested objects may grow m_seen, so it is always indexed
+    const size_t level = m_level++;
+    if (m_seen.size() <= level)
+        m_seen.resize(level + 1);
+    m_seen[level].assign(info.features.size(), 0);
+
+    while (m_parser.next() == JsonPullParser::kKey)
+    {
+        auto it = info.tags.find(m_parser.getText());
+        if (it == info.tags.end())
+        {
+            m_parser.skipValue();
+            continue;
+        }
+
+        // Null features are reset along with the missing ones
+        if (m_parser.next() == JsonPullParser::kNull)
+            continue;
+
+        m_seen[level][it->second] = 1;
+        readValue(info.features[it->second]->getValue(obj));
+    }
+
+    --m_level;
+
+    ModelClass * prototype = info.prototype.isValid()
+                                 ? classDesc->get(info.prototype)
+                                 : nullptr;
+
+    for (size_t i = 0; i < info.features.size(); i++)
+    {
+        if (m_seen[level][i])
+            continue;
+
+        const FeatureDescriptor* feature = info.features[i];
+        Holder value = feature->getValue(obj);
+
+        // Pointers are reset to null rather than to the value in the
+        // prototype, which would share its objects with every record
+        if (!prototype ||
+            value.descriptor()->getKind() == TypeDescriptor::kPointer)
+        {
+            reset(value);
+        }
+        else
+        {
+            value.descriptor()->copy(feature->getValue(prototype), value);
+        }
+    }
+}
+
+/**
+ * Reads a value starting at the current event.
+ */
+void JsonRecordReader::readValue(Holder h)
+{
+    if (m_parser.getEvent() == JsonPullParser::kNull)
+    {
+        reset(h);
+        return;
+    }
+
+    auto desc = h.descriptor();
+
+    switch (desc->getKind())
+    {
+    case TypeDescriptor::kPrimitive:
+        readScalar(h);
+        break;
+    case TypeDescriptor::kClass:
+        if (m_parser.getEvent() != JsonPullParser::kObjectStart)
+            throw runtime_error("Expected an object");
+        readObject(desc->as<ClassDescriptor>()->get(h));
+        break;
+    case TypeDescriptor::kPair:
+        readPair(h);
+        break;
+    case TypeDescriptor::kMap:
+    case TypeDescriptor::kList:
+    case TypeDescriptor::kSet:
+        readContainer(h);
+        break;
+    case TypeDescriptor::kPointer:
+        readPointer(h);
+        break;
+    default:
+        m_parser.skipValue();
+        break;
+    }
+}
+
+void JsonRecordReader::readScalar(Holder h)
+{
+    auto primDesc = h.descriptor()->as<PrimitiveTypeDescriptor>();
+
+    try
+    {
+        switch (m_parser.getEvent())
+        {
+        case JsonPullParser::kKey:
+        case JsonPullParser::kString:
+        case JsonPullParser::kNumber:
+            primDesc->setString(h, m_parser.getText());
+            break;
+        case JsonPullParser::kTrue:
+            primDesc->setString(h, "1");
+            break;
+        case JsonPullParser::kFalse:
+            primDesc->setString(h, "0");
+            break;
+        default:
+            throw runtime_error("Expected a scalar value");
+        }
+    }
+    catch (const bad_cast&)
+    {
+        throw runtime_error("Invalid value: " + m_parser.getText());
+    }
+}
+
+/**
+ * Reads a {"first", "second"} object into a pair.
+ */
+void JsonRecordReader::readPair(Holder h)
+{
+    if (m_parser.getEvent() != JsonPullParser::kObjectStart)
+        throw runtime_error("Expected an object");
+
+    const auto value = h.descriptor()->as<PairTypeDescriptor>()->getValue(h);
+
+    while (m_parser.next() == JsonPullParser::kKey)
+    {
+        const string& key = m_parser.getText();
+
+        if (key == "first")
+        {
+            m_parser.next();
+            readValue(value.first);
+        }
+        else if (key == "second")
+        {
+            m_parser.next();
+            readValue(value.second);
+        }
+        else
+        {
+            m_parser.skipValue();
+        }
+    }
+}
+
+void JsonRecordReader::readContainer(Holder h)
+{
+    auto desc = h.descriptor();
+    const auto event = m_parser.getEvent();
+
+    if (desc->getKind() == TypeDescriptor::kList)
+    {
+        if (event != JsonPullParser::kArrayStart)
+            throw runtime_error("Expected an array");
+
+        // Elements are read in place, so they keep their own capacity
+        auto listDesc = desc->as<ListTypeDescriptor>();
+        size_t size = 0;
+
+        for (; m_parser.next() != JsonPullParser::kArrayEnd; ++size)
+        {
+            if (size == listDesc->getSize(h))
+                listDesc->resize(h, size + 1);
+
+            // Fixed-size lists drop the elements they have no room for
+            if (size < listDesc->getSize(h))
+                readValue(listDesc->getElement(h, size));
+            else
+                m_parser.skipValue();
+        }
+
+        listDesc->resize(h, size);
+        return;
+    }
+
+    // Sets and maps are filled from items reused between records, one
+    // pool per nesting level as only one container per level is being
+    // read at a time
+    auto containerDesc = desc->as<ContainerTypeDescriptor>();
+    auto valueDesc = containerDesc->getValueTypeDescriptor();
+
+    const size_t depth = m_parser.getDepth();
+    if (m_items.size() < depth)
+        m_items.resize(depth);
+
+    size_t size = 0;
+    auto item = [&]() -> Holder {
+        vector<Holder>& items = m_items[depth - 1][valueDesc];
+        if (items.size() == size)
+            items.push_back(valueDesc->create());
+        return items[size++];
+    };
+
+    const bool object = event == JsonPullParser::kObjectStart &&
+                        desc->getKind() == TypeDescriptor::kMap;
+
+    if (object)
+    {
+        // Keys of the object are the keys of the map
+        auto mapDesc = desc->as<MapTypeDescriptor>();
+        if (mapDesc->getKeyTypeDescriptor()->getKind() !=
+            TypeDescriptor::kPrimitive)
+        {
+            throw runtime_error("Expected an array");
+        }
+
+        auto pairDesc = valueDesc->as<PairTypeDescriptor>();
+
+        while (m_parser.next() == JsonPullParser::kKey)
+        {
+            const auto value = pairDesc->getValue(item());
+            readScalar(value.first);
+
+            m_parser.next();
+            readValue(value.second);
+        }
+    }
+    else
+    {
+        if (event != JsonPullParser::kArrayStart)
+            throw runtime_error("Expected an array");
+
+        while (m_parser.next() != JsonPullParser::kArrayEnd)
+            readValue(item());
+    }
+
+    // The pool keeps its items for the next records
+    const vector<Holder>& items = m_items[depth - 1][valueDesc];
+    m_selected.assign(items.begin(), items.begin() + size);
+    containerDesc->setValue(h, m_selected);
+    m_selected.clear();
+}
+
+/**
+ * Reads the object owned by a pointer, reusing the current one if no other
+ * pointer shares it. Pointers that do not own their objects are left
+ * untouched.
+ */
+void JsonRecordReader::readPointer(Holder h)
+{
+    auto ptrDesc = h.descriptor()->as<PointerTypeDescriptor>();
+
+    if (!ptrDesc->isOwner())
+    {
+        m_parser.skipValue();
+        return;
+    }
+
+    // Objects kept by the caller from previous records are left as is
+    Holder value =
+        ptrDesc->getUseCount(h) == 1
+            ? ptrDesc->dereference(h)
+            : ptrDesc->emplace(h, ptrDesc->getPointedTypeDescriptor());
+
+    if (!value.isValid())
+    {
+        m_parser.skipValue();
+        return;
+    }
+
+    readValue(value);
+}
+
+/**
+ * Sets a value to the value of a default instance of its type.
+ */
+void JsonRecordReader::reset(Holder h)
+{
+    auto desc = h.descriptor();
+
+    auto it = m_defaults.find(desc);
+    if (it == m_defaults.end())
+        it = m_defaults.emplace(desc, desc->create()).first;
+
+    if (it->second.isValid())
+        desc->copy(it->second, h);
+}
@@ -0,0 +1,93 @@
+#ifndef REFCPP_JSON_RECORD_READER_HPP
+#define REFCPP_JSON_RECORD_READER_HPP
+
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <ref/Holder.hpp>
+#include "JsonPullParser.hpp"
+
+namespace ref
+{
+    struct ModelClass;
+    struct TypeDescriptor;
+    struct ClassDescriptor;
+    struct FeatureDescriptor;
+
+    /**
+     * @brief Reads a stream of JSON objects, as written by JsonSerializer,
+     * one record at a time into the same object.
+     *
+     * The input is either a top-level array of objects or a sequence of
+     * top-level objects. Keys are mapped to features by their XML tags and
+     * unknown keys are skipped. Every record replaces the whole value of
+     * the object: features missing in a record get the value they have in
+     * a default instance of the class, and null resets a feature to that
+     * value too.
+     *
+     * Values are written into the existing object in place. Strings and
+     * lists keep their capacity and the elements of lists and the objects
+     * owned by pointers are reused, so once a record of each shape has
+     * been read, reading further ones does not allocate beyond what sets,
+     * maps and newly non-null pointers need. Objects also owned by other
+     * shared pointers, such as objects of previous records kept by the
+     * caller, are not reused: a new object replaces them.
+     *
+     * Pointed objects are read as instances of the pointed type, as
+     * JsonSerializer does not write the class of objects.
+     *
+     * Scalars are read from JSON strings, numbers and booleans. Maps are
+     * read from arrays of {"first", "second"} objects, as written by
+     * JsonSerializer, or from objects whose keys are the keys of the map.
+     *
+     * Malformed input throws std::runtime_error.
+     */
+    struct JsonRecordReader
+    {
+        JsonRecordReader(std::istream& is);
+
+        /**
+         * @brief Reads the next record into obj.
+         *
+         * @return false at the end of the stream.
+         */
+        bool next(ModelClass * obj);
+
+    protected:
+        struct ClassInfo
+        {
+            std::vector<const FeatureDescriptor*> features;
+            std::unordered_map<std::string, std::size_t> tags;
+            // Default instance, source of the values of missing features
+            Holder prototype;
+        };
+
+        JsonPullParser m_parser;
+        bool m_started;
+        bool m_array;
+        std::unordered_map<const ClassDescriptor*, ClassInfo> m_classes;
+        // Features seen in the object being read at each nesting level
+        std::vector<std::vector<char> > m_seen;
+        std::size_t m_level;
+        // Reusable items of the sets and maps at each nesting level
+        std::vector<std::unordered_map<const TypeDescriptor*,
+                                       std::vector<Holder> > >
+            m_items;
+        // Items of the pool that make up the container being set
+        std::vector<Holder> m_selected;
+        std::unordered_map<const TypeDescriptor*, Holder> m_defaults;
+
+        const ClassInfo& getClassInfo(const ClassDescriptor* classDesc);
+
+        void readObject(ModelClass * obj);
+        void readValue(Holder h);
+        void readScalar(Holder h);
+        void readPair(Holder h);
+        void readContainer(Holder h);
+        void readPointer(Holder h);
+        void reset(Holder h);
+    };
+} // namespace ref
+
+#endif // REFCPP_JSON_RECORD_READER_HPP
@@ -2,6 +2,7 @@
 #include <ref/Descriptors.hpp>
 #include <ref/Class.hpp>
 #include <algorithm>
+#include <cstdio>
 
 using namespace ref;
 using namespace std;
@@ -35,6 +36,48 @@ namespace
     };
 } // namespace
 
+void detail::appendJsonString(string& out, const string& text)
+{
+    out += '"';
+
+    for (const char c : text)
+    {
+        switch (c)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[7];
+                snprintf(escaped, sizeof(escaped), "\\u%04x",
+                         static_cast<unsigned>(c));
+                out += escaped;
+            }
+            else
+            {
+                out += c;
+            }
+            break;
+        }
+    }
+
+    out += '"';
+}
+
 const char * JsonSerializer::indent() const
 {
     const int index = min(level, maxLevel);
@@ -42,6 +85,14 @@ const char * JsonSerializer::indent() const
 }
 
 void JsonSerializer::serialize(ModelClass * obj)
+{
+    if (!obj)
+        return;
+
+    serializeAs(obj->getClassDescriptor(), obj);
+}
+
+void JsonSerializer::serializeAs(const ClassDescriptor * desc, ModelClass * obj)
 {
     if (!obj)
         return;
@@ -49,19 +100,22 @@ void JsonSerializer::serialize(ModelClass * obj)
     ++level;
     os << '{';
 
-    auto classDesc = obj->getClassDescriptor();
-    const auto features = classDesc->getFeatureValues(obj);
+    // Read from a snapshot of objects written by other threads
+    const Holder snapshot = desc->snapshot(obj);
 
-    for (size_t i = 0; i < features.size(); i++)
-    {
-        os << endl << indent();
-        os << '"' << features[i].first->getXmlTag() << "\" : ";
+    bool first = true;
+    desc->forEachFeature(
+        desc->get(snapshot),
+        [&](const FeatureDescriptor * feature, Holder value) {
+            if (!first)
+                os << ',';
+            first = false;
 
-        serialize(features[i].second);
+            os << endl << indent();
+            os << '"' << feature->getXmlTag() << "\" : ";
 
-        if (i + 1 < features.size())
-            os << ',';
-    }
+            serialize(value);
+        });
 
     --level;
     os << endl << indent();
@@ -73,73 +127,104 @@ void JsonSerializer::serialize(Holder h)
     if (!h.isValid())
         return;
 
-    auto desc = h.descriptor();
+    visitType(h.descriptor(), [&](auto desc) { serialize(desc, h); });
+}
 
-    switch (desc->getKind())
-    {
-    case TypeDescriptor::kPrimitive:
-        {
-            auto primDesc = desc->as<PrimitiveTypeDescriptor>();
-            os << '"' << primDesc->getString(h) << '"';
-        }
-        break;
-    case TypeDescriptor::kClass:
-        {
-            auto classDesc = desc->as<ClassDescriptor>();
-            ModelClass * obj = classDesc->get(h);
-            serialize(obj);
-        }
-        break;
-    case TypeDescriptor::kPair:
-        {
-            auto pairDesc = desc->as<PairTypeDescriptor>();
-            const auto value = pairDesc->getValue(h);
+void JsonSerializer::serialize(const PrimitiveTypeDescriptor * desc, Holder h)
+{
+    string text;
+    detail::appendJsonString(text, desc->getString(h));
+    os << text;
+}
 
-            ++level;
-            os << '{';
+void JsonSerializer::serialize(const ClassDescriptor * desc, Holder h)
+{
+    if (staticTypes)
+        serializeAs(desc, desc->get(h));
+    else
+        serialize(desc->get(h));
+}
 
-            os << endl << indent();
-            os << "\"first\" : ";
-            serialize(value.first);
+void JsonSerializer::serialize(const PairTypeDescriptor * desc, Holder h)
+{
+    const auto value = desc->getValue(h);
 
-            os << ',';
+    ++level;
+    os << '{';
 
-            os << endl << indent();
-            os << "\"second\" : ";
-            serialize(value.second);
+    os << endl << indent();
+    os << "\"first\" : ";
+    serialize(value.first);
 
-            --level;
-            os << endl << indent();
-            os << '}';
-        }
-        break;
-    case TypeDescriptor::kMap:
-    case TypeDescriptor::kList:
-    case TypeDescriptor::kSet:
-        {
-            ++level;
-            os << '[';
+    os << ',';
 
-            auto vecDesc = desc->as<ContainerTypeDescriptor>();
-            const auto values = vecDesc->getValue(h);
+    os << endl << indent();
+    os << "\"second\" : ";
+    serialize(value.second);
 
-            for (size_t i = 0; i < values.size(); i++)
-            {
-                os << endl << indent();
+    --level;
+    os << endl << indent();
+    os << '}';
+}
 
-                serialize(values[i]);
+void JsonSerializer::serialize(const ListTypeDescriptor * desc, Holder h)
+{
+    serializeElements(desc, h);
+}
 
-                if (i + 1 < values.size())
-                    os << ',';
-            }
+void JsonSerializer::serialize(const SetTypeDescriptor * desc, Holder h)
+{
+    serializeElements(desc, h);
+}
 
-            --level;
-            os << endl << indent();
-            os << ']';
-        }
-        break;
-    default:
-        os << "\"Unsupported type\"";
-        break;
+void JsonSerializer::serialize(const MapTypeDescriptor * desc, Holder h)
+{
+    serializeElements(desc, h);
+}
+
+/**
+ * Containers are written as arrays of their elements, map entries as
+ * pairs.
+ */
+void JsonSerializer::serializeElements(const ContainerTypeDescriptor * desc,
+                                       Holder h)
+{
+    ++level;
+    os << '[';
+
+    const auto values = desc->getValue(h);
+
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        os << endl << indent();
+
+        serialize(values[i]);
+
+        if (i + 1 < values.size())
+            os << ',';
+    }
+
+    --level;
+    os << endl << indent();
+    os << ']';
+}
+
+/**
+ * Pointers are written as the value they own, and as null if they are
+ * null or do not own it.
+ */
+void JsonSerializer::serialize(const PointerTypeDescriptor * desc, Holder h)
+{
+    if (!desc->isOwner() || desc->isNull(h))
+    {
+        os << "null";
+        return;
     }
+
+    serialize(desc->dereference(h));
+}
+
+void JsonSerializer::serialize(const UnsupportedTypeDescriptor *, Holder)
+{
+    os << "\"Unsupported type\"";
 }
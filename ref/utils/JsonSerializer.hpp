@@ -2,26 +2,80 @@
 #define REF_JSON_HPP
 
 #include <ostream>
+#include <string>
 #include <ref/Holder.hpp>
 
 namespace ref
 {
     struct ModelClass;
+    struct TypeDescriptor;
+    struct ClassDescriptor;
+    struct PrimitiveTypeDescriptor;
+    struct ContainerTypeDescriptor;
+    struct ListTypeDescriptor;
+    struct SetTypeDescriptor;
+    struct MapTypeDescriptor;
+    struct PairTypeDescriptor;
+    struct PointerTypeDescriptor;
+    struct UnsupportedTypeDescriptor;
 
+    namespace detail
+    {
+        /**
+         * @brief Appends text as a quoted JSON string, escaping quotes,
+         * backslashes and control characters, as JsonPullParser decodes
+         * them.
+         */
+        void appendJsonString(std::string& out, const std::string& text);
+    }  // namespace detail
+
+    /**
+     * @brief Writes objects as JSON. Scalars are written as strings, pairs
+     * as {"first", "second"} objects and containers as arrays. Objects
+     * owned by pointers are written inline; null, raw and weak pointers
+     * are written as null.
+     *
+     * With static types, objects are described by the descriptor of the
+     * type they are held as, instead of ModelClass::getClassDescriptor, so
+     * that no virtual function of them is called. Instances built by other
+     * processes, such as those in a SharedSegment, are written this way,
+     * starting from serializeAs. Objects of subclasses are then written as
+     * instances of the type that holds them.
+     */
     struct JsonSerializer
     {
-        JsonSerializer(std::ostream& os_)
-            : os(os_), level(0)
+        JsonSerializer(std::ostream& os_, bool staticTypes_ = false)
+            : os(os_), level(0), staticTypes(staticTypes_)
         {}
 
         void serialize(ModelClass * obj);
         void serialize(Holder h);
 
+        /**
+         * @brief Writes an object as an instance of a class, which must
+         * be its class or a base of it.
+         */
+        void serializeAs(const ClassDescriptor * desc, ModelClass * obj);
+
     protected:
         std::ostream& os;
         int level;
+        bool staticTypes;
 
         const char * indent() const;
+
+        // Values by kind, dispatched from serialize(Holder)
+        void serialize(const PrimitiveTypeDescriptor * desc, Holder h);
+        void serialize(const ClassDescriptor * desc, Holder h);
+        void serialize(const PairTypeDescriptor * desc, Holder h);
+        void serialize(const ListTypeDescriptor * desc, Holder h);
+        void serialize(const SetTypeDescriptor * desc, Holder h);
+        void serialize(const MapTypeDescriptor * desc, Holder h);
+        void serialize(const PointerTypeDescriptor * desc, Holder h);
+        void serialize(const UnsupportedTypeDescriptor * desc, Holder h);
+
+        void serializeElements(const ContainerTypeDescriptor * desc,
+                               Holder h);
     };
 } // namespace ref
 
@@ -0,0 +1,454 @@
+#include "LeakFinder.hpp"
+#include "StructuralContext.hpp"
+#include <ref/Descriptors.hpp>
+#include <ref/Holder.hpp>
+#include <ref/Class.hpp>
+#include <algorithm>
+#include <limits>
+
+using namespace ref;
+using namespace std;
+
+namespace
+{
+    const size_t npos = numeric_limits<size_t>::max();
+}  // namespace
+
+/**
+ * Objects found from the root and the candidates, numbered in the order
+ * they are found. The edges of each object are contiguous.
+ */
+struct LeakFinder::Graph
+{
+    struct Edge
+    {
+        size_t to;
+        bool owner;
+        // Shared pointers, which may be reset to break a cycle
+        Holder pointer;
+    };
+
+    struct Node
+    {
+        ModelClass* obj;
+        size_t firstEdge;
+        size_t edgeCount;
+        size_t owners;
+        size_t sharedOwners;
+        // Shared pointers to the object, including those out of the graph
+        size_t useCount;
+        // Held by value in a set element or a map key
+        bool ordered;
+    };
+
+    vector<Node> nodes;
+    vector<Edge> edges;
+    unordered_map<const ModelClass*, size_t> ids;
+
+    // Set by LeakFinder::build
+    vector<bool> live;
+    vector<size_t> component;
+    size_t components;
+
+    size_t add(ModelClass* obj)
+    {
+        auto res = ids.emplace(obj, nodes.size());
+        if (res.second) nodes.push_back(Node{obj, 0, 0, 0, 0, 0, false});
+        return res.first->second;
+    }
+
+    /**
+     * Adds the edges to the objects in a value of the last object. Shared
+     * pointers in set elements and map keys are not resettable, since
+     * changing them in place would break the order of their container.
+     */
+    void walk(Holder h, bool resettable = true)
+    {
+        auto desc = h.descriptor();
+
+        switch (desc->getKind())
+        {
+        case TypeDescriptor::kClass:
+            {
+                const size_t to = add(desc->as<ClassDescriptor>()->get(h));
+                edges.push_back(Edge{to, true, Holder()});
+                nodes[to].owners++;
+                if (!resettable) nodes[to].ordered = true;
+            }
+            break;
+        case TypeDescriptor::kPointer:
+            {
+                auto ptrDesc = desc->as<PointerTypeDescriptor>();
+                if (ptrDesc->isNull(h)) break;
+
+                Holder value = ptrDesc->dereference(h);
+                // Pointed values are not ordered by the containers
+                if (value.descriptor()->getKind() != TypeDescriptor::kClass)
+                {
+                    walk(value);
+                    break;
+                }
+
+                const size_t to =
+                    add(value.descriptor()->as<ClassDescriptor>()->get(value));
+                const bool shared =
+                    ptrDesc->getPointerType() == PointerTypeDescriptor::kShared;
+
+                edges.push_back(Edge{to, ptrDesc->isOwner(),
+                                     shared && resettable ? h : Holder()});
+
+                if (ptrDesc->isOwner()) nodes[to].owners++;
+                if (shared)
+                {
+                    nodes[to].sharedOwners++;
+                    nodes[to].useCount = ptrDesc->getUseCount(h);
+                }
+            }
+            break;
+        case TypeDescriptor::kPair:
+            {
+                const auto value = desc->as<PairTypeDescriptor>()->getValue(h);
+                walk(value.first, resettable);
+                walk(value.second, resettable);
+            }
+            break;
+        case TypeDescriptor::kList:
+            {
+                auto listDesc = desc->as<ListTypeDescriptor>();
+                const size_t size = listDesc->getSize(h);
+                for (size_t i = 0; i < size; i++)
+                    walk(listDesc->getElement(h, i), resettable);
+            }
+            break;
+        case TypeDescriptor::kSet:
+            for (const auto& value :
+                 desc->as<ContainerTypeDescriptor>()->getValue(h))
+            {
+                walk(value, false);
+            }
+            break;
+        case TypeDescriptor::kMap:
+            for (const auto& value :
+                 desc->as<ContainerTypeDescriptor>()->getValue(h))
+            {
+                const auto entry =
+                    value.descriptor()->as<PairTypeDescriptor>()->getValue(
+                        value);
+                walk(entry.first, false);
+                walk(entry.second, resettable);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    /**
+     * Objects owned from the root, or from outside the model: those not
+     * owned by any object found, or with shared pointers out of the graph.
+     */
+    void findLive()
+    {
+        live.assign(nodes.size(), false);
+
+        vector<size_t> pending(1, 0);
+        for (size_t i = 1; i < nodes.size(); i++)
+        {
+            const Node& node = nodes[i];
+            if (!node.owners || node.useCount > node.sharedOwners)
+                pending.push_back(i);
+        }
+
+        for (auto i : pending)
+            live[i] = true;
+
+        while (!pending.empty())
+        {
+            const Node& node = nodes[pending.back()];
+            pending.pop_back();
+
+            for (size_t e = 0; e < node.edgeCount; e++)
+            {
+                const Edge& edge = edges[node.firstEdge + e];
+                if (edge.owner && !live[edge.to])
+                {
+                    live[edge.to] = true;
+                    pending.push_back(edge.to);
+                }
+            }
+        }
+    }
+
+    /**
+     * Tarjan's algorithm over the owning edges, without recursion, as
+     * ownership chains may be long.
+     */
+    void findComponents()
+    {
+        const size_t count = nodes.size();
+        vector<size_t> index(count, npos);
+        vector<size_t> low(count, 0);
+        vector<bool> onStack(count, false);
+        vector<size_t> stack;
+
+        // Node and next edge to visit
+        vector<pair<size_t, size_t> > frames;
+        size_t next = 0;
+
+        component.assign(count, npos);
+        components = 0;
+
+        for (size_t start = 0; start < count; start++)
+        {
+            if (index[start] != npos) continue;
+
+            frames.emplace_back(start, 0);
+            index[start] = low[start] = next++;
+            stack.push_back(start);
+            onStack[start] = true;
+
+            while (!frames.empty())
+            {
+                const size_t v = frames.back().first;
+                const Node& node = nodes[v];
+                size_t& e = frames.back().second;
+
+                bool descended = false;
+                for (; e < node.edgeCount; e++)
+                {
+                    const Edge& edge = edges[node.firstEdge + e];
+                    if (!edge.owner) continue;
+
+                    const size_t w = edge.to;
+                    if (index[w] == npos)
+                    {
+                        ++e;
+                        index[w] = low[w] = next++;
+                        stack.push_back(w);
+                        onStack[w] = true;
+                        frames.emplace_back(w, 0);
+                        descended = true;
+                        break;
+                    }
+
+                    if (onStack[w]) low[v] = min(low[v], index[w]);
+                }
+
+                if (descended) continue;
+
+                if (low[v] == index[v])
+                {
+                    size_t w;
+                    do
+                    {
+                        w = stack.back();
+                        stack.pop_back();
+                        onStack[w] = false;
+                        component[w] = components;
+                    } while (w != v);
+                    ++components;
+                }
+
+                frames.pop_back();
+                if (!frames.empty())
+                {
+                    const size_t parent = frames.back().first;
+                    low[parent] = min(low[parent], low[v]);
+                }
+            }
+        }
+    }
+
+    /**
+     * Components with an owning edge between two of their objects.
+     */
+    vector<bool> findCyclic() const
+    {
+        vector<bool> cyclic(components, false);
+
+        for (size_t v = 0; v < nodes.size(); v++)
+        {
+            const Node& node = nodes[v];
+            for (size_t e = 0; e < node.edgeCount; e++)
+            {
+                const Edge& edge = edges[node.firstEdge + e];
+                if (edge.owner && component[edge.to] == component[v])
+                    cyclic[component[v]] = true;
+            }
+        }
+        return cyclic;
+    }
+};
+
+LeakFinder::LeakFinder(const StructuralContext& ctx) : m_ctx(ctx) {}
+
+LeakFinder::~LeakFinder() {}
+
+void LeakFinder::addCandidate(weak_ptr<ModelClass> obj)
+{
+    m_candidates.push_back(std::move(obj));
+}
+
+const vector<const FeatureDescriptor*>& LeakFinder::getFeatures(
+    const ClassDescriptor* classDesc)
+{
+    auto it = m_features.find(classDesc);
+    if (it != m_features.end()) return it->second;
+
+    vector<const FeatureDescriptor*> features;
+
+    // Classes out of the context, such as subclasses of the classes in
+    // it, have every feature walked
+    const auto& classes = m_ctx.getAllClasses();
+    if (find(classes.begin(), classes.end(), classDesc) != classes.end())
+    {
+        for (const auto& ref : m_ctx.getAllOutgoingReferences(classDesc))
+        {
+            if (find(features.begin(), features.end(), ref.featureDesc) ==
+                features.end())
+            {
+                features.push_back(ref.featureDesc);
+            }
+        }
+    }
+    else
+    {
+        features = classDesc->getAllFeatureDescriptors();
+    }
+
+    return m_features.emplace(classDesc, std::move(features)).first->second;
+}
+
+void LeakFinder::build(ModelClass* root, Graph& graph)
+{
+    graph.add(root);
+
+    // Candidates are released before counting the owners of the objects
+    for (const auto& candidate : m_candidates)
+    {
+        ModelClass* obj = candidate.lock().get();
+        if (obj) graph.add(obj);
+    }
+
+    for (size_t i = 0; i < graph.nodes.size(); i++)
+    {
+        ModelClass* obj = graph.nodes[i].obj;
+        graph.nodes[i].firstEdge = graph.edges.size();
+
+        // Features of classes with a seqlock hold no owners to reset
+        const ClassDescriptor* classDesc = obj->getClassDescriptor();
+        const Holder snapshot = classDesc->snapshot(obj);
+        for (auto feature : getFeatures(classDesc))
+        {
+            graph.walk(feature->getValue(classDesc->get(snapshot)),
+                       !graph.nodes[i].ordered);
+        }
+
+        graph.nodes[i].edgeCount =
+            graph.edges.size() - graph.nodes[i].firstEdge;
+    }
+
+    graph.findLive();
+    graph.findComponents();
+}
+
+LeakReport LeakFinder::analyze(ModelClass* root)
+{
+    Graph graph;
+    build(root, graph);
+
+    LeakReport report;
+    report.objects = graph.nodes.size();
+
+    const vector<bool> cyclic = graph.findCyclic();
+    vector<size_t> cycleIndex(graph.components, npos);
+
+    for (size_t v = 0; v < graph.nodes.size(); v++)
+    {
+        const size_t c = graph.component[v];
+        if (cyclic[c])
+        {
+            if (cycleIndex[c] == npos)
+            {
+                cycleIndex[c] = report.cycles.size();
+                report.cycles.emplace_back();
+            }
+            report.cycles[cycleIndex[c]].push_back(graph.nodes[v].obj);
+        }
+
+        if (!graph.live[v]) report.leaked.push_back(graph.nodes[v].obj);
+    }
+
+    // Candidates that are no longer found have been released
+    m_candidates.erase(
+        remove_if(m_candidates.begin(), m_candidates.end(),
+                  [](const weak_ptr<ModelClass>& c) { return c.expired(); }),
+        m_candidates.end());
+
+    return report;
+}
+
+size_t LeakFinder::collect(ModelClass* root)
+{
+    size_t count = 0;
+
+    for (;;)
+    {
+        Graph graph;
+        build(root, graph);
+
+        const vector<bool> cyclic = graph.findCyclic();
+
+        // Leaked cycles owned by other leaked objects are released along
+        // with them, or broken in a later pass
+        vector<bool> owned(graph.components, false);
+        for (size_t v = 0; v < graph.nodes.size(); v++)
+        {
+            if (graph.live[v]) continue;
+
+            const auto& node = graph.nodes[v];
+            for (size_t e = 0; e < node.edgeCount; e++)
+            {
+                const auto& edge = graph.edges[node.firstEdge + e];
+                if (edge.owner && graph.component[edge.to] != graph.component[v])
+                    owned[graph.component[edge.to]] = true;
+            }
+        }
+
+        // A shared pointer within each of the other leaked cycles. They do
+        // not own each other, so resetting one releases no other
+        vector<Holder> pointers;
+        vector<bool> done(graph.components, false);
+
+        for (size_t v = 0; v < graph.nodes.size(); v++)
+        {
+            const size_t c = graph.component[v];
+            if (graph.live[v] || !cyclic[c] || owned[c] || done[c]) continue;
+
+            const auto& node = graph.nodes[v];
+            for (size_t e = 0; e < node.edgeCount; e++)
+            {
+                const auto& edge = graph.edges[node.firstEdge + e];
+                if (edge.pointer.isValid() && graph.component[edge.to] == c)
+                {
+                    pointers.push_back(edge.pointer);
+                    done[c] = true;
+                    break;
+                }
+            }
+        }
+
+        if (pointers.empty()) break;
+
+        for (auto& pointer : pointers)
+            pointer.descriptor()->as<PointerTypeDescriptor>()->reset(pointer);
+        count += pointers.size();
+    }
+
+    m_candidates.erase(
+        remove_if(m_candidates.begin(), m_candidates.end(),
+                  [](const weak_ptr<ModelClass>& c) { return c.expired(); }),
+        m_candidates.end());
+
+    return count;
+}
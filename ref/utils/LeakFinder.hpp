@@ -0,0 +1,90 @@
+#ifndef REFCPP_LEAK_FINDER_HPP
+#define REFCPP_LEAK_FINDER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ref
+{
+    struct ModelClass;
+    struct ClassDescriptor;
+    struct FeatureDescriptor;
+    struct StructuralContext;
+
+    struct LeakReport
+    {
+        /**
+         * @brief Groups of objects that own each other, directly or
+         * through other objects of the group. Each one is kept alive by
+         * its own shared pointers.
+         */
+        std::vector<std::vector<ModelClass*> > cycles;
+
+        /**
+         * @brief Objects owned neither from the root nor from outside the
+         * model, and therefore never released.
+         */
+        std::vector<ModelClass*> leaked;
+
+        /**
+         * @brief Number of objects found.
+         */
+        std::size_t objects;
+    };
+
+    /**
+     * @brief Finds reference cycles and leaked objects in the graph of
+     * objects reachable from a root.
+     *
+     * Objects are found through every kind of pointer, including weak and
+     * raw ones, and through the candidates added, if any. They are owned
+     * through values, containers and owning pointers. Objects whose
+     * shared pointers are not all in the graph are owned from outside the
+     * model; the rest are leaked unless owned from the root or from those.
+     *
+     * Only the features that hold references in the structural context
+     * are walked, so large values without objects are skipped.
+     */
+    struct LeakFinder
+    {
+        LeakFinder(const StructuralContext& ctx);
+        ~LeakFinder();
+
+        /**
+         * @brief Adds an object to look for, for instance one that should
+         * have been released by now.
+         */
+        void addCandidate(std::weak_ptr<ModelClass> obj);
+
+        LeakReport analyze(ModelClass* root);
+
+        /**
+         * @brief Releases the leaked objects by resetting shared pointers
+         * that close cycles among them. Objects owned from the root or
+         * from outside the model are left untouched, and so are the
+         * pointers in set elements and map keys, which cannot change in
+         * place: cycles closed only through them are kept.
+         *
+         * @return The number of pointers reset.
+         */
+        std::size_t collect(ModelClass* root);
+
+    protected:
+        struct Graph;
+
+        const StructuralContext& m_ctx;
+        std::vector<std::weak_ptr<ModelClass> > m_candidates;
+        std::unordered_map<const ClassDescriptor*,
+                           std::vector<const FeatureDescriptor*> >
+            m_features;
+
+        const std::vector<const FeatureDescriptor*>& getFeatures(
+            const ClassDescriptor* classDesc);
+
+        void build(ModelClass* root, Graph& graph);
+    };
+}  // namespace ref
+
+#endif  // REFCPP_LEAK_FINDER_HPP
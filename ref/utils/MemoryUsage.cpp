@@ -0,0 +1,204 @@
+#include "MemoryUsage.hpp"
+#include <ref/Descriptors.hpp>
+#include <ref/Holder.hpp>
+#include <ref/Class.hpp>
+#include <algorithm>
+#include <vector>
+
+using namespace ref;
+using namespace std;
+
+namespace
+{
+    // Reference counts and deleter of shared pointers
+    const size_t controlBlockSize = 2 * sizeof(void*);
+
+    string getName(const Descriptor* desc)
+    {
+        return desc ? desc->getFqn() : "<unknown>";
+    }
+}  // namespace
+
+MemoryUsage::MemoryUsage(MemoryReport* report)
+    : m_report(report), m_nested(0)
+{
+}
+
+MemoryUsage::~MemoryUsage() {}
+
+size_t MemoryUsage::measure(Holder h)
+{
+    auto desc = h.descriptor();
+
+    if (desc->getKind() == TypeDescriptor::kClass)
+    {
+        ModelClass* obj = desc->as<ClassDescriptor>()->get(h);
+        return m_visited.insert(obj).second ? object(obj) : 0;
+    }
+
+    return desc->getTypeSize() + value(h);
+}
+
+size_t MemoryUsage::object(ModelClass* obj)
+{
+    const ClassDescriptor* classDesc = obj->getClassDescriptor();
+
+    const size_t outer = m_nested;
+    m_nested = 0;
+
+    size_t bytes = classDesc->getTypeSize();
+    const Holder snapshot = classDesc->snapshot(obj);
+    classDesc->forEachFeature(
+        classDesc->get(snapshot),
+        [&](const FeatureDescriptor* feature, Holder h) {
+            const size_t featureBytes = value(h);
+            bytes += featureBytes;
+
+            if (m_report)
+            {
+                auto& entry = m_report->features[feature];
+                entry.count++;
+                entry.bytes += featureBytes;
+            }
+        });
+
+    if (m_report)
+    {
+        auto& entry = m_report->classes[classDesc];
+        entry.count++;
+        entry.bytes += bytes - m_nested;
+    }
+
+    m_nested = outer + bytes;
+    return bytes;
+}
+
+size_t MemoryUsage::value(Holder h)
+{
+    auto desc = h.descriptor();
+
+    switch (desc->getKind())
+    {
+    case TypeDescriptor::kClass:
+        // Its own size is part of the value that contains it
+        return object(desc->as<ClassDescriptor>()->get(h)) -
+               desc->getTypeSize();
+    case TypeDescriptor::kPointer:
+        {
+            auto ptrDesc = desc->as<PointerTypeDescriptor>();
+            if (ptrDesc->isNull(h)) return 0;
+
+            const auto type = ptrDesc->getPointerType();
+            if (type == PointerTypeDescriptor::kOptional)
+                return value(ptrDesc->dereference(h));
+            if (!ptrDesc->isOwner()) return 0;
+
+            const size_t controlBlock =
+                type == PointerTypeDescriptor::kShared ? controlBlockSize : 0;
+
+            Holder pointed = ptrDesc->dereference(h);
+            auto pointedDesc = pointed.descriptor();
+            if (pointedDesc->getKind() != TypeDescriptor::kClass)
+                return controlBlock + pointedDesc->getTypeSize() +
+                       value(pointed);
+
+            ModelClass* obj = pointedDesc->as<ClassDescriptor>()->get(pointed);
+            if (!m_visited.insert(obj).second) return 0;
+            return controlBlock + object(obj);
+        }
+    case TypeDescriptor::kPair:
+        {
+            const auto values = desc->as<PairTypeDescriptor>()->getValue(h);
+            return value(values.first) + value(values.second);
+        }
+    case TypeDescriptor::kList:
+        {
+            auto listDesc = desc->as<ListTypeDescriptor>();
+            size_t bytes = desc->getHeapSize(h);
+            const size_t size = listDesc->getSize(h);
+            for (size_t i = 0; i < size; i++)
+                bytes += value(listDesc->getElement(h, i));
+            return bytes;
+        }
+    case TypeDescriptor::kSet:
+    case TypeDescriptor::kMap:
+        {
+            size_t bytes = desc->getHeapSize(h);
+            for (const auto& element :
+                 desc->as<ContainerTypeDescriptor>()->getValue(h))
+            {
+                bytes += value(element);
+            }
+            return bytes;
+        }
+    default:
+        break;
+    }
+
+    return desc->getHeapSize(h);
+}
+
+size_t ref::memoryUsage(Holder h)
+{
+    return MemoryUsage().measure(h);
+}
+
+MemoryReport ref::computeMemoryReport(ModelClass* root)
+{
+    MemoryReport report;
+    report.total = MemoryUsage(&report).measure(
+        Holder(root, root->getClassDescriptor()));
+    return report;
+}
+
+void ref::printMemoryReport(ostream& os, const MemoryReport& report)
+{
+    typedef pair<const FeatureDescriptor*, MemoryReport::Entry> FeatureEntry;
+
+    struct ClassEntry
+    {
+        const ClassDescriptor* classDesc;
+        MemoryReport::Entry entry;
+        vector<FeatureEntry> features;
+    };
+
+    // Classes without objects of their own, such as abstract ones, are
+    // listed for the features defined in them
+    map<const ClassDescriptor*, ClassEntry> classes;
+    for (const auto& entry : report.classes)
+        classes[entry.first].entry = entry.second;
+    for (const auto& feature : report.features)
+        classes[feature.first->getDefinedIn()].features.push_back(feature);
+
+    vector<ClassEntry> sortedClasses;
+    for (auto& entry : classes)
+    {
+        entry.second.classDesc = entry.first;
+        sortedClasses.push_back(entry.second);
+    }
+
+    sort(sortedClasses.begin(), sortedClasses.end(),
+         [](const ClassEntry& a, const ClassEntry& b) {
+             return a.entry.bytes > b.entry.bytes;
+         });
+
+    os << "Total: " << report.total << " bytes" << endl;
+
+    for (auto& classEntry : sortedClasses)
+    {
+        os << getName(classEntry.classDesc) << ": " << classEntry.entry.count
+           << " objects, " << classEntry.entry.bytes << " bytes" << endl;
+
+        sort(classEntry.features.begin(), classEntry.features.end(),
+             [](const FeatureEntry& a, const FeatureEntry& b) {
+                 return a.second.bytes > b.second.bytes;
+             });
+
+        for (const auto& feature : classEntry.features)
+        {
+            os << "    " << feature.first->getName() << ": "
+               << feature.second.count << " values, "
+               << feature.second.bytes << " bytes" << endl;
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef REFCPP_MEMORY_USAGE_HPP
+#define REFCPP_MEMORY_USAGE_HPP
+
+#include <cstddef>
+#include <map>
+#include <ostream>
+#include <unordered_set>
+#include <ref/Holder.hpp>
+
+namespace ref
+{
+    struct ModelClass;
+    struct ClassDescriptor;
+    struct FeatureDescriptor;
+
+    struct MemoryReport
+    {
+        struct Entry
+        {
+            std::size_t count;
+            std::size_t bytes;
+
+            Entry() : count(0), bytes(0) {}
+        };
+
+        /**
+         * @brief Objects of each class and the memory they use, excluding
+         * that of the objects they contain or own, which is accounted to
+         * their own classes. The sum over every class is the total.
+         */
+        std::map<const ClassDescriptor*, Entry> classes;
+
+        /**
+         * @brief Values of each feature and the memory they use out of
+         * their objects, including that of the objects they contain or
+         * own.
+         */
+        std::map<const FeatureDescriptor*, Entry> features;
+
+        std::size_t total;
+
+        MemoryReport() : total(0) {}
+    };
+
+    /**
+     * @brief Measures the memory used by values: their own size, the
+     * memory allocated by them and, recursively, by their elements and
+     * the values and objects they own.
+     *
+     * Objects owned through unique and shared pointers are counted once,
+     * along with the control blocks of shared pointers, even when measured
+     * through different values. Objects referenced through raw and weak
+     * pointers are not counted. Allocations are estimated from the sizes
+     * and capacities of the values, without the overhead of the allocator.
+     */
+    struct MemoryUsage
+    {
+        /**
+         * @param report Accumulates the memory used by each class and
+         * feature measured, if any.
+         */
+        MemoryUsage(MemoryReport* report = nullptr);
+        ~MemoryUsage();
+
+        /**
+         * @return The memory used by the value contained in h, or zero
+         * for an object already measured.
+         */
+        std::size_t measure(Holder h);
+
+    protected:
+        MemoryReport* m_report;
+        std::unordered_set<const ModelClass*> m_visited;
+
+        // Memory used by the objects measured within the current one
+        std::size_t m_nested;
+
+        std::size_t object(ModelClass* obj);
+        std::size_t value(Holder h);
+    };
+
+    /**
+     * @brief Memory used by the value contained in h, along with that of
+     * the values and objects it owns.
+     */
+    std::size_t memoryUsage(Holder h);
+
+    /**
+     * @brief Measures the objects owned by root, root included.
+     */
+    MemoryReport computeMemoryReport(ModelClass* root);
+
+    /**
+     * @brief Prints a report grouped by class, as the instrumentation
+     * report does. Classes are sorted by the memory they use, followed by
+     * the features defined in them.
+     */
+    void printMemoryReport(std::ostream& os, const MemoryReport& report);
+}  // namespace ref
+
+#endif  // REFCPP_MEMORY_USAGE_HPP
@@ -0,0 +1,468 @@
+#ifndef REFCPP_QUERY_HPP
+#define REFCPP_QUERY_HPP
+
+#include <map>
+#include <vector>
+#include <thread>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <exception>
+#include <stdexcept>
+#include <boost/optional.hpp>
+#include <ref/Class.hpp>
+#include <ref/Holder.hpp>
+#include <ref/DescriptorsImpl.ipp>
+
+namespace ref
+{
+    /**
+     * @brief Typed closure that reads a feature of type T from an
+     * instance of Class without going through a Holder.
+     */
+    template <typename Class, typename T>
+    struct Accessor
+    {
+        typedef T value_type;
+        // A copy for classes with a seqlock, as returned by Class::get
+        typedef detail::GetResult<Class, const T> result_type;
+        typedef result_type (*Function)(const Class&);
+
+        explicit Accessor(Function fn_ = nullptr) : fn(fn_) {}
+
+        result_type operator()(const Class& obj) const { return fn(obj); }
+
+        bool isValid() const { return fn != nullptr; }
+
+        Function fn;
+    };
+
+    namespace detail
+    {
+        template <typename Class, typename DefinedIn, typename Feature>
+        GetResult<Class, const typename Feature::type> getFeatureValue(
+            const Class& obj)
+        {
+            return static_cast<const DefinedIn&>(obj).template get<Feature>();
+        }
+
+        template <typename Class, typename T>
+        struct AccessorResolver
+        {
+            const FeatureDescriptor* feature;
+            Accessor<Class, T>& result;
+
+            AccessorResolver(const FeatureDescriptor* feature_,
+                             Accessor<Class, T>& result_)
+                : feature(feature_), result(result_)
+            {
+            }
+
+            template <typename DefinedIn, typename Feature>
+            void resolve(boost::true_type) const
+            {
+                result.fn = &getFeatureValue<Class, DefinedIn, Feature>;
+            }
+
+            template <typename DefinedIn, typename Feature>
+            void resolve(boost::false_type) const
+            {
+                throw std::invalid_argument("Feature type mismatch: " +
+                                            feature->getName());
+            }
+
+            template <typename DefinedIn>
+            struct Level
+            {
+                const AccessorResolver& r;
+
+                template <typename Feature>
+                void operator()(Feature*) const
+                {
+                    if (FeatureDescriptorImpl<DefinedIn, Feature>::instance() !=
+                        r.feature)
+                        return;
+
+                    typedef typename boost::is_same<typename Feature::type,
+                                                     T>::type same_type;
+                    r.template resolve<DefinedIn, Feature>(same_type());
+                }
+            };
+
+            template <typename DefinedIn>
+            void operator()(DefinedIn*)
+            {
+                ref::for_each<typename DefinedIn::features_type>(
+                    Level<DefinedIn>{*this});
+
+                if (!result.isValid())
+                    (*this)(static_cast<typename DefinedIn::base_class*>(
+                        nullptr));
+            }
+
+            void operator()(ModelClass*) {}
+        };
+
+        template <typename Class>
+        struct QueryElement
+        {
+            static const Class* get(const Class& obj) { return &obj; }
+
+            static const Class* get(const Class* obj) { return obj; }
+
+            static const Class* get(const std::shared_ptr<Class>& obj)
+            {
+                return obj.get();
+            }
+
+            static const Class* get(const std::unique_ptr<Class>& obj)
+            {
+                return obj.get();
+            }
+        };
+
+        template <typename Class, typename Container>
+        bool appendListElements(Holder h, std::vector<const Class*>& res)
+        {
+            if (h.descriptor() != TypeDescriptor::getDescriptor<Container>())
+                return false;
+
+            const Container* c = h.get<Container>();
+            res.reserve(c->size());
+
+            for (const auto& i : *c)
+                if (const Class* obj = QueryElement<Class>::get(i))
+                    res.push_back(obj);
+
+            return true;
+        }
+    }  // namespace detail
+
+    /**
+     * @brief Builds an accessor for a feature known at compile time.
+     */
+    template <typename Class, typename Feature>
+    Accessor<Class, typename Feature::type> accessor()
+    {
+        typedef typename detail::FeatureDefinedIn<Class, Feature>::type
+            DefinedIn;
+        return Accessor<Class, typename Feature::type>(
+            &detail::getFeatureValue<Class, DefinedIn, Feature>);
+    }
+
+    /**
+     * @brief Resolves a feature descriptor of Class, or of any of its
+     * parent classes, into a typed accessor.
+     *
+     * @throw std::invalid_argument if the feature is not defined in the
+     * hierarchy of Class or if its type is not T.
+     */
+    template <typename Class, typename T>
+    Accessor<Class, T> accessor(const FeatureDescriptor* feature)
+    {
+        Accessor<Class, T> result;
+        detail::AccessorResolver<Class, T> resolver(feature, result);
+        resolver(static_cast<Class*>(nullptr));
+
+        if (!result.isValid())
+        {
+            throw std::invalid_argument(
+                "Feature not defined in class: " +
+                (feature ? feature->getName() : std::string("null")));
+        }
+
+        return result;
+    }
+
+    /**
+     * @brief Filters, projects and aggregates containers of instances of
+     * Class.
+     *
+     * Predicates and projections are resolved once into typed accessors,
+     * so evaluating them neither creates holders nor converts values into
+     * strings. Supported containers are any iterable of Class, Class*,
+     * std::shared_ptr<Class> or std::unique_ptr<Class>, and holders
+     * containing a std::vector of them. Null pointers are skipped.
+     *
+     * When built with more than one thread, random access containers
+     * are split in contiguous chunks evaluated in parallel.
+     * Predicates and accessors must be safe to call concurrently. The
+     * first exception thrown by a chunk is rethrown once all of them
+     * have finished.
+     */
+    template <typename Class>
+    struct Query
+    {
+        typedef std::function<bool(const Class&)> Predicate;
+        typedef std::vector<const Class*> ObjectVector;
+
+        explicit Query(unsigned threads = 1) : m_threads(threads ? threads : 1)
+        {
+        }
+
+        // Filters
+
+        Query& where(Predicate predicate)
+        {
+            m_predicates.push_back(predicate);
+            return *this;
+        }
+
+        template <typename T, typename Pred>
+        Query& where(Accessor<Class, T> acc, Pred pred)
+        {
+            return where(Predicate(
+                [acc, pred](const Class& obj) { return pred(acc(obj)); }));
+        }
+
+        template <typename Feature, typename Pred>
+        Query& where(Pred pred)
+        {
+            return where(accessor<Class, Feature>(), pred);
+        }
+
+        template <typename T, typename Pred>
+        Query& where(const FeatureDescriptor* feature, Pred pred)
+        {
+            return where(accessor<Class, T>(feature), pred);
+        }
+
+        bool matches(const Class& obj) const
+        {
+            for (const auto& predicate : m_predicates)
+                if (!predicate(obj)) return false;
+            return true;
+        }
+
+        // Operations
+
+        template <typename Container>
+        ObjectVector filter(const Container& c) const
+        {
+            return run(c, ObjectVector(),
+                       [](ObjectVector& res, const Class* obj) {
+                           res.push_back(obj);
+                       },
+                       [](ObjectVector& res, const ObjectVector& partial) {
+                           res.insert(res.end(), partial.begin(),
+                                      partial.end());
+                       });
+        }
+
+        template <typename Container>
+        std::size_t count(const Container& c) const
+        {
+            return run(c, std::size_t(0),
+                       [](std::size_t& res, const Class*) { ++res; },
+                       [](std::size_t& res, std::size_t partial) {
+                           res += partial;
+                       });
+        }
+
+        template <typename T, typename Container>
+        std::vector<T> project(Accessor<Class, T> acc,
+                               const Container& c) const
+        {
+            return run(c, std::vector<T>(),
+                       [acc](std::vector<T>& res, const Class* obj) {
+                           res.push_back(acc(*obj));
+                       },
+                       [](std::vector<T>& res, const std::vector<T>& partial) {
+                           res.insert(res.end(), partial.begin(),
+                                      partial.end());
+                       });
+        }
+
+        template <typename T, typename Container>
+        T sum(Accessor<Class, T> acc, const Container& c) const
+        {
+            return run(c, T(),
+                       [acc](T& res, const Class* obj) { res += acc(*obj); },
+                       [](T& res, const T& partial) { res += partial; });
+        }
+
+        template <typename T, typename Container>
+        boost::optional<T> min(Accessor<Class, T> acc,
+                               const Container& c) const
+        {
+            return extreme(acc, c, std::less<T>());
+        }
+
+        template <typename T, typename Container>
+        boost::optional<T> max(Accessor<Class, T> acc,
+                               const Container& c) const
+        {
+            return extreme(acc, c, std::greater<T>());
+        }
+
+        template <typename K, typename Container>
+        std::map<K, ObjectVector> groupBy(Accessor<Class, K> acc,
+                                          const Container& c) const
+        {
+            typedef std::map<K, ObjectVector> Groups;
+
+            return run(c, Groups(),
+                       [acc](Groups& res, const Class* obj) {
+                           res[acc(*obj)].push_back(obj);
+                       },
+                       [](Groups& res, const Groups& partial) {
+                           for (const auto& group : partial)
+                           {
+                               ObjectVector& objs = res[group.first];
+                               objs.insert(objs.end(), group.second.begin(),
+                                           group.second.end());
+                           }
+                       });
+        }
+
+        // Shortcuts for features named by type
+
+        template <typename Feature, typename Container>
+        std::vector<typename Feature::type> project(const Container& c) const
+        {
+            return project(accessor<Class, Feature>(), c);
+        }
+
+        template <typename Feature, typename Container>
+        typename Feature::type sum(const Container& c) const
+        {
+            return sum(accessor<Class, Feature>(), c);
+        }
+
+        template <typename Feature, typename Container>
+        boost::optional<typename Feature::type> min(const Container& c) const
+        {
+            return min(accessor<Class, Feature>(), c);
+        }
+
+        template <typename Feature, typename Container>
+        boost::optional<typename Feature::type> max(const Container& c) const
+        {
+            return max(accessor<Class, Feature>(), c);
+        }
+
+        template <typename Feature, typename Container>
+        std::map<typename Feature::type, ObjectVector> groupBy(
+            const Container& c) const
+        {
+            return groupBy(accessor<Class, Feature>(), c);
+        }
+
+    protected:
+        unsigned m_threads;
+        std::vector<Predicate> m_predicates;
+
+        template <typename T, typename Container, typename Compare>
+        boost::optional<T> extreme(Accessor<Class, T> acc, const Container& c,
+                                   Compare cmp) const
+        {
+            typedef boost::optional<T> Result;
+
+            return run(c, Result(),
+                       [acc, cmp](Result& res, const Class* obj) {
+                           const T& value = acc(*obj);
+                           if (!res || cmp(value, *res)) res = value;
+                       },
+                       [cmp](Result& res, const Result& partial) {
+                           if (partial && (!res || cmp(*partial, *res)))
+                               res = partial;
+                       });
+        }
+
+        template <typename Iterator, typename Result, typename Fn>
+        void runRange(Iterator first, Iterator last, Result& res, Fn fn) const
+        {
+            for (; first != last; ++first)
+            {
+                const Class* obj = detail::QueryElement<Class>::get(*first);
+                if (obj && matches(*obj)) fn(res, obj);
+            }
+        }
+
+        template <typename Container, typename Result, typename Fn,
+                  typename Merge>
+        Result run(const Container& c, Result init, Fn fn, Merge merge) const
+        {
+            typedef typename Container::const_iterator Iterator;
+            typedef typename std::iterator_traits<Iterator>::iterator_category
+                Category;
+
+            const std::size_t size = c.size();
+            const std::size_t chunks = std::min<std::size_t>(m_threads, size);
+
+            if (chunks <= 1 ||
+                !boost::is_base_of<std::random_access_iterator_tag,
+                                   Category>::value)
+            {
+                runRange(c.begin(), c.end(), init, fn);
+                return init;
+            }
+
+            // Partials start empty, so that init is merged only once
+            std::vector<Result> partials(chunks);
+            std::vector<std::exception_ptr> errors(chunks);
+            std::vector<std::thread> threads;
+            const std::size_t chunkSize = (size + chunks - 1) / chunks;
+
+            for (std::size_t i = 0; i < chunks; i++)
+            {
+                Iterator first = c.begin();
+                std::advance(first, std::min(size, i * chunkSize));
+                Iterator last = c.begin();
+                std::advance(last, std::min(size, (i + 1) * chunkSize));
+
+                Result& partial = partials[i];
+                std::exception_ptr& error = errors[i];
+                threads.push_back(std::thread([this, first, last, &partial,
+                                               &error, &fn]() {
+                    try
+                    {
+                        runRange(first, last, partial, fn);
+                    }
+                    catch (...)
+                    {
+                        error = std::current_exception();
+                    }
+                }));
+            }
+
+            for (auto& thread : threads)
+                thread.join();
+
+            for (const auto& error : errors)
+                if (error) std::rethrow_exception(error);
+
+            for (const auto& partial : partials)
+                merge(init, partial);
+
+            return init;
+        }
+
+        template <typename Result, typename Fn, typename Merge>
+        Result run(Holder h, Result init, Fn fn, Merge merge) const
+        {
+            if (!h.isValid() ||
+                h.descriptor()->getKind() != TypeDescriptor::kList)
+            {
+                throw std::invalid_argument("Holder does not contain a list");
+            }
+
+            ObjectVector objs;
+            if (!detail::appendListElements<Class, std::vector<Class> >(h,
+                                                                         objs) &&
+                !detail::appendListElements<Class, std::vector<Class*> >(
+                    h, objs) &&
+                !detail::appendListElements<
+                    Class, std::vector<std::shared_ptr<Class> > >(h, objs))
+            {
+                throw std::invalid_argument(
+                    "Unsupported list type: " + h.descriptor()->getFqn());
+            }
+
+            return run(objs, init, fn, merge);
+        }
+    };
+
+}  // namespace ref
+
+#endif  // REFCPP_QUERY_HPP
@@ -2,9 +2,26 @@
 #include <ref/Class.hpp>
 #include <ref/Holder.hpp>
 #include <cassert>
+#include <type_traits>
 
 using namespace ref;
 
+namespace
+{
+    // Null for types other than primitive ones
+    const PrimitiveTypeDescriptor* asPrimitive(const TypeDescriptor* t)
+    {
+        const PrimitiveTypeDescriptor* primDesc = nullptr;
+        visitType(t, [&](auto desc) {
+            typedef decltype(desc) D;
+            if constexpr (std::is_same<D,
+                                       const PrimitiveTypeDescriptor*>::value)
+                primDesc = desc;
+        });
+        return primDesc;
+    }
+}  // namespace
+
 struct DefaultReferenceResolver::Impl
 {
     Impl(const StructuralContext& ctx) : m_ctx(ctx) {}
@@ -25,17 +42,19 @@ std::string DefaultReferenceResolver::getIdForObject(ModelClass* obj)
 
     static const std::string defaultIds[] = {"Id", "Name"};
     const ClassDescriptor* desc = obj->getClassDescriptor();
+    const Holder snapshot = desc->snapshot(obj);
+    obj = desc->get(snapshot);
 
     for (const auto& id : defaultIds)
     {
         const FeatureDescriptor* f = desc->getFeatureDescriptor(id);
         if (!f) continue;
 
-        const TypeDescriptor* t = f->getTypeDescriptor();
-        if (t->getKind() != TypeDescriptor::kPrimitive) continue;
+        const PrimitiveTypeDescriptor* t = asPrimitive(f->getTypeDescriptor());
+        if (!t) continue;
 
         Holder h = f->getValue(obj);
-        return t->as<PrimitiveTypeDescriptor>()->getString(h);
+        return t->getString(h);
     }
 
     // Use first primtive feature
@@ -43,12 +62,12 @@ std::string DefaultReferenceResolver::getIdForObject(ModelClass* obj)
 
     for (const auto& f: features)
     {
-        const TypeDescriptor* t = f->getTypeDescriptor();
+        const PrimitiveTypeDescriptor* t = asPrimitive(f->getTypeDescriptor());
 
-        if (t->getKind() == TypeDescriptor::kPrimitive)
+        if (t)
         {
             Holder h = f->getValue(obj);
-            return t->as<PrimitiveTypeDescriptor>()->getString(h);
+            return t->getString(h);
         }
     }
 
@@ -0,0 +1,285 @@
+#include "ResumableJsonSerializer.hpp"
+#include "JsonSerializer.hpp"
+#include <ref/Descriptors.hpp>
+#include <ref/Class.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace ref;
+using namespace std;
+
+namespace
+{
+    // As in JsonSerializer
+    const int maxLevel = 20;
+    const size_t spaces = 4;
+}  // namespace
+
+OutputSink::~OutputSink() {}
+
+StreamSink::StreamSink(ostream& os) : m_os(os) {}
+
+size_t StreamSink::write(const char * data, size_t size)
+{
+    m_os.write(data, size);
+    return size;
+}
+
+FileDescriptorSink::FileDescriptorSink(int fd) : m_fd(fd) {}
+
+size_t FileDescriptorSink::write(const char * data, size_t size)
+{
+    for (;;)
+    {
+        const ssize_t written = ::write(m_fd, data, size);
+        if (written >= 0) return written;
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        if (errno != EINTR)
+            throw runtime_error(string("Cannot write: ") + strerror(errno));
+    }
+}
+
+struct ResumableJsonSerializer::Frame
+{
+    enum Kind
+    {
+        kObject, kPair, kList, kContainer
+    };
+
+    Kind kind;
+    Holder h;
+    ModelClass * obj;
+    const vector<const FeatureDescriptor*>* features;
+    // Elements of sets and maps, and both halves of pairs
+    vector<Holder> values;
+    size_t index;
+    size_t size;
+
+    Frame(Kind kind_, Holder h_, ModelClass * obj_ = nullptr)
+        : kind(kind_), h(h_), obj(obj_), features(), index(0), size(0)
+    {}
+};
+
+ResumableJsonSerializer::ResumableJsonSerializer(ModelClass * obj,
+                                                 size_t chunkSize)
+    : m_chunkSize(chunkSize), m_started(false), m_level(0), m_offset(0)
+{
+    if (obj) m_root = Holder(obj, obj->getClassDescriptor());
+}
+
+ResumableJsonSerializer::ResumableJsonSerializer(Holder h, size_t chunkSize)
+    : m_chunkSize(chunkSize), m_root(h), m_started(false), m_level(0),
+      m_offset(0)
+{
+}
+
+ResumableJsonSerializer::~ResumableJsonSerializer() {}
+
+bool ResumableJsonSerializer::isDone() const
+{
+    return m_started && m_stack.empty() && m_offset == m_pending.size();
+}
+
+ResumableJsonSerializer::Status ResumableJsonSerializer::resume(
+    OutputSink& sink)
+{
+    bool formatted = false;
+
+    for (;;)
+    {
+        while (m_offset < m_pending.size())
+        {
+            const size_t written = sink.write(m_pending.data() + m_offset,
+                                              m_pending.size() - m_offset);
+            if (!written) return kBlocked;
+            m_offset += written;
+        }
+
+        // A chunk per call, so the caller gets to serve other work
+        if (formatted) return isDone() ? kDone : kPending;
+
+        m_offset = 0;
+        if (!next(m_pending)) return kDone;
+        formatted = true;
+    }
+}
+
+bool ResumableJsonSerializer::next(string& chunk)
+{
+    chunk.clear();
+
+    if (!m_started)
+    {
+        m_started = true;
+        beginValue(chunk, m_root);
+    }
+
+    while (!m_stack.empty())
+    {
+        step(chunk);
+        if (chunk.size() >= m_chunkSize) break;
+    }
+
+    return !chunk.empty();
+}
+
+void ResumableJsonSerializer::newLine(string& out) const
+{
+    out += '\n';
+    out.append(min(m_level, maxLevel) * spaces, ' ');
+}
+
+void ResumableJsonSerializer::beginObject(string& out, ModelClass * obj)
+{
+    if (!obj) return;
+
+    const ClassDescriptor * classDesc = obj->getClassDescriptor();
+    auto it = m_features.find(classDesc);
+    if (it == m_features.end())
+    {
+        it = m_features
+                 .emplace(classDesc, classDesc->getAllFeatureDescriptors())
+                 .first;
+    }
+
+    ++m_level;
+    out += '{';
+
+    // The snapshot is kept until the object is written
+    const Holder snapshot = classDesc->snapshot(obj);
+    m_stack.emplace_back(Frame::kObject, snapshot, classDesc->get(snapshot));
+    m_stack.back().features = &it->second;
+    m_stack.back().size = it->second.size();
+}
+
+void ResumableJsonSerializer::beginValue(string& out, Holder h)
+{
+    if (!h.isValid()) return;
+
+    auto desc = h.descriptor();
+
+    switch (desc->getKind())
+    {
+    case TypeDescriptor::kPrimitive:
+        detail::appendJsonString(
+            out, desc->as<PrimitiveTypeDescriptor>()->getString(h));
+        break;
+    case TypeDescriptor::kClass:
+        beginObject(out, desc->as<ClassDescriptor>()->get(h));
+        break;
+    case TypeDescriptor::kPair:
+        {
+            const auto value = desc->as<PairTypeDescriptor>()->getValue(h);
+
+            ++m_level;
+            out += '{';
+
+            m_stack.emplace_back(Frame::kPair, h);
+            m_stack.back().values = {value.first, value.second};
+            m_stack.back().size = 2;
+        }
+        break;
+    case TypeDescriptor::kList:
+        ++m_level;
+        out += '[';
+
+        // Elements are fetched as they are written
+        m_stack.emplace_back(Frame::kList, h);
+        m_stack.back().size = desc->as<ListTypeDescriptor>()->getSize(h);
+        break;
+    case TypeDescriptor::kMap:
+    case TypeDescriptor::kSet:
+        ++m_level;
+        out += '[';
+
+        m_stack.emplace_back(Frame::kContainer, h);
+        m_stack.back().values =
+            desc->as<ContainerTypeDescriptor>()->getValue(h);
+        m_stack.back().size = m_stack.back().values.size();
+        break;
+    case TypeDescriptor::kPointer:
+        {
+            auto ptrDesc = desc->as<PointerTypeDescriptor>();
+
+            if (!ptrDesc->isOwner() || ptrDesc->isNull(h))
+                out += "null";
+            else
+                beginValue(out, ptrDesc->dereference(h));
+        }
+        break;
+    default:
+        out += "\"Unsupported type\"";
+        break;
+    }
+}
+
+void ResumableJsonSerializer::step(string& out)
+{
+    // Frames may be pushed below, so no reference is kept
+    const size_t top = m_stack.size() - 1;
+    const size_t index = m_stack[top].index;
+
+    if (index == m_stack[top].size)
+    {
+        const Frame::Kind kind = m_stack[top].kind;
+        const char close =
+            kind == Frame::kObject || kind == Frame::kPair ? '}' : ']';
+        m_stack.pop_back();
+
+        --m_level;
+        newLine(out);
+        out += close;
+        return;
+    }
+
+    m_stack[top].index++;
+
+    switch (m_stack[top].kind)
+    {
+    case Frame::kObject:
+        {
+            const Frame& frame = m_stack[top];
+            const FeatureDescriptor * feature = (*frame.features)[index];
+            ModelClass * obj = frame.obj;
+
+            if (index) out += ',';
+            newLine(out);
+            out += '"';
+            out += feature->getXmlTag();
+            out += "\" : ";
+
+            beginValue(out, feature->getValue(obj));
+        }
+        break;
+    case Frame::kPair:
+        if (index) out += ',';
+        newLine(out);
+        out += index ? "\"second\" : " : "\"first\" : ";
+        beginValue(out, m_stack[top].values[index]);
+        break;
+    case Frame::kList:
+        {
+            Holder h = m_stack[top].h;
+
+            if (index) out += ',';
+            newLine(out);
+            beginValue(out, h.descriptor()->as<ListTypeDescriptor>()
+                                ->getElement(h, index));
+        }
+        break;
+    case Frame::kContainer:
+        {
+            // Copied, as beginValue may reallocate the stack
+            Holder value = m_stack[top].values[index];
+
+            if (index) out += ',';
+            newLine(out);
+            beginValue(out, value);
+        }
+        break;
+    }
+}
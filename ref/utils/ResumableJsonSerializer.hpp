@@ -0,0 +1,134 @@
+#ifndef REFCPP_RESUMABLE_JSON_SERIALIZER_HPP
+#define REFCPP_RESUMABLE_JSON_SERIALIZER_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <ref/Holder.hpp>
+
+namespace ref
+{
+    struct ModelClass;
+    struct ClassDescriptor;
+    struct FeatureDescriptor;
+
+    /**
+     * @brief Destination of the output of a ResumableJsonSerializer.
+     */
+    struct OutputSink
+    {
+        virtual ~OutputSink();
+
+        /**
+         * @brief Writes the first bytes of data that fit.
+         *
+         * @return The number of bytes written. Zero when the sink is full
+         * and would block.
+         */
+        virtual std::size_t write(const char * data, std::size_t size) = 0;
+    };
+
+    /**
+     * @brief Writes into a blocking stream, so it is never full.
+     */
+    struct StreamSink : OutputSink
+    {
+        StreamSink(std::ostream& os);
+
+        std::size_t write(const char * data, std::size_t size) override;
+
+    protected:
+        std::ostream& m_os;
+    };
+
+    /**
+     * @brief Writes into a file descriptor, usually a non-blocking socket
+     * or pipe. Errors other than a full descriptor throw
+     * std::runtime_error.
+     */
+    struct FileDescriptorSink : OutputSink
+    {
+        FileDescriptorSink(int fd);
+
+        std::size_t write(const char * data, std::size_t size) override;
+
+    protected:
+        int m_fd;
+    };
+
+    /**
+     * @brief Produces the same output as JsonSerializer, a chunk at a
+     * time, so large models can be written from an event loop without
+     * stalling it.
+     *
+     * The position within the model is kept in an explicit stack, one
+     * frame per object, pair or container being written, and the
+     * serializer resumes exactly where the previous chunk ended. Chunks
+     * exceed the chunk size by at most the last value written, as values
+     * are not split.
+     *
+     * The model must not be modified until the serialization is done.
+     */
+    struct ResumableJsonSerializer
+    {
+        enum Status
+        {
+            // Everything has been written
+            kDone,
+            // A chunk has been written, and the sink has room for more
+            kPending,
+            // The sink is full; resume once it becomes writable
+            kBlocked
+        };
+
+        ResumableJsonSerializer(ModelClass * obj,
+                                std::size_t chunkSize = 64 * 1024);
+        ResumableJsonSerializer(Holder h, std::size_t chunkSize = 64 * 1024);
+        ~ResumableJsonSerializer();
+
+        /**
+         * @brief Writes what is left of the previous chunk and then,
+         * if the sink accepted it, formats and writes the next one.
+         *
+         * Formatting a chunk happens while the sink, such as the kernel
+         * buffer of a socket, is still sending the previous ones.
+         */
+        Status resume(OutputSink& sink);
+
+        /**
+         * @brief Formats the next chunk, for callers that write the output
+         * themselves. It may be called while the previous chunk is still
+         * being written, as it is formatted into the given string.
+         *
+         * @return false once everything has been formatted.
+         */
+        bool next(std::string& chunk);
+
+        bool isDone() const;
+
+    protected:
+        struct Frame;
+
+        std::size_t m_chunkSize;
+        Holder m_root;
+        bool m_started;
+        int m_level;
+        std::vector<Frame> m_stack;
+        std::unordered_map<const ClassDescriptor*,
+                           std::vector<const FeatureDescriptor*> >
+            m_features;
+
+        // Output formatted and not yet accepted by the sink
+        std::string m_pending;
+        std::size_t m_offset;
+
+        void newLine(std::string& out) const;
+        void beginValue(std::string& out, Holder h);
+        void beginObject(std::string& out, ModelClass * obj);
+        void step(std::string& out);
+    };
+}  // namespace ref
+
+#endif  // REFCPP_RESUMABLE_JSON_SERIALIZER_HPP
@@ -0,0 +1,132 @@
+#include "SharedMemory.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+using namespace ref;
+using namespace std;
+namespace bip = boost::interprocess;
+
+namespace
+{
+    typedef bip::managed_shared_memory::segment_manager SegmentManager;
+
+    const char anchorName[] = "ref::anchor";
+
+    // Its address identifies the code of this process
+    const char anchor = 0;
+
+    thread_local SegmentManager * current = nullptr;
+
+    // Writable segments open in this process, to release memory into
+    mutex segmentsMutex;
+    vector<bip::managed_shared_memory*> segments;
+
+    void addSegment(bip::managed_shared_memory* segment)
+    {
+        lock_guard<mutex> lock(segmentsMutex);
+        segments.push_back(segment);
+    }
+
+    void removeSegment(bip::managed_shared_memory* segment)
+    {
+        lock_guard<mutex> lock(segmentsMutex);
+        segments.erase(remove(segments.begin(), segments.end(), segment),
+                       segments.end());
+    }
+}  // namespace
+
+void * ref::detail::sharedAllocate(size_t size)
+{
+    if (current) return current->allocate(size);
+    return ::operator new(size);
+}
+
+void ref::detail::sharedDeallocate(void * p)
+{
+    if (!p) return;
+
+    {
+        lock_guard<mutex> lock(segmentsMutex);
+        for (auto segment : segments)
+        {
+            if (segment->belongs_to_segment(p))
+            {
+                segment->deallocate(p);
+                return;
+            }
+        }
+    }
+
+    ::operator delete(p);
+}
+
+SharedSegment::SharedSegment(const string& name, size_t size)
+    : m_name(name), m_readOnly(false)
+{
+    try
+    {
+        bip::managed_shared_memory(bip::create_only, name.c_str(), size)
+            .swap(m_segment);
+
+        m_segment.construct<uintptr_t>(anchorName)(
+            reinterpret_cast<uintptr_t>(&anchor));
+    }
+    catch (const bip::interprocess_exception& e)
+    {
+        throw runtime_error("Cannot create shared segment " + name + ": " +
+                            e.what());
+    }
+
+    addSegment(&m_segment);
+}
+
+SharedSegment::SharedSegment(const string& name)
+    : m_name(name), m_readOnly(true)
+{
+    try
+    {
+        bip::managed_shared_memory(bip::open_read_only, name.c_str())
+            .swap(m_segment);
+    }
+    catch (const bip::interprocess_exception& e)
+    {
+        throw runtime_error("Cannot open shared segment " + name + ": " +
+                            e.what());
+    }
+}
+
+SharedSegment::~SharedSegment()
+{
+    if (!m_readOnly) removeSegment(&m_segment);
+}
+
+bool SharedSegment::remove(const string& name)
+{
+    return bip::shared_memory_object::remove(name.c_str());
+}
+
+bool SharedSegment::isNative() const
+{
+    const uintptr_t* address = find<uintptr_t>(anchorName);
+    return address && *address == reinterpret_cast<uintptr_t>(&anchor);
+}
+
+void SharedSegment::checkWritable() const
+{
+    if (m_readOnly)
+        throw runtime_error("Shared segment " + m_name + " is read-only");
+}
+
+SharedSegment::Scope::Scope(SharedSegment& segment) : m_previous(current)
+{
+    segment.checkWritable();
+    current = segment.m_segment.get_segment_manager();
+}
+
+SharedSegment::Scope::~Scope()
+{
+    current = static_cast<SegmentManager*>(m_previous);
+}
@@ -0,0 +1,394 @@
+#ifndef REFCPP_SHARED_MEMORY_HPP
+#define REFCPP_SHARED_MEMORY_HPP
+
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <boost/container/map.hpp>
+#include <boost/container/set.hpp>
+#include <boost/container/string.hpp>
+#include <boost/container/vector.hpp>
+#include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/offset_ptr.hpp>
+#include <ref/DescriptorsImpl.ipp>
+
+namespace ref
+{
+    namespace detail
+    {
+        /**
+         * @brief Allocates from the segment of the innermost
+         * SharedSegment::Scope of the calling thread, or from the heap
+         * if there is none.
+         */
+        void * sharedAllocate(std::size_t size);
+
+        /**
+         * @brief Releases memory from sharedAllocate into the segment it
+         * belongs to, which must be open in this process, or into the
+         * heap.
+         */
+        void sharedDeallocate(void * p);
+    } // namespace detail
+
+    /**
+     * @brief Stateless allocator whose pointers are offsets, so that the
+     * containers that use it can be mapped at any address.
+     *
+     * Memory comes from the segment in scope when allocating, as given by
+     * SharedSegment::Scope, or from the heap otherwise. Instances that
+     * use it can therefore be built on the heap as any other one, and
+     * copied into a segment within a scope.
+     */
+    template < typename T >
+    struct SharedAllocator
+    {
+        typedef T value_type;
+        typedef boost::interprocess::offset_ptr< T > pointer;
+        typedef boost::interprocess::offset_ptr< const T > const_pointer;
+        typedef boost::interprocess::offset_ptr< void > void_pointer;
+        typedef boost::interprocess::offset_ptr< const void >
+            const_void_pointer;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+
+        template < typename U >
+        struct rebind
+        {
+            typedef SharedAllocator< U > other;
+        };
+
+        SharedAllocator() {}
+
+        template < typename U >
+        SharedAllocator(const SharedAllocator< U >&) {}
+
+        pointer allocate(size_type n)
+        {
+            return pointer(
+                static_cast< T * >(detail::sharedAllocate(n * sizeof(T))));
+        }
+
+        void deallocate(pointer p, size_type)
+        {
+            detail::sharedDeallocate(p.get());
+        }
+
+        template < typename U >
+        bool operator==(const SharedAllocator< U >&) const
+        {
+            return true;
+        }
+
+        template < typename U >
+        bool operator!=(const SharedAllocator< U >&) const
+        {
+            return false;
+        }
+    };
+
+    // Types whose values can live in a shared segment
+
+    typedef boost::container::basic_string< char, std::char_traits< char >,
+                                            SharedAllocator< char > >
+        SharedString;
+
+    template < typename T >
+    using SharedVector = boost::container::vector< T, SharedAllocator< T > >;
+
+    template < typename T >
+    using SharedSet =
+        boost::container::set< T, std::less< T >, SharedAllocator< T > >;
+
+    template < typename K, typename T >
+    using SharedMap =
+        boost::container::map< K, T, std::less< K >,
+                               SharedAllocator< std::pair< const K, T > > >;
+
+    /**
+     * @brief Raw pointer stored as an offset from itself, valid wherever
+     * the segment is mapped as long as it points into the same segment.
+     */
+    template < typename T >
+    using OffsetPtr = boost::interprocess::offset_ptr< T >;
+
+    /**
+     * @brief Named shared memory segment, holding model instances that
+     * other processes read in place, without copies nor deserialization.
+     *
+     * Model classes whose features use the types above can live in a
+     * segment: descriptors describe them as any other class. A process
+     * creates the segment and builds the model in it. Other processes
+     * open it read-only, find the root by name and read it through its
+     * static type and the descriptors.
+     *
+     * Instances keep the virtual table pointers of the process that built
+     * them. Unless isNative returns true, their virtual functions, such as
+     * ModelClass::getClassDescriptor, must not be called, and neither
+     * must the utilities that start from an object, which call it. Other
+     * processes read instances through their static types: with Class::get,
+     * with the descriptor of the root class, whose forEachFeature and
+     * feature values make no virtual call on the instances, or with a
+     * JsonSerializer with static types. Nested objects are then described
+     * by the types that hold them, so values and pointers must not hold
+     * subclasses of those. Pointers must be OffsetPtr and point into the
+     * segment.
+     *
+     * Errors throw std::runtime_error.
+     */
+    struct SharedSegment
+    {
+        /**
+         * @brief Creates a new segment of the given size in bytes. Fails
+         * if a segment of the same name exists.
+         */
+        SharedSegment(const std::string& name, std::size_t size);
+
+        /**
+         * @brief Opens an existing segment, read-only.
+         */
+        explicit SharedSegment(const std::string& name);
+
+        ~SharedSegment();
+
+        SharedSegment(const SharedSegment&) = delete;
+        SharedSegment& operator=(const SharedSegment&) = delete;
+
+        /**
+         * @brief Removes the segment with the given name. Processes that
+         * have it open keep it until they close it.
+         */
+        static bool remove(const std::string& name);
+
+        const std::string& getName() const { return m_name; }
+
+        bool isReadOnly() const { return m_readOnly; }
+
+        /**
+         * @brief True if the segment was created by this process, or by
+         * one with the same code at the same addresses, such as a parent
+         * process it was forked from. Virtual functions of the instances
+         * in the segment can only be called in that case.
+         */
+        bool isNative() const;
+
+        std::size_t getSize() const { return m_segment.get_size(); }
+
+        std::size_t getFreeMemory() const
+        {
+            return m_segment.get_free_memory();
+        }
+
+        bool contains(const void * p) const
+        {
+            return m_segment.belongs_to_segment(p);
+        }
+
+        /**
+         * @brief Makes the shared allocators of the calling thread take
+         * memory from a segment, until destroyed.
+         */
+        struct Scope
+        {
+            Scope(SharedSegment& segment);
+
+            ~Scope();
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        protected:
+            void * m_previous;
+        };
+
+        /**
+         * @brief Constructs a named instance in the segment, within a
+         * scope of it, so that the values it allocates are also in the
+         * segment.
+         *
+         * @return The new instance.
+         */
+        template < typename T, typename... Args >
+        T * construct(const std::string& name, Args&&... args)
+        {
+            checkWritable();
+
+            Scope scope(*this);
+            try
+            {
+                return m_segment.construct< T >(name.c_str())(
+                    std::forward< Args >(args)...);
+            }
+            catch (const boost::interprocess::interprocess_exception& e)
+            {
+                throw std::runtime_error("Cannot construct " + name + ": " +
+                                         e.what());
+            }
+        }
+
+        /**
+         * @brief Finds a named instance.
+         *
+         * @return The instance, or null if not found.
+         */
+        template < typename T >
+        T * find(const std::string& name) const
+        {
+            auto& segment =
+                const_cast< boost::interprocess::managed_shared_memory& >(
+                    m_segment);
+
+            // Locking would write into the segment
+            return m_readOnly ? segment.find_no_lock< T >(name.c_str()).first
+                              : segment.find< T >(name.c_str()).first;
+        }
+
+        /**
+         * @brief Destroys a named instance, releasing the values it
+         * allocated.
+         *
+         * @return True if found.
+         */
+        template < typename T >
+        bool destroy(const std::string& name)
+        {
+            checkWritable();
+
+            Scope scope(*this);
+            return m_segment.destroy< T >(name.c_str());
+        }
+
+    protected:
+        std::string m_name;
+        bool m_readOnly;
+        boost::interprocess::managed_shared_memory m_segment;
+
+        void checkWritable() const;
+    };
+
+    namespace detail
+    {
+        /**
+         * Shared strings are neither std::string nor InternedString, so
+         * they have their own kind.
+         */
+        template <>
+        struct GetDescriptorType< SharedString >
+        {
+            typedef PrimitiveTypeDescriptorImpl< SharedString > type;
+        };
+
+        template < typename T >
+        struct GetDescriptorType< SharedVector< T > >
+        {
+            typedef ListTypeDescriptorImpl< SharedVector< T > > type;
+        };
+
+        template < typename T >
+        struct GetDescriptorType< SharedSet< T > >
+        {
+            typedef SetTypeDescriptorImpl< SharedSet< T > > type;
+        };
+
+        template < typename K, typename T >
+        struct GetDescriptorType< SharedMap< K, T > >
+        {
+            typedef MapTypeDescriptorImpl< SharedMap< K, T > > type;
+        };
+
+        template < typename T >
+        struct GetDescriptorType< OffsetPtr< T > >
+        {
+            typedef PointerTypeDescriptorImpl< OffsetPtr< T > > type;
+        };
+
+        template < typename T >
+        struct pointer_traits< OffsetPtr< T > >
+        {
+            typedef T element_type;
+            enum
+            {
+                pointer_type = PointerTypeDescriptor::kRaw
+            };
+
+            static T * get(const OffsetPtr< T >& t) { return t.get(); }
+
+            static bool reset(OffsetPtr< T >& p, T * t)
+            {
+                p = t;
+                return true;
+            }
+
+            static void clear(OffsetPtr< T >& p) { p = nullptr; }
+
+            static std::size_t use_count(const OffsetPtr< T >& p)
+            {
+                return p ? 1 : 0;
+            }
+        };
+
+        // Short strings are stored inside the object
+        template <>
+        struct heap_size< SharedString >
+        {
+            static std::size_t get(const SharedString& t)
+            {
+                const char * begin = reinterpret_cast< const char * >(&t);
+                const bool inside = t.data() >= begin &&
+                                    t.data() < begin + sizeof(SharedString);
+                return inside ? 0 : t.capacity() + 1;
+            }
+        };
+
+        template < typename T >
+        struct heap_size< SharedVector< T > >
+        {
+            static std::size_t get(const SharedVector< T >& t)
+            {
+                return t.capacity() * sizeof(T);
+            }
+        };
+
+        template < typename T >
+        struct heap_size< SharedSet< T > > : tree_heap_size< T >
+        {
+        };
+
+        template < typename K, typename T >
+        struct heap_size< SharedMap< K, T > >
+            : tree_heap_size< std::pair< const K, T > >
+        {
+        };
+    } // namespace detail
+
+    template <>
+    inline PrimitiveTypeDescriptor::PrimitiveKind
+    PrimitiveTypeDescriptorImpl< SharedString >::getPrimitiveKind() const
+    {
+        return PrimitiveTypeDescriptor::kSharedString;
+    }
+
+    template <>
+    inline std::string PrimitiveTypeDescriptorImpl< SharedString >::getString(
+        Holder h) const
+    {
+        REF_INSTRUMENT(this, kGetString, 1);
+        assert(h.descriptor() == this && h.get< SharedString >());
+        const SharedString * s = h.get< SharedString >();
+        return std::string(s->data(), s->size());
+    }
+
+    template <>
+    inline void PrimitiveTypeDescriptorImpl< SharedString >::setString(
+        Holder h, const std::string& value) const
+    {
+        REF_INSTRUMENT(this, kSetString, 1);
+        assert(h.descriptor() == this && h.get< SharedString >());
+        h.get< SharedString >()->assign(value.data(), value.size());
+    }
+
+} // namespace ref
+
+#endif // REFCPP_SHARED_MEMORY_HPP
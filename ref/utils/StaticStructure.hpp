@@ -0,0 +1,360 @@
+#ifndef REFCPP_STATIC_STRUCTURE_HPP
+#define REFCPP_STATIC_STRUCTURE_HPP
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <ref/Class.hpp>
+#include "StructuralContext.hpp"
+
+namespace ref
+{
+    namespace detail
+    {
+        template < typename... Lists >
+        struct ConcatLists
+        {
+            typedef EmptyList type;
+        };
+
+        template < typename List, typename... Lists >
+        struct ConcatLists< List, Lists... >
+        {
+            typedef typename Concat< List,
+                typename ConcatLists< Lists... >::type >::type type;
+        };
+
+        template < typename List, typename T >
+        struct IndexOf;
+
+        template < typename T, typename... Ts >
+        struct IndexOf< TypeList< T, Ts... >, T > :
+            std::integral_constant< std::size_t, 0 >
+        {};
+
+        template < typename U, typename... Ts, typename T >
+        struct IndexOf< TypeList< U, Ts... >, T > :
+            std::integral_constant< std::size_t,
+                1 + IndexOf< TypeList< Ts... >, T >::value >
+        {};
+
+        // A class found in the type of a feature
+        template < typename Class, Reference::ReferenceType Type >
+        struct ReferenceTo
+        {};
+
+        /**
+         * @brief Classes found in a type, following the same types as
+         * StructuralContext does at runtime.
+         */
+        template < typename T, Reference::ReferenceType Type,
+                   typename Enabled = void >
+        struct ReferencesIn
+        {
+            typedef EmptyList type;
+        };
+
+        template < typename T, Reference::ReferenceType Type >
+        struct ReferencesIn< T, Type,
+            typename std::enable_if<
+                std::is_base_of< ModelClass, T >::value >::type >
+        {
+            typedef TypeList< ReferenceTo< T, Type > > type;
+        };
+
+        template < typename T, Reference::ReferenceType Pointer,
+                   Reference::ReferenceType Type >
+        struct PointerReferences
+        {
+            static_assert(Type == Reference::kContained,
+                          "Pointers to pointers are not supported");
+
+            typedef typename ReferencesIn< T, Pointer >::type type;
+        };
+
+        template < typename T, Reference::ReferenceType Type >
+        struct ReferencesIn< T *, Type > :
+            PointerReferences< T, Reference::kRaw, Type >
+        {};
+
+        template < typename T, Reference::ReferenceType Type >
+        struct ReferencesIn< std::unique_ptr< T >, Type > :
+            PointerReferences< T, Reference::kOwned, Type >
+        {};
+
+        template < typename T, Reference::ReferenceType Type >
+        struct ReferencesIn< std::optional< T >, Type > :
+            PointerReferences< T, Reference::kOwned, Type >
+        {};
+
+        template < typename T, Reference::ReferenceType Type >
+        struct ReferencesIn< std::shared_ptr< T >, Type > :
+            PointerReferences< T, Reference::kSharedOwned, Type >
+        {};
+
+        template < typename T, Reference::ReferenceType Type >
+        struct ReferencesIn< std::weak_ptr< T >, Type > :
+            PointerReferences< T, Reference::kWeak, Type >
+        {};
+
+        template < typename K, typename T, Reference::ReferenceType Type >
+        struct ReferencesIn< std::pair< K, T >, Type >
+        {
+            typedef typename ConcatLists<
+                typename ReferencesIn< K, Type >::type,
+                typename ReferencesIn< T, Type >::type >::type type;
+        };
+
+        template < typename K, typename T, Reference::ReferenceType Type >
+        struct ReferencesIn< std::map< K, T >, Type > :
+            ReferencesIn< std::pair< K, T >, Type >
+        {};
+
+        template < typename K, typename T, Reference::ReferenceType Type >
+        struct ReferencesIn< std::unordered_map< K, T >, Type > :
+            ReferencesIn< std::pair< K, T >, Type >
+        {};
+
+        template < typename T, Reference::ReferenceType Type >
+        struct ReferencesIn< std::vector< T >, Type > : ReferencesIn< T, Type >
+        {};
+
+        template < typename T, Reference::ReferenceType Type >
+        struct ReferencesIn< std::deque< T >, Type > : ReferencesIn< T, Type >
+        {};
+
+        template < typename T, std::size_t N, Reference::ReferenceType Type >
+        struct ReferencesIn< std::array< T, N >, Type > :
+            ReferencesIn< T, Type >
+        {};
+
+        template < typename T, std::size_t N, typename A, typename O,
+                   Reference::ReferenceType Type >
+        struct ReferencesIn< boost::container::small_vector< T, N, A, O >,
+                             Type > : ReferencesIn< T, Type >
+        {};
+
+        template < typename T, std::size_t N, typename O,
+                   Reference::ReferenceType Type >
+        struct ReferencesIn< boost::container::static_vector< T, N, O >,
+                             Type > : ReferencesIn< T, Type >
+        {};
+
+        template < typename T, Reference::ReferenceType Type >
+        struct ReferencesIn< std::set< T >, Type > : ReferencesIn< T, Type >
+        {};
+
+        template < typename T, Reference::ReferenceType Type >
+        struct ReferencesIn< std::unordered_set< T >, Type > :
+            ReferencesIn< T, Type >
+        {};
+
+        // A reference from a feature of Class
+        template < typename Class, typename Feature, typename Referenced,
+                   Reference::ReferenceType Type >
+        struct Edge
+        {};
+
+        template < typename Class, typename Feature, typename References >
+        struct FeatureEdges;
+
+        template < typename Class, typename Feature, typename... Referenced,
+                   Reference::ReferenceType... Types >
+        struct FeatureEdges< Class, Feature,
+                             TypeList< ReferenceTo< Referenced, Types >... > >
+        {
+            typedef TypeList< Edge< Class, Feature, Referenced, Types >... >
+                type;
+        };
+
+        template < typename Class, typename Features >
+        struct ClassEdges;
+
+        template < typename Class, typename... Features >
+        struct ClassEdges< Class, TypeList< Features... > >
+        {
+            typedef typename ConcatLists< typename FeatureEdges< Class,
+                Features,
+                typename ReferencesIn< typename Features::type,
+                    Reference::kContained >::type >::type... >::type type;
+        };
+
+        /**
+         * @brief References from the features defined in Class.
+         */
+        template < typename Class >
+        struct OwnEdges :
+            ClassEdges< Class, typename Class::features_type >
+        {};
+
+        template < typename Class >
+        struct ParentOf
+        {
+            typedef TypeList< typename Class::base_class > type;
+        };
+
+        template <>
+        struct ParentOf< ModelClass >
+        {
+            typedef EmptyList type;
+        };
+
+        template <>
+        struct ParentOf< LazyModelClass >
+        {
+            typedef EmptyList type;
+        };
+
+        template <>
+        struct ParentOf< SeqLockModelClass >
+        {
+            typedef EmptyList type;
+        };
+
+        template < typename Edges >
+        struct ReferencedClasses;
+
+        template < typename... Classes, typename... Features,
+                   typename... Referenced, Reference::ReferenceType... Types >
+        struct ReferencedClasses<
+            TypeList< Edge< Classes, Features, Referenced, Types >... > >
+        {
+            typedef TypeList< Referenced... > type;
+        };
+
+        template < typename Class >
+        struct Successors
+        {
+            typedef typename ConcatLists< typename ParentOf< Class >::type,
+                typename ReferencedClasses<
+                    typename OwnEdges< Class >::type >::type >::type type;
+        };
+
+        /**
+         * @brief Classes reachable from the pending ones, in breadth-first
+         * order.
+         */
+        template < typename Pending, typename Done >
+        struct Closure;
+
+        template < bool Visited, typename Class, typename Pending,
+                   typename Done >
+        struct ClosureStep;
+
+        template < typename Done >
+        struct Closure< EmptyList, Done >
+        {
+            typedef Done type;
+        };
+
+        template < typename Class, typename... Pending, typename Done >
+        struct Closure< TypeList< Class, Pending... >, Done > :
+            ClosureStep< Contains< Done, Class >::value, Class,
+                         TypeList< Pending... >, Done >
+        {};
+
+        template < typename Class, typename Pending, typename Done >
+        struct ClosureStep< true, Class, Pending, Done > :
+            Closure< Pending, Done >
+        {};
+
+        template < typename Class, typename Pending, typename Done >
+        struct ClosureStep< false, Class, Pending, Done > :
+            Closure< typename Concat< Pending,
+                         typename Successors< Class >::type >::type,
+                     typename Concat< Done, TypeList< Class > >::type >
+        {};
+
+        template < typename Class >
+        const ClassDescriptor * getStaticClassDescriptor()
+        {
+            return ClassDescriptorImpl< Class >::instance();
+        }
+
+        template < typename Class, typename Feature >
+        const FeatureDescriptor * getStaticFeatureDescriptor()
+        {
+            return FeatureDescriptorImpl< Class, Feature >::instance();
+        }
+
+        template < typename Classes, typename Class,
+                   typename Parent = typename ParentOf< Class >::type >
+        struct ParentIndex : std::integral_constant< int, -1 >
+        {};
+
+        template < typename Classes, typename Class, typename Parent >
+        struct ParentIndex< Classes, Class, TypeList< Parent > > :
+            std::integral_constant< int, IndexOf< Classes, Parent >::value >
+        {};
+
+        template < typename Classes, typename List = Classes >
+        struct ClassTable;
+
+        template < typename Classes, typename... List >
+        struct ClassTable< Classes, TypeList< List... > >
+        {
+            static constexpr std::array< StructureTable::ClassEntry,
+                                         sizeof...(List) >
+                value = {{{&getStaticClassDescriptor< List >,
+                           ParentIndex< Classes, List >::value}...}};
+        };
+
+        template < typename Classes, typename Edges >
+        struct ReferenceTable;
+
+        template < typename All, typename... Classes, typename... Features,
+                   typename... Referenced, Reference::ReferenceType... Types >
+        struct ReferenceTable< All,
+            TypeList< Edge< Classes, Features, Referenced, Types >... > >
+        {
+            static constexpr std::array< StructureTable::ReferenceEntry,
+                                         sizeof...(Types) >
+                value = {{{Types, IndexOf< All, Classes >::value,
+                           &getStaticFeatureDescriptor< Classes, Features >,
+                           IndexOf< All, Referenced >::value}...}};
+        };
+
+        template < typename Classes >
+        struct AllEdges;
+
+        template < typename... Classes >
+        struct AllEdges< TypeList< Classes... > >
+        {
+            typedef typename ConcatLists<
+                typename OwnEdges< Classes >::type... >::type type;
+        };
+    } // namespace detail
+
+    /**
+     * @brief The classes reachable from Root and their references,
+     * computed at compile time from the Features of each class.
+     *
+     * A StructuralContext built from its table does not walk the
+     * descriptors of the model:
+     *
+     *     const StructuralContext ctx(StaticStructure< Company >::table);
+     *
+     * Only the descriptors themselves, which are created on first use,
+     * are looked up at runtime.
+     */
+    template < typename Root >
+    struct StaticStructure
+    {
+        typedef typename detail::Closure< TypeList< Root >, EmptyList >::type
+            classes_type;
+        typedef typename detail::AllEdges< classes_type >::type
+            references_type;
+
+        static constexpr const auto& classes =
+            detail::ClassTable< classes_type >::value;
+
+        static constexpr const auto& references =
+            detail::ReferenceTable< classes_type, references_type >::value;
+
+        static constexpr StructureTable table = {
+            classes.data(), classes.size(), references.data(),
+            references.size()};
+    };
+} // namespace ref
+
+#endif // REFCPP_STATIC_STRUCTURE_HPP
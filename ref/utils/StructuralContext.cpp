@@ -24,6 +24,7 @@ namespace
         switch (type)
         {
             case PointerTypeDescriptor::kUnique:
+            case PointerTypeDescriptor::kOptional:
                 return Reference::kOwned;
             case PointerTypeDescriptor::kShared:
                 return Reference::kSharedOwned;
@@ -35,6 +36,60 @@ namespace
 
         return Reference::kRaw;
     }
+
+    /**
+     * @brief Visits a type on the way from a feature to the classes it
+     * references, queueing the types it contains.
+     */
+    struct PathStep
+    {
+        const IterationItem& item;
+        list<IterationItem>& path;
+        const ClassDescriptor* classDesc;
+
+        PathStep(const IterationItem& item_, list<IterationItem>& path_)
+            : item(item_), path(path_), classDesc()
+        {
+        }
+
+        void push(const TypeDescriptor* desc,
+                  Reference::ReferenceType referenceType)
+        {
+            IterationItem next;
+            next.referenceType = referenceType;
+            next.desc = desc;
+            path.push_back(next);
+        }
+
+        void operator()(const ClassDescriptor* desc) { classDesc = desc; }
+
+        void operator()(const PointerTypeDescriptor* desc)
+        {
+            if (item.referenceType != Reference::kContained)
+            {
+                throw runtime_error("Invalid model");
+            }
+
+            push(desc->getPointedTypeDescriptor(),
+                 getReferenceType(desc->getPointerType()));
+        }
+
+        void operator()(const PairTypeDescriptor* desc)
+        {
+            push(desc->getFirstTypeDescriptor(), item.referenceType);
+            push(desc->getSecondTypeDescriptor(), item.referenceType);
+        }
+
+        // Lists, sets and maps
+        void operator()(const ContainerTypeDescriptor* desc)
+        {
+            push(desc->getValueTypeDescriptor(), item.referenceType);
+        }
+
+        void operator()(const PrimitiveTypeDescriptor*) {}
+
+        void operator()(const UnsupportedTypeDescriptor*) {}
+    };
 }  // namespace
 
 struct StructuralContext::Impl
@@ -63,6 +118,8 @@ struct StructuralContext::Impl
 
     Impl(const ClassDescriptor* rootClassDesc);
 
+    Impl(const StructureTable& table);
+
     const ClassInfo& getClassInfo(ClassDesc classDesc) const
     {
         ClassInfoMap::const_iterator it = m_classInfoMap.find(classDesc);
@@ -123,66 +180,23 @@ StructuralContext::Impl::Impl(const ClassDescriptor* rootClassDesc)
 
             while (!path.empty())
             {
-                IterationItem currentItem = path.front();
-                auto typeDesc = currentItem.desc;
+                const IterationItem currentItem = path.front();
                 path.pop_front();
 
-                switch (typeDesc->getKind())
+                PathStep step(currentItem, path);
+                visitType(currentItem.desc, step);
+
+                if (auto classDesc = step.classDesc)
                 {
-                    case TypeDescriptor::kClass:
-                    {
-                        auto classDesc = typeDesc->as<ClassDescriptor>();
-                        const Reference ref{currentItem.referenceType, current,
-                                            feature, classDesc};
-
-                        m_classInfoMap[classDesc].inReferences.push_back(ref);
-                        m_classInfoMap[current].outReferences.push_back(ref);
-
-                        m_allReferences.insert(feature);
-
-                        pending.push_back(classDesc);
-                    }
-                    break;
-                    case TypeDescriptor::kPointer:
-                    {
-                        if (currentItem.referenceType != Reference::kContained)
-                        {
-                            throw runtime_error("Invalid model");
-                        }
-
-                        auto ptrDesc = typeDesc->as<PointerTypeDescriptor>();
-                        currentItem.desc = ptrDesc->getPointedTypeDescriptor();
-                        currentItem.referenceType =
-                            getReferenceType(ptrDesc->getPointerType());
-
-                        path.push_back(currentItem);
-                    }
-                    break;
-                    case TypeDescriptor::kPair:
-                    {
-                        auto pairDesc = typeDesc->as<PairTypeDescriptor>();
-
-                        currentItem.desc = pairDesc->getFirstTypeDescriptor();
-                        path.push_back(currentItem);
-
-                        currentItem.desc = pairDesc->getSecondTypeDescriptor();
-                        path.push_back(currentItem);
-                    }
-                    break;
-                    // Containers
-                    case TypeDescriptor::kList:
-                    case TypeDescriptor::kMap:
-                    case TypeDescriptor::kSet:
-                    {
-                        auto containerDesc =
-                            typeDesc->as<ContainerTypeDescriptor>();
-                        currentItem.desc =
-                            containerDesc->getValueTypeDescriptor();
-                        path.push_back(currentItem);
-                    }
-                    break;
-                    default:
-                        break;
+                    const Reference ref{currentItem.referenceType, current,
+                                        feature, classDesc};
+
+                    m_classInfoMap[classDesc].inReferences.push_back(ref);
+                    m_classInfoMap[current].outReferences.push_back(ref);
+
+                    m_allReferences.insert(feature);
+
+                    pending.push_back(classDesc);
                 }
             }
         }
@@ -220,11 +234,62 @@ StructuralContext::Impl::Impl(const ClassDescriptor* rootClassDesc)
     }
 }
 
+StructuralContext::Impl::Impl(const StructureTable& table)
+{
+    m_allClasses.reserve(table.classCount);
+    for (size_t i = 0; i < table.classCount; i++)
+    {
+        m_allClasses.push_back(table.classes[i].get());
+    }
+    m_rootClassDesc = m_allClasses.front();
+
+    for (size_t i = 0; i < table.referenceCount; i++)
+    {
+        const StructureTable::ReferenceEntry& entry = table.references[i];
+        const Reference ref{entry.type, m_allClasses[entry.classIndex],
+                            entry.feature(),
+                            m_allClasses[entry.referencedIndex]};
+
+        m_classInfoMap[ref.referencedClassDesc].inReferences.push_back(ref);
+        m_classInfoMap[ref.classDesc].outReferences.push_back(ref);
+
+        m_allReferences.insert(ref.featureDesc);
+    }
+
+    // All references, those of the parent classes first
+    for (size_t i = 0; i < table.classCount; i++)
+    {
+        vector<size_t> hierarchy(1, i);
+        for (int parent = table.classes[i].parent; parent >= 0;
+             parent = table.classes[parent].parent)
+        {
+            hierarchy.push_back(parent);
+        }
+
+        ClassInfo& classInfo = m_classInfoMap[m_allClasses[i]];
+        for (auto it = hierarchy.rbegin(); it != hierarchy.rend(); ++it)
+        {
+            const ClassInfo& info = m_classInfoMap[m_allClasses[*it]];
+            classInfo.allOutReferences.insert(
+                classInfo.allOutReferences.end(), info.outReferences.begin(),
+                info.outReferences.end());
+            classInfo.allInReferences.insert(
+                classInfo.allInReferences.end(), info.inReferences.begin(),
+                info.inReferences.end());
+        }
+    }
+}
+
 StructuralContext::StructuralContext(const ClassDescriptor* rootClassDesc)
     : m_impl(new Impl(rootClassDesc))
 {
 }
 
+StructuralContext::StructuralContext(const StructureTable& table)
+    : m_impl(new Impl(table))
+{
+}
+
 StructuralContext::~StructuralContext() { delete m_impl; }
 
 const ClassDescriptor* StructuralContext::getRootClass() const
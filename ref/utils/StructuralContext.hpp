@@ -1,6 +1,7 @@
 #ifndef REFCPP_STRUCTURAL_CONTEXT_HPP
 #define REFCPP_STRUCTURAL_CONTEXT_HPP
 
+#include <cstddef>
 #include <vector>
 
 namespace ref
@@ -25,9 +26,43 @@ namespace ref
         const ClassDescriptor* referencedClassDesc;
     };
 
+    /**
+     * @brief Classes and references of a model, as computed at compile
+     * time by StaticStructure.
+     */
+    struct StructureTable
+    {
+        struct ClassEntry
+        {
+            const ClassDescriptor* (*get)();
+            // Index of the parent class, or -1
+            int parent;
+        };
+
+        struct ReferenceEntry
+        {
+            Reference::ReferenceType type;
+            std::size_t classIndex;
+            const FeatureDescriptor* (*feature)();
+            std::size_t referencedIndex;
+        };
+
+        // The root class comes first
+        const ClassEntry* classes;
+        std::size_t classCount;
+        const ReferenceEntry* references;
+        std::size_t referenceCount;
+    };
+
     struct StructuralContext
     {
         StructuralContext(const ClassDescriptor* rootClassDesc);
+
+        /**
+         * @brief Wraps a table computed at compile time, which does not
+         * require walking the descriptors of the model.
+         */
+        StructuralContext(const StructureTable& table);
         StructuralContext(const StructuralContext&) = delete;
         ~StructuralContext();
 
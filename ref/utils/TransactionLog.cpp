@@ -0,0 +1,1185 @@
+#include "TransactionLog.hpp"
+#include <ref/Descriptors.hpp>
+#include <ref/DescriptorRegistry.hpp>
+#include <ref/Class.hpp>
+#include <ref/detail/Name.hpp>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <set>
+#include <stdexcept>
+#include <unordered_set>
+
+using namespace ref;
+using namespace std;
+using namespace ref::detail;
+
+namespace
+{
+    enum RecordKind : uint8_t
+    {
+        kValue = 1,
+        kListDelta = 2,
+        kSetDelta = 3,
+        // State of an object owned by shared pointers
+        kObject = 4
+    };
+
+    // Pointers that do not own their value are not recorded, and objects
+    // owned by shared pointers are recorded by id
+    enum PointerTag : uint8_t
+    {
+        kNull = 0,
+        kOwned = 1,
+        kNotRecorded = 2,
+        kShared = 3
+    };
+
+    typedef vector<pair<ModelClass*, shared_ptr<void> > > SharedObjects;
+
+    const size_t frameHeaderSize = sizeof(uint32_t) + sizeof(uint64_t);
+
+    bool isContainer(const TypeDescriptor* desc)
+    {
+        const auto kind = desc->getKind();
+        return kind == TypeDescriptor::kList || kind == TypeDescriptor::kSet ||
+               kind == TypeDescriptor::kMap;
+    }
+
+    void appendStrings(string& out, vector<string>::const_iterator begin,
+                       vector<string>::const_iterator end)
+    {
+        appendVarint(out, static_cast<uint64_t>(distance(begin, end)));
+        for (; begin != end; ++begin)
+            appendString(out, *begin);
+    }
+
+    void readStrings(BinaryCursor& cursor, vector<string_view>& out)
+    {
+        const uint64_t count = cursor.readVarint();
+        for (uint64_t i = 0; i < count; i++)
+            out.push_back(cursor.readStringView());
+    }
+
+    /**
+     * Collects the objects held by a value. Objects owned by shared
+     * pointers are collected along with their ownership into shared, if
+     * not null, and their own objects only if intoShared is true.
+     */
+    void collectObjects(Holder h, vector<ModelClass*>& out,
+                        unordered_set<const ModelClass*>& visited,
+                        bool intoShared, SharedObjects* shared)
+    {
+        auto desc = h.descriptor();
+
+        switch (desc->getKind())
+        {
+        case TypeDescriptor::kClass:
+            {
+                ModelClass* obj = desc->as<ClassDescriptor>()->get(h);
+                if (!visited.insert(obj).second) break;
+
+                out.push_back(obj);
+                const ClassDescriptor* classDesc = obj->getClassDescriptor();
+                const Holder snapshot = classDesc->snapshot(obj);
+                classDesc->forEachFeature(
+                    classDesc->get(snapshot),
+                    [&](const FeatureDescriptor*, Holder value) {
+                        collectObjects(value, out, visited, intoShared,
+                                       shared);
+                    });
+            }
+            break;
+        case TypeDescriptor::kPair:
+            {
+                const auto value = desc->as<PairTypeDescriptor>()->getValue(h);
+                collectObjects(value.first, out, visited, intoShared, shared);
+                collectObjects(value.second, out, visited, intoShared, shared);
+            }
+            break;
+        case TypeDescriptor::kList:
+        case TypeDescriptor::kSet:
+        case TypeDescriptor::kMap:
+            for (const auto& value :
+                 desc->as<ContainerTypeDescriptor>()->getValue(h))
+            {
+                collectObjects(value, out, visited, intoShared, shared);
+            }
+            break;
+        case TypeDescriptor::kPointer:
+            {
+                auto ptrDesc = desc->as<PointerTypeDescriptor>();
+                if (ptrDesc->isOwner() && !ptrDesc->isNull(h))
+                {
+                    Holder value = ptrDesc->dereference(h);
+                    if (value.descriptor()->getKind() == TypeDescriptor::kClass)
+                    {
+                        ModelClass* obj = value.descriptor()
+                                              ->as<ClassDescriptor>()
+                                              ->get(value);
+                        value = Holder(obj, obj->getClassDescriptor());
+
+                        if (ptrDesc->getPointerType() ==
+                            PointerTypeDescriptor::kShared)
+                        {
+                            if (shared && !visited.count(obj))
+                                shared->emplace_back(obj,
+                                                     ptrDesc->getOwnership(h));
+                            if (!intoShared) break;
+                        }
+                    }
+                    collectObjects(value, out, visited, intoShared, shared);
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    /**
+     * Objects held by a value, through values, containers and unique
+     * pointers, depth-first in feature order. Objects owned by shared
+     * pointers are kept alive by the log, so they are not released.
+     */
+    vector<ModelClass*> ownedObjects(Holder h)
+    {
+        vector<ModelClass*> res;
+        unordered_set<const ModelClass*> visited;
+        collectObjects(h, res, visited, false, nullptr);
+        return res;
+    }
+
+    /**
+     * Objects owned by shared pointers in a value, outside of other such
+     * objects.
+     */
+    SharedObjects sharedObjects(Holder h)
+    {
+        vector<ModelClass*> objs;
+        unordered_set<const ModelClass*> visited;
+        SharedObjects res;
+        collectObjects(h, objs, visited, false, &res);
+        return res;
+    }
+
+    /**
+     * Forgets the ids of the objects released by a change, so that they
+     * are not given to objects created later at the same address.
+     */
+    void releaseObjects(ObjectIds& ids, const vector<ModelClass*>& before,
+                        Holder after)
+    {
+        if (before.empty()) return;
+
+        const auto objects = ownedObjects(after);
+        const unordered_set<const ModelClass*> kept(objects.begin(),
+                                                    objects.end());
+        for (auto obj : before)
+        {
+            if (!kept.count(obj)) ids.erase(obj);
+        }
+    }
+
+    uint64_t checksum(const char* data, size_t size)
+    {
+        return get_hash(string_view(data, size));
+    }
+}  // namespace
+
+struct TransactionLog::Record
+{
+    RecordKind kind;
+    uint64_t object;
+    uint64_t feature;
+    // Class of the object whose state is recorded
+    uint64_t type;
+    // Elements before the replaced range of a list
+    uint64_t prefix;
+    // Old and new values, list ranges, or removed and added elements
+    vector<string_view> before;
+    vector<string_view> after;
+};
+
+/**
+ * Encodes values along with the id of every object in them, so that
+ * objects created by a transaction get the same ids when it is
+ * replayed.
+ *
+ * Objects owned by shared pointers are encoded by id, and retained by the
+ * log. If definitions is not null, the records of the state of those the
+ * id table does not know and the log has not recorded are appended to it.
+ */
+struct TransactionLog::Codec
+{
+    TransactionLog& log;
+    string* definitions;
+    ObjectIds& ids = log.m_ids;
+    // Objects whose state is appended to definitions
+    vector<uint64_t> defined;
+
+    string encode(Holder h)
+    {
+        string res;
+        encodeValue(res, h);
+        return res;
+    }
+
+    vector<string> encodeElements(Holder h)
+    {
+        vector<string> res;
+        for (const auto& value :
+             h.descriptor()->as<ContainerTypeDescriptor>()->getValue(h))
+        {
+            res.push_back(encode(value));
+        }
+        return res;
+    }
+
+    /**
+     * Decodes a value in place. Objects are registered only if they
+     * keep their address, that is, unless they are decoded by value
+     * into a temporary that is then copied.
+     */
+    void decode(string_view data, Holder h, bool inPlace = true)
+    {
+        BinaryCursor cursor(data.data(), data.data() + data.size());
+        decodeValue(cursor, h, inPlace);
+        if (cursor.pos != cursor.end)
+            throw runtime_error("Invalid value in transaction log");
+    }
+
+    void encodeObject(string& out, ModelClass* obj)
+    {
+        appendVarint(out, ids.getId(obj));
+        encodeFeatures(out, obj);
+    }
+
+    void encodeFeatures(string& out, ModelClass* obj)
+    {
+        const ClassDescriptor* classDesc = obj->getClassDescriptor();
+        const Holder snapshot = classDesc->snapshot(obj);
+        classDesc->forEachFeature(
+            classDesc->get(snapshot),
+            [&](const FeatureDescriptor*, Holder value) {
+                encodeValue(out, value);
+            });
+    }
+
+    void decodeObject(BinaryCursor& cursor, ModelClass* obj,
+                      bool inPlace)
+    {
+        const uint64_t id = cursor.readVarint();
+        if (inPlace) ids.add(id, obj);
+        decodeFeatures(cursor, obj, inPlace);
+    }
+
+    void decodeFeatures(BinaryCursor& cursor, ModelClass* obj,
+                        bool inPlace)
+    {
+        obj->getClassDescriptor()->forEachFeature(
+            obj, [&](const FeatureDescriptor*, Holder value) {
+                decodeValue(cursor, value, inPlace);
+            });
+    }
+
+    /**
+     * Returns the id of an object owned by shared pointers, retaining it
+     * and recording its state if needed.
+     */
+    uint64_t encodeShared(ModelClass* obj, shared_ptr<void> ownership)
+    {
+        const uint64_t id = ids.getId(obj);
+        log.m_shared[id] = SharedObject{obj, std::move(ownership)};
+
+        if (!definitions || ids.getOwnership(id) || log.m_defined.count(id) ||
+            !log.m_pendingDefined.insert(id).second)
+        {
+            return id;
+        }
+
+        // Objects it points to are recorded first
+        string state;
+        encodeFeatures(state, obj);
+
+        defined.push_back(id);
+        *definitions += static_cast<char>(kObject);
+        appendVarint(*definitions, id);
+        appendFixed(*definitions, obj->getClassDescriptor()->getTypeId());
+        appendString(*definitions, state);
+        return id;
+    }
+
+    /**
+     * Points a shared pointer to the object with an id: a retained one,
+     * one of the model, or one created from the state in the frame.
+     */
+    void decodeShared(const PointerTypeDescriptor* ptrDesc, Holder h,
+                      uint64_t id)
+    {
+        SharedObject shared{nullptr, nullptr};
+
+        auto it = log.m_shared.find(id);
+        if (it != log.m_shared.end())
+        {
+            shared = it->second;
+        }
+        else if ((shared.ownership = ids.getOwnership(id)))
+        {
+            shared.obj = ids.find(id);
+        }
+        else
+        {
+            auto def = log.m_definitions.find(id);
+            if (def == log.m_definitions.end())
+                throw runtime_error("Unknown object in transaction log");
+
+            const Definition definition = def->second;
+            log.m_definitions.erase(def);
+
+            Holder value = ptrDesc->emplace(h, definition.classDesc);
+            if (!value.isValid())
+                throw runtime_error("Cannot create " +
+                                    definition.classDesc->getFqn());
+
+            // Known before its state is decoded, for cycles
+            ModelClass* obj = definition.classDesc->get(value);
+            ids.add(id, obj);
+            log.m_shared[id] = SharedObject{obj, ptrDesc->getOwnership(h)};
+
+            BinaryCursor cursor(definition.state.data(),
+                                definition.state.data() +
+                                    definition.state.size());
+            decodeFeatures(cursor, obj, true);
+            if (cursor.pos != cursor.end)
+                throw runtime_error("Invalid value in transaction log");
+            return;
+        }
+
+        if (!shared.obj ||
+            !ptrDesc->share(h, shared.ownership,
+                            Holder(shared.obj,
+                                   shared.obj->getClassDescriptor())))
+        {
+            throw runtime_error("Invalid pointer in transaction log");
+        }
+
+        // Restored objects are in the model again
+        log.m_shared[id] = shared;
+        ids.add(id, shared.obj);
+    }
+
+    void encodeValue(string& out, Holder h)
+    {
+        auto desc = h.descriptor();
+
+        switch (desc->getKind())
+        {
+        case TypeDescriptor::kPrimitive:
+            encodePrimitive(out, h);
+            break;
+        case TypeDescriptor::kClass:
+            encodeObject(out, desc->as<ClassDescriptor>()->get(h));
+            break;
+        case TypeDescriptor::kPair:
+            {
+                const auto value = desc->as<PairTypeDescriptor>()->getValue(h);
+                encodeValue(out, value.first);
+                encodeValue(out, value.second);
+            }
+            break;
+        case TypeDescriptor::kList:
+        case TypeDescriptor::kSet:
+        case TypeDescriptor::kMap:
+            {
+                const auto values =
+                    desc->as<ContainerTypeDescriptor>()->getValue(h);
+
+                appendVarint(out, values.size());
+                for (const auto& value : values)
+                    encodeValue(out, value);
+            }
+            break;
+        case TypeDescriptor::kPointer:
+            {
+                auto ptrDesc = desc->as<PointerTypeDescriptor>();
+
+                if (!ptrDesc->isOwner())
+                {
+                    out += static_cast<char>(kNotRecorded);
+                    break;
+                }
+
+                if (ptrDesc->isNull(h))
+                {
+                    out += static_cast<char>(kNull);
+                    break;
+                }
+
+                Holder value = ptrDesc->dereference(h);
+
+                if (value.descriptor()->getKind() == TypeDescriptor::kClass)
+                {
+                    ModelClass* obj =
+                        value.descriptor()->as<ClassDescriptor>()->get(value);
+
+                    if (ptrDesc->getPointerType() ==
+                        PointerTypeDescriptor::kShared)
+                    {
+                        out += static_cast<char>(kShared);
+                        appendVarint(out, encodeShared(
+                                              obj, ptrDesc->getOwnership(h)));
+                        break;
+                    }
+
+                    // Objects are written with their dynamic class
+                    out += static_cast<char>(kOwned);
+                    appendFixed(out, obj->getClassDescriptor()->getTypeId());
+                    encodeObject(out, obj);
+                }
+                else
+                {
+                    out += static_cast<char>(kOwned);
+                    encodeValue(out, value);
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    void decodeValue(BinaryCursor& cursor, Holder h, bool inPlace)
+    {
+        auto desc = h.descriptor();
+
+        switch (desc->getKind())
+        {
+        case TypeDescriptor::kPrimitive:
+            decodePrimitive(cursor, h);
+            break;
+        case TypeDescriptor::kClass:
+            decodeObject(cursor, desc->as<ClassDescriptor>()->get(h),
+                         inPlace);
+            break;
+        case TypeDescriptor::kPair:
+            {
+                const auto value = desc->as<PairTypeDescriptor>()->getValue(h);
+                decodeValue(cursor, value.first, inPlace);
+                decodeValue(cursor, value.second, inPlace);
+            }
+            break;
+        case TypeDescriptor::kList:
+            {
+                auto listDesc = desc->as<ListTypeDescriptor>();
+                const uint64_t count = cursor.readVarint();
+
+                listDesc->resize(h, count);
+                const uint64_t size = min<uint64_t>(count, listDesc->getSize(h));
+
+                for (uint64_t i = 0; i < size; i++)
+                    decodeValue(cursor, listDesc->getElement(h, i),
+                                inPlace);
+
+                if (size < count)
+                {
+                    Holder scratch =
+                        listDesc->getValueTypeDescriptor()->create();
+                    for (uint64_t i = size; i < count; i++)
+                        decodeValue(cursor, scratch, false);
+                }
+            }
+            break;
+        case TypeDescriptor::kSet:
+        case TypeDescriptor::kMap:
+            {
+                auto containerDesc = desc->as<ContainerTypeDescriptor>();
+                auto valueDesc = containerDesc->getValueTypeDescriptor();
+                const uint64_t count = cursor.readVarint();
+
+                vector<Holder> values;
+                for (uint64_t i = 0; i < count; i++)
+                {
+                    // Elements are copied into the container
+                    values.push_back(valueDesc->create());
+                    decodeValue(cursor, values.back(), false);
+                }
+
+                containerDesc->setValue(h, values);
+            }
+            break;
+        case TypeDescriptor::kPointer:
+            {
+                auto ptrDesc = desc->as<PointerTypeDescriptor>();
+                const auto tag = cursor.readFixed<uint8_t>();
+
+                if (tag == kNotRecorded) break;
+
+                if (tag == kNull)
+                {
+                    if (!ptrDesc->isNull(h)) desc->copy(desc->create(), h);
+                    break;
+                }
+
+                if (tag == kShared)
+                {
+                    decodeShared(ptrDesc, h, cursor.readVarint());
+                    break;
+                }
+
+                const TypeDescriptor* valueDesc =
+                    ptrDesc->getPointedTypeDescriptor();
+
+                if (valueDesc->getKind() == TypeDescriptor::kClass)
+                {
+                    const auto id = cursor.readFixed<uint64_t>();
+                    valueDesc = DescriptorRegistry::instance().findById(id);
+                    if (!valueDesc)
+                        throw runtime_error("Unknown class in transaction log");
+                }
+
+                Holder value = ptrDesc->emplace(h, valueDesc);
+                if (!value.isValid())
+                    throw runtime_error("Cannot create " + valueDesc->getFqn());
+
+                // Objects owned by pointers keep their address
+                decodeValue(cursor, value, true);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+};
+
+// ObjectTable
+
+uint64_t ObjectTable::getId(ModelClass* obj)
+{
+    auto it = m_ids.find(obj);
+    if (it != m_ids.end()) return it->second;
+
+    while (m_objects.count(m_next))
+        ++m_next;
+
+    add(m_next, obj);
+    return m_next++;
+}
+
+ModelClass* ObjectTable::find(uint64_t id) const
+{
+    auto it = m_objects.find(id);
+    return it == m_objects.end() ? nullptr : it->second;
+}
+
+void ObjectTable::add(uint64_t id, ModelClass* obj)
+{
+    auto known = m_ids.find(obj);
+    if (known != m_ids.end() && known->second == id) return;
+
+    erase(obj);
+
+    auto it = m_objects.find(id);
+    if (it != m_objects.end())
+    {
+        m_ids.erase(it->second);
+        m_owners.erase(id);
+    }
+
+    m_ids[obj] = id;
+    m_objects[id] = obj;
+}
+
+void ObjectTable::erase(ModelClass* obj)
+{
+    auto it = m_ids.find(obj);
+    if (it == m_ids.end()) return;
+
+    m_objects.erase(it->second);
+    m_owners.erase(it->second);
+    m_ids.erase(it);
+}
+
+shared_ptr<void> ObjectTable::getOwnership(uint64_t id) const
+{
+    auto it = m_owners.find(id);
+    return it == m_owners.end() ? nullptr : it->second.lock();
+}
+
+void ObjectTable::clear()
+{
+    m_ids.clear();
+    m_objects.clear();
+    m_owners.clear();
+    m_next = 0;
+}
+
+void ObjectTable::assign(ModelClass* root)
+{
+    clear();
+
+    vector<ModelClass*> objects;
+    unordered_set<const ModelClass*> visited;
+    SharedObjects owners;
+    collectObjects(Holder(root, root->getClassDescriptor()), objects, visited,
+                   true, &owners);
+
+    for (auto obj : objects)
+        getId(obj);
+    for (const auto& owner : owners)
+        m_owners[getId(owner.first)] = owner.second;
+}
+
+// TransactionLog
+
+TransactionLog::TransactionLog(ObjectIds& ids)
+    : m_ids(ids), m_wal(nullptr), m_active(false)
+{
+    addFeatureObserver(this);
+}
+
+TransactionLog::~TransactionLog()
+{
+    if (m_active) rollback();
+    removeFeatureObserver(this);
+}
+
+void TransactionLog::begin()
+{
+    if (m_active) throw logic_error("Transaction already active");
+
+    m_active = true;
+    m_changes.clear();
+    m_pending.clear();
+    m_pendingDefined.clear();
+}
+
+void TransactionLog::commit()
+{
+    if (!m_active) throw logic_error("No active transaction");
+
+    if (!m_pending.empty())
+    {
+        if (m_pending.size() > numeric_limits<uint32_t>::max())
+            throw length_error("Transaction too large");
+
+        string frame;
+        appendFixed(frame, static_cast<uint32_t>(m_pending.size()));
+        appendFixed(frame, checksum(m_pending.data(), m_pending.size()));
+        frame += m_pending;
+
+        if (m_wal)
+        {
+            m_wal->write(frame.data(), frame.size());
+            m_wal->flush();
+            if (!*m_wal)
+                throw runtime_error("Cannot write the write-ahead log");
+        }
+
+        m_frames.push_back(m_log.size());
+        m_log += frame;
+        m_undo.push_back(m_frames.size() - 1);
+        m_redo.clear();
+    }
+
+    m_defined.insert(m_pendingDefined.begin(), m_pendingDefined.end());
+    m_pendingDefined.clear();
+    m_active = false;
+    m_pending.clear();
+}
+
+void TransactionLog::rollback()
+{
+    if (!m_active) throw logic_error("No active transaction");
+
+    // Restored values are not recorded
+    m_active = false;
+
+    const auto records = readRecords(m_pending.data(), m_pending.size());
+    for (auto it = records.rbegin(); it != records.rend(); ++it)
+        apply(*it, true);
+
+    m_changes.clear();
+    m_pending.clear();
+    m_pendingDefined.clear();
+}
+
+/**
+ * Reverts a committed transaction in a new one, left active.
+ */
+void TransactionLog::revert(size_t frame)
+{
+    const string_view data = getFrame(frame);
+    const auto records = readRecords(data.data(), data.size());
+
+    begin();
+
+    try
+    {
+        for (auto it = records.rbegin(); it != records.rend(); ++it)
+            apply(*it, true);
+    }
+    catch (...)
+    {
+        rollback();
+        throw;
+    }
+}
+
+void TransactionLog::undo()
+{
+    if (m_active) throw logic_error("Transaction active");
+    if (m_undo.empty()) return;
+
+    revert(m_undo.back());
+
+    const size_t frames = m_frames.size();
+    vector<size_t> redo = m_redo;
+    commit();
+
+    m_undo.pop_back();
+    if (m_frames.size() == frames) return;
+
+    // Reverting the new transaction redoes the undone one
+    m_undo.pop_back();
+    redo.push_back(m_frames.size() - 1);
+    m_redo = std::move(redo);
+}
+
+void TransactionLog::redo()
+{
+    if (m_active) throw logic_error("Transaction active");
+    if (m_redo.empty()) return;
+
+    revert(m_redo.back());
+
+    vector<size_t> redo = m_redo;
+    redo.pop_back();
+    commit();
+    m_redo = std::move(redo);
+}
+
+void TransactionLog::clear()
+{
+    m_log.clear();
+    m_frames.clear();
+    m_undo.clear();
+    m_redo.clear();
+    releaseShared();
+}
+
+/**
+ * Keeps the objects owned by shared pointers in a value alive, so that
+ * records can point to them after the value changes.
+ */
+void TransactionLog::retainShared(Holder h)
+{
+    for (auto& shared : sharedObjects(h))
+    {
+        const uint64_t id = m_ids.getId(shared.first);
+        m_shared[id] = SharedObject{shared.first, std::move(shared.second)};
+    }
+}
+
+/**
+ * Releases the objects kept alive by the log, forgetting the ids of those
+ * no longer in the model.
+ */
+void TransactionLog::releaseShared()
+{
+    for (const auto& shared : m_shared)
+    {
+        if (shared.second.ownership.use_count() == 1)
+            m_ids.erase(shared.second.obj);
+    }
+
+    m_shared.clear();
+    m_defined.clear();
+}
+
+string_view TransactionLog::getFrame(size_t index) const
+{
+    const size_t offset = m_frames[index];
+    const size_t size =
+        (index + 1 < m_frames.size() ? m_frames[index + 1] : m_log.size()) -
+        offset - frameHeaderSize;
+    return string_view(m_log.data() + offset + frameHeaderSize, size);
+}
+
+size_t TransactionLog::replay(istream& is)
+{
+    const string data((istreambuf_iterator<char>(is)),
+                      istreambuf_iterator<char>());
+    return replay(data);
+}
+
+size_t TransactionLog::replay(const string& data)
+{
+    if (m_active) throw logic_error("Transaction active");
+
+    BinaryCursor cursor(data.data(), data.data() + data.size());
+    size_t count = 0;
+
+    while (static_cast<size_t>(cursor.end - cursor.pos) >= frameHeaderSize)
+    {
+        const auto size = cursor.readFixed<uint32_t>();
+        const auto sum = cursor.readFixed<uint64_t>();
+
+        // Incomplete frames are left by a crash while writing them
+        if (static_cast<size_t>(cursor.end - cursor.pos) < size ||
+            checksum(cursor.pos, size) != sum)
+        {
+            break;
+        }
+
+        const auto records = readRecords(cursor.take(size), size);
+        try
+        {
+            for (const auto& record : records)
+                apply(record, false);
+        }
+        catch (...)
+        {
+            m_definitions.clear();
+            throw;
+        }
+
+        // States of objects no record pointed to are dropped
+        m_definitions.clear();
+        ++count;
+    }
+
+    return count;
+}
+
+vector<TransactionLog::Record> TransactionLog::readRecords(const char* data,
+                                                          size_t size) const
+{
+    BinaryCursor cursor(data, data + size);
+    vector<Record> records;
+
+    while (cursor.pos != cursor.end)
+    {
+        Record record;
+        record.kind = static_cast<RecordKind>(cursor.readFixed<uint8_t>());
+        record.object = cursor.readVarint();
+        record.feature = 0;
+        record.type = 0;
+        record.prefix = 0;
+
+        if (record.kind == kObject)
+        {
+            record.type = cursor.readFixed<uint64_t>();
+            record.after.push_back(cursor.readStringView());
+            records.push_back(std::move(record));
+            continue;
+        }
+
+        record.feature = cursor.readVarint();
+
+        switch (record.kind)
+        {
+        case kValue:
+            record.before.push_back(cursor.readStringView());
+            record.after.push_back(cursor.readStringView());
+            break;
+        case kListDelta:
+            record.prefix = cursor.readVarint();
+            readStrings(cursor, record.before);
+            readStrings(cursor, record.after);
+            break;
+        case kSetDelta:
+            readStrings(cursor, record.before);
+            readStrings(cursor, record.after);
+            break;
+        default:
+            throw runtime_error("Invalid record in transaction log");
+        }
+
+        records.push_back(std::move(record));
+    }
+
+    return records;
+}
+
+size_t TransactionLog::getFeatureId(const FeatureDescriptor* feature)
+{
+    auto it = m_featureIds.find(feature);
+    if (it != m_featureIds.end()) return it->second;
+
+    // Inherited features keep their index in derived classes
+    const auto features = feature->getDefinedIn()->getAllFeatureDescriptors();
+    const size_t id =
+        std::find(features.begin(), features.end(), feature) - features.begin();
+
+    m_featureIds[feature] = id;
+    return id;
+}
+
+const FeatureDescriptor* TransactionLog::getFeature(ModelClass* obj,
+                                                    size_t id)
+{
+    const ClassDescriptor* classDesc = obj->getClassDescriptor();
+
+    auto it = m_features.find(classDesc);
+    if (it == m_features.end())
+        it = m_features
+                 .emplace(classDesc, classDesc->getAllFeatureDescriptors())
+                 .first;
+
+    if (id >= it->second.size())
+        throw runtime_error("Invalid feature in transaction log");
+    return it->second[id];
+}
+
+void TransactionLog::apply(const Record& record, bool undo)
+{
+    if (record.kind == kObject)
+    {
+        // Objects are created by the first record that points to them,
+        // and kept when undoing
+        if (undo) return;
+
+        const TypeDescriptor* desc =
+            DescriptorRegistry::instance().findById(record.type);
+        if (!desc || desc->getKind() != TypeDescriptor::kClass)
+            throw runtime_error("Unknown class in transaction log");
+
+        m_definitions[record.object] =
+            Definition{desc->as<ClassDescriptor>(), record.after.front()};
+        return;
+    }
+
+    // Objects changed before being added to the model are unknown, or
+    // already released when rolling back, and the records that add them
+    // hold their whole state
+    ModelClass* obj = m_ids.find(record.object);
+    if (!obj) return;
+
+    const FeatureDescriptor* feature = getFeature(obj, record.feature);
+    const auto& from = undo ? record.after : record.before;
+    const auto& to = undo ? record.before : record.after;
+
+    Codec codec{*this, nullptr};
+    Holder current = feature->getValue(obj);
+    const auto released = ownedObjects(current);
+    retainShared(current);
+
+    // Values are decoded in place, so that the objects they contain are
+    // registered with their address in the model
+    const bool notify = detail::hasFeatureObservers();
+    if (notify) detail::notifyBeforeSet(obj, feature);
+
+    switch (record.kind)
+    {
+    case kValue:
+        codec.decode(to.front(), current);
+        break;
+    case kListDelta:
+        {
+            auto listDesc = current.descriptor()->as<ListTypeDescriptor>();
+            auto valueDesc = listDesc->getValueTypeDescriptor();
+            const size_t size = listDesc->getSize(current);
+
+            if (record.prefix + from.size() > size)
+                throw runtime_error("Transaction log does not match the model");
+
+            // The elements after the range are moved to their new place
+            const size_t suffix = size - record.prefix - from.size();
+            const size_t newSize = record.prefix + to.size() + suffix;
+            auto move = [&](size_t i) {
+                valueDesc->copy(
+                    listDesc->getElement(current, size - suffix + i),
+                    listDesc->getElement(current, newSize - suffix + i));
+            };
+
+            if (newSize > size)
+            {
+                listDesc->resize(current, newSize);
+                for (size_t i = suffix; i > 0; i--)
+                    move(i - 1);
+            }
+            else if (newSize < size)
+            {
+                for (size_t i = 0; i < suffix; i++)
+                    move(i);
+                listDesc->resize(current, newSize);
+            }
+
+            for (size_t i = 0; i < to.size(); i++)
+                codec.decode(to[i],
+                             listDesc->getElement(current, record.prefix + i));
+        }
+        break;
+    case kSetDelta:
+        {
+            auto containerDesc =
+                current.descriptor()->as<ContainerTypeDescriptor>();
+            auto valueDesc = containerDesc->getValueTypeDescriptor();
+
+            multiset<string_view> removed(from.begin(), from.end());
+            vector<Holder> values;
+
+            const auto elements = containerDesc->getValue(current);
+            vector<string> encoded;
+            encoded.reserve(elements.size());
+
+            for (const auto& element : elements)
+            {
+                encoded.push_back(codec.encode(element));
+
+                auto it = removed.find(encoded.back());
+                if (it != removed.end())
+                    removed.erase(it);
+                else
+                    values.push_back(element);
+            }
+
+            // Elements are copied into the container
+            for (const auto& element : to)
+            {
+                values.push_back(valueDesc->create());
+                codec.decode(element, values.back(), false);
+            }
+
+            Holder value = current.descriptor()->create();
+            containerDesc->setValue(value, values);
+            current.descriptor()->copy(value, current);
+        }
+        break;
+    case kObject:
+        break;
+    }
+
+    releaseObjects(m_ids, released, current);
+    if (notify) detail::notifyAfterSet(obj, feature);
+}
+
+void TransactionLog::beforeSet(ModelClass* obj,
+                               const FeatureDescriptor* feature)
+{
+    if (!m_active) return;
+
+    Change change;
+    change.obj = obj;
+    change.feature = feature;
+
+    // Other threads may write objects with a seqlock meanwhile
+    const ClassDescriptor* classDesc = obj->getClassDescriptor();
+    const Holder snapshot = classDesc->snapshot(obj);
+    Holder value = feature->getValue(classDesc->get(snapshot));
+    if (isContainer(value.descriptor()))
+        change.elements = Codec{*this, nullptr}.encodeElements(value);
+    else
+        change.value = Codec{*this, nullptr}.encode(value);
+    change.objects = ownedObjects(value);
+
+    m_changes.push_back(std::move(change));
+}
+
+void TransactionLog::afterSet(ModelClass* obj,
+                              const FeatureDescriptor* feature)
+{
+    if (!m_active) return;
+
+    // Changes nested in others, made by the setters of the outer ones,
+    // are recorded first
+    auto it = std::find_if(m_changes.rbegin(), m_changes.rend(),
+                           [&](const Change& change) {
+                               return change.obj == obj &&
+                                      change.feature == feature;
+                           });
+    if (it == m_changes.rend()) return;
+
+    Change change = std::move(*it);
+    m_changes.erase(std::next(it).base());
+
+    // States of the objects the new value points to, recorded first
+    string definitions;
+    Codec codec{*this, &definitions};
+    const ClassDescriptor* classDesc = obj->getClassDescriptor();
+    const Holder snapshot = classDesc->snapshot(obj);
+    Holder value = feature->getValue(classDesc->get(snapshot));
+    const auto kind = value.descriptor()->getKind();
+    releaseObjects(m_ids, change.objects, value);
+
+    string record;
+    char recordKind;
+    appendVarint(record, m_ids.getId(obj));
+    appendVarint(record, getFeatureId(feature));
+
+    if (kind == TypeDescriptor::kList)
+    {
+        const vector<string> elements = codec.encodeElements(value);
+        const auto& old = change.elements;
+
+        // Only the range between the common prefix and suffix is kept
+        size_t prefix = 0;
+        while (prefix < old.size() && prefix < elements.size() &&
+               old[prefix] == elements[prefix])
+        {
+            ++prefix;
+        }
+
+        size_t suffix = 0;
+        while (suffix < old.size() - prefix &&
+               suffix < elements.size() - prefix &&
+               old[old.size() - suffix - 1] ==
+                   elements[elements.size() - suffix - 1])
+        {
+            ++suffix;
+        }
+
+        if (prefix + suffix == old.size() &&
+            prefix + suffix == elements.size())
+        {
+            recordKind = 0;
+        }
+        else
+        {
+            appendVarint(record, prefix);
+            appendStrings(record, old.begin() + prefix, old.end() - suffix);
+            appendStrings(record, elements.begin() + prefix,
+                          elements.end() - suffix);
+            recordKind = kListDelta;
+        }
+    }
+    else if (kind == TypeDescriptor::kSet || kind == TypeDescriptor::kMap)
+    {
+        vector<string> old = std::move(change.elements);
+        vector<string> elements = codec.encodeElements(value);
+        sort(old.begin(), old.end());
+        sort(elements.begin(), elements.end());
+
+        vector<string> removed;
+        vector<string> added;
+        set_difference(old.begin(), old.end(), elements.begin(),
+                       elements.end(), back_inserter(removed));
+        set_difference(elements.begin(), elements.end(), old.begin(),
+                       old.end(), back_inserter(added));
+
+        appendStrings(record, removed.begin(), removed.end());
+        appendStrings(record, added.begin(), added.end());
+        recordKind = removed.empty() && added.empty() ? 0 : kSetDelta;
+    }
+    else
+    {
+        string encoded = codec.encode(value);
+
+        appendString(record, change.value);
+        appendString(record, encoded);
+        recordKind = encoded == change.value ? 0 : kValue;
+    }
+
+    if (!recordKind)
+    {
+        // Unchanged values record no object
+        for (auto id : codec.defined)
+            m_pendingDefined.erase(id);
+        return;
+    }
+
+    m_pending += definitions;
+    m_pending += recordKind;
+    m_pending += record;
+}
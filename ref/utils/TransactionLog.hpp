@@ -0,0 +1,323 @@
+#ifndef REFCPP_TRANSACTION_LOG_HPP
+#define REFCPP_TRANSACTION_LOG_HPP
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <ref/Holder.hpp>
+#include <ref/Observer.hpp>
+#include "BinarySchema.hpp"
+
+namespace ref
+{
+    struct ModelClass;
+    struct ClassDescriptor;
+    struct FeatureDescriptor;
+
+    /**
+     * @brief Identifies the objects modified in a transaction log.
+     *
+     * Logs replayed on another copy of a model, for instance to recover
+     * from a crash, need an id table that gives the same ids to the same
+     * objects in both copies.
+     */
+    struct ObjectIds
+    {
+        virtual ~ObjectIds() {}
+
+        /**
+         * @brief Returns the id of an object, assigning one if needed.
+         */
+        virtual std::uint64_t getId(ModelClass* obj) = 0;
+
+        /**
+         * @brief Returns the object with an id, or null if unknown.
+         */
+        virtual ModelClass* find(std::uint64_t id) const = 0;
+
+        /**
+         * @brief Gives an id to an object, replacing the object that had
+         * it, if any. Called for the objects created by replayed records.
+         */
+        virtual void add(std::uint64_t id, ModelClass* obj) = 0;
+
+        /**
+         * @brief Forgets the id of an object, if any. Called for the
+         * objects released by recorded and replayed changes.
+         */
+        virtual void erase(ModelClass* obj) = 0;
+
+        /**
+         * @brief Returns the ownership of the object with an id, as given
+         * by PointerTypeDescriptor::getOwnership, if shared pointers own
+         * it. Null if unknown.
+         *
+         * Replayed records point shared pointers to the objects of the
+         * model this way, instead of creating copies of them.
+         */
+        virtual std::shared_ptr<void> getOwnership(std::uint64_t) const
+        {
+            return nullptr;
+        }
+    };
+
+    /**
+     * @brief Object ids assigned in order, starting from zero.
+     */
+    struct ObjectTable : ObjectIds
+    {
+        ObjectTable() : m_next(0) {}
+
+        std::uint64_t getId(ModelClass* obj) override;
+
+        ModelClass* find(std::uint64_t id) const override;
+
+        void add(std::uint64_t id, ModelClass* obj) override;
+
+        /**
+         * @brief Must be called for objects destroyed while in the table
+         * other than through a transaction log.
+         */
+        void erase(ModelClass* obj) override;
+
+        std::shared_ptr<void> getOwnership(std::uint64_t id) const override;
+
+        void clear();
+
+        std::size_t size() const { return m_ids.size(); }
+
+        /**
+         * @brief Replaces the table with ids for every object reachable
+         * from root, through values, containers and owning pointers,
+         * numbered depth-first in feature order. Two equal models get the
+         * same ids. The ownership of the objects owned by shared pointers
+         * is tracked too, without keeping them alive.
+         */
+        void assign(ModelClass* root);
+
+    protected:
+        std::unordered_map<const ModelClass*, std::uint64_t> m_ids;
+        std::unordered_map<std::uint64_t, ModelClass*> m_objects;
+        std::unordered_map<std::uint64_t, std::weak_ptr<void> > m_owners;
+        std::uint64_t m_next;
+    };
+
+    /**
+     * @brief Log of the changes made to a model in transactions, which
+     * can be rolled back, undone, redone and replayed.
+     *
+     * While a transaction is active, every change made through Class::set
+     * or FeatureDescriptor::setValue appends a compact binary record to
+     * the log: the id of the object, the index of the feature in its class
+     * and the old and new values of the feature. Lists are recorded as the
+     * range of elements replaced, and sets and maps as the elements
+     * removed and added, so a single edit of a large container takes the
+     * size of the edit in the log. Finding the edit does not: as setters
+     * replace whole values, each change encodes every element of the old
+     * and the new value and compares them, which takes time linear in
+     * their size, n log n for sets and maps, and keeps both encodings in
+     * memory until the setter returns. That is the order of the copy the
+     * caller makes to set a container anyway, but large containers edited
+     * often in transactions should be split into smaller objects.
+     * Objects in the values are written along with
+     * their id, and get it again when the values are decoded. Changes made
+     * through the references returned by Class::get are not recorded.
+     *
+     * Objects owned by shared pointers are written as their id only.
+     * Rollback, undo and replay point the shared pointers to the original
+     * objects again, so that their other owners and the other pointers to
+     * them keep seeing the same instances. The first record that points
+     * to an object the id table does not know, such as an object created
+     * in the transaction, follows a record of the state of the object, so
+     * that replaying it creates the object. The log keeps the objects
+     * owned by shared pointers in its records alive until cleared.
+     *
+     * Committed transactions are kept in memory as frames:
+     *
+     *     frame   := size:u32 checksum:u64 record*
+     *     record  := kind:u8 object:varint feature:varint change
+     *              | kind:u8 object:varint class:u64 state:string
+     *     change  := old:string new:string
+     *              | prefix:varint count:varint old:string{count}
+     *                count:varint new:string{count}
+     *              | count:varint removed:string{count}
+     *                count:varint added:string{count}
+     *
+     * and, if a write-ahead log is set, written and flushed to it on
+     * commit. Replaying a write-ahead log over the model it started from
+     * restores the committed state: frames left incomplete by a crash are
+     * detected by their size and checksum and ignored.
+     *
+     * Objects are identified by their address, so objects held by value
+     * in containers that reallocate them lose their id; objects held by
+     * shared or unique pointers keep it. Raw and weak pointers are not
+     * recorded and are left untouched by rollback, undo and replay.
+     * Transactions on several threads are not supported.
+     */
+    struct TransactionLog : FeatureObserver
+    {
+        TransactionLog(ObjectIds& ids);
+        TransactionLog(const TransactionLog&) = delete;
+
+        /**
+         * @brief Rolls back the active transaction, if any.
+         */
+        virtual ~TransactionLog();
+
+        /**
+         * @brief Sets a stream every committed transaction is written to
+         * before commit returns. Null to disable it.
+         */
+        void setWriteAheadLog(std::ostream* os) { m_wal = os; }
+
+        /**
+         * @throw std::logic_error if a transaction is already active.
+         */
+        void begin();
+
+        /**
+         * @throw std::runtime_error if the write-ahead log cannot be
+         * written. The transaction is then still active.
+         */
+        void commit();
+
+        void rollback();
+
+        bool isActive() const { return m_active; }
+
+        /**
+         * @brief Reverts the last committed transaction not undone yet,
+         * in a new transaction.
+         */
+        void undo();
+
+        /**
+         * @brief Reapplies the last undone transaction, in a new
+         * transaction. New transactions discard the undone ones.
+         */
+        void redo();
+
+        bool canUndo() const { return !m_undo.empty(); }
+
+        bool canRedo() const { return !m_redo.empty(); }
+
+        /**
+         * @brief Frames of the committed transactions.
+         */
+        const std::string& data() const { return m_log; }
+
+        /**
+         * @brief Number of committed transactions.
+         */
+        std::size_t size() const { return m_frames.size(); }
+
+        /**
+         * @brief Forgets the committed transactions, for instance once
+         * the model has been saved.
+         */
+        void clear();
+
+        /**
+         * @brief Applies the complete transactions of a log, stopping at
+         * the first incomplete one.
+         *
+         * Changes to objects not in the model, such as objects set up
+         * before being added to it, are skipped: the records that add
+         * them hold their whole state.
+         *
+         * @return The number of transactions applied.
+         * @throw std::runtime_error if a record does not match the model.
+         */
+        std::size_t replay(std::istream& is);
+
+        std::size_t replay(const std::string& data);
+
+        /**
+         * @brief Encodes the old value of a feature about to change. For
+         * containers, each element is encoded on its own.
+         */
+        void beforeSet(ModelClass* obj,
+                       const FeatureDescriptor* feature) override;
+
+        /**
+         * @brief Encodes the new value and records how it differs from
+         * the old one, in time linear in the size of both, or n log n
+         * for sets and maps.
+         */
+        void afterSet(ModelClass* obj,
+                      const FeatureDescriptor* feature) override;
+
+    protected:
+        struct Change
+        {
+            ModelClass* obj;
+            const FeatureDescriptor* feature;
+            std::string value;
+            std::vector<std::string> elements;
+            // Objects owned by the old value
+            std::vector<ModelClass*> objects;
+        };
+
+        struct Record;
+        struct Codec;
+
+        struct SharedObject
+        {
+            ModelClass* obj;
+            std::shared_ptr<void> ownership;
+        };
+
+        struct Definition
+        {
+            const ClassDescriptor* classDesc;
+            std::string_view state;
+        };
+
+        ObjectIds& m_ids;
+        std::ostream* m_wal;
+        bool m_active;
+        std::vector<Change> m_changes;
+        std::string m_pending;
+
+        std::string m_log;
+        // Offset of each frame in the log
+        std::vector<std::size_t> m_frames;
+        std::vector<std::size_t> m_undo;
+        std::vector<std::size_t> m_redo;
+
+        std::unordered_map<const FeatureDescriptor*, std::size_t> m_featureIds;
+        std::unordered_map<const ClassDescriptor*,
+                           std::vector<const FeatureDescriptor*> >
+            m_features;
+
+        // Objects owned by shared pointers in the records, by id
+        std::unordered_map<std::uint64_t, SharedObject> m_shared;
+        // Objects whose state is in a committed or in the active
+        // transaction
+        std::unordered_set<std::uint64_t> m_defined;
+        std::unordered_set<std::uint64_t> m_pendingDefined;
+        // States of the frame being replayed, of objects not created yet
+        std::unordered_map<std::uint64_t, Definition> m_definitions;
+
+        void retainShared(Holder h);
+        void releaseShared();
+
+        std::size_t getFeatureId(const FeatureDescriptor* feature);
+        const FeatureDescriptor* getFeature(ModelClass* obj, std::size_t id);
+
+        std::vector<Record> readRecords(const char* data,
+                                        std::size_t size) const;
+        std::string_view getFrame(std::size_t index) const;
+
+        void apply(const Record& record, bool undo);
+        void revert(std::size_t frame);
+    };
+}  // namespace ref
+
+#endif  // REFCPP_TRANSACTION_LOG_HPP
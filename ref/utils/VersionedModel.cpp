@@ -0,0 +1,254 @@
+#include "VersionedModel.hpp"
+#include <ref/Descriptors.hpp>
+#include <ref/Class.hpp>
+#include <cassert>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+using namespace ref;
+using namespace std;
+
+struct VersionedModel::Version
+{
+    Holder holder;
+    ModelClass * root;
+    uint64_t number;
+};
+
+VersionedModel::VersionedModel(const ModelClass * root)
+    : m_epoch(1), m_current(nullptr)
+{
+    const ClassDescriptor * classDesc = root->getClassDescriptor();
+
+    Holder holder = classDesc->create();
+    classDesc->copy(Holder(const_cast<ModelClass *>(root), classDesc), holder);
+
+    m_current = new Version{holder, classDesc->get(holder), 0};
+}
+
+VersionedModel::~VersionedModel()
+{
+    for (auto& reader : m_readers)
+        assert(reader.epoch.load() == 0);
+
+    for (auto& retired : m_retired)
+        delete retired.second;
+    delete m_current.load();
+}
+
+// Snapshot
+
+VersionedModel::Snapshot::Snapshot(Snapshot&& other)
+    : m_model(other.m_model), m_slot(other.m_slot), m_version(other.m_version)
+{
+    other.m_model = nullptr;
+    other.m_version = nullptr;
+}
+
+ModelClass * VersionedModel::Snapshot::root() const
+{
+    return m_version ? m_version->root : nullptr;
+}
+
+uint64_t VersionedModel::Snapshot::version() const
+{
+    assert(m_version);
+    return m_version->number;
+}
+
+void VersionedModel::Snapshot::release()
+{
+    if (!m_model) return;
+
+    m_model->m_readers[m_slot].epoch.store(0, memory_order_release);
+    m_model = nullptr;
+    m_version = nullptr;
+}
+
+VersionedModel::Snapshot VersionedModel::snapshot()
+{
+    // Threads start looking at different slots, so they seldom contend
+    const size_t start = hash<thread::id>()(this_thread::get_id());
+
+    for (;;)
+    {
+        for (size_t i = 0; i < kMaxReaders; i++)
+        {
+            ReaderSlot& slot = m_readers[(start + i) % kMaxReaders];
+
+            // The version is loaded after the epoch is published, so a
+            // writer that misses the slot has already replaced the version
+            // it would protect
+            uint64_t expected = 0;
+            if (slot.epoch.compare_exchange_strong(expected, m_epoch.load()))
+            {
+                return Snapshot(this, (start + i) % kMaxReaders,
+                                m_current.load());
+            }
+        }
+
+        this_thread::yield();
+    }
+}
+
+// Writer
+
+VersionedModel::Writer::Writer(VersionedModel& model)
+    : m_model(model), m_lock(model.m_writeMutex), m_root(nullptr)
+{
+    m_holder = copy(model.m_current.load()->root);
+    m_root = m_holder.descriptor()->as<ClassDescriptor>()->get(m_holder);
+    m_copies.insert(m_root);
+}
+
+Holder VersionedModel::Writer::copy(const ModelClass * obj)
+{
+    const ClassDescriptor * classDesc = obj->getClassDescriptor();
+
+    Holder holder = classDesc->create();
+    classDesc->copy(Holder(const_cast<ModelClass *>(obj), classDesc), holder);
+    return holder;
+}
+
+void VersionedModel::Writer::checkWritable(const ModelClass * obj) const
+{
+    if (!m_lock.owns_lock())
+        throw logic_error("Writer already committed");
+
+    if (!isWritable(obj))
+        throw invalid_argument("Object not writable: " +
+                               obj->getClassDescriptor()->getFqn());
+}
+
+ModelClass * VersionedModel::Writer::edit(Holder h)
+{
+    auto desc = h.descriptor();
+    if (desc->getKind() != TypeDescriptor::kPointer)
+        throw invalid_argument("Not a pointer: " + desc->getFqn());
+
+    auto ptrDesc = desc->as<PointerTypeDescriptor>();
+    auto pointedDesc = ptrDesc->getPointedTypeDescriptor();
+
+    if (ptrDesc->getPointerType() != PointerTypeDescriptor::kShared ||
+        pointedDesc->getKind() != TypeDescriptor::kClass)
+    {
+        throw invalid_argument("Not a shared pointer to a class: " +
+                               desc->getFqn());
+    }
+
+    if (ptrDesc->isNull(h)) return nullptr;
+
+    ModelClass * obj =
+        pointedDesc->as<ClassDescriptor>()->get(ptrDesc->dereference(h));
+    if (isWritable(obj)) return obj;
+
+    // The current object is kept alive by the published version while it
+    // is copied, and the copy handed over to the pointer afterwards
+    Holder value = copy(obj);
+    const ClassDescriptor * classDesc = obj->getClassDescriptor();
+
+    Holder res = ptrDesc->emplace(h, classDesc);
+    if (!res.isValid())
+        throw runtime_error("Cannot create " + classDesc->getFqn());
+
+    ModelClass * writable = classDesc->get(res);
+    classDesc->copy(value, res);
+    m_copies.insert(writable);
+    return writable;
+}
+
+ModelClass * VersionedModel::Writer::edit(ModelClass * parent,
+                                          const FeatureDescriptor * feature)
+{
+    checkWritable(parent);
+    return edit(feature->getValue(parent));
+}
+
+ModelClass * VersionedModel::Writer::edit(ModelClass * parent,
+                                          const FeatureDescriptor * feature,
+                                          size_t index)
+{
+    checkWritable(parent);
+
+    Holder list = feature->getValue(parent);
+    if (list.descriptor()->getKind() != TypeDescriptor::kList)
+        throw invalid_argument("Not a list: " + feature->getName());
+
+    auto listDesc = list.descriptor()->as<ListTypeDescriptor>();
+    if (index >= listDesc->getSize(list))
+        throw out_of_range("Invalid index for " + feature->getName());
+
+    return edit(listDesc->getElement(list, index));
+}
+
+void VersionedModel::Writer::commit()
+{
+    if (!m_lock.owns_lock())
+        throw logic_error("Writer already committed");
+
+    m_model.publish(m_holder);
+
+    m_holder = Holder();
+    m_root = nullptr;
+    m_copies.clear();
+    m_lock.unlock();
+
+    m_model.collect();
+}
+
+// Versions
+
+void VersionedModel::publish(Holder root)
+{
+    Version * current = m_current.load();
+    Version * version = new Version{
+        root, root.descriptor()->as<ClassDescriptor>()->get(root),
+        current->number + 1};
+
+    Version * old = m_current.exchange(version);
+    const uint64_t epoch = m_epoch.fetch_add(1);
+
+    lock_guard<mutex> lock(m_retiredMutex);
+    m_retired.emplace_back(epoch, old);
+}
+
+uint64_t VersionedModel::version() const
+{
+    return m_current.load()->number;
+}
+
+size_t VersionedModel::retired() const
+{
+    lock_guard<mutex> lock(m_retiredMutex);
+    return m_retired.size();
+}
+
+void VersionedModel::collect()
+{
+    vector<Version *> reclaimed;
+
+    {
+        // Versions retired while the readers are scanned are not
+        // considered, as snapshots missed by the scan may access them
+        lock_guard<mutex> lock(m_retiredMutex);
+
+        // Snapshots pinned after a version was retired cannot access it
+        uint64_t oldest = numeric_limits<uint64_t>::max();
+        for (auto& reader : m_readers)
+        {
+            const uint64_t epoch = reader.epoch.load();
+            if (epoch && epoch < oldest) oldest = epoch;
+        }
+
+        auto it = m_retired.begin();
+        for (; it != m_retired.end() && it->first < oldest; ++it)
+            reclaimed.push_back(it->second);
+        m_retired.erase(m_retired.begin(), it);
+    }
+
+    // Deleted outside the lock, as it may release large graphs
+    for (auto version : reclaimed)
+        delete version;
+}
@@ -0,0 +1,227 @@
+#ifndef REFCPP_VERSIONED_MODEL_HPP
+#define REFCPP_VERSIONED_MODEL_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <ref/Holder.hpp>
+
+namespace ref
+{
+    struct ModelClass;
+    struct FeatureDescriptor;
+
+    /**
+     * @brief Multi-version model for one writer and many concurrent
+     * readers.
+     *
+     * Readers pin an immutable snapshot of the model, which is never
+     * modified, so they read it without locks while the writer prepares
+     * the next version. The writer copies the objects on the path from the
+     * root to the ones it modifies; every other object is shared between
+     * versions through the shared pointers that reference it. Copying an
+     * object copies its values and containers, but not the objects held by
+     * its shared pointers.
+     *
+     * Versions replaced by a commit are reclaimed through epoch-based
+     * reclamation: each snapshot records the epoch in which it was pinned,
+     * and a version retired in an epoch is deleted once every snapshot
+     * pinned up to that epoch has been released. Readers never touch the
+     * reference counts of the objects, which are only updated by the
+     * writer.
+     *
+     * Objects shared between versions must only be reached through shared
+     * pointers. Lazy objects must be materialized before they are shared.
+     */
+    struct VersionedModel
+    {
+        /**
+         * @brief Creates a model whose first version is a copy of root.
+         * Objects reachable from root are shared with it, so they must not
+         * be modified afterwards.
+         */
+        explicit VersionedModel(const ModelClass * root);
+
+        VersionedModel(const VersionedModel&) = delete;
+        VersionedModel& operator=(const VersionedModel&) = delete;
+
+        /**
+         * @brief No snapshot may outlive the model.
+         */
+        ~VersionedModel();
+
+        struct Version;
+
+        /**
+         * @brief Read-only view of a version, which stays valid until the
+         * snapshot is released.
+         */
+        struct Snapshot
+        {
+            Snapshot(Snapshot&& other);
+
+            Snapshot(const Snapshot&) = delete;
+            Snapshot& operator=(const Snapshot&) = delete;
+
+            ~Snapshot() { release(); }
+
+            /**
+             * @brief Root of the version. Objects of a snapshot are shared
+             * with other versions and must not be modified.
+             */
+            ModelClass * root() const;
+
+            template <typename T>
+            const T * get() const
+            {
+                return dynamic_cast<const T *>(root());
+            }
+
+            std::uint64_t version() const;
+
+            void release();
+
+        protected:
+            friend struct VersionedModel;
+
+            Snapshot(VersionedModel * model, std::size_t slot,
+                     const Version * version)
+                : m_model(model), m_slot(slot), m_version(version)
+            {
+            }
+
+            VersionedModel * m_model;
+            std::size_t m_slot;
+            const Version * m_version;
+        };
+
+        /**
+         * @brief Pins the current version. Waits for a free slot if
+         * kMaxReaders snapshots are already pinned.
+         */
+        Snapshot snapshot();
+
+        /**
+         * @brief Prepares the next version. Writers are serialized: only
+         * one of them exists at a time.
+         */
+        struct Writer
+        {
+            Writer(const Writer&) = delete;
+            Writer& operator=(const Writer&) = delete;
+
+            /**
+             * @brief Writable copy of the root.
+             */
+            ModelClass * root() { return m_root; }
+
+            template <typename T>
+            T * get()
+            {
+                return dynamic_cast<T *>(m_root);
+            }
+
+            /**
+             * @brief Makes the object held by a shared pointer writable,
+             * copying it unless it was already copied by this writer.
+             * The pointer must belong to a writable object.
+             *
+             * @return The writable object, or null if the pointer is null.
+             * @throw std::invalid_argument if h does not hold a shared
+             * pointer to a class.
+             */
+            ModelClass * edit(Holder h);
+
+            /**
+             * @brief Makes the object held by a shared pointer feature of
+             * a writable object writable.
+             */
+            ModelClass * edit(ModelClass * parent,
+                              const FeatureDescriptor * feature);
+
+            /**
+             * @brief Makes the object held by an element of a list of
+             * shared pointers of a writable object writable.
+             */
+            ModelClass * edit(ModelClass * parent,
+                              const FeatureDescriptor * feature,
+                              std::size_t index);
+
+            bool isWritable(const ModelClass * obj) const
+            {
+                return m_copies.count(obj) != 0;
+            }
+
+            /**
+             * @brief Publishes the new version. The writer can no longer
+             * be used afterwards. Writers destroyed without committing
+             * discard their changes.
+             */
+            void commit();
+
+        protected:
+            friend struct VersionedModel;
+
+            explicit Writer(VersionedModel& model);
+
+            VersionedModel& m_model;
+            std::unique_lock<std::mutex> m_lock;
+            Holder m_holder;
+            ModelClass * m_root;
+            std::unordered_set<const ModelClass *> m_copies;
+
+            Holder copy(const ModelClass * obj);
+            void checkWritable(const ModelClass * obj) const;
+        };
+
+        Writer write() { return Writer(*this); }
+
+        /**
+         * @brief Number of the current version, starting from zero.
+         */
+        std::uint64_t version() const;
+
+        /**
+         * @brief Number of replaced versions not reclaimed yet.
+         */
+        std::size_t retired() const;
+
+        /**
+         * @brief Deletes the replaced versions no snapshot can access.
+         * Called on every commit.
+         */
+        void collect();
+
+        enum
+        {
+            kMaxReaders = 64
+        };
+
+    protected:
+        struct alignas(64) ReaderSlot
+        {
+            // Epoch in which a snapshot was pinned, or zero if free
+            std::atomic<std::uint64_t> epoch;
+
+            ReaderSlot() : epoch(0) {}
+        };
+
+        std::array<ReaderSlot, kMaxReaders> m_readers;
+        std::atomic<std::uint64_t> m_epoch;
+        std::atomic<Version *> m_current;
+
+        std::mutex m_writeMutex;
+
+        // Replaced versions along with the epoch they were retired in
+        mutable std::mutex m_retiredMutex;
+        std::vector<std::pair<std::uint64_t, Version *> > m_retired;
+
+        void publish(Holder root);
+    };
+}  // namespace ref
+
+#endif  // REFCPP_VERSIONED_MODEL_HPP
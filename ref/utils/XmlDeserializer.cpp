@@ -0,0 +1,293 @@
+#include "XmlDeserializer.hpp"
+#include <ref/Descriptors.hpp>
+#include <ref/DescriptorRegistry.hpp>
+#include <ref/Class.hpp>
+#include <stdexcept>
+#include <typeinfo>
+#include <vector>
+
+using namespace ref;
+using namespace std;
+
+namespace
+{
+    bool isSubclass(const ClassDescriptor* classDesc,
+                    const ClassDescriptor* base)
+    {
+        for (; classDesc; classDesc = classDesc->getParentClassDescriptor())
+            if (classDesc == base) return true;
+        return false;
+    }
+} // namespace
+
+XmlDeserializer::XmlDeserializer(istream& is)
+    : m_parser(is), m_started(false)
+{
+}
+
+void XmlDeserializer::startDocument()
+{
+    if (m_started)
+        throw runtime_error("Root element already read");
+
+    m_started = true;
+
+    if (m_parser.next() != XmlPullParser::kStartElement)
+        throw runtime_error("Missing root element");
+}
+
+void XmlDeserializer::deserialize(ModelClass * obj)
+{
+    startDocument();
+
+    auto classDesc = getClassDescriptor();
+    if (!isSubclass(obj->getClassDescriptor(), classDesc))
+        throw runtime_error("Unexpected root element: " + m_parser.getName());
+
+    readObject(obj);
+}
+
+Holder XmlDeserializer::deserialize()
+{
+    startDocument();
+
+    Holder h = getClassDescriptor()->create();
+    if (!h.isValid())
+        throw runtime_error("Cannot create " + m_parser.getName());
+
+    readObject(h.descriptor()->as<ClassDescriptor>()->get(h));
+    return h;
+}
+
+Holder XmlDeserializer::next()
+{
+    if (!m_started)
+        startDocument();
+
+    for (;;)
+    {
+        switch (m_parser.next())
+        {
+        case XmlPullParser::kStartElement:
+            {
+                Holder h = getClassDescriptor()->create();
+                if (!h.isValid())
+                    throw runtime_error("Cannot create " + m_parser.getName());
+
+                readObject(h.descriptor()->as<ClassDescriptor>()->get(h));
+                return h;
+            }
+        case XmlPullParser::kEndElement:
+        case XmlPullParser::kEndDocument:
+            return Holder();
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * Returns the class descriptor for the current element.
+ */
+const ClassDescriptor* XmlDeserializer::getClassDescriptor(
+    const ClassDescriptor* base) const
+{
+    const string& tag = m_parser.getName();
+    const ClassDescriptor* classDesc =
+        (base && base->getXmlTag() == tag)
+            ? base
+            : DescriptorRegistry::instance().findByXmlTag(tag);
+
+    if (!classDesc || (base && !isSubclass(classDesc, base)))
+        throw runtime_error("Unexpected element: " + tag);
+
+    return classDesc;
+}
+
+const FeatureDescriptor* XmlDeserializer::getFeatureDescriptor(
+    const ClassDescriptor* classDesc, const string& tag)
+{
+    auto it = m_features.find(classDesc);
+
+    if (it == m_features.end())
+    {
+        FeatureMap& features = m_features[classDesc];
+        for (auto feature : classDesc->getAllFeatureDescriptors())
+            features[feature->getXmlTag()] = feature;
+
+        it = m_features.find(classDesc);
+    }
+
+    auto featureIt = it->second.find(tag);
+    return featureIt == it->second.end() ? nullptr : featureIt->second;
+}
+
+/**
+ * Reads the features of an object, from the start element of the object
+ * up to its end element.
+ */
+void XmlDeserializer::readObject(ModelClass * obj)
+{
+    auto classDesc = obj->getClassDescriptor();
+
+    for (;;)
+    {
+        switch (m_parser.next())
+        {
+        case XmlPullParser::kStartElement:
+            if (auto feature = getFeatureDescriptor(classDesc,
+                                                    m_parser.getName()))
+            {
+                readValue(feature->getValue(obj));
+            }
+            else
+            {
+                m_parser.skipElement();
+            }
+            break;
+        case XmlPullParser::kEndElement:
+            return;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * Reads a value from the content of the current element, up to its end
+ * element. See XmlSerializer::writeValue.
+ */
+void XmlDeserializer::readValue(Holder h)
+{
+    auto desc = h.descriptor();
+
+    switch (desc->getKind())
+    {
+    case TypeDescriptor::kPrimitive:
+        {
+            const string tag = m_parser.getName();
+            try
+            {
+                desc->as<PrimitiveTypeDescriptor>()->setString(
+                    h, m_parser.readText());
+            }
+            catch (const bad_cast&)
+            {
+                throw runtime_error("Invalid value for element: " + tag);
+            }
+        }
+        return;
+    case TypeDescriptor::kUnsupported:
+        m_parser.skipElement();
+        return;
+    case TypeDescriptor::kPointer:
+        // Null unless the element contains an item
+        desc->copy(desc->create(), h);
+        break;
+    default:
+        break;
+    }
+
+    vector<Holder> items;
+
+    for (;;)
+    {
+        const auto event = m_parser.next();
+
+        if (event == XmlPullParser::kEndElement)
+            break;
+
+        if (event != XmlPullParser::kStartElement)
+            continue;
+
+        switch (desc->getKind())
+        {
+        case TypeDescriptor::kClass:
+            readObject(desc->as<ClassDescriptor>()->get(h));
+            break;
+        case TypeDescriptor::kPair:
+            {
+                const auto value = desc->as<PairTypeDescriptor>()->getValue(h);
+
+                if (m_parser.getName() == "first")
+                    readValue(value.first);
+                else if (m_parser.getName() == "second")
+                    readValue(value.second);
+                else
+                    m_parser.skipElement();
+            }
+            break;
+        case TypeDescriptor::kMap:
+        case TypeDescriptor::kList:
+        case TypeDescriptor::kSet:
+            {
+                auto valueDesc = desc->as<ContainerTypeDescriptor>()
+                                     ->getValueTypeDescriptor();
+                Holder item = valueDesc->create();
+                readItem(item);
+                items.push_back(item);
+            }
+            break;
+        default:
+            readItem(h);
+            break;
+        }
+    }
+
+    switch (desc->getKind())
+    {
+    case TypeDescriptor::kMap:
+    case TypeDescriptor::kList:
+    case TypeDescriptor::kSet:
+        desc->as<ContainerTypeDescriptor>()->setValue(h, items);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Reads a value from the current element, which represents it. See
+ * XmlSerializer::writeItem.
+ */
+void XmlDeserializer::readItem(Holder h)
+{
+    auto desc = h.descriptor();
+
+    switch (desc->getKind())
+    {
+    case TypeDescriptor::kClass:
+        readObject(desc->as<ClassDescriptor>()->get(h));
+        break;
+    case TypeDescriptor::kPointer:
+        {
+            if (m_parser.getName() == "null")
+            {
+                m_parser.skipElement();
+                break;
+            }
+
+            auto ptrDesc = desc->as<PointerTypeDescriptor>();
+            auto pointedDesc = ptrDesc->getPointedTypeDescriptor();
+            const bool isClass =
+                pointedDesc->getKind() == TypeDescriptor::kClass;
+
+            if (isClass)
+                pointedDesc =
+                    getClassDescriptor(pointedDesc->as<ClassDescriptor>());
+
+            Holder value = ptrDesc->emplace(h, pointedDesc);
+            if (!value.isValid())
+                throw runtime_error("Cannot create " + m_parser.getName());
+
+            if (isClass)
+                readObject(pointedDesc->as<ClassDescriptor>()->get(value));
+            else
+                readValue(value);
+        }
+        break;
+    default:
+        readValue(h);
+        break;
+    }
+}
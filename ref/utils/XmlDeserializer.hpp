@@ -0,0 +1,73 @@
+#ifndef REFCPP_XML_DESERIALIZER_HPP
+#define REFCPP_XML_DESERIALIZER_HPP
+
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <ref/Holder.hpp>
+#include "XmlPullParser.hpp"
+
+namespace ref
+{
+    struct ModelClass;
+    struct ClassDescriptor;
+    struct FeatureDescriptor;
+
+    /**
+     * @brief Reads objects written by XmlSerializer.
+     *
+     * Elements are mapped to classes and features by their XML tags, the
+     * document is read with a pull parser and values are set while reading,
+     * so no intermediate tree is built. Elements that do not match any
+     * feature are skipped. Classes are looked up in the DescriptorRegistry.
+     *
+     * Malformed documents throw std::runtime_error.
+     */
+    struct XmlDeserializer
+    {
+        XmlDeserializer(std::istream& is);
+
+        /**
+         * @brief Reads the root element into an existing object.
+         */
+        void deserialize(ModelClass * obj);
+
+        /**
+         * @brief Reads the root element into a new instance of the class
+         * its tag refers to.
+         *
+         * @return A holder that owns the new instance.
+         */
+        Holder deserialize();
+
+        /**
+         * @brief Reads the next object within the root element, as written
+         * between XmlSerializer::begin and end. Only the current object is
+         * kept in memory, so documents of any size can be processed.
+         *
+         * @return A holder that owns the new instance. An invalid holder
+         * once the root element is closed.
+         */
+        Holder next();
+
+    protected:
+        typedef std::unordered_map<std::string, const FeatureDescriptor*>
+            FeatureMap;
+
+        XmlPullParser m_parser;
+        bool m_started;
+        std::unordered_map<const ClassDescriptor*, FeatureMap> m_features;
+
+        void startDocument();
+        const ClassDescriptor* getClassDescriptor(
+            const ClassDescriptor* base = nullptr) const;
+        const FeatureDescriptor* getFeatureDescriptor(
+            const ClassDescriptor* classDesc, const std::string& tag);
+
+        void readObject(ModelClass * obj);
+        void readValue(Holder h);
+        void readItem(Holder h);
+    };
+} // namespace ref
+
+#endif // REFCPP_XML_DESERIALIZER_HPP
@@ -0,0 +1,330 @@
+#include "XmlPullParser.hpp"
+#include <cstring>
+#include <stdexcept>
+
+using namespace ref;
+using namespace std;
+
+namespace
+{
+    bool isSpace(int c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    bool isNameChar(int c)
+    {
+        return c != EOF && !isSpace(c) && c != '>' && c != '/' && c != '=' &&
+               c != '<' && c != '"' && c != '\'';
+    }
+
+    void appendUtf8(string& out, unsigned long cp)
+    {
+        if (cp < 0x80)
+        {
+            out += static_cast<char>(cp);
+        }
+        else if (cp < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+}  // namespace
+
+XmlPullParser::XmlPullParser(istream& is)
+    : m_is(is),
+      m_event(kEndDocument),
+      m_depth(0),
+      m_pendingEnd(false),
+      m_line(1)
+{
+}
+
+int XmlPullParser::get()
+{
+    const int c = m_is.get();
+    if (c == '\n') ++m_line;
+    return c;
+}
+
+int XmlPullParser::peek() { return m_is.peek(); }
+
+void XmlPullParser::expect(char c)
+{
+    if (get() != c) error(string("expected '") + c + "'");
+}
+
+void XmlPullParser::error(const string& msg) const
+{
+    throw runtime_error("XML error at line " + to_string(m_line) + ": " + msg);
+}
+
+void XmlPullParser::skipSpaces()
+{
+    while (isSpace(peek()))
+        get();
+}
+
+void XmlPullParser::skipUntil(const char* terminator)
+{
+    const size_t size = strlen(terminator);
+    string window;
+
+    while (window.size() < size ||
+           window.compare(window.size() - size, size, terminator) != 0)
+    {
+        const int c = get();
+        if (c == EOF) error("unexpected end of document");
+
+        if (window.size() == size) window.erase(0, 1);
+        window += static_cast<char>(c);
+    }
+}
+
+string XmlPullParser::readName()
+{
+    string name;
+    while (isNameChar(peek()))
+        name += static_cast<char>(get());
+
+    if (name.empty()) error("expected a name");
+    return name;
+}
+
+void XmlPullParser::readReference(string& out)
+{
+    // '&' already consumed
+    string ref;
+    int c;
+    while ((c = get()) != ';')
+    {
+        if (c == EOF || ref.size() > 10) error("invalid reference");
+        ref += static_cast<char>(c);
+    }
+
+    if (ref == "lt")
+        out += '<';
+    else if (ref == "gt")
+        out += '>';
+    else if (ref == "amp")
+        out += '&';
+    else if (ref == "quot")
+        out += '"';
+    else if (ref == "apos")
+        out += '\'';
+    else if (ref.size() > 1 && ref[0] == '#')
+    {
+        const bool hex = ref[1] == 'x';
+        try
+        {
+            appendUtf8(out, stoul(ref.substr(hex ? 2 : 1), nullptr,
+                                  hex ? 16 : 10));
+        }
+        catch (const logic_error&)
+        {
+            error("invalid character reference: " + ref);
+        }
+    }
+    else
+        error("unknown entity: " + ref);
+}
+
+void XmlPullParser::readAttributes()
+{
+    m_attributes.clear();
+
+    for (;;)
+    {
+        skipSpaces();
+
+        const int c = peek();
+        if (c == '>' || c == '/' || c == EOF) return;
+
+        string name = readName();
+        skipSpaces();
+        expect('=');
+        skipSpaces();
+
+        const int quote = get();
+        if (quote != '"' && quote != '\'') error("expected quote");
+
+        string value;
+        int v;
+        while ((v = get()) != quote)
+        {
+            if (v == EOF) error("unexpected end of document");
+
+            if (v == '&')
+                readReference(value);
+            else
+                value += static_cast<char>(v);
+        }
+
+        m_attributes.push_back(make_pair(name, value));
+    }
+}
+
+bool XmlPullParser::readMarkup()
+{
+    // '<' already consumed
+    const int c = peek();
+
+    if (c == '?')
+    {
+        skipUntil("?>");
+        return false;
+    }
+
+    if (c == '!')
+    {
+        get();
+        if (peek() == '-')
+        {
+            skipUntil("-->");
+            return false;
+        }
+
+        if (peek() == '[')
+        {
+            // CDATA section
+            skipUntil("CDATA[");
+            m_text.clear();
+
+            while (m_text.size() < 3 ||
+                   m_text.compare(m_text.size() - 3, 3, "]]>") != 0)
+            {
+                const int t = get();
+                if (t == EOF) error("unexpected end of document");
+                m_text += static_cast<char>(t);
+            }
+            m_text.resize(m_text.size() - 3);
+
+            m_event = kText;
+            return true;
+        }
+
+        // DOCTYPE and other declarations
+        int depth = 1;
+        while (depth)
+        {
+            const int t = get();
+            if (t == EOF) error("unexpected end of document");
+            if (t == '<') ++depth;
+            if (t == '>') --depth;
+        }
+        return false;
+    }
+
+    if (c == '/')
+    {
+        get();
+        m_name = readName();
+        skipSpaces();
+        expect('>');
+
+        if (m_stack.empty() || m_stack.back() != m_name)
+            error("unexpected end element: " + m_name);
+
+        m_stack.pop_back();
+        --m_depth;
+        m_event = kEndElement;
+        return true;
+    }
+
+    m_name = readName();
+    readAttributes();
+
+    if (peek() == '/')
+    {
+        get();
+        m_pendingEnd = true;
+    }
+    expect('>');
+
+    if (!m_pendingEnd) m_stack.push_back(m_name);
+    ++m_depth;
+    m_event = kStartElement;
+    return true;
+}
+
+XmlPullParser::Event XmlPullParser::next()
+{
+    if (m_pendingEnd)
+    {
+        m_pendingEnd = false;
+        --m_depth;
+        return m_event = kEndElement;
+    }
+
+    for (;;)
+    {
+        int c = peek();
+
+        if (c == EOF)
+        {
+            if (m_depth) error("unexpected end of document");
+            return m_event = kEndDocument;
+        }
+
+        if (c == '<')
+        {
+            get();
+            if (readMarkup()) return m_event;
+            continue;
+        }
+
+        m_text.clear();
+        while ((c = peek()) != '<' && c != EOF)
+        {
+            get();
+            if (c == '&')
+                readReference(m_text);
+            else
+                m_text += static_cast<char>(c);
+        }
+
+        // Text out of the root element can only be white space
+        if (m_depth == 0) continue;
+
+        return m_event = kText;
+    }
+}
+
+void XmlPullParser::skipElement()
+{
+    const int depth = m_depth;
+
+    while (m_depth >= depth)
+    {
+        if (next() == kEndDocument) error("unexpected end of document");
+    }
+}
+
+string XmlPullParser::readText()
+{
+    const int depth = m_depth;
+    string text;
+
+    while (next() != kEndElement || m_depth >= depth)
+    {
+        if (m_event == kEndDocument) error("unexpected end of document");
+
+        if (m_event == kText && m_depth == depth) text += m_text;
+    }
+
+    return text;
+}
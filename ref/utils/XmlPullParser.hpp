@@ -0,0 +1,96 @@
+#ifndef REFCPP_XML_PULL_PARSER_HPP
+#define REFCPP_XML_PULL_PARSER_HPP
+
+#include <istream>
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace ref
+{
+    /**
+     * @brief Minimal streaming XML parser.
+     *
+     * Reads its input one character at a time and keeps no more than the
+     * current tag or text and the names of the open elements in memory.
+     * The XML declaration, processing instructions, comments and DOCTYPE
+     * declarations are skipped. CDATA
+     * sections are reported as text. Empty elements are reported as a
+     * start element followed by an end element.
+     *
+     * Malformed input throws std::runtime_error.
+     */
+    struct XmlPullParser
+    {
+        enum Event
+        {
+            kStartElement,
+            kEndElement,
+            kText,
+            kEndDocument
+        };
+
+        typedef std::vector<std::pair<std::string, std::string> >
+            AttributeVector;
+
+        XmlPullParser(std::istream& is);
+
+        Event next();
+
+        Event getEvent() const { return m_event; }
+
+        /**
+         * @brief Name of the current element, for start and end events.
+         */
+        const std::string& getName() const { return m_name; }
+
+        /**
+         * @brief Decoded text, for text events.
+         */
+        const std::string& getText() const { return m_text; }
+
+        const AttributeVector& getAttributes() const { return m_attributes; }
+
+        /**
+         * @brief Number of elements currently open.
+         */
+        int getDepth() const { return m_depth; }
+
+        /**
+         * @brief Skips the rest of the current element, including its
+         * children. Must be called right after a start element event.
+         */
+        void skipElement();
+
+        /**
+         * @brief Reads the text content of the current element, up to and
+         * including its end element. Child elements are skipped.
+         */
+        std::string readText();
+
+    protected:
+        std::istream& m_is;
+        Event m_event;
+        std::string m_name;
+        std::string m_text;
+        AttributeVector m_attributes;
+        std::vector<std::string> m_stack;
+        int m_depth;
+        bool m_pendingEnd;
+        std::size_t m_line;
+
+        int get();
+        int peek();
+        void expect(char c);
+        void error(const std::string& msg) const;
+
+        void skipSpaces();
+        void skipUntil(const char* terminator);
+        std::string readName();
+        void readAttributes();
+        void readReference(std::string& out);
+        bool readMarkup();
+    };
+}  // namespace ref
+
+#endif  // REFCPP_XML_PULL_PARSER_HPP
@@ -0,0 +1,165 @@
+#include "XmlSerializer.hpp"
+#include <ref/Descriptors.hpp>
+#include <ref/Class.hpp>
+#include <cassert>
+
+using namespace ref;
+using namespace std;
+
+namespace
+{
+    const size_t spaces = 4;
+} // namespace
+
+string XmlSerializer::indent() const
+{
+    return string(level * spaces, ' ');
+}
+
+void XmlSerializer::begin(const string& tag)
+{
+    os << indent() << '<' << tag << '>' << endl;
+    tags.push_back(tag);
+    ++level;
+}
+
+void XmlSerializer::end()
+{
+    assert(!tags.empty());
+
+    --level;
+    os << indent() << "</" << tags.back() << '>' << endl;
+    tags.pop_back();
+}
+
+void XmlSerializer::serialize(ModelClass * obj)
+{
+    if (!obj)
+        return;
+
+    auto classDesc = obj->getClassDescriptor();
+    const string tag = classDesc->getXmlTag();
+
+    os << indent() << '<' << tag << '>' << endl;
+    ++level;
+
+    const Holder snapshot = classDesc->snapshot(obj);
+    classDesc->forEachFeature(
+        classDesc->get(snapshot),
+        [&](const FeatureDescriptor * feature, Holder value) {
+            const string featureTag = feature->getXmlTag();
+
+            os << indent() << '<' << featureTag << '>';
+            writeValue(value);
+            os << "</" << featureTag << '>' << endl;
+        });
+
+    --level;
+    os << indent() << "</" << tag << '>' << endl;
+}
+
+void XmlSerializer::writeText(const string& text)
+{
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '&': os << "&amp;"; break;
+        case '<': os << "&lt;"; break;
+        case '>': os << "&gt;"; break;
+        default: os << c; break;
+        }
+    }
+}
+
+/**
+ * Writes the content of the element that contains a value, which is
+ * already open.
+ */
+void XmlSerializer::writeValue(Holder h)
+{
+    auto desc = h.descriptor();
+
+    switch (desc->getKind())
+    {
+    case TypeDescriptor::kPrimitive:
+        writeText(desc->as<PrimitiveTypeDescriptor>()->getString(h));
+        return;
+    case TypeDescriptor::kUnsupported:
+        return;
+    default:
+        break;
+    }
+
+    os << endl;
+    ++level;
+
+    switch (desc->getKind())
+    {
+    case TypeDescriptor::kPair:
+        {
+            const auto value = desc->as<PairTypeDescriptor>()->getValue(h);
+
+            os << indent() << "<first>";
+            writeValue(value.first);
+            os << "</first>" << endl;
+
+            os << indent() << "<second>";
+            writeValue(value.second);
+            os << "</second>" << endl;
+        }
+        break;
+    case TypeDescriptor::kMap:
+    case TypeDescriptor::kList:
+    case TypeDescriptor::kSet:
+        {
+            const auto values = desc->as<ContainerTypeDescriptor>()->getValue(h);
+
+            for (size_t i = 0; i < values.size(); i++)
+                writeItem(values[i]);
+        }
+        break;
+    default:
+        writeItem(h);
+        break;
+    }
+
+    --level;
+    os << indent();
+}
+
+/**
+ * Writes an element that represents a value: objects are written with
+ * their own element, pointers as the value they point to and anything
+ * else within an item element.
+ */
+void XmlSerializer::writeItem(Holder h)
+{
+    auto desc = h.descriptor();
+
+    switch (desc->getKind())
+    {
+    case TypeDescriptor::kClass:
+        serialize(desc->as<ClassDescriptor>()->get(h));
+        break;
+    case TypeDescriptor::kPointer:
+        {
+            auto ptrDesc = desc->as<PointerTypeDescriptor>();
+
+            if (!ptrDesc->isOwner() || ptrDesc->isNull(h))
+            {
+                os << indent() << "<null/>" << endl;
+            }
+            else
+            {
+                writeItem(ptrDesc->dereference(h));
+            }
+        }
+        break;
+    default:
+        os << indent() << "<item>";
+        writeValue(h);
+        os << "</item>" << endl;
+        break;
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef REFCPP_XML_SERIALIZER_HPP
+#define REFCPP_XML_SERIALIZER_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <ref/Holder.hpp>
+
+namespace ref
+{
+    struct ModelClass;
+
+    /**
+     * @brief Writes objects as XML, directly into the output stream.
+     *
+     * Objects are written as an element named after the XML tag of their
+     * dynamic class, containing an element for each feature named after
+     * the XML tag of the feature. Within features:
+     *
+     * - primitive values are written as text,
+     * - collections contain an element for each item: objects are written
+     *   as above, any other value within an item element,
+     * - pairs contain a first and a second element,
+     * - shared and unique pointers contain the pointed value as an item,
+     *   or a null element. Raw and weak pointers are always written as
+     *   null, as they do not own the pointed object.
+     */
+    struct XmlSerializer
+    {
+        XmlSerializer(std::ostream& os_)
+            : os(os_), level(0)
+        {}
+
+        void serialize(ModelClass * obj);
+
+        /**
+         * @brief Opens an element that will contain the objects written
+         * until the matching call to end, so sequences of objects can be
+         * streamed without building a container.
+         */
+        void begin(const std::string& tag);
+
+        void end();
+
+    protected:
+        std::ostream& os;
+        int level;
+        std::vector<std::string> tags;
+
+        std::string indent() const;
+
+        void writeValue(Holder h);
+        void writeItem(Holder h);
+        void writeText(const std::string& text);
+    };
+} // namespace ref
+
+#endif // REFCPP_XML_SERIALIZER_HPP
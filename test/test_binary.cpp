@@ -0,0 +1,314 @@
+#include <cassert>
+#include <sstream>
+#include <stdexcept>
+#include <ref/Class.hpp>
+#include <ref/DescriptorsImpl.ipp>
+#include <ref/utils/BinarySchema.hpp>
+#include <ref/utils/BinarySerializer.hpp>
+#include <ref/utils/BinaryDeserializer.hpp>
+
+using namespace ref;
+
+// Two versions of the same model. Streams written with v1 are read with
+// v2 by renaming the namespace in the stream.
+namespace v1
+{
+    struct Person;
+
+    struct Name : String {};
+    struct Price : Int32 {};
+    struct Tags : Feature<std::vector<std::string> > {};
+    struct Owner : Feature<std::shared_ptr<Person> > {};
+    struct Removed : Feature<std::map<std::string, int> > {};
+    struct Level : UInt8 {};
+
+    struct Person : Class<Person, Features<Name> >
+    {
+    };
+
+    struct Admin : Class<Admin, Features<Level>, Person>
+    {
+    };
+
+    struct Item : Class<Item, Features<Name, Price, Tags, Owner, Removed> >
+    {
+    };
+}  // namespace v1
+
+namespace v2
+{
+    struct Person;
+
+    struct Name : String {};
+    struct Price : Feature<double> {};
+    struct Tags : Feature<std::vector<std::string> > {};
+    struct Owner : Feature<std::shared_ptr<Person> > {};
+    struct Added : Int32 {};
+
+    struct Person : Class<Person, Features<Name> >
+    {
+    };
+
+    struct Item : Class<Item, Features<Name, Price, Tags, Owner, Added> >
+    {
+    };
+}  // namespace v2
+
+namespace all
+{
+    struct Base;
+
+    struct B : Bool {};
+    struct C : Feature<char> {};
+    struct I8 : Int8 {};
+    struct U16 : UInt16 {};
+    struct I64 : Int64 {};
+    struct F : Feature<float> {};
+    struct D : Feature<double> {};
+    struct S : String {};
+    struct Range : Feature<std::pair<int, std::string> > {};
+    struct Counts : Feature<std::map<std::string, std::set<int> > > {};
+    struct Number : Feature<std::shared_ptr<int> > {};
+    struct Children : Feature<std::vector<std::shared_ptr<Base> > > {};
+    struct Parent : Feature<std::weak_ptr<Base> > {};
+    struct Leaf : Feature<v1::Person> {};
+
+    struct Base : Class<Base, Features<S, Parent> >
+    {
+    };
+
+    struct Derived : Class<Derived, Features<D, Leaf>, Base>
+    {
+    };
+
+    struct Root
+        : Class<Root, Features<B, C, I8, U16, I64, F, D, S, Range, Counts,
+                               Number, Children> >
+    {
+    };
+}  // namespace all
+
+namespace
+{
+    std::string rename(std::string data)
+    {
+        for (std::size_t pos = data.find("v1::"); pos != std::string::npos;
+             pos = data.find("v1::", pos))
+        {
+            data[pos + 1] = '2';
+        }
+        return data;
+    }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    // Primitive kinds
+    {
+        typedef PrimitiveTypeDescriptor P;
+
+        assert(TypeDescriptor::getDescriptor<bool>()->as<P>()
+                   ->getPrimitiveKind() == P::kBool);
+        assert(TypeDescriptor::getDescriptor<char>()->as<P>()
+                   ->getPrimitiveKind() == P::kChar);
+        assert(TypeDescriptor::getDescriptor<unsigned char>()->as<P>()
+                   ->getPrimitiveKind() == P::kUInt8);
+        assert(TypeDescriptor::getDescriptor<short>()->as<P>()
+                   ->getPrimitiveKind() == P::kInt16);
+        assert(TypeDescriptor::getDescriptor<long long>()->as<P>()
+                   ->getPrimitiveKind() == P::kInt64);
+        assert(TypeDescriptor::getDescriptor<float>()->as<P>()
+                   ->getPrimitiveKind() == P::kFloat);
+        assert(TypeDescriptor::getDescriptor<std::string>()->as<P>()
+                   ->getPrimitiveKind() == P::kString);
+    }
+
+    // Schema
+    {
+        const ClassSchema schema(v1::Item::getClassDescriptorInstance());
+        assert(schema.fqn == "v1::Item");
+        assert(schema.fields.size() == 5);
+        assert(schema.fields[1].name == "Price");
+        assert(schema.fields[1].signature == "i4");
+        assert(schema.fields[2].signature == "Ls");
+        assert(schema.fields[3].signature == "HCv1::Person;");
+        assert(schema.fields[4].signature == "Msi4");
+
+        assert(schema.fingerprint ==
+               ClassSchema(v1::Item::getClassDescriptorInstance()).fingerprint);
+        assert(schema.fingerprint !=
+               ClassSchema(v2::Item::getClassDescriptorInstance()).fingerprint);
+        assert(ClassSchema(v1::Person::getClassDescriptorInstance())
+                   .fingerprint ==
+               ClassSchema(v2::Person::getClassDescriptorInstance())
+                   .fingerprint);
+    }
+
+    // Round trip
+    {
+        using namespace all;
+
+        Root root;
+        root.set<B>(true);
+        root.set<C>('c');
+        root.set<I8>(-8);
+        root.set<U16>(16);
+        root.set<I64>(-(1ll << 40));
+        root.set<F>(1.5f);
+        root.set<D>(0.1);
+        root.set<S>("root");
+        root.set<Range>(std::make_pair(-1, std::string("one")));
+        root.set<Counts>(std::map<std::string, std::set<int> >{
+            {"a", {1, 2}}, {"b", {}}});
+        root.set<Number>(std::make_shared<int>(42));
+
+        auto base = std::make_shared<Base>();
+        base->set<S>("base");
+        auto derived = std::make_shared<Derived>();
+        derived->set<S>("derived");
+        derived->set<D>(2.5);
+        derived->set<Parent>(base);
+        v1::Person leaf;
+        leaf.set<v1::Name>("leaf");
+        derived->set<Leaf>(leaf);
+        root.set<Children>(
+            std::vector<std::shared_ptr<Base> >{base, nullptr, derived});
+
+        std::ostringstream os;
+        BinarySerializer serializer(os);
+        serializer.serialize(&root);
+        const std::size_t first = os.str().size();
+        serializer.serialize(&root);
+        const std::size_t second = os.str().size() - first;
+
+        // Classes are described only once
+        assert(second < first);
+
+        std::istringstream is(os.str());
+        BinaryDeserializer deserializer(is);
+
+        for (int i = 0; i < 2; i++)
+        {
+            Holder h = deserializer.next();
+            assert(h.isValid());
+            assert(h.descriptor() == Root::getClassDescriptorInstance());
+
+            Root *res = h.get<Root>();
+            assert(res->get<B>());
+            assert(res->get<C>() == 'c');
+            assert(res->get<I8>() == -8);
+            assert(res->get<U16>() == 16);
+            assert(res->get<I64>() == -(1ll << 40));
+            assert(res->get<F>() == 1.5f);
+            assert(res->get<D>() == 0.1);
+            assert(res->get<S>() == "root");
+            assert(res->get<Range>() == root.get<Range>());
+            assert(res->get<Counts>() == root.get<Counts>());
+            assert(*res->get<Number>() == 42);
+
+            const auto &children = res->get<Children>();
+            assert(children.size() == 3);
+            assert(children[0]->get<S>() == "base");
+            assert(!children[1]);
+
+            auto d = std::dynamic_pointer_cast<Derived>(children[2]);
+            assert(d);
+            assert(d->get<S>() == "derived");
+            assert(d->get<D>() == 2.5);
+            assert(d->get<Parent>().expired());
+            assert(d->get<Leaf>().get<v1::Name>() == "leaf");
+        }
+
+        assert(!deserializer.next().isValid());
+    }
+
+    // Schema evolution
+    {
+        v1::Item item;
+        item.set<v1::Name>("item");
+        item.set<v1::Price>(10);
+        item.set<v1::Tags>(std::vector<std::string>{"x", "y"});
+        item.set<v1::Removed>(std::map<std::string, int>{{"r", 1}});
+
+        auto owner = std::make_shared<v1::Person>();
+        owner->set<v1::Name>("owner");
+        item.set<v1::Owner>(owner);
+
+        std::ostringstream os;
+        BinarySerializer serializer(os);
+        serializer.serialize(&item);
+
+        // Classes unknown to the reader are skipped
+        auto admin = std::make_shared<v1::Admin>();
+        admin->set<v1::Name>("admin");
+        item.set<v1::Owner>(admin);
+        serializer.serialize(&item);
+
+        std::istringstream is(rename(os.str()));
+        BinaryDeserializer deserializer(is);
+
+        v2::Item res;
+        res.set<v2::Price>(0.5);
+        res.set<v2::Added>(3);
+
+        assert(deserializer.next(&res));
+        assert(res.get<v2::Name>() == "item");
+        assert(res.get<v2::Tags>() == item.get<v1::Tags>());
+        assert(res.get<v2::Owner>()->get<v2::Name>() == "owner");
+
+        // Not in the stream or with a different type: reset to the
+        // value of a default instance
+        assert(res.get<v2::Price>() == 0);
+        assert(res.get<v2::Added>() == 0);
+
+        Holder h = deserializer.next();
+        assert(h.isValid());
+        assert(h.get<v2::Item>()->get<v2::Name>() == "item");
+        assert(!h.get<v2::Item>()->get<v2::Owner>());
+
+        assert(!deserializer.next(&res));
+
+        // Nothing is kept from the previous record either
+        std::istringstream again(rename(os.str()));
+        BinaryDeserializer other(again);
+
+        assert(other.next(&res));
+        res.set<v2::Price>(2.5);
+        res.set<v2::Added>(7);
+
+        assert(other.next(&res));
+        assert(res.get<v2::Name>() == "item");
+        assert(!res.get<v2::Owner>());
+        assert(res.get<v2::Price>() == 0 && res.get<v2::Added>() == 0);
+    }
+
+    // Malformed streams
+    {
+        v1::Person person;
+        person.set<v1::Name>("person");
+
+        std::ostringstream os;
+        BinarySerializer(os).serialize(&person);
+        const std::string data = os.str();
+
+        const std::string streams[] = {"XXXX", data.substr(0, data.size() - 1),
+                                       data.substr(0, 7)};
+
+        for (const auto &stream : streams)
+        {
+            std::istringstream is(stream);
+            bool thrown = false;
+            try
+            {
+                BinaryDeserializer(is).next();
+            }
+            catch (const std::runtime_error &)
+            {
+                thrown = true;
+            }
+            assert(thrown);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include <cassert>
+#include <sstream>
+#include <stdexcept>
+#include <ref/Class.hpp>
+#include <ref/DescriptorsImpl.ipp>
+#include <ref/utils/BinarySerializer.hpp>
+#include <ref/utils/ColumnarReader.hpp>
+#include <ref/utils/ColumnarWriter.hpp>
+
+using namespace ref;
+
+namespace model
+{
+    struct Id : UInt64 {};
+    struct Name : String {};
+    struct Department : Feature<InternedString> {};
+    struct Age : Int16 {};
+    struct Delta : Int32 {};
+    struct Active : Bool {};
+    struct Salary : Feature<double> {};
+    struct Skills : Feature<std::vector<std::string> > {};
+
+    struct Employee
+        : Class<Employee, Features<Id, Name, Department, Age, Delta, Active,
+                                   Salary, Skills> >
+    {
+    };
+
+    // Another version of Employee, with fewer features
+    struct OtherEmployee
+        : Class<OtherEmployee, Features<Id, Department, Active> >
+    {
+    };
+}  // namespace model
+
+using namespace model;
+
+namespace
+{
+    const char * departments[] = {"Sales", "Engineering", "Support"};
+
+    void fill(Employee& e, std::size_t i)
+    {
+        e.set<Id>(1000000 + i);
+        e.set<Name>("employee " + std::to_string(i));
+        e.set<Department>(InternedString(departments[i % 3]));
+        e.set<Age>(static_cast<std::int16_t>(20 + i % 40));
+        e.set<Delta>(static_cast<std::int32_t>(i % 7) - 3);
+        e.set<Active>(i % 100 < 90);
+        e.set<Salary>(1000.5 * (i % 10));
+        e.set<Skills>(i % 5 ? std::vector<std::string>()
+                            : std::vector<std::string>{"c++", "sql"});
+    }
+
+    Employee& get(Holder h)
+    {
+        return static_cast<Employee&>(
+            *Employee::getClassDescriptorInstance()->get(h));
+    }
+
+    bool equal(Employee& a, Employee& b)
+    {
+        return a.get<Id>() == b.get<Id>() && a.get<Name>() == b.get<Name>() &&
+               a.get<Department>() == b.get<Department>() &&
+               a.get<Age>() == b.get<Age>() &&
+               a.get<Delta>() == b.get<Delta>() &&
+               a.get<Active>() == b.get<Active>() &&
+               a.get<Salary>() == b.get<Salary>() &&
+               a.get<Skills>() == b.get<Skills>();
+    }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    const std::size_t rows = 10000;
+    const ClassDescriptor * employeeDesc =
+        Employee::getClassDescriptorInstance();
+
+    std::ostringstream columnar, binary;
+    {
+        ColumnarWriter writer(columnar, employeeDesc, 1000);
+        BinarySerializer serializer(binary);
+
+        Employee e;
+        for (std::size_t i = 0; i < rows; i++)
+        {
+            fill(e, i);
+            writer.write(&e);
+            serializer.serialize(&e);
+        }
+    }
+
+    const std::string data = columnar.str();
+    assert(data.size() * 3 < binary.str().size());
+
+    // Every row group, in parallel
+    {
+        std::istringstream is(data);
+        ColumnarReader reader(is);
+        assert(reader.getSchema().fqn == employeeDesc->getFqn());
+        assert(reader.getRowCount() == rows);
+        assert(reader.getRowGroupCount() == 10);
+
+        for (unsigned threads : {1u, 4u})
+        {
+            const std::vector<Holder> objects = reader.readAll(threads);
+            assert(objects.size() == rows);
+
+            Employee expected;
+            for (std::size_t i = 0; i < rows; i++)
+            {
+                fill(expected, i);
+                assert(equal(get(objects[i]), expected));
+            }
+        }
+    }
+
+    // A single row group, and only some features
+    {
+        std::istringstream is(data);
+        ColumnarReader reader(is);
+        reader.project({"Id", "Active"});
+
+        std::vector<Holder> objects = reader.readRowGroup(3);
+        assert(objects.size() == 1000);
+
+        for (std::size_t i = 0; i < objects.size(); i++)
+        {
+            Employee& e = get(objects[i]);
+            assert(e.get<Id>() == 1003000 + i);
+            assert(e.get<Active>() == ((3000 + i) % 100 < 90));
+            assert(e.get<Name>().empty() && e.get<Age>() == 0);
+        }
+    }
+
+    // Another class, mapping features by name
+    {
+        std::istringstream is(data);
+        ColumnarReader reader(is,
+                              OtherEmployee::getClassDescriptorInstance());
+
+        const std::vector<Holder> objects = reader.readAll();
+        const ClassDescriptor * otherDesc =
+            OtherEmployee::getClassDescriptorInstance();
+        auto& last =
+            static_cast<OtherEmployee&>(*otherDesc->get(objects.back()));
+        assert(last.get<Id>() == 1000000 + rows - 1);
+        assert(last.get<Department>() ==
+               InternedString(departments[(rows - 1) % 3]));
+    }
+
+    // Malformed files
+    {
+        std::istringstream is(data.substr(0, data.size() - 1));
+        bool thrown = false;
+        try
+        {
+            ColumnarReader reader(is);
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    return 0;
+}
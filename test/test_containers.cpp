@@ -0,0 +1,265 @@
+#include <cassert>
+#include <sstream>
+#include <ref/Class.hpp>
+#include <ref/DescriptorsImpl.ipp>
+#include <ref/utils/BinarySerializer.hpp>
+#include <ref/utils/BinaryDeserializer.hpp>
+#include <ref/utils/JsonSerializer.hpp>
+#include <ref/utils/JsonRecordReader.hpp>
+#include <ref/utils/XmlSerializer.hpp>
+#include <ref/utils/XmlDeserializer.hpp>
+
+using namespace ref;
+
+namespace model
+{
+    struct X : Int32 {};
+    struct Y : Int32 {};
+
+    // Optional values hold their object, so its class must be complete
+    struct Point : Class<Point, Features<X, Y> >
+    {
+    };
+
+    struct Scores : Feature<std::unordered_map<std::string, int> > {};
+    struct Tags : Feature<std::unordered_set<std::string> > {};
+    struct History : Feature<std::deque<double> > {};
+    struct Position : Feature<std::array<int, 3> > {};
+    struct Nickname : Feature<std::optional<std::string> > {};
+    struct Origin : Feature<std::optional<Point> > {};
+
+    struct Player : Class<Player, Features<Scores, Tags, History, Position,
+                                           Nickname, Origin> >
+    {
+    };
+
+    struct Track : Class<Track, Features<Scores, Tags, History, Position> >
+    {
+    };
+
+    typedef boost::container::small_vector<int, 4> SmallInts;
+    typedef boost::container::static_vector<int, 2> StaticInts;
+
+    struct Samples : Feature<SmallInts> {};
+    struct Slots : Feature<StaticInts> {};
+
+    struct Sample : Class<Sample, Features<Samples, Slots> >
+    {
+    };
+}  // namespace model
+
+using namespace model;
+
+namespace
+{
+    template <typename T>
+    void fill(T& obj)
+    {
+        obj.template set<Scores>(
+            std::unordered_map<std::string, int>{{"a", 1}, {"b", 2}});
+        obj.template set<Tags>(std::unordered_set<std::string>{"x", "y"});
+        obj.template set<History>(std::deque<double>{0.5, 1.5});
+        obj.template set<Position>(std::array<int, 3>{{1, 2, 3}});
+    }
+
+    template <typename T>
+    bool equal(const T& a, const T& b)
+    {
+        return a.template get<Scores>() == b.template get<Scores>() &&
+               a.template get<Tags>() == b.template get<Tags>() &&
+               a.template get<History>() == b.template get<History>() &&
+               a.template get<Position>() == b.template get<Position>();
+    }
+
+    Player makePlayer()
+    {
+        Player player;
+        fill(player);
+        player.set<Nickname>(std::string("ace"));
+
+        Point origin;
+        origin.set<X>(4);
+        origin.set<Y>(5);
+        player.set<Origin>(origin);
+        return player;
+    }
+
+    bool equal(const Player& a, const Player& b)
+    {
+        return equal<Player>(a, b) && a.get<Nickname>() == b.get<Nickname>() &&
+               a.get<Origin>().has_value() == b.get<Origin>().has_value() &&
+               (!a.get<Origin>() ||
+                (a.get<Origin>()->get<X>() == b.get<Origin>()->get<X>() &&
+                 a.get<Origin>()->get<Y>() == b.get<Origin>()->get<Y>()));
+    }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    // Descriptors
+    {
+        typedef std::unordered_map<std::string, int> Map;
+        typedef std::array<int, 3> Array;
+        typedef std::optional<std::string> Optional;
+
+        assert(TypeDescriptor::getDescriptor<Map>()->getKind() ==
+               TypeDescriptor::kMap);
+        assert(TypeDescriptor::getDescriptor<std::unordered_set<int> >()
+                   ->getKind() == TypeDescriptor::kSet);
+        assert(TypeDescriptor::getDescriptor<std::deque<int> >()->getKind() ==
+               TypeDescriptor::kList);
+
+        // Arrays keep their size
+        auto arrayDesc =
+            TypeDescriptor::getDescriptor<Array>()->as<ListTypeDescriptor>();
+        Array array{{1, 2, 3}};
+        Holder ha(&array, arrayDesc);
+        arrayDesc->resize(ha, 1);
+        assert(arrayDesc->getSize(ha) == 3);
+        assert(array[0] == 1 && array[1] == 0 && array[2] == 0);
+
+        int values[] = {7, 8, 9, 10};
+        std::vector<Holder> items;
+        for (auto& v : values)
+            items.push_back(Holder(&v, TypeDescriptor::getDescriptor<int>()));
+        arrayDesc->setValue(ha, items);
+        assert((array == Array{{7, 8, 9}}));
+
+        // Optional values are owning pointers
+        auto optDesc = TypeDescriptor::getDescriptor<Optional>()
+                           ->as<PointerTypeDescriptor>();
+        assert(optDesc->getPointerType() == PointerTypeDescriptor::kOptional);
+        assert(optDesc->isOwner());
+
+        Optional opt;
+        Holder ho(&opt, optDesc);
+        assert(optDesc->isNull(ho));
+        assert(!optDesc->emplace(ho, TypeDescriptor::getDescriptor<int>())
+                    .isValid());
+
+        Holder value = optDesc->emplace(ho, nullptr);
+        assert(value.get<std::string>() == &*opt);
+        *value.get<std::string>() = "value";
+        assert(!optDesc->isNull(ho));
+        assert(*optDesc->dereference(ho).get<std::string>() == "value");
+
+        Holder copy = optDesc->create();
+        optDesc->copy(ho, copy);
+        assert(*copy.get<Optional>() == opt);
+
+        // Hashed containers are filled through their descriptors too
+        auto mapDesc = TypeDescriptor::getDescriptor<Map>()
+                           ->as<MapTypeDescriptor>();
+        Map map{{"a", 1}, {"b", 2}, {"c", 3}};
+        Map res;
+        mapDesc->setValue(Holder(&res, mapDesc),
+                          mapDesc->getValue(Holder(&map, mapDesc)));
+        assert(res == map);
+    }
+
+    // XML
+    {
+        Player player = makePlayer();
+
+        std::ostringstream os;
+        XmlSerializer(os).serialize(&player);
+
+        std::istringstream is(os.str());
+        Player res;
+        XmlDeserializer(is).deserialize(&res);
+        assert(equal(res, player));
+    }
+
+    // Binary
+    {
+        Player player = makePlayer();
+        Player empty;
+
+        std::ostringstream os;
+        BinarySerializer serializer(os);
+        serializer.serialize(&player);
+        serializer.serialize(&empty);
+
+        std::istringstream is(os.str());
+        BinaryDeserializer deserializer(is);
+
+        Player res;
+        assert(deserializer.next(&res));
+        assert(equal(res, player));
+
+        // Optional values are reset to empty
+        assert(deserializer.next(&res));
+        assert(!res.get<Nickname>() && !res.get<Origin>());
+        assert(equal(res, empty));
+    }
+
+    // JSON
+    {
+        Track track;
+        fill(track);
+
+        std::ostringstream os;
+        JsonSerializer(os).serialize(&track);
+
+        // Arrays drop the elements they have no room for
+        std::string data = os.str() + "{\"position\": [4, 5, 6, 7]}";
+
+        std::istringstream is(data);
+        JsonRecordReader reader(is);
+
+        Track res;
+        assert(reader.next(&res));
+        assert(equal(res, track));
+
+        assert(reader.next(&res));
+        assert((res.get<Position>() == std::array<int, 3>{{4, 5, 6}}));
+        assert(res.get<Scores>().empty() && res.get<History>().empty());
+    }
+
+    // Inline vectors
+    {
+        assert(TypeDescriptor::getDescriptor<SmallInts>()->getKind() ==
+               TypeDescriptor::kList);
+
+        auto staticDesc = TypeDescriptor::getDescriptor<StaticInts>()
+                              ->as<ListTypeDescriptor>();
+        StaticInts slots;
+        staticDesc->resize(Holder(&slots, staticDesc), 5);
+        assert(slots.size() == 2);
+
+        Sample sample;
+        sample.set<Samples>(SmallInts{1, 2, 3});
+        sample.set<Slots>(StaticInts{4, 5});
+
+        std::ostringstream bos;
+        BinarySerializer(bos).serialize(&sample);
+
+        std::istringstream bis(bos.str());
+        Sample bres;
+        assert(BinaryDeserializer(bis).next(&bres));
+        assert(bres.get<Samples>() == sample.get<Samples>());
+        assert(bres.get<Slots>() == sample.get<Slots>());
+
+        // Elements stay inline
+        assert(bres.get<Samples>().capacity() == 4);
+
+        std::ostringstream os;
+        XmlSerializer(os).serialize(&sample);
+
+        std::istringstream is(os.str());
+        Sample res;
+        XmlDeserializer(is).deserialize(&res);
+        assert(res.get<Samples>() == sample.get<Samples>());
+        assert(res.get<Slots>() == sample.get<Slots>());
+
+        // Static vectors drop the elements past their capacity
+        std::istringstream js("{\"samples\": [1, 2, 3, 4, 5],"
+                              " \"slots\": [6, 7, 8]}");
+        Sample jres;
+        assert(JsonRecordReader(js).next(&jres));
+        assert((jres.get<Samples>() == SmallInts{1, 2, 3, 4, 5}));
+        assert((jres.get<Slots>() == StaticInts{6, 7}));
+    }
+
+    return 0;
+}
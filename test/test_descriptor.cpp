@@ -1,10 +1,91 @@
 #include <iostream>
 #include <ref/Class.hpp>
 #include <ref/DescriptorsImpl.ipp>
+#include <ref/utils/Initializer.hpp>
 #include <map>
 
 using namespace ref;
 
+namespace test
+{
+    struct MyTestClass : Class<MyTestClass>
+    {
+    };
+}  // namespace test
+
+namespace
+{
+    // The kind of a descriptor, as found by visitType
+    struct KindOf
+    {
+        TypeDescriptor::Kind kind;
+
+        void operator()(const ClassDescriptor *)
+        {
+            kind = TypeDescriptor::kClass;
+        }
+        void operator()(const PrimitiveTypeDescriptor *)
+        {
+            kind = TypeDescriptor::kPrimitive;
+        }
+        void operator()(const ListTypeDescriptor *)
+        {
+            kind = TypeDescriptor::kList;
+        }
+        void operator()(const SetTypeDescriptor *)
+        {
+            kind = TypeDescriptor::kSet;
+        }
+        void operator()(const MapTypeDescriptor *)
+        {
+            kind = TypeDescriptor::kMap;
+        }
+        void operator()(const PairTypeDescriptor *)
+        {
+            kind = TypeDescriptor::kPair;
+        }
+        void operator()(const PointerTypeDescriptor *)
+        {
+            kind = TypeDescriptor::kPointer;
+        }
+        void operator()(const UnsupportedTypeDescriptor *)
+        {
+            kind = TypeDescriptor::kUnsupported;
+        }
+    };
+
+    // Counts the visits of each kind
+    struct CountingVisitor : TypeVisitor
+    {
+        int classes = 0, others = 0;
+
+        void visit(const ClassDescriptor *) override { ++classes; }
+        void visit(const PrimitiveTypeDescriptor *) override { ++others; }
+        void visit(const ListTypeDescriptor *) override { ++others; }
+        void visit(const SetTypeDescriptor *) override { ++others; }
+        void visit(const MapTypeDescriptor *) override { ++others; }
+        void visit(const PairTypeDescriptor *) override { ++others; }
+        void visit(const PointerTypeDescriptor *) override { ++others; }
+        void visit(const UnsupportedTypeDescriptor *) override { ++others; }
+    };
+
+    template < typename T >
+    TypeDescriptor::Kind kindOf()
+    {
+        KindOf visitor{TypeDescriptor::kUnsupported};
+        visitType(TypeDescriptor::getDescriptor<T>(), visitor);
+        return visitor.kind;
+    }
+}  // namespace
+
+// Names are computed at compile time
+static_assert(detail::TypeName<test::MyTestClass>::fqn == "test::MyTestClass",
+              "Invalid FQN");
+static_assert(detail::TypeName<test::MyTestClass>::name == "MyTestClass",
+              "Invalid name");
+static_assert(detail::TypeName<test::MyTestClass>::xmltag == "my-test-class",
+              "Invalid XML tag");
+
 int main(int argc, char **argv)
 {
     const TypeDescriptor *stringTypeDesc =
@@ -78,5 +159,52 @@ int main(int argc, char **argv)
         assert(ptrDesc->getPointedTypeDescriptor() == stringTypeDesc);
     }
 
+    // Names
+    {
+        const TypeDescriptor *typeDesc =
+            TypeDescriptor::getDescriptor<test::MyTestClass>();
+        assert(typeDesc->getFqn() == "test::MyTestClass");
+        assert(typeDesc->getName() == "MyTestClass");
+        assert(typeDesc->getXmlTag() == "my-test-class");
+        assert(TypeDescriptor::getDescriptor<uint32_t>()->getName() ==
+               "unsigned int");
+    }
+
+    // Eager initialization
+    {
+        typedef std::map<std::string, std::vector<test::MyTestClass *> >
+            ComplexType;
+
+        // map, pair, string, vector, pointer, class and ModelClass
+        assert(initializeDescriptors(
+                   TypeDescriptor::getDescriptor<ComplexType>()) == 7);
+    }
+
+    // Visitors
+    {
+        assert(kindOf<test::MyTestClass>() == TypeDescriptor::kClass);
+        assert(kindOf<std::string>() == TypeDescriptor::kPrimitive);
+        assert(kindOf<std::vector<int> >() == TypeDescriptor::kList);
+        assert(kindOf<std::set<int> >() == TypeDescriptor::kSet);
+        assert((kindOf<std::map<int, int> >() == TypeDescriptor::kMap));
+        assert((kindOf<std::pair<int, int> >() == TypeDescriptor::kPair));
+        assert(kindOf<int *>() == TypeDescriptor::kPointer);
+
+        const ClassDescriptor *classDesc =
+            test::MyTestClass::getClassDescriptorInstance();
+
+        // Known statically, without a call to accept
+        const ClassDescriptor *visited = nullptr;
+        visitType(classDesc, [&](const ClassDescriptor *desc) {
+            visited = desc;
+        });
+        assert(visited == classDesc);
+
+        CountingVisitor counter;
+        classDesc->accept(counter);
+        stringTypeDesc->accept(counter);
+        assert(counter.classes == 1 && counter.others == 1);
+    }
+
     return 0;
 }
@@ -17,6 +17,28 @@ struct MySubClass : Class<MySubClass, Features<MyFeature3>, MyTestClass>
 {
 };
 
+struct MyFeature4 : Int32 {};
+struct MyFeature5 : Bool  {};
+
+struct MyPodClass : Class<MyPodClass, Features<MyFeature3, MyFeature4> >
+{
+};
+
+struct MyPodSubClass : Class<MyPodSubClass, Features<MyFeature5>, MyPodClass>
+{
+};
+
+static_assert(std::is_same<MySubClass::all_features_type,
+                           Features<MyFeature1, MyFeature2, MyFeature3> >::value,
+              "Inherited features come first");
+static_assert(std::is_same<detail::FeatureDefinedIn<MySubClass,
+                                                     MyFeature2>::type,
+                           MyTestClass>::value,
+              "Feature defined in the parent class");
+static_assert(!detail::IsTriviallyCopyableClass<MySubClass>::value &&
+                  detail::IsTriviallyCopyableClass<MyPodSubClass>::value,
+              "Trivially copyable features");
+
 int main(int argc, char **argv)
 {
     MyTestClass mtc;
@@ -62,6 +84,36 @@ int main(int argc, char **argv)
         assert(values[1].second.get<std::string>() == &mtc.get<MyFeature2>());
     }
 
+    // Feature visitation
+    {
+        MySubClass sub;
+        sub.set<MyFeature2>("b");
+        sub.set<MyFeature3>(3);
+
+        const ClassDescriptor *subClassDesc = sub.getClassDescriptor();
+        const auto features = subClassDesc->getAllFeatureDescriptors();
+
+        std::size_t count = 0;
+        subClassDesc->forEachFeature(
+            &sub, [&](const FeatureDescriptor *feature, Holder value) {
+                assert(feature == features[count++]);
+                assert(value.descriptor() == feature->getTypeDescriptor());
+                assert(value.get<char>() == feature->getValue(&sub).get<char>());
+            });
+        assert(count == 3);
+
+        // Typed, resolved at compile time
+        std::string text;
+        sub.forEachFeature([&](const FeatureDescriptor *feature, auto& value) {
+            if constexpr (std::is_same<std::decay_t<decltype(value)>,
+                                       std::string>::value)
+                text += value;
+            else
+                value *= 2;
+        });
+        assert(text == "b" && sub.get<MyFeature3>() == 6);
+    }
+
     {
         const ClassDescriptor *subClassDesc =
             MySubClass::getClassDescriptorInstance();
@@ -71,5 +123,52 @@ int main(int argc, char **argv)
         assert(subClassDesc->getFeatureDescriptors().size() == 1);
     }
 
+    // Offsets
+    {
+        MySubClass sub;
+        const char *base =
+            reinterpret_cast<const char *>(static_cast<ModelClass *>(&sub));
+        const auto features =
+            MySubClass::getClassDescriptorInstance()->getAllFeatureDescriptors();
+
+        for (auto feature: features)
+        {
+            Holder h = feature->getValue(&sub);
+            assert(base + feature->getOffset() == h.get<char>());
+        }
+    }
+
+    // Copy
+    {
+        const ClassDescriptor *subClassDesc =
+            MySubClass::getClassDescriptorInstance();
+
+        MySubClass src, dst;
+        src.set<MyFeature1>("a long enough string to be heap allocated");
+        src.set<MyFeature2>("b");
+        src.set<MyFeature3>(-3);
+
+        subClassDesc->copy(Holder(static_cast<ModelClass *>(&src), subClassDesc),
+                           Holder(static_cast<ModelClass *>(&dst), subClassDesc));
+        assert(dst.get<MyFeature1>() == src.get<MyFeature1>());
+        assert(dst.get<MyFeature2>() == "b");
+        assert(dst.get<MyFeature3>() == -3);
+
+        const ClassDescriptor *podDesc =
+            MyPodClass::getClassDescriptorInstance();
+
+        MyPodSubClass podSrc, podDst;
+        podSrc.set<MyFeature3>(1);
+        podSrc.set<MyFeature4>(2);
+        podSrc.set<MyFeature5>(true);
+
+        // Uses the descriptor of the dynamic type
+        podDesc->copy(Holder(static_cast<ModelClass *>(&podSrc), podDesc),
+                      Holder(static_cast<ModelClass *>(&podDst), podDesc));
+        assert(podDst.get<MyFeature3>() == 1);
+        assert(podDst.get<MyFeature4>() == 2);
+        assert(podDst.get<MyFeature5>());
+    }
+
     return 0;
 }
@@ -0,0 +1,199 @@
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <ref/utils/Index.hpp>
+#include "../examples/company.hpp"
+
+using namespace ref;
+using namespace example;
+
+std::shared_ptr<Employee> employee(const std::string& name)
+{
+    std::shared_ptr<Employee> e(new Employee);
+    e->set<Name>(name);
+    return e;
+}
+
+std::shared_ptr<Department> department(uint32_t number)
+{
+    std::shared_ptr<Department> d(new Department);
+    d->set<Number>(number);
+    return d;
+}
+
+struct Level : Int32 {};
+
+// Class::get returns copies of its values
+struct Gauge : Class<Gauge, Features<Level>, SeqLockModelClass>
+{
+};
+
+struct Counter : FeatureObserver
+{
+    std::atomic<unsigned> count{0};
+
+    void beforeSet(ModelClass*, const FeatureDescriptor*) override {}
+
+    void afterSet(ModelClass*, const FeatureDescriptor*) override
+    {
+        ++count;
+    }
+};
+
+int main(int argc, char **argv)
+{
+    auto companyDesc = Company::getClassDescriptorInstance();
+    auto departmentDesc = Department::getClassDescriptorInstance();
+    auto employeeDesc = Employee::getClassDescriptorInstance();
+
+    Department dept;
+    for (auto name : {"Ann", "Bob", "Carl", "Bob"})
+        dept.get<Employees>().push_back(employee(name));
+
+    // Hash index
+    {
+        HashIndex<Employee, Name> index;
+        assert(index.getKeyFeatureDescriptor() ==
+               employeeDesc->getFeatureDescriptor("Name"));
+
+        index.attach(&dept, departmentDesc->getFeatureDescriptor("Employees"));
+        assert(index.size() == 4);
+        assert(index.find("Bob").size() == 2);
+        assert(index.find("Dana").empty());
+
+        assert(findIndex(&dept,
+                         departmentDesc->getFeatureDescriptor("Employees"),
+                         employeeDesc->getFeatureDescriptor("Name")) ==
+               &index);
+
+        // Maintained through Class::set
+        Employee* carl = dept.get<Employees>()[2].get();
+        carl->set<Name>("Dana");
+        assert(index.find("Carl").empty());
+        assert(index.find("Dana").size() == 1 &&
+               index.find("Dana")[0] == carl);
+
+        // Maintained through reflective setters
+        const FeatureDescriptor* nameDesc =
+            employeeDesc->getFeatureDescriptor("Name");
+        std::string name = "Eve";
+        nameDesc->setValue(carl, Holder(&name, nameDesc->getTypeDescriptor()));
+        assert(carl->get<Name>() == "Eve");
+        assert(index.find("Dana").empty());
+
+        const auto found =
+            index.find(Holder(&name, nameDesc->getTypeDescriptor()));
+        assert(found.size() == 1 && found[0] == carl);
+
+        // Objects out of the collection are ignored
+        Employee other;
+        other.set<Name>("Eve");
+        assert(index.find("Eve").size() == 1);
+
+        // Explicit maintenance
+        auto frank = employee("Frank");
+        dept.get<Employees>().push_back(frank);
+        index.insert(frank.get());
+        assert(index.find("Frank").size() == 1);
+        index.erase(frank.get());
+        assert(index.find("Frank").empty());
+
+        index.rebuild();
+        assert(index.size() == 5);
+    }
+
+    assert(getFeatureObservers().empty());
+
+    // Ordered index
+    {
+        Company company;
+        for (uint32_t number : {40, 10, 30, 20})
+            company.get<Departments>().push_back(department(number));
+
+        OrderedIndex<Department, Number> index;
+        index.attach(&company, companyDesc->getFeatureDescriptor("Departments"));
+
+        const auto range = index.range(15, 30);
+        assert(range.size() == 2);
+        assert(range[0]->get<Number>() == 20);
+        assert(range[1]->get<Number>() == 30);
+
+        company.get<Departments>()[0]->set<Number>(25);
+        assert(index.range(15, 30).size() == 3);
+        assert(index.find(40).empty());
+
+        bool thrown = false;
+        try
+        {
+            index.attach(&company, companyDesc->getFeatureDescriptor("Name"));
+        }
+        catch (const std::invalid_argument&)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    // Observers of a single feature
+    {
+        Counter counter;
+        const FeatureDescriptor *number =
+            departmentDesc->getFeatureDescriptor("Number");
+        addFeatureObserver(&counter, number);
+        assert(getFeatureObservers().size() == 1);
+
+        Department d;
+        d.set<Number>(1);
+        dept.get<Employees>()[0]->set<Name>("Ann");
+        assert(counter.count == 1);
+
+        removeFeatureObserver(&counter);
+        d.set<Number>(2);
+        assert(counter.count == 1 && getFeatureObservers().empty());
+    }
+
+    // Registration while other threads set features
+    {
+        Counter counter;
+        std::atomic<bool> done(false);
+
+        std::thread registering([&] {
+            while (!done)
+            {
+                addFeatureObserver(&counter);
+                removeFeatureObserver(&counter);
+            }
+        });
+
+        Department d;
+        for (uint32_t i = 0; i < 100000; i++)
+            d.set<Number>(i);
+
+        done = true;
+        registering.join();
+        assert(getFeatureObservers().empty());
+    }
+
+    // Classes with a seqlock
+    {
+        Gauge gauges[4];
+        OrderedIndex<Gauge, Level> index;
+        for (int i = 0; i < 4; i++)
+        {
+            gauges[i].set<Level>(i * 10);
+            index.insert(&gauges[i]);
+        }
+
+        assert(index.find(20).size() == 1 && index.find(20)[0] == &gauges[2]);
+        assert(index.range(10, 30).size() == 3);
+
+        // Moved by the observer of the key
+        gauges[0].set<Level>(25);
+        assert(index.find(0).empty() && index.range(20, 30).size() == 3);
+
+        index.erase(&gauges[1]);
+        assert(index.size() == 3);
+    }
+
+    return 0;
+}
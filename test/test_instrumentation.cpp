@@ -0,0 +1,82 @@
+#include <cassert>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <ref/Class.hpp>
+#include <ref/DescriptorsImpl.ipp>
+#include <ref/Instrumentation.hpp>
+#include <ref/utils/InstrumentationReport.hpp>
+
+using namespace ref;
+
+struct Count : Feature<uint16_t> {};
+struct Values : Feature<std::vector<int16_t> > {};
+
+struct Counted : Class<Counted, Features<Count, Values> >
+{
+};
+
+typedef InstrumentationCounters Counters;
+
+int main(int argc, char **argv)
+{
+    static_assert(isInstrumentationEnabled(), "Enabled for this test");
+
+    const ClassDescriptor *classDesc = Counted::getClassDescriptorInstance();
+    const FeatureDescriptor *count = classDesc->getFeatureDescriptor("Count");
+    const FeatureDescriptor *values = classDesc->getFeatureDescriptor("Values");
+    const TypeDescriptor *valuesType = values->getTypeDescriptor();
+    auto countType = count->getTypeDescriptor()->as<PrimitiveTypeDescriptor>();
+
+    resetInstrumentation();
+    assert(getInstrumentationSnapshot().empty());
+
+    Counted obj;
+    obj.set<Values>(std::vector<int16_t>{1, 2, 3});
+
+    // Counters of every thread are aggregated, including exited ones
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++)
+    {
+        threads.emplace_back([&]() {
+            Counted local;
+            for (int j = 0; j < 10; j++)
+                countType->setString(count->getValue(&local), "7");
+        });
+    }
+
+    for (auto &thread : threads)
+        thread.join();
+
+    countType->getString(count->getValue(&obj));
+    valuesType->as<ContainerTypeDescriptor>()->getValue(
+        values->getValue(&obj));
+
+    Counted other;
+    classDesc->copy(Holder(&obj, classDesc), Holder(&other, classDesc));
+
+    InstrumentationSnapshot snapshot = getInstrumentationSnapshot();
+
+    assert(snapshot[count][Counters::kGetValue] == 41);
+    assert(snapshot[countType][Counters::kSetString] == 40);
+    assert(snapshot[countType][Counters::kGetString] == 1);
+    assert(snapshot[countType][Counters::kHolderAllocations] == 0);
+    assert(snapshot[values][Counters::kGetValue] == 1);
+    assert(snapshot[valuesType][Counters::kMaterializations] == 1);
+    assert(snapshot[valuesType][Counters::kMaterializedElements] == 3);
+    assert(snapshot[classDesc][Counters::kCopy] == 1);
+
+    std::ostringstream os;
+    printInstrumentationReport(os, snapshot);
+    const std::string report = os.str();
+
+    assert(report.find("Counted: 43 operations") == 0);
+    assert(report.find("    Count: get value: 41") !=
+           std::string::npos);
+    assert(report.find("Types:") != std::string::npos);
+
+    resetInstrumentation();
+    assert(getInstrumentationSnapshot().empty());
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include <cassert>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+#include <ref/Class.hpp>
+#include <ref/DescriptorsImpl.ipp>
+#include <ref/utils/BinarySerializer.hpp>
+#include <ref/utils/BinaryDeserializer.hpp>
+#include <ref/utils/XmlSerializer.hpp>
+#include <ref/utils/XmlDeserializer.hpp>
+
+using namespace ref;
+
+namespace v1
+{
+    struct Name : String {};
+    struct City : String {};
+
+    struct Employee : Class<Employee, Features<Name, City> >
+    {
+    };
+}  // namespace v1
+
+namespace v2
+{
+    struct Name : String {};
+    struct City : Feature<InternedString> {};
+    struct Roles : Feature<std::set<InternedString> > {};
+
+    struct Employee : Class<Employee, Features<Name, City, Roles> >
+    {
+    };
+
+    // Its XML tag is not shared with v1
+    struct Worker : Class<Worker, Features<City, Roles> >
+    {
+    };
+}  // namespace v2
+
+int main(int argc, char **argv)
+{
+    // Pool
+    {
+        const std::size_t size = StringPool::instance().size();
+
+        InternedString a("Madrid");
+        InternedString b(std::string("Mad") + "rid");
+        InternedString c("Paris");
+
+        assert(a == b && a != c);
+        assert(&a.str() == &b.str());
+        assert(a.hash() == b.hash());
+        assert(std::hash<InternedString>()(a) == a.hash());
+        assert(a < c && !(c < a) && !(a < b));
+        assert(a.str() == "Madrid" && a.size() == 6);
+        assert(StringPool::instance().size() == size + 2);
+
+        // Empty strings are not pooled
+        assert(InternedString() == InternedString(""));
+        assert(InternedString().empty());
+        assert(StringPool::instance().size() == size + 2);
+
+        std::unordered_set<InternedString> set{a, b, c};
+        assert(set.size() == 2);
+    }
+
+    // Concurrent interning
+    {
+        const std::size_t count = 1000;
+        std::vector<std::vector<InternedString> > results(4);
+        std::vector<std::thread> threads;
+
+        for (auto& result : results)
+        {
+            threads.emplace_back([&result]() {
+                for (std::size_t i = 0; i < count; i++)
+                    result.push_back(InternedString("value " +
+                                                    std::to_string(i)));
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        for (std::size_t i = 0; i < count; i++)
+        {
+            for (auto& result : results)
+                assert(result[i] == results[0][i]);
+            assert(results[0][i].str() == "value " + std::to_string(i));
+        }
+    }
+
+    // Descriptor
+    {
+        typedef PrimitiveTypeDescriptor P;
+
+        auto desc = TypeDescriptor::getDescriptor<InternedString>();
+        assert(desc->getKind() == TypeDescriptor::kPrimitive);
+        assert(desc->as<P>()->getPrimitiveKind() == P::kInternedString);
+
+        InternedString value;
+        Holder h(&value, desc);
+        desc->as<P>()->setString(h, "Sales engineer");
+        assert(value == InternedString("Sales engineer"));
+        assert(desc->as<P>()->getString(h) == "Sales engineer");
+
+        Holder copy = desc->create();
+        desc->copy(h, copy);
+        assert(*copy.get<InternedString>() == value);
+    }
+
+    // Serializers
+    {
+        v2::Worker employee;
+        employee.set<v2::City>(InternedString("Lisbon"));
+        employee.set<v2::Roles>(
+            std::set<InternedString>{InternedString("dev"),
+                                     InternedString("ops")});
+
+        std::ostringstream os;
+        XmlSerializer(os).serialize(&employee);
+
+        std::istringstream is(os.str());
+        v2::Worker res;
+        XmlDeserializer(is).deserialize(&res);
+        assert(res.get<v2::City>() == employee.get<v2::City>());
+        assert(res.get<v2::Roles>() == employee.get<v2::Roles>());
+
+        std::ostringstream bos;
+        BinarySerializer(bos).serialize(&employee);
+
+        std::istringstream bis(bos.str());
+        v2::Worker bres;
+        assert(BinaryDeserializer(bis).next(&bres));
+        assert(bres.get<v2::City>() == employee.get<v2::City>());
+        assert(bres.get<v2::Roles>() == employee.get<v2::Roles>());
+    }
+
+    // Strings and interned strings share their binary encoding
+    {
+        v1::Employee employee;
+        employee.set<v1::Name>("Ana");
+        employee.set<v1::City>("Lisbon");
+
+        std::ostringstream os;
+        BinarySerializer(os).serialize(&employee);
+
+        std::string data = os.str();
+        for (std::size_t pos = data.find("v1::"); pos != std::string::npos;
+             pos = data.find("v1::", pos))
+        {
+            data[pos + 1] = '2';
+        }
+
+        std::istringstream is(data);
+        v2::Employee res;
+        assert(BinaryDeserializer(is).next(&res));
+        assert(res.get<v2::Name>() == "Ana");
+        assert(res.get<v2::City>() == InternedString("Lisbon"));
+    }
+
+    return 0;
+}
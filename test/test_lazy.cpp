@@ -0,0 +1,208 @@
+#include <cassert>
+#include <sstream>
+#include <ref/Class.hpp>
+#include <ref/DescriptorsImpl.ipp>
+#include <ref/utils/BinarySerializer.hpp>
+#include <ref/utils/BinaryDeserializer.hpp>
+#include <ref/utils/JsonSerializer.hpp>
+
+using namespace ref;
+
+namespace model
+{
+    struct Leaf;
+
+    struct Name : String {};
+    struct Count : Int32 {};
+    struct Values : Feature<std::vector<int> > {};
+    struct Child : Feature<std::shared_ptr<Leaf> > {};
+    struct Leaves : Feature<std::vector<Leaf> > {};
+    struct Scores : Feature<std::map<std::string, double> > {};
+
+    struct Leaf : Class<Leaf, Features<Name, Values>, LazyModelClass>
+    {
+    };
+
+    struct Record
+        : Class<Record, Features<Name, Count, Values, Child, Leaves, Scores>,
+                LazyModelClass>
+    {
+    };
+
+    struct Derived : Class<Derived, Features<Count>, Leaf>
+    {
+    };
+}  // namespace model
+
+using namespace model;
+
+namespace
+{
+    Record makeRecord(int i)
+    {
+        Record record;
+        record.set<Name>("record " + std::to_string(i));
+        record.set<Count>(i);
+        record.set<Values>(std::vector<int>{i, i + 1, i + 2});
+
+        auto child = std::make_shared<Leaf>();
+        child->set<Name>("child");
+        child->set<Values>(std::vector<int>(5, i));
+        record.set<Child>(child);
+
+        std::vector<Leaf> leaves(2);
+        leaves[1].set<Name>("leaf");
+        record.set<Leaves>(leaves);
+
+        record.set<Scores>(std::map<std::string, double>{{"a", 0.5}});
+        return record;
+    }
+
+    std::string toJson(ModelClass * obj)
+    {
+        std::ostringstream os;
+        JsonSerializer(os).serialize(obj);
+        return os.str();
+    }
+
+    std::string write(int count)
+    {
+        std::ostringstream os;
+        BinarySerializer serializer(os);
+
+        for (int i = 0; i < count; i++)
+        {
+            Record record = makeRecord(i);
+            serializer.serialize(&record);
+        }
+        return os.str();
+    }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    // Features are decoded on first access
+    {
+        std::istringstream is(write(1));
+        BinaryDeserializer deserializer(is);
+        deserializer.setLazy(true);
+
+        Record res;
+        assert(deserializer.next(&res));
+        assert(!res.isMaterialized());
+
+        assert(res.get<Count>() == 0);
+        assert(!res.isMaterialized());
+
+        // Through descriptors too
+        auto feature = res.getClassDescriptor()->getFeatureDescriptor("Name");
+        assert(*feature->getValue(&res).get<std::string>() == "record 0");
+
+        // Nested objects are decoded on their own first access
+        const Leaf& child = *res.get<Child>();
+        assert(!child.isMaterialized());
+        assert(child.get<Values>().size() == 5);
+        assert(child.get<Name>() == "child");
+        assert(child.isMaterialized());
+
+        const Leaf& leaf = res.get<Leaves>()[1];
+        assert(!leaf.isMaterialized());
+        assert(leaf.get<Name>() == "leaf");
+
+        // Set values are never overwritten by pending ones
+        res.set<Values>(std::vector<int>{42});
+        assert(res.get<Values>().size() == 1);
+
+        assert(res.get<Scores>().at("a") == 0.5);
+        assert(res.isMaterialized());
+    }
+
+    // Lazy objects are equal to eagerly read ones, and outlive the
+    // deserializer and the records that follow theirs
+    {
+        const std::string data = write(3);
+        std::vector<Holder> lazy;
+
+        {
+            std::istringstream is(data);
+            BinaryDeserializer deserializer(is);
+            deserializer.setLazy(true);
+
+            for (Holder h = deserializer.next(); h.isValid();
+                 h = deserializer.next())
+            {
+                lazy.push_back(h);
+            }
+        }
+
+        assert(lazy.size() == 3);
+
+        for (int i = 2; i >= 0; i--)
+        {
+            Record expected = makeRecord(i);
+            Record * obj = lazy[i].get<Record>();
+            assert(!obj->isMaterialized());
+            assert(toJson(obj) == toJson(&expected));
+        }
+    }
+
+    // Copies decode the source
+    {
+        std::istringstream is(write(1));
+        BinaryDeserializer deserializer(is);
+        deserializer.setLazy(true);
+
+        Record res;
+        assert(deserializer.next(&res));
+
+        Record copy(res);
+        assert(res.isMaterialized());
+        assert(copy.get<Count>() == 0);
+        assert(copy.get<Leaves>().size() == 2);
+
+        std::istringstream is2(write(2));
+        BinaryDeserializer deserializer2(is2);
+        deserializer2.setLazy(true);
+
+        assert(deserializer2.next(&res));
+        assert(deserializer2.next(&res));
+        assert(!res.isMaterialized());
+
+        // Through the descriptor
+        const ClassDescriptor * classDesc = res.getClassDescriptor();
+        Record other;
+        classDesc->copy(Holder(&res, classDesc), Holder(&other, classDesc));
+        assert(res.isMaterialized());
+        assert(other.isMaterialized());
+        assert(other.get<Count>() == 1);
+        assert(other.get<Child>()->get<Values>()[0] == 1);
+
+        // Pending values of a previous record are replaced
+        Record expected = makeRecord(1);
+        assert(toJson(&res) == toJson(&expected));
+    }
+
+    // Inherited features of lazy classes
+    {
+        Derived derived;
+        derived.set<Name>("derived");
+        derived.set<Count>(7);
+
+        std::ostringstream os;
+        BinarySerializer(os).serialize(&derived);
+
+        std::istringstream is(os.str());
+        BinaryDeserializer deserializer(is);
+        deserializer.setLazy(true);
+
+        Holder h = deserializer.next();
+        Derived * res = h.get<Derived>();
+        assert(!res->isMaterialized());
+        assert(res->get<Count>() == 7);
+        assert(res->get<Name>() == "derived");
+        assert(res->get<Values>().empty());
+        assert(res->isMaterialized());
+    }
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cassert>
+#include <ref/Class.hpp>
+#include <ref/DescriptorsImpl.ipp>
+#include <ref/utils/LeakFinder.hpp>
+#include <ref/utils/StructuralContext.hpp>
+
+using namespace ref;
+
+namespace model
+{
+    struct Person;
+
+    struct Name : String {};
+    struct Scores : Feature<std::vector<int> > {};
+    struct Mentor : Feature<std::shared_ptr<Person> > {};
+    struct Manager : Feature<std::weak_ptr<Person> > {};
+    struct People : Feature<std::vector<std::shared_ptr<Person> > > {};
+    struct Reports : Feature<std::vector<std::shared_ptr<Person> > > {};
+    struct Friends : Feature<std::set<std::shared_ptr<Person> > > {};
+    struct Ranks : Feature<std::map<std::shared_ptr<Person>, int> > {};
+
+    struct Person
+        : Class<Person, Features<Name, Scores, Mentor, Manager, Reports,
+                                 Friends, Ranks> >
+    {
+    };
+
+    struct Registry : Class<Registry, Features<People> >
+    {
+    };
+}  // namespace model
+
+using namespace model;
+
+namespace
+{
+    std::shared_ptr<Person> makePerson(const std::string& name)
+    {
+        auto person = std::make_shared<Person>();
+        person->set<Name>(name);
+        person->set<Scores>(std::vector<int>(1000, 1));
+        return person;
+    }
+
+    bool contains(const std::vector<ModelClass *>& objects,
+                  const std::shared_ptr<Person>& person)
+    {
+        return std::find(objects.begin(), objects.end(), person.get()) !=
+               objects.end();
+    }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    const StructuralContext ctx(Registry::getClassDescriptorInstance());
+
+    Registry registry;
+    auto a = makePerson("a");
+    auto b = makePerson("b");
+    registry.set<People>(std::vector<std::shared_ptr<Person> >{a, b});
+
+    // Cycles owned from the root are not leaked
+    a->set<Mentor>(b);
+    b->set<Mentor>(a);
+
+    // A detached cycle, still found through a weak pointer
+    std::weak_ptr<Person> c, d;
+    {
+        auto pc = makePerson("c");
+        auto pd = makePerson("d");
+        pc->set<Mentor>(pd);
+        pd->set<Mentor>(pc);
+        a->set<Manager>(pc);
+        c = pc;
+        d = pd;
+    }
+
+    // An object owning itself, found as a candidate
+    std::weak_ptr<Person> e;
+    {
+        auto pe = makePerson("e");
+        pe->set<Mentor>(pe);
+        e = pe;
+    }
+
+    // A cycle owned from outside the model
+    auto f = makePerson("f");
+    {
+        auto g = makePerson("g");
+        f->set<Mentor>(g);
+        g->set<Mentor>(f);
+        b->set<Manager>(g);
+    }
+
+    LeakFinder finder(ctx);
+    finder.addCandidate(e);
+
+    {
+        const LeakReport report = finder.analyze(&registry);
+        assert(report.objects == 8);
+        assert(report.cycles.size() == 4);
+
+        assert(report.leaked.size() == 3);
+        assert(contains(report.leaked, c.lock()));
+        assert(contains(report.leaked, d.lock()));
+        assert(contains(report.leaked, e.lock()));
+        assert(!contains(report.leaked, f));
+    }
+
+    assert(finder.collect(&registry) == 2);
+    assert(c.expired() && d.expired() && e.expired());
+
+    {
+        const LeakReport report = finder.analyze(&registry);
+        assert(report.objects == 5);
+        assert(report.cycles.size() == 2);
+        assert(report.leaked.empty());
+    }
+
+    // Objects owned from the root or from outside are kept
+    assert(a->get<Mentor>() == b && b->get<Mentor>() == a);
+    assert(f->get<Mentor>()->get<Mentor>() == f);
+    assert(finder.collect(&registry) == 0);
+
+    // Cycles owned by other leaked cycles, broken in a later pass
+    {
+        std::weak_ptr<Person> h, j;
+        {
+            auto ph = makePerson("h");
+            auto pi = makePerson("i");
+            auto pj = makePerson("j");
+            ph->set<Mentor>(pi);
+            pi->set<Mentor>(ph);
+            pi->set<Reports>(std::vector<std::shared_ptr<Person> >{pj});
+            pj->set<Mentor>(pj);
+            a->set<Manager>(pj);
+            h = ph;
+            j = pj;
+        }
+
+        finder.addCandidate(h);
+
+        const LeakReport report = finder.analyze(&registry);
+        assert(report.objects == 8);
+        assert(report.leaked.size() == 3);
+
+        assert(finder.collect(&registry) == 2);
+        assert(h.expired() && j.expired());
+    }
+
+    // Set elements and map keys are not reset in place
+    {
+        std::weak_ptr<Person> k, l, m;
+        {
+            auto pk = makePerson("k");
+            auto pl = makePerson("l");
+            auto pm = makePerson("m");
+            pk->set<Friends>(std::set<std::shared_ptr<Person> >{pl});
+            pl->set<Mentor>(pk);
+            pm->set<Ranks>(std::map<std::shared_ptr<Person>, int>{{pm, 1}});
+            finder.addCandidate(pk);
+            finder.addCandidate(pm);
+            k = pk;
+            l = pl;
+            m = pm;
+        }
+
+        assert(finder.analyze(&registry).leaked.size() == 3);
+
+        assert(finder.collect(&registry) == 1);
+        assert(k.expired() && l.expired());
+
+        // Only closed through a map key
+        const LeakReport report = finder.analyze(&registry);
+        assert(report.leaked.size() == 1);
+        assert(contains(report.leaked, m.lock()));
+
+        m.lock()->set<Ranks>(std::map<std::shared_ptr<Person>, int>());
+        assert(m.expired());
+    }
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <cassert>
+#include <sstream>
+#include <ref/Class.hpp>
+#include <ref/DescriptorsImpl.ipp>
+#include <ref/utils/MemoryUsage.hpp>
+
+using namespace ref;
+
+namespace model
+{
+    struct Employee;
+
+    struct Name : String {};
+    struct Tags : Feature<std::set<std::string> > {};
+    struct Manager : Feature<std::weak_ptr<Employee> > {};
+    struct Employees : Feature<std::vector<std::shared_ptr<Employee> > > {};
+    struct Head : Feature<std::shared_ptr<Employee> > {};
+
+    struct Employee : Class<Employee, Features<Name, Tags, Manager> >
+    {
+    };
+
+    struct Department : Class<Department, Features<Name, Employees, Head> >
+    {
+    };
+
+    struct Departments : Feature<std::vector<Department> > {};
+
+    struct Company : Class<Company, Features<Name, Departments> >
+    {
+    };
+}  // namespace model
+
+using namespace model;
+
+namespace
+{
+    const std::string longName(100, 'x');
+
+    template <typename T>
+    std::size_t measure(T& value)
+    {
+        return memoryUsage(Holder(&value, TypeDescriptor::getDescriptor<T>()));
+    }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    // Values
+    {
+        std::string shortName = "a";
+        assert(measure(shortName) == sizeof(std::string));
+
+        std::string name = longName;
+        assert(measure(name) == sizeof(std::string) + name.capacity() + 1);
+
+        std::vector<int> values;
+        values.reserve(100);
+        assert(measure(values) == sizeof(values) + 100 * sizeof(int));
+
+        // Elements are measured too
+        std::vector<std::string> names(2, longName);
+        assert(measure(names) == sizeof(names) +
+                                     names.capacity() * sizeof(std::string) +
+                                     2 * (longName.capacity() + 1));
+
+        // Per node
+        std::set<int> small = {1}, large = {1, 2, 3};
+        assert(measure(large) - measure(small) == 2 * (measure(large) -
+                                                       sizeof(large)) / 3);
+    }
+
+    // Objects
+    {
+        Company company;
+        company.set<Name>(longName);
+
+        auto head = std::make_shared<Employee>();
+        head->set<Name>(longName);
+        head->set<Tags>(std::set<std::string>{"a", "b"});
+
+        std::vector<Department> departments(2);
+        for (auto& department : departments)
+        {
+            std::vector<std::shared_ptr<Employee> > employees;
+            for (int i = 0; i < 3; i++)
+            {
+                auto employee = std::make_shared<Employee>();
+                employee->set<Manager>(head);
+                employees.push_back(employee);
+            }
+            employees.push_back(head);
+            department.set<Employees>(employees);
+            department.set<Head>(head);
+        }
+        company.set<Departments>(departments);
+
+        Holder holder(static_cast<ModelClass *>(&company),
+                      company.getClassDescriptor());
+
+        const std::size_t total = memoryUsage(holder);
+        assert(total > sizeof(Company) + 7 * sizeof(Employee));
+
+        // Objects pointed to from several places are counted once
+        MemoryUsage usage;
+        assert(usage.measure(holder) == total);
+        assert(usage.measure(holder) == 0);
+
+        Company other;
+        other.set<Departments>(std::vector<Department>(1));
+        other.get<Departments>()[0].set<Head>(head);
+
+        Holder otherHolder(static_cast<ModelClass *>(&other),
+                           other.getClassDescriptor());
+        assert(usage.measure(otherHolder) <
+               memoryUsage(otherHolder) - sizeof(Employee));
+
+        // Report
+        const MemoryReport report = computeMemoryReport(&company);
+        assert(report.total == total);
+
+        const ClassDescriptor * employeeDesc =
+            Employee::getClassDescriptorInstance();
+        const ClassDescriptor * departmentDesc =
+            Department::getClassDescriptorInstance();
+        const ClassDescriptor * companyDesc =
+            Company::getClassDescriptorInstance();
+
+        assert(report.classes.at(employeeDesc).count == 7);
+        assert(report.classes.at(departmentDesc).count == 2);
+        assert(report.classes.at(companyDesc).count == 1);
+
+        std::size_t sum = 0;
+        for (const auto& entry : report.classes)
+            sum += entry.second.bytes;
+        assert(sum == report.total);
+
+        // Features include the objects they own
+        const FeatureDescriptor * departmentsFeature =
+            companyDesc->getFeatureDescriptor("Departments");
+        const auto& departmentsEntry = report.features.at(departmentsFeature);
+        assert(departmentsEntry.count == 1);
+        assert(departmentsEntry.bytes ==
+               report.total - sizeof(Company) -
+                   report.features.at(
+                       companyDesc->getFeatureDescriptor("Name")).bytes);
+
+        std::ostringstream os;
+        printMemoryReport(os, report);
+        const std::string text = os.str();
+        assert(text.find("Employee: 7 objects") != std::string::npos);
+        assert(text.find("    Departments: 1 values") != std::string::npos);
+    }
+
+    return 0;
+}
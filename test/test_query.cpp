@@ -0,0 +1,187 @@
+#include <cassert>
+#include <stdexcept>
+#include <ref/Class.hpp>
+#include <ref/DescriptorsImpl.ipp>
+#include <ref/utils/Query.hpp>
+
+using namespace ref;
+
+struct Name       : String {};
+struct Department : String {};
+struct Age        : UInt32 {};
+struct Salary     : UInt64 {};
+
+struct Person : Class<Person, Features<Name, Age> >
+{
+};
+
+struct Employee : Class<Employee, Features<Department, Salary>, Person>
+{
+};
+
+struct Staff : Feature<std::vector<std::shared_ptr<Employee> > > {};
+
+struct Company : Class<Company, Features<Staff> >
+{
+};
+
+struct Reading : Int64 {};
+
+// Class::get returns copies of its values
+struct Sample : Class<Sample, Features<Reading>, SeqLockModelClass>
+{
+};
+
+std::shared_ptr<Employee> employee(const std::string& name, uint32_t age,
+                                   const std::string& dept, uint64_t salary)
+{
+    std::shared_ptr<Employee> e(new Employee);
+    e->set<Name>(name);
+    e->set<Age>(age);
+    e->set<Department>(dept);
+    e->set<Salary>(salary);
+    return e;
+}
+
+int main(int argc, char **argv)
+{
+    Company company;
+    auto& staff = company.get<Staff>();
+    staff.push_back(employee("Ann", 30, "R&D", 100));
+    staff.push_back(employee("Bob", 45, "Sales", 80));
+    staff.push_back(employee("Carl", 28, "R&D", 120));
+    staff.push_back(nullptr);
+    staff.push_back(employee("Dana", 52, "Sales", 90));
+
+    const ClassDescriptor *personDesc = Person::getClassDescriptorInstance();
+    const ClassDescriptor *employeeDesc =
+        Employee::getClassDescriptorInstance();
+
+    // Accessors
+    {
+        auto byType = accessor<Employee, Salary>();
+        auto byDesc =
+            accessor<Employee, uint64_t>(employeeDesc->getFeatureDescriptor(
+                "Salary"));
+        auto inherited = accessor<Employee, uint32_t>(
+            personDesc->getFeatureDescriptor("Age"));
+
+        assert(byType(*staff[0]) == 100);
+        assert(byDesc(*staff[2]) == 120);
+        assert(inherited(*staff[1]) == 45);
+
+        bool thrown = false;
+        try
+        {
+            accessor<Employee, std::string>(
+                employeeDesc->getFeatureDescriptor("Salary"));
+        }
+        catch (const std::invalid_argument&)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    // Filter, count and project
+    {
+        Query<Employee> q;
+        assert(q.count(staff) == 4);
+
+        q.where<Department>(
+            [](const std::string& dept) { return dept == "R&D"; });
+        assert(q.count(staff) == 2);
+
+        const auto names = q.project<Name>(staff);
+        assert(names.size() == 2);
+        assert(names[0] == "Ann" && names[1] == "Carl");
+
+        q.where<uint32_t>(personDesc->getFeatureDescriptor("Age"),
+                          [](uint32_t age) { return age < 30; });
+        const auto objs = q.filter(staff);
+        assert(objs.size() == 1 && objs[0] == staff[2].get());
+    }
+
+    // Aggregation and grouping
+    {
+        Query<Employee> q;
+        assert(q.sum<Salary>(staff) == 390);
+        assert(*q.min<Age>(staff) == 28);
+        assert(*q.max<Age>(staff) == 52);
+
+        const auto groups = q.groupBy<Department>(staff);
+        assert(groups.size() == 2);
+        assert(groups.at("Sales").size() == 2);
+        assert(q.sum<Salary>(groups.at("R&D")) == 220);
+
+        Query<Employee> none;
+        none.where<Age>([](uint32_t age) { return age > 100; });
+        assert(!none.max<Age>(staff));
+    }
+
+    // Multi-threaded execution over a reflected list
+    {
+        Company big;
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            big.get<Staff>().push_back(
+                employee("E", i % 50, i % 2 ? "Sales" : "R&D", i));
+        }
+
+        const FeatureDescriptor *staffDesc =
+            Company::getClassDescriptorInstance()->getFeatureDescriptor(
+                "Staff");
+        Holder h = staffDesc->getValue(&big);
+
+        Query<Employee> serial;
+        Query<Employee> parallel(4);
+        serial.where<Department>(
+            [](const std::string& dept) { return dept == "Sales"; });
+        parallel.where<Department>(
+            [](const std::string& dept) { return dept == "Sales"; });
+
+        assert(parallel.count(h) == 500);
+        assert(parallel.sum<Salary>(h) == serial.sum<Salary>(h));
+        assert(parallel.filter(h) == serial.filter(h));
+        assert(*parallel.max<Salary>(h) == 999);
+        assert(parallel.groupBy<Age>(h).size() == 25);
+
+        // Exceptions in workers reach the caller
+        Query<Employee> failing(4);
+        failing.where<Age>([](uint32_t age) {
+            if (age == 42) throw std::runtime_error("age");
+            return true;
+        });
+
+        bool thrown = false;
+        try
+        {
+            failing.count(h);
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    // Classes with a seqlock
+    {
+        std::vector<std::shared_ptr<Sample> > samples;
+        for (int i = 1; i <= 10; i++)
+        {
+            samples.push_back(std::make_shared<Sample>());
+            samples.back()->set<Reading>(i);
+        }
+
+        Query<Sample> query;
+        query.where<Reading>([](std::int64_t r) { return r % 2 == 0; });
+        assert(query.count(samples) == 5);
+        assert(query.sum<Reading>(samples) == 30);
+        assert(*query.max<Reading>(samples) == 10);
+        assert(query.project(accessor<Sample, Reading>(), samples).size() ==
+               5);
+    }
+
+    return 0;
+}
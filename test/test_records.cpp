@@ -0,0 +1,429 @@
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <ref/Class.hpp>
+#include <ref/DescriptorsImpl.ipp>
+#include <ref/utils/JsonPullParser.hpp>
+#include <ref/utils/JsonRecordReader.hpp>
+#include <ref/utils/JsonSerializer.hpp>
+#include <ref/utils/BinarySerializer.hpp>
+#include <ref/utils/BinaryDeserializer.hpp>
+#include "../examples/company.hpp"
+
+using namespace ref;
+
+// Counts the allocations made by the whole program, to check that reading
+// records into the same object stops allocating after the first ones.
+namespace
+{
+    std::size_t allocations = 0;
+}  // namespace
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace model
+{
+    struct Child;
+
+    struct Name : String {};
+    struct Count : Int32 {};
+    struct Flag : Bool {};
+    struct Values : Feature<std::vector<int> > {};
+    struct Label : String {};
+    struct Tags : Feature<std::set<std::string> > {};
+    struct Scores : Feature<std::map<std::string, int> > {};
+    struct Owner : Feature<std::shared_ptr<Child> > {};
+    struct Children : Feature<std::vector<Child> > {};
+
+    struct Child : Class<Child, Features<Label, Values> >
+    {
+    };
+
+    struct Record
+        : Class<Record, Features<Name, Count, Flag, Values, Tags, Scores,
+                                 Owner, Children> >
+    {
+        Record() { set<Count>(-1); }
+    };
+
+    struct Flat : Class<Flat, Features<Name, Count, Flag, Values, Children> >
+    {
+    };
+}  // namespace model
+
+using namespace model;
+using example::Company;
+using example::Department;
+using example::Employee;
+using example::Employees;
+using example::Departments;
+using example::Number;
+
+namespace
+{
+    template <typename F>
+    bool throws(F f)
+    {
+        try
+        {
+            f();
+        }
+        catch (const std::runtime_error&)
+        {
+            return true;
+        }
+        return false;
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    // Pull parser
+    {
+        std::istringstream is(
+            "{\"a\" : [1, -2.5e3, true, false, null], "
+            "\"b\\n\" : \"x\\\"\\u00e9\\ud83d\\ude00\", \"c\" : {}} []");
+        JsonPullParser parser(is);
+        typedef JsonPullParser P;
+
+        assert(parser.next() == P::kObjectStart);
+        assert(parser.next() == P::kKey && parser.getText() == "a");
+        assert(parser.next() == P::kArrayStart);
+        assert(parser.getDepth() == 2);
+        assert(parser.next() == P::kNumber && parser.getText() == "1");
+        assert(parser.next() == P::kNumber && parser.getText() == "-2.5e3");
+        assert(parser.next() == P::kTrue);
+        assert(parser.next() == P::kFalse);
+        assert(parser.next() == P::kNull);
+        assert(parser.next() == P::kArrayEnd);
+        assert(parser.next() == P::kKey && parser.getText() == "b\n");
+        assert(parser.next() == P::kString);
+        assert(parser.getText() == "x\"\xc3\xa9\xf0\x9f\x98\x80");
+        assert(parser.next() == P::kKey && parser.getText() == "c");
+        parser.skipValue();
+        assert(parser.next() == P::kObjectEnd);
+        assert(parser.next() == P::kArrayStart);
+        parser.skipValue();
+        assert(parser.getDepth() == 0);
+        assert(parser.next() == P::kEndDocument);
+
+        const char* malformed[] = {"{\"a\" 1}", "[1 2]", "{1 : 2}", "[tru]",
+                                   "[\"a", "{\"a\" : 1,"};
+
+        for (auto input : malformed)
+        {
+            assert(throws([&]() {
+                std::istringstream is(input);
+                JsonPullParser parser(is);
+                while (parser.next() != JsonPullParser::kEndDocument)
+                {
+                }
+            }));
+        }
+    }
+
+    // Top-level array of records read into the same object
+    {
+        std::istringstream is(
+            "[{\"name\" : \"first\", \"count\" : 3, \"flag\" : true,"
+            "  \"values\" : [1, 2, 3], \"tags\" : [\"a\", \"b\"],"
+            "  \"scores\" : {\"x\" : 1, \"y\" : 2},"
+            "  \"owner\" : {\"label\" : \"o\", \"values\" : [4]},"
+            "  \"children\" : [{\"label\" : \"c1\"}, {\"label\" : \"c2\"}],"
+            "  \"unknown\" : {\"nested\" : [1, {}]}},"
+            " {\"name\" : \"second\", \"values\" : [5, 6],"
+            "  \"scores\" : [{\"first\" : \"z\", \"second\" : \"26\"}],"
+            "  \"owner\" : {\"label\" : \"p\"},"
+            "  \"children\" : [{\"values\" : [7]}]},"
+            " {\"name\" : null, \"owner\" : null, \"flag\" : \"1\"}]");
+        JsonRecordReader reader(is);
+        Record res;
+
+        assert(reader.next(&res));
+        assert(res.get<Name>() == "first");
+        assert(res.get<Count>() == 3);
+        assert(res.get<Flag>());
+        assert((res.get<Values>() == std::vector<int>{1, 2, 3}));
+        assert((res.get<Tags>() == std::set<std::string>{"a", "b"}));
+        assert((res.get<Scores>() ==
+                std::map<std::string, int>{{"x", 1}, {"y", 2}}));
+        assert(res.get<Owner>()->get<Label>() == "o");
+        assert(res.get<Children>().size() == 2);
+        assert(res.get<Children>()[1].get<Label>() == "c2");
+
+        const int* values = res.get<Values>().data();
+        const Child* owner = res.get<Owner>().get();
+        const Child* children = res.get<Children>().data();
+
+        // Missing features get their default value, while lists and
+        // pointed objects are reused
+        assert(reader.next(&res));
+        assert(res.get<Name>() == "second");
+        assert(res.get<Count>() == -1);
+        assert(!res.get<Flag>());
+        assert((res.get<Values>() == std::vector<int>{5, 6}));
+        assert(res.get<Values>().data() == values);
+        assert(res.get<Tags>().empty());
+        assert((res.get<Scores>() == std::map<std::string, int>{{"z", 26}}));
+        assert(res.get<Owner>().get() == owner);
+        assert(res.get<Owner>()->get<Label>() == "p");
+        assert(res.get<Owner>()->get<Values>().empty());
+        assert(res.get<Children>().data() == children);
+        assert(res.get<Children>().size() == 1);
+        assert(res.get<Children>()[0].get<Label>().empty());
+        assert((res.get<Children>()[0].get<Values>() == std::vector<int>{7}));
+
+        assert(reader.next(&res));
+        assert(res.get<Name>().empty());
+        assert(!res.get<Owner>());
+        assert(res.get<Flag>());
+
+        assert(!reader.next(&res));
+    }
+
+    // Records written by JsonSerializer, one after the other, are read
+    // without allocating once the buffers have grown
+    {
+        std::ostringstream os;
+        const std::size_t count = 20;
+
+        for (std::size_t i = 0; i < count; i++)
+        {
+            Flat flat;
+            flat.set<Name>("a record name longer than the small buffer");
+            flat.set<Count>(static_cast<int>(i));
+            flat.set<Flag>(i % 2 == 0);
+            flat.set<Values>(std::vector<int>(10, static_cast<int>(i)));
+            flat.set<Children>(std::vector<Child>(3));
+
+            JsonSerializer(os).serialize(&flat);
+            os << std::endl;
+        }
+
+        std::istringstream is(os.str());
+        JsonRecordReader reader(is);
+        Flat res;
+
+        assert(reader.next(&res));
+        assert(reader.next(&res));
+
+        const std::size_t before = allocations;
+
+        for (std::size_t i = 2; i < count; i++)
+        {
+            assert(reader.next(&res));
+            assert(res.get<Count>() == static_cast<int>(i));
+            assert(res.get<Flag>() == (i % 2 == 0));
+            assert(res.get<Values>().size() == 10);
+            assert(res.get<Values>()[9] == static_cast<int>(i));
+            assert(res.get<Children>().size() == 3);
+        }
+
+        assert(allocations == before);
+        assert(!reader.next(&res));
+    }
+
+    // Records with pointers written by JsonSerializer
+    {
+        std::ostringstream os;
+        const std::size_t count = 4;
+
+        for (std::size_t i = 0; i < count; i++)
+        {
+            Record record;
+            record.set<Name>("record " + std::to_string(i));
+            record.set<Tags>(std::set<std::string>{"t" + std::to_string(i)});
+            record.set<Scores>(std::map<std::string, int>{{"s", int(i)}});
+
+            if (i % 2 == 0)
+            {
+                auto owner = std::make_shared<Child>();
+                owner->set<Label>("owner " + std::to_string(i));
+                owner->set<Values>(std::vector<int>{int(i)});
+                record.set<Owner>(owner);
+            }
+
+            JsonSerializer(os).serialize(&record);
+        }
+
+        std::istringstream is(os.str());
+        JsonRecordReader reader(is);
+        Record res;
+
+        assert(reader.next(&res));
+        assert(res.get<Name>() == "record 0");
+        assert(res.get<Tags>().count("t0"));
+        assert(res.get<Scores>().at("s") == 0);
+        assert(res.get<Owner>()->get<Label>() == "owner 0");
+        assert((res.get<Owner>()->get<Values>() == std::vector<int>{0}));
+
+        assert(reader.next(&res));
+        assert(res.get<Name>() == "record 1" && !res.get<Owner>());
+
+        // Objects kept from previous records are not overwritten
+        assert(reader.next(&res));
+        const std::shared_ptr<Child> kept = res.get<Owner>();
+        assert(kept->get<Label>() == "owner 2");
+
+        res.set<Owner>(kept);
+        std::istringstream again(os.str());
+        JsonRecordReader other(again);
+        assert(other.next(&res));
+        assert(res.get<Owner>() != kept);
+        assert(res.get<Owner>()->get<Label>() == "owner 0");
+        assert(kept->get<Label>() == "owner 2");
+
+        assert(reader.next(&res));
+        assert(!res.get<Owner>());
+        assert(!reader.next(&res));
+    }
+
+    // Strings that need escaping
+    {
+        const std::string text = "say \"hi\"\\path\nnext\tline\x01";
+
+        Record record;
+        record.set<Name>(text);
+        record.set<Tags>(std::set<std::string>{"\"", "\\", "\n"});
+        record.set<Scores>(std::map<std::string, int>{{text, 1}});
+
+        std::ostringstream os;
+        JsonSerializer(os).serialize(&record);
+        JsonSerializer(os).serialize(&record);
+        assert(os.str().find('\t') == std::string::npos);
+
+        std::istringstream is(os.str());
+        JsonRecordReader reader(is);
+        Record res;
+
+        for (int i = 0; i < 2; i++)
+        {
+            assert(reader.next(&res));
+            assert(res.get<Name>() == text);
+            assert(res.get<Tags>() == record.get<Tags>());
+            assert(res.get<Scores>().at(text) == 1);
+        }
+        assert(!reader.next(&res));
+    }
+
+    // Company example, whose objects are all owned by shared pointers
+    {
+        Company company;
+        company.set<example::Name>("Acme");
+
+        for (int i = 0; i < 2; i++)
+        {
+            auto department = std::make_shared<Department>();
+            department->set<Number>(i);
+
+            for (int j = 0; j < 3; j++)
+            {
+                auto employee = std::make_shared<Employee>();
+                employee->set<example::Name>("e" + std::to_string(i * 3 + j));
+                department->get<Employees>().push_back(employee);
+            }
+
+            company.get<Departments>().push_back(department);
+        }
+
+        std::ostringstream os;
+        JsonSerializer(os).serialize(&company);
+
+        std::istringstream is(os.str());
+        Company res;
+        assert(JsonRecordReader(is).next(&res));
+        assert(res.get<example::Name>() == "Acme");
+        assert(res.get<Departments>().size() == 2);
+
+        const auto& department = res.get<Departments>()[1];
+        assert(department->get<Number>() == 1);
+        assert(department->get<Employees>().size() == 3);
+        assert(department->get<Employees>()[2]->get<example::Name>() == "e5");
+
+        std::ostringstream copy;
+        JsonSerializer(copy).serialize(&res);
+        assert(copy.str() == os.str());
+    }
+
+    // Binary records read into the same object
+    {
+        std::ostringstream os;
+        BinarySerializer serializer(os);
+        const std::size_t count = 20;
+
+        for (std::size_t i = 0; i < count; i++)
+        {
+            Record record;
+            record.set<Name>("a record name longer than the small buffer");
+            record.set<Count>(static_cast<int>(i));
+            record.set<Values>(std::vector<int>(10, static_cast<int>(i)));
+
+            auto owner = std::make_shared<Child>();
+            owner->set<Label>("owner");
+            record.set<Owner>(owner);
+
+            serializer.serialize(&record);
+        }
+
+        std::istringstream is(os.str());
+        BinaryDeserializer deserializer(is);
+        Record res;
+
+        assert(deserializer.next(&res));
+        assert(deserializer.next(&res));
+
+        const Child* owner = res.get<Owner>().get();
+        const std::size_t before = allocations;
+
+        for (std::size_t i = 2; i < count; i++)
+        {
+            assert(deserializer.next(&res));
+            assert(res.get<Count>() == static_cast<int>(i));
+            assert(res.get<Values>()[9] == static_cast<int>(i));
+            assert(res.get<Owner>()->get<Label>() == "owner");
+        }
+
+        assert(allocations == before);
+        assert(res.get<Owner>().get() == owner);
+        assert(!deserializer.next(&res));
+
+        // Objects kept by the caller are not overwritten
+        const std::shared_ptr<Child> kept = res.get<Owner>();
+        kept->set<Label>("kept");
+
+        std::istringstream again(os.str());
+        BinaryDeserializer other(again);
+        assert(other.next(&res));
+        assert(res.get<Owner>() != kept);
+        assert(res.get<Owner>()->get<Label>() == "owner");
+        assert(kept->get<Label>() == "kept");
+    }
+
+    // Malformed records
+    {
+        const char* malformed[] = {"[1]", "{\"count\" : \"x\"}",
+                                   "{\"values\" : {}}", "{\"owner\" : 1}"};
+
+        for (auto input : malformed)
+        {
+            assert(throws([&]() {
+                std::istringstream is(input);
+                Record res;
+                JsonRecordReader(is).next(&res);
+            }));
+        }
+    }
+
+    return 0;
+}
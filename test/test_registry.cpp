@@ -0,0 +1,177 @@
+#include <cassert>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <ref/Class.hpp>
+#include <ref/DescriptorsImpl.ipp>
+#include <ref/DescriptorRegistry.hpp>
+
+using namespace ref;
+
+namespace a
+{
+    struct Name : String {};
+
+    struct MyClass : Class<MyClass, Features<Name> >
+    {
+    };
+
+    struct MySubClass : Class<MySubClass, Features<>, MyClass>
+    {
+    };
+}  // namespace a
+
+namespace b
+{
+    struct MyClass : Class<MyClass>
+    {
+    };
+}  // namespace b
+
+namespace c
+{
+    template <int N>
+    struct Many : Class<Many<N> >
+    {
+    };
+}  // namespace c
+
+namespace
+{
+    // A registry of its own, to register descriptors after freezing it
+    struct LateRegistry : DescriptorRegistry
+    {
+        std::size_t getSnapshotCount() const { return m_snapshots.size(); }
+    };
+
+    // Another class with the type id of a::MyClass
+    struct CollidingDescriptor : ClassDescriptorImpl<a::MyClass>
+    {
+        std::string getFqn() const override { return "c::Colliding"; }
+    };
+
+    template <int... N>
+    std::vector<const ClassDescriptor*> many(
+        std::integer_sequence<int, N...>)
+    {
+        return {c::Many<N>::getClassDescriptorInstance()...};
+    }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    DescriptorRegistry& registry = DescriptorRegistry::instance();
+
+    // Registered at load time, before any use of the descriptors
+    const ClassDescriptor *subClassDesc =
+        registry.findByFqn("a::MySubClass");
+    assert(subClassDesc);
+    assert(subClassDesc == a::MySubClass::getClassDescriptorInstance());
+
+    // Lookups
+    {
+        const ClassDescriptor *aDesc = a::MyClass::getClassDescriptorInstance();
+        const ClassDescriptor *bDesc = b::MyClass::getClassDescriptorInstance();
+
+        assert(registry.findByFqn("a::MyClass") == aDesc);
+        assert(registry.findByFqn("b::MyClass") == bDesc);
+        assert(registry.findByFqn("c::MyClass") == nullptr);
+
+        assert(registry.findByName("MySubClass") == subClassDesc);
+        assert(registry.findByXmlTag("my-sub-class") == subClassDesc);
+
+        // Ambiguous
+        assert(registry.findByName("MyClass") == nullptr);
+        assert(registry.findByXmlTag("my-class") == nullptr);
+
+        assert(aDesc->getTypeId() != bDesc->getTypeId());
+        assert(registry.findById(aDesc->getTypeId()) == aDesc);
+        assert(registry.findById(bDesc->getTypeId()) == bDesc);
+        assert(registry.findById(0) == nullptr);
+
+        // ModelClass, a::MyClass, a::MySubClass, b::MyClass, c::Many
+        assert(registry.getClassDescriptors().size() == 104);
+    }
+
+    // Concurrent lookups once frozen
+    {
+        assert(!registry.isFrozen());
+        registry.freeze();
+        assert(registry.isFrozen());
+
+        const std::uint64_t id = subClassDesc->getTypeId();
+        std::vector<std::thread> threads;
+        std::vector<int> found(4, 0);
+
+        for (size_t i = 0; i < found.size(); i++)
+        {
+            threads.push_back(std::thread([&registry, &found, id, i]() {
+                for (int j = 0; j < 1000; j++)
+                {
+                    found[i] += registry.findByFqn("a::MySubClass") &&
+                                registry.findById(id);
+                }
+            }));
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        for (auto count : found)
+            assert(count == 1000);
+    }
+
+    // Registrations after freeze
+    {
+        LateRegistry late;
+        late.add(subClassDesc);
+        late.add(a::MyClass::getClassDescriptorInstance());
+        late.freeze();
+        assert(late.findByName("MyClass"));
+
+        // Pending, and visible
+        late.add(b::MyClass::getClassDescriptorInstance());
+        assert(late.getSnapshotCount() == 1);
+        assert(late.findByName("MyClass") == nullptr);
+        assert(late.findByFqn("b::MyClass"));
+        assert(late.getClassDescriptors().size() == 3);
+
+        // Published in batches of growing size
+        const auto descs = many(std::make_integer_sequence<int, 100>());
+        for (auto desc : descs)
+        {
+            late.add(desc);
+            assert(late.findByFqn(desc->getFqn()) == desc);
+            assert(late.findById(desc->getTypeId()) == desc);
+        }
+
+        assert(late.getClassDescriptors().size() == 103);
+        assert(late.getSnapshotCount() <= 7);
+
+        late.freeze();
+        assert(late.findByFqn(descs.back()->getFqn()) == descs.back());
+    }
+
+    // Type id collisions are reported in every build
+    {
+        LateRegistry late;
+        late.add(a::MyClass::getClassDescriptorInstance());
+
+        const CollidingDescriptor colliding;
+        bool thrown = false;
+        try
+        {
+            late.add(&colliding);
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+        assert(!late.findByFqn("c::Colliding"));
+        assert(late.getClassDescriptors().size() == 1);
+    }
+
+    return 0;
+}
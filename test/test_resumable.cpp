@@ -0,0 +1,225 @@
+#include <cassert>
+#include <fcntl.h>
+#include <sstream>
+#include <unistd.h>
+#include <ref/Class.hpp>
+#include <ref/DescriptorsImpl.ipp>
+#include <ref/utils/JsonPullParser.hpp>
+#include <ref/utils/JsonSerializer.hpp>
+#include <ref/utils/ResumableJsonSerializer.hpp>
+
+using namespace ref;
+
+namespace model
+{
+    struct Child;
+
+    struct Name : String {};
+    struct Count : Int32 {};
+    struct Values : Feature<std::vector<int> > {};
+    struct Tags : Feature<std::set<std::string> > {};
+    struct Scores : Feature<std::map<std::string, int> > {};
+    struct Owner : Feature<std::shared_ptr<Child> > {};
+    struct Children : Feature<std::vector<Child> > {};
+
+    struct Child : Class<Child, Features<Name, Values> >
+    {
+    };
+
+    struct Document
+        : Class<Document, Features<Name, Count, Tags, Scores, Owner,
+                                   Children> >
+    {
+    };
+}  // namespace model
+
+using namespace model;
+
+namespace
+{
+    Document makeDocument(int children)
+    {
+        Document doc;
+        doc.set<Name>("document");
+        doc.set<Count>(children);
+        doc.set<Tags>(std::set<std::string>{"a", "b", "c"});
+        doc.set<Scores>(std::map<std::string, int>{{"x", 1}, {"y", 2}});
+
+        auto owner = std::make_shared<Child>();
+        owner->set<Name>("owner");
+        doc.set<Owner>(owner);
+
+        std::vector<Child> values(children);
+        for (int i = 0; i < children; i++)
+        {
+            values[i].set<Name>("child " + std::to_string(i));
+            values[i].set<Values>(std::vector<int>(i % 10, i));
+        }
+        doc.set<Children>(values);
+        return doc;
+    }
+
+    std::string toJson(Document& doc)
+    {
+        std::ostringstream os;
+        JsonSerializer(os).serialize(&doc);
+        return os.str();
+    }
+
+    // Accepts a few bytes at a time, and nothing every other call
+    struct ThrottledSink : OutputSink
+    {
+        std::string data;
+        std::size_t calls = 0;
+
+        std::size_t write(const char * bytes, std::size_t size) override
+        {
+            if (calls++ % 2) return 0;
+
+            size = std::min<std::size_t>(size, 7);
+            data.append(bytes, size);
+            return size;
+        }
+    };
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    Document doc = makeDocument(20);
+    const std::string expected = toJson(doc);
+
+    // Bounded chunks
+    {
+        std::ostringstream os;
+        StreamSink sink(os);
+        ResumableJsonSerializer serializer(&doc, 64);
+
+        std::size_t chunks = 1;
+        while (serializer.resume(sink) == ResumableJsonSerializer::kPending)
+        {
+            assert(os.str().size() <= chunks * (64 + 64));
+            ++chunks;
+        }
+
+        assert(serializer.isDone());
+        assert(chunks > expected.size() / 128);
+        assert(os.str() == expected);
+
+        std::string chunk;
+        ResumableJsonSerializer pull(&doc, 64);
+        std::string pulled;
+        while (pull.next(chunk))
+            pulled += chunk;
+        assert(pulled == expected);
+    }
+
+    // Suspended while the sink is full
+    {
+        ThrottledSink sink;
+        ResumableJsonSerializer serializer(&doc, 100);
+
+        std::size_t blocked = 0;
+        ResumableJsonSerializer::Status status;
+        while ((status = serializer.resume(sink)) !=
+               ResumableJsonSerializer::kDone)
+        {
+            if (status == ResumableJsonSerializer::kBlocked) ++blocked;
+        }
+
+        assert(blocked > 0);
+        assert(sink.data == expected);
+    }
+
+    // Suspended inside strings that need escaping
+    {
+        const std::string name = "a \"quoted\" C:\\path\nand\ta long tail";
+
+        Document escaped = makeDocument(2);
+        escaped.set<Name>(name);
+        escaped.set<Tags>(std::set<std::string>{"\\", "\"\n\""});
+        const std::string expectedEscaped = toJson(escaped);
+
+        // Where the name is written, escaped
+        const std::size_t begin = expectedEscaped.find("\"a \\\"");
+        const std::size_t end = expectedEscaped.find("tail\"", begin);
+        assert(begin != std::string::npos && end != std::string::npos);
+
+        ThrottledSink sink;
+        ResumableJsonSerializer serializer(&escaped, 16);
+
+        bool inside = false;
+        ResumableJsonSerializer::Status status;
+        while ((status = serializer.resume(sink)) !=
+               ResumableJsonSerializer::kDone)
+        {
+            if (status == ResumableJsonSerializer::kBlocked &&
+                sink.data.size() > begin && sink.data.size() < end)
+            {
+                inside = true;
+            }
+        }
+
+        assert(inside);
+        assert(sink.data == expectedEscaped);
+
+        std::istringstream is(sink.data);
+        JsonPullParser parser(is);
+        while (parser.next() != JsonPullParser::kString)
+        {
+        }
+        assert(parser.getText() == name);
+    }
+
+    // Non-blocking pipe, larger than its buffer
+    {
+        Document large = makeDocument(20000);
+        const std::string expectedLarge = toJson(large);
+        assert(expectedLarge.size() > 1 << 20);
+
+        int fds[2];
+        if (pipe(fds) != 0) return 1;
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+        fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+        FileDescriptorSink sink(fds[1]);
+        ResumableJsonSerializer serializer(&large);
+
+        std::string received;
+        char buffer[4096];
+        const auto drain = [&]() {
+            ssize_t n;
+            while ((n = read(fds[0], buffer, sizeof(buffer))) > 0)
+                received.append(buffer, n);
+        };
+
+        std::size_t blocked = 0;
+        ResumableJsonSerializer::Status status;
+        while ((status = serializer.resume(sink)) !=
+               ResumableJsonSerializer::kDone)
+        {
+            if (status == ResumableJsonSerializer::kBlocked)
+            {
+                ++blocked;
+                drain();
+            }
+        }
+        drain();
+
+        close(fds[0]);
+        close(fds[1]);
+
+        assert(blocked > 0);
+        assert(received == expectedLarge);
+    }
+
+    // Nothing to write
+    {
+        std::ostringstream os;
+        StreamSink sink(os);
+        ResumableJsonSerializer serializer(static_cast<ModelClass *>(nullptr));
+        assert(serializer.resume(sink) == ResumableJsonSerializer::kDone);
+        assert(serializer.isDone() && os.str().empty());
+    }
+
+    return 0;
+}
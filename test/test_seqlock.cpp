@@ -0,0 +1,151 @@
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <ref/Class.hpp>
+#include <ref/DescriptorsImpl.ipp>
+
+using namespace ref;
+
+namespace model
+{
+    struct X : Int64 {};
+    struct Y : Int64 {};
+    struct Count : UInt64 {};
+
+    // Y is always -X, as both are written together
+    struct Point : Class<Point, Features<X, Y, Count>, SeqLockModelClass>
+    {
+        void move(std::int64_t x)
+        {
+            write([&] {
+                X::value = x;
+                Y::value = -x;
+            });
+        }
+
+        std::pair<std::int64_t, std::int64_t> position() const
+        {
+            return read([this] { return std::make_pair(X::value, Y::value); });
+        }
+    };
+}  // namespace model
+
+using namespace model;
+
+int main(int argc, char **argv)
+{
+    const ClassDescriptor * pointDesc = Point::getClassDescriptorInstance();
+    const FeatureDescriptor * xDesc = pointDesc->getFeatureDescriptor("X");
+    const FeatureDescriptor * yDesc = pointDesc->getFeatureDescriptor("Y");
+
+    // Every write takes two steps of the sequence
+    {
+        Point p;
+        assert(p.getSequence() == 0);
+
+        p.set<X>(3);
+        assert(p.get<X>() == 3 && p.getSequence() == 2);
+
+        p.update<Count>([](std::uint64_t& count) { count += 5; });
+        assert(p.get<Count>() == 5 && p.getSequence() == 4);
+
+        p.move(7);
+        assert(p.position().first == 7 && p.position().second == -7);
+        assert(p.getSequence() == 6);
+
+        // Reflective writes
+        std::int64_t value = 11;
+        pointDesc->getFeatureDescriptor("X")->setValue(
+            &p, Holder(&value, TypeDescriptor::getDescriptor<std::int64_t>()));
+        assert(p.get<X>() == 11 && p.getSequence() == 8);
+
+        // Copies do not take the sequence
+        Point copy(p);
+        assert(copy.get<X>() == 11 && copy.getSequence() == 0);
+
+        Point other;
+        pointDesc->copy(Holder(static_cast<ModelClass *>(&p), pointDesc),
+                        Holder(static_cast<ModelClass *>(&other), pointDesc));
+        assert(other.get<Y>() == -7 && other.getSequence() == 2);
+
+        // Snapshots are copies, read through the descriptors
+        const Holder snapshot = pointDesc->snapshot(&p);
+        ModelClass * copied = pointDesc->get(snapshot);
+        assert(copied != &p);
+        assert(*pointDesc->getFeatureValue(copied, "Y").get<std::int64_t>() ==
+               -7);
+    }
+
+    // Readers see consistent values while a thread writes them
+    {
+        const std::int64_t writes = 200000;
+        const unsigned readers = 4;
+
+        Point p;
+        std::atomic<bool> done(false);
+        std::atomic<unsigned> errors(0);
+
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < readers; i++)
+        {
+            threads.emplace_back([&, i] {
+                std::uint64_t last = 0;
+                Point snapshot;
+                Holder src(static_cast<ModelClass *>(&p), pointDesc);
+                Holder dst(static_cast<ModelClass *>(&snapshot), pointDesc);
+
+                while (!done)
+                {
+                    const auto position = p.position();
+                    if (position.first != -position.second) ++errors;
+
+                    // Values only grow
+                    const std::uint64_t count = p.get<Count>();
+                    if (count < last) ++errors;
+                    last = count;
+
+                    if (i % 2)
+                    {
+                        pointDesc->copy(src, dst);
+                        if (snapshot.get<X>() != -snapshot.get<Y>())
+                            ++errors;
+                    }
+                    else
+                    {
+                        // As serializers read them
+                        const Holder h = pointDesc->snapshot(&p);
+                        std::int64_t x = 0, y = 0;
+                        pointDesc->forEachFeature(
+                            pointDesc->get(h),
+                            [&](const FeatureDescriptor * feature,
+                                Holder value) {
+                                if (feature == xDesc)
+                                    x = *value.get<std::int64_t>();
+                                else if (feature == yDesc)
+                                    y = *value.get<std::int64_t>();
+                            });
+                        if (x != -y) ++errors;
+                    }
+                }
+            });
+        }
+
+        for (std::int64_t x = 1; x <= writes; x++)
+        {
+            p.move(x);
+            p.set<Count>(x);
+        }
+
+        done = true;
+        for (auto& thread : threads)
+            thread.join();
+
+        assert(errors == 0);
+        assert(p.position().first == writes);
+        assert(p.getSequence() == 4 * writes);
+    }
+
+    return 0;
+}
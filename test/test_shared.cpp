@@ -0,0 +1,274 @@
+#include <cassert>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <ref/Class.hpp>
+#include <ref/utils/SharedMemory.hpp>
+#include <ref/utils/BinaryDeserializer.hpp>
+#include <ref/utils/BinarySerializer.hpp>
+#include <ref/utils/JsonSerializer.hpp>
+
+using namespace ref;
+
+namespace model
+{
+    struct Name : Feature<SharedString> {};
+    struct Tags : Feature<SharedVector<SharedString> > {};
+    struct Scores : Feature<SharedMap<SharedString, std::int32_t> > {};
+    struct Ids : Feature<SharedSet<std::uint32_t> > {};
+
+    struct Person : Class<Person, Features<Name, Tags, Scores, Ids> >
+    {
+    };
+
+    struct Members : Feature<SharedVector<Person> > {};
+    struct Leader : Feature<OffsetPtr<Person> > {};
+
+    struct Team : Class<Team, Features<Name, Members, Leader> >
+    {
+    };
+}  // namespace model
+
+using namespace model;
+
+namespace
+{
+    // Long enough not to fit in the string itself
+    const std::string longName(100, 'x');
+
+    void fill(Team& team)
+    {
+        team.set<Name>(SharedString(longName.c_str()));
+
+        for (int i = 0; i < 10; i++)
+        {
+            Person person;
+            person.set<Name>(
+                SharedString(("person " + std::to_string(i)).c_str()));
+            person.get<Tags>().push_back(SharedString(longName.c_str()));
+            person.get<Scores>()[SharedString("score")] = i;
+            person.get<Ids>().insert(i);
+            team.get<Members>().push_back(person);
+        }
+
+        team.set<Leader>(&team.get<Members>()[3]);
+    }
+
+    std::string leaderName(const Team& team)
+    {
+        const Person& leader = *team.get<Leader>();
+        return std::string(leader.get<Name>().data(),
+                           leader.get<Name>().size());
+    }
+
+    // Writes the values of features, through their descriptors only
+    struct Describe
+    {
+        std::ostream& os;
+        Holder value;
+
+        void operator()(const PrimitiveTypeDescriptor * desc)
+        {
+            os << desc->getString(value);
+        }
+
+        void operator()(const ListTypeDescriptor * desc)
+        {
+            os << desc->getSize(value);
+        }
+
+        void operator()(const PointerTypeDescriptor * desc)
+        {
+            const ClassDescriptor * personDesc =
+                Person::getClassDescriptorInstance();
+            const Holder leader = desc->dereference(value);
+            const Holder name =
+                personDesc->getFeatureValue(personDesc->get(leader), "Name");
+            os << name.descriptor()->as<PrimitiveTypeDescriptor>()->getString(
+                      name);
+        }
+
+        void operator()(const TypeDescriptor *) {}
+    };
+
+    /**
+     * Reads a team without calling its virtual functions, as a process
+     * with other virtual table addresses would.
+     */
+    std::string describe(Team * team)
+    {
+        std::ostringstream os;
+
+        Team::getClassDescriptorInstance()->forEachFeature(
+            team, [&](const FeatureDescriptor * feature, Holder value) {
+                os << feature->getName() << ':';
+                visitType(value.descriptor(), Describe{os, value});
+                os << ';';
+            });
+
+        return os.str();
+    }
+
+    /**
+     * Reads the team of a segment in a new program, whose virtual tables
+     * may be at other addresses.
+     */
+    int readTeam(const std::string& name)
+    {
+        SharedSegment reader(name);
+        Team * shared = reader.find<Team>("team");
+        if (!shared) return 1;
+
+        Team local;
+        fill(local);
+
+        std::ostringstream expected;
+        JsonSerializer(expected).serialize(&local);
+
+        std::ostringstream os;
+        JsonSerializer(os, true).serializeAs(
+            Team::getClassDescriptorInstance(), shared);
+
+        const bool ok = describe(shared) == describe(&local) &&
+                        leaderName(*shared) == "person 3" &&
+                        os.str() == expected.str();
+        return ok ? 0 : 1;
+    }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && std::string(argv[1]) == "--read")
+        return readTeam(argv[2]);
+
+    // Descriptors
+    {
+        auto nameDesc = TypeDescriptor::getDescriptor<SharedString>();
+        assert(nameDesc->getKind() == TypeDescriptor::kPrimitive);
+        assert(nameDesc->as<PrimitiveTypeDescriptor>()->getPrimitiveKind() ==
+               PrimitiveTypeDescriptor::kSharedString);
+        assert(TypeDescriptor::getDescriptor<Tags::type>()->getKind() ==
+               TypeDescriptor::kList);
+        assert(TypeDescriptor::getDescriptor<Scores::type>()->getKind() ==
+               TypeDescriptor::kMap);
+        assert(TypeDescriptor::getDescriptor<Ids::type>()->getKind() ==
+               TypeDescriptor::kSet);
+
+        auto leaderDesc = TypeDescriptor::getDescriptor<Leader::type>();
+        assert(leaderDesc->getKind() == TypeDescriptor::kPointer);
+        assert(leaderDesc->as<PointerTypeDescriptor>()->getPointerType() ==
+               PointerTypeDescriptor::kRaw);
+    }
+
+    const std::string name = "ref_test_shared_" + std::to_string(getpid());
+    SharedSegment::remove(name);
+
+    // Out of a scope, values are on the heap
+    Team local;
+    fill(local);
+
+    std::ostringstream expected;
+    JsonSerializer(expected).serialize(&local);
+
+    {
+        SharedSegment segment(name, 1 << 20);
+        assert(!segment.isReadOnly() && segment.isNative());
+        assert(!segment.contains(local.get<Name>().data()));
+
+        // Built in place
+        Team * team = segment.construct<Team>("team");
+        {
+            SharedSegment::Scope scope(segment);
+            fill(*team);
+        }
+        assert(segment.contains(team->get<Name>().data()));
+        assert(segment.contains(
+            team->get<Members>()[9].get<Tags>()[0].data()));
+        assert(leaderName(*team) == "person 3");
+
+        // Copied from the heap
+        Team * copy = segment.construct<Team>("copy", local);
+        assert(segment.contains(copy->get<Members>().data()));
+        assert(segment.contains(
+            copy->get<Members>()[0].get<Tags>()[0].data()));
+
+        std::ostringstream os;
+        JsonSerializer(os).serialize(copy);
+        assert(os.str() == expected.str());
+
+        // Read from another process
+        const std::string description = describe(team);
+        const pid_t pid = fork();
+        if (pid == 0)
+        {
+            SharedSegment reader(name);
+            Team * shared = reader.find<Team>("team");
+
+            bool ok = shared && reader.isReadOnly();
+            ok = ok && !reader.find<Team>("missing");
+            ok = ok && describe(shared) == description;
+            ok = ok && leaderName(*shared) == "person 3";
+
+            // Same code at the same addresses
+            std::ostringstream os;
+            JsonSerializer(os).serialize(shared);
+            ok = ok && reader.isNative() && os.str() == expected.str();
+
+            _exit(ok ? 0 : 1);
+        }
+
+        int status = 0;
+        const pid_t waited = waitpid(pid, &status, 0);
+        assert(waited == pid);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+        // Read from another program, through static types only
+        const pid_t reader = fork();
+        if (reader == 0)
+        {
+            execl("/proc/self/exe", "test_shared", "--read", name.c_str(),
+                  static_cast<char *>(nullptr));
+            _exit(127);
+        }
+
+        status = 0;
+        const pid_t reaped = waitpid(reader, &status, 0);
+        assert(reaped == reader);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+        // Binary round trip of shared strings
+        std::ostringstream binary;
+        BinarySerializer(binary).serialize(team);
+        std::istringstream is(binary.str());
+        Holder h = BinaryDeserializer(is).next();
+        Team * read = static_cast<Team *>(
+            Team::getClassDescriptorInstance()->get(h));
+        assert(read->get<Members>().size() == 10);
+        assert(read->get<Members>()[9].get<Tags>()[0] == team->get<Name>());
+
+        const std::size_t freeMemory = segment.getFreeMemory();
+        const bool destroyed = segment.destroy<Team>("copy");
+        assert(destroyed);
+        assert(segment.getFreeMemory() > freeMemory);
+    }
+
+    // Read-only
+    {
+        SharedSegment segment(name);
+        bool thrown = false;
+        try
+        {
+            segment.construct<Team>("other");
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    const bool removed = SharedSegment::remove(name);
+    assert(removed);
+    return 0;
+}
@@ -1,13 +1,42 @@
 #include <cassert>
+#include <ref/utils/StaticStructure.hpp>
 #include <ref/utils/StructuralContext.hpp>
 #include "../examples/company.hpp"
 #include <iostream>
 #include <set>
 #include <algorithm>
+#include <tuple>
 
 using namespace ref;
 using namespace std;
 
+namespace
+{
+    typedef StaticStructure<example::Company> CompanyStructure;
+
+    static_assert(CompanyStructure::classes.size() == 4,
+                  "Company, Department, Employee and ModelClass");
+    static_assert(CompanyStructure::references.size() == 3,
+                  "Departments, Employees and Manager");
+    static_assert(CompanyStructure::references[2].type == Reference::kWeak,
+                  "Manager is a weak pointer");
+
+    typedef tuple<const ClassDescriptor *, const FeatureDescriptor *,
+                  const ClassDescriptor *, Reference::ReferenceType>
+        ReferenceKey;
+
+    multiset<ReferenceKey> keys(const vector<Reference>& references)
+    {
+        multiset<ReferenceKey> res;
+        for (const auto& ref : references)
+        {
+            res.insert(ReferenceKey(ref.classDesc, ref.featureDesc,
+                                    ref.referencedClassDesc, ref.type));
+        }
+        return res;
+    }
+}  // namespace
+
 int main(int argc, char **argv)
 {
     auto companyDesc =
@@ -74,5 +103,36 @@ int main(int argc, char **argv)
         assert(!ctx.isReference(companyDesc->getFeatureDescriptor("Name")));
     }
 
+    // Computed at compile time
+    {
+        const StructuralContext staticCtx(CompanyStructure::table);
+
+        assert(staticCtx.getRootClass() == companyDesc);
+
+        auto classes = ctx.getAllClasses();
+        auto staticClasses = staticCtx.getAllClasses();
+        sort(classes.begin(), classes.end());
+        sort(staticClasses.begin(), staticClasses.end());
+        assert(classes == staticClasses);
+
+        for (auto classDesc : classes)
+        {
+            assert(keys(ctx.getIncomingReferences(classDesc)) ==
+                   keys(staticCtx.getIncomingReferences(classDesc)));
+            assert(keys(ctx.getAllIncomingReferences(classDesc)) ==
+                   keys(staticCtx.getAllIncomingReferences(classDesc)));
+            assert(keys(ctx.getOutgoingReferences(classDesc)) ==
+                   keys(staticCtx.getOutgoingReferences(classDesc)));
+            assert(keys(ctx.getAllOutgoingReferences(classDesc)) ==
+                   keys(staticCtx.getAllOutgoingReferences(classDesc)));
+
+            for (auto feature : classDesc->getFeatureDescriptors())
+            {
+                assert(ctx.isReference(feature) ==
+                       staticCtx.isReference(feature));
+            }
+        }
+    }
+
     return 0;
 }
@@ -0,0 +1,259 @@
+#include <cassert>
+#include <sstream>
+#include <ref/Class.hpp>
+#include <ref/DescriptorsImpl.ipp>
+#include <ref/utils/TransactionLog.hpp>
+#include <ref/utils/XmlSerializer.hpp>
+
+using namespace ref;
+
+namespace model
+{
+    struct Item;
+
+    struct Name : String {};
+    struct Count : Int32 {};
+    struct Tags : Feature<std::set<std::string> > {};
+    struct Totals : Feature<std::map<std::string, int> > {};
+    struct Values : Feature<std::vector<int> > {};
+    struct Items : Feature<std::vector<std::shared_ptr<Item> > > {};
+    struct Owner : Feature<std::shared_ptr<Item> > {};
+
+    struct Item : Class<Item, Features<Name, Count> >
+    {
+    };
+
+    struct Document
+        : Class<Document, Features<Name, Tags, Totals, Values, Items, Owner> >
+    {
+    };
+}  // namespace model
+
+using namespace model;
+
+namespace
+{
+    std::string toXml(Document& doc)
+    {
+        std::ostringstream os;
+        XmlSerializer(os).serialize(&doc);
+        return os.str();
+    }
+
+    Document makeDocument()
+    {
+        Document doc;
+        doc.set<Name>("draft");
+        doc.set<Tags>(std::set<std::string>{"a", "b"});
+        doc.set<Totals>(std::map<std::string, int>{{"x", 1}});
+
+        std::vector<int> values;
+        for (int i = 0; i < 1000; i++)
+            values.push_back(i);
+        doc.set<Values>(values);
+
+        std::vector<std::shared_ptr<Item> > items;
+        for (int i = 0; i < 3; i++)
+        {
+            items.push_back(std::make_shared<Item>());
+            items.back()->set<Name>("item " + std::to_string(i));
+        }
+        doc.set<Items>(items);
+        return doc;
+    }
+
+    // Edits every kind of feature
+    void edit(Document& doc)
+    {
+        doc.set<Name>("final");
+
+        std::vector<int> values = doc.get<Values>();
+        values.insert(values.begin() + 500, 42);
+        doc.set<Values>(values);
+
+        std::set<std::string> tags = doc.get<Tags>();
+        tags.erase("a");
+        tags.insert("c");
+        doc.set<Tags>(tags);
+
+        doc.get<Items>()[1]->set<Count>(7);
+
+        auto owner = std::make_shared<Item>();
+        owner->set<Name>("owner");
+        doc.set<Owner>(owner);
+    }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    // Rollback, undo and redo
+    {
+        Document doc = makeDocument();
+        const std::string original = toXml(doc);
+
+        ObjectTable ids;
+        ids.assign(&doc);
+        TransactionLog log(ids);
+
+        log.begin();
+        edit(doc);
+        log.rollback();
+        assert(toXml(doc) == original);
+        assert(log.size() == 0 && !log.canUndo());
+
+        log.begin();
+        edit(doc);
+        log.commit();
+        const std::string edited = toXml(doc);
+        assert(edited != original);
+
+        // Records hold the edits only
+        assert(log.size() == 1);
+        assert(log.data().size() < 200);
+
+        log.undo();
+        assert(toXml(doc) == original);
+        assert(!log.canUndo() && log.canRedo());
+
+        log.redo();
+        assert(toXml(doc) == edited);
+        assert(log.canUndo() && !log.canRedo());
+
+        // Through the descriptors too
+        const FeatureDescriptor * name =
+            doc.getClassDescriptor()->getFeatureDescriptor("Name");
+        std::string value = "reflective";
+
+        log.begin();
+        name->setValue(&doc, Holder(&value, name->getTypeDescriptor()));
+        log.commit();
+
+        log.undo();
+        assert(doc.get<Name>() == "final");
+        log.undo();
+        assert(toXml(doc) == original);
+
+        // New transactions discard the undone ones
+        log.begin();
+        doc.set<Totals>(std::map<std::string, int>{{"y", 2}});
+        log.commit();
+        assert(!log.canRedo());
+
+        log.undo();
+        assert(doc.get<Totals>().at("x") == 1);
+    }
+
+    // Write-ahead log
+    {
+        Document doc = makeDocument();
+        ObjectTable ids;
+        ids.assign(&doc);
+
+        std::ostringstream wal;
+        TransactionLog log(ids);
+        log.setWriteAheadLog(&wal);
+
+        log.begin();
+        edit(doc);
+        log.commit();
+
+        // Objects created by a transaction can be modified in later ones
+        log.begin();
+        doc.get<Owner>()->set<Count>(3);
+        doc.set<Totals>(std::map<std::string, int>{{"x", 1}, {"z", 26}});
+        log.commit();
+
+        assert(wal.str() == log.data());
+
+        // Replayed over a copy of the initial model
+        Document recovered = makeDocument();
+        ObjectTable recoveredIds;
+        recoveredIds.assign(&recovered);
+
+        TransactionLog replayer(recoveredIds);
+        std::istringstream is(wal.str());
+        assert(replayer.replay(is) == 2);
+        assert(toXml(recovered) == toXml(doc));
+        assert(recovered.get<Owner>()->get<Count>() == 3);
+
+        // Frames cut by a crash are ignored
+        Document partial = makeDocument();
+        ObjectTable partialIds;
+        partialIds.assign(&partial);
+
+        const std::string data = wal.str();
+        assert(TransactionLog(partialIds).replay(
+                   data.substr(0, data.size() - 3)) == 1);
+        assert(partial.get<Name>() == "final");
+        assert(partial.get<Owner>()->get<Count>() == 0);
+        assert(partial.get<Totals>().size() == 1);
+    }
+
+    // Objects owned by shared pointers keep their identity
+    {
+        Document doc = makeDocument();
+        ObjectTable ids;
+        ids.assign(&doc);
+
+        std::ostringstream wal;
+        TransactionLog log(ids);
+        log.setWriteAheadLog(&wal);
+
+        // Also held outside of the log
+        const std::shared_ptr<Item> kept = doc.get<Items>()[1];
+
+        log.begin();
+        doc.set<Owner>(kept);
+        log.commit();
+        assert(log.data().size() < 50);
+
+        auto replace = [&] {
+            std::vector<std::shared_ptr<Item> > items = doc.get<Items>();
+            items.erase(items.begin() + 1);
+            doc.set<Items>(items);
+
+            auto owner = std::make_shared<Item>();
+            owner->set<Name>("owner");
+            doc.set<Owner>(owner);
+        };
+
+        log.begin();
+        replace();
+        log.rollback();
+        assert(doc.get<Owner>() == kept && doc.get<Items>()[1] == kept);
+
+        log.begin();
+        replace();
+        log.commit();
+        const std::shared_ptr<Item> owner = doc.get<Owner>();
+        assert(owner != kept && doc.get<Items>().size() == 2);
+
+        log.undo();
+        assert(doc.get<Owner>() == kept && doc.get<Items>()[1] == kept);
+
+        log.redo();
+        assert(doc.get<Owner>() == owner);
+
+        log.undo();
+        assert(doc.get<Owner>() == kept);
+
+        // Restored objects are known again
+        log.begin();
+        kept->set<Count>(5);
+        log.commit();
+        log.undo();
+        assert(kept->get<Count>() == 0);
+
+        // Replaying keeps the objects shared
+        Document recovered = makeDocument();
+        ObjectTable recoveredIds;
+        recoveredIds.assign(&recovered);
+
+        std::istringstream is(wal.str());
+        assert(TransactionLog(recoveredIds).replay(is) == log.size());
+        assert(toXml(recovered) == toXml(doc));
+        assert(recovered.get<Owner>() == recovered.get<Items>()[1]);
+    }
+
+    return 0;
+}
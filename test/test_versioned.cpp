@@ -0,0 +1,217 @@
+#include <atomic>
+#include <cassert>
+#include <sstream>
+#include <thread>
+#include <ref/Class.hpp>
+#include <ref/DescriptorsImpl.ipp>
+#include <ref/utils/VersionedModel.hpp>
+#include <ref/utils/XmlSerializer.hpp>
+
+using namespace ref;
+
+namespace model
+{
+    struct Item;
+
+    struct Name : String {};
+    struct Value : Int32 {};
+    struct Items : Feature<std::vector<std::shared_ptr<Item> > > {};
+    struct Detail : Feature<std::shared_ptr<Item> > {};
+
+    struct Item : Class<Item, Features<Name, Value, Detail> >
+    {
+    };
+
+    struct Catalog : Class<Catalog, Features<Name, Items> >
+    {
+    };
+}  // namespace model
+
+using namespace model;
+
+namespace
+{
+    Catalog makeCatalog(int size)
+    {
+        Catalog catalog;
+        catalog.set<Name>("catalog");
+
+        std::vector<std::shared_ptr<Item> > items;
+        for (int i = 0; i < size; i++)
+        {
+            auto item = std::make_shared<Item>();
+            item->set<Name>("item " + std::to_string(i));
+            item->set<Detail>(std::make_shared<Item>());
+            items.push_back(item);
+        }
+        catalog.set<Items>(items);
+        return catalog;
+    }
+
+    const FeatureDescriptor * feature(const char * name)
+    {
+        return Item::getClassDescriptorInstance()->getFeatureDescriptor(name);
+    }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    const FeatureDescriptor * items =
+        Catalog::getClassDescriptorInstance()->getFeatureDescriptor("Items");
+
+    // Snapshots keep seeing their version
+    {
+        Catalog catalog = makeCatalog(3);
+        VersionedModel model(&catalog);
+
+        auto before = model.snapshot();
+        assert(before.version() == 0);
+
+        {
+            auto writer = model.write();
+            ModelClass * item = writer.edit(writer.root(), items, 1);
+            assert(writer.isWritable(item));
+            static_cast<Item *>(item)->set<Value>(42);
+
+            ModelClass * detail = writer.edit(item, feature("Detail"));
+            static_cast<Item *>(detail)->set<Name>("detail");
+
+            // Objects are copied once per writer
+            assert(writer.edit(writer.root(), items, 1) == item);
+            writer.commit();
+        }
+
+        auto after = model.snapshot();
+        assert(after.version() == 1 && model.version() == 1);
+
+        const auto& oldItems = before.get<Catalog>()->get<Items>();
+        const auto& newItems = after.get<Catalog>()->get<Items>();
+
+        assert(oldItems[1]->get<Value>() == 0);
+        assert(oldItems[1]->get<Detail>()->get<Name>().empty());
+        assert(newItems[1]->get<Value>() == 42);
+        assert(newItems[1]->get<Detail>()->get<Name>() == "detail");
+
+        // Untouched objects are shared
+        assert(oldItems[0] == newItems[0] && oldItems[2] == newItems[2]);
+        assert(oldItems[1] != newItems[1]);
+
+        // The initial objects are shared too
+        assert(catalog.get<Items>()[0] == newItems[0]);
+
+        // Only the objects of unpublished versions are writable
+        {
+            auto writer = model.write();
+            bool thrown = false;
+            try
+            {
+                writer.edit(newItems[0].get(), feature("Detail"));
+            }
+            catch (const std::invalid_argument&)
+            {
+                thrown = true;
+            }
+            assert(thrown);
+        }
+
+        // Discarded writers leave the model untouched
+        assert(model.version() == 1);
+        assert(model.snapshot().get<Catalog>()->get<Items>()[1] ==
+               newItems[1]);
+    }
+
+    // Replaced versions are reclaimed once no snapshot can access them
+    {
+        Catalog catalog = makeCatalog(1);
+        VersionedModel model(&catalog);
+        catalog.get<Items>().clear();
+
+        std::weak_ptr<Item> first =
+            model.snapshot().get<Catalog>()->get<Items>()[0];
+
+        auto snapshot = model.snapshot();
+
+        for (int i = 0; i < 3; i++)
+        {
+            auto writer = model.write();
+            writer.edit(writer.root(), items, 0);
+            writer.commit();
+        }
+
+        assert(model.retired() == 3);
+        assert(!first.expired());
+        assert(snapshot.get<Catalog>()->get<Items>()[0]->get<Value>() == 0);
+
+        snapshot.release();
+        model.collect();
+        assert(model.retired() == 0);
+        assert(first.expired());
+    }
+
+    // Readers serialize consistent versions while the writer commits
+    {
+        const int size = 8;
+        const int commits = 200;
+
+        Catalog catalog = makeCatalog(size);
+        VersionedModel model(&catalog);
+
+        std::atomic<bool> done(false);
+        std::vector<std::thread> readers;
+        std::atomic<int> reads(0);
+
+        for (int r = 0; r < 4; r++)
+        {
+            readers.emplace_back([&]() {
+                while (!done.load())
+                {
+                    auto snapshot = model.snapshot();
+                    const Catalog * root = snapshot.get<Catalog>();
+
+                    // Every commit sets the same value in every item
+                    const int value = root->get<Items>()[0]->get<Value>();
+                    for (auto& item : root->get<Items>())
+                    {
+                        assert(item->get<Value>() == value);
+                        assert(item->get<Detail>()->get<Value>() == value);
+                    }
+
+                    std::ostringstream os;
+                    XmlSerializer(os).serialize(snapshot.root());
+                    assert(!os.str().empty());
+                    ++reads;
+                }
+            });
+        }
+
+        while (reads == 0)
+            std::this_thread::yield();
+
+        for (int i = 1; i <= commits; i++)
+        {
+            auto writer = model.write();
+            for (int j = 0; j < size; j++)
+            {
+                auto item =
+                    static_cast<Item *>(writer.edit(writer.root(), items, j));
+                item->set<Value>(i);
+
+                auto detail =
+                    static_cast<Item *>(writer.edit(item, feature("Detail")));
+                detail->set<Value>(i);
+            }
+            writer.commit();
+        }
+
+        done = true;
+        for (auto& reader : readers)
+            reader.join();
+
+        assert(model.version() == commits);
+
+        model.collect();
+        assert(model.retired() == 0);
+    }
+
+    return 0;
+}
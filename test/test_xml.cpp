@@ -0,0 +1,236 @@
+#include <cassert>
+#include <sstream>
+#include <stdexcept>
+#include <ref/Class.hpp>
+#include <ref/DescriptorsImpl.ipp>
+#include <ref/utils/XmlSerializer.hpp>
+#include <ref/utils/XmlDeserializer.hpp>
+#include <ref/utils/XmlPullParser.hpp>
+
+using namespace ref;
+
+namespace xml
+{
+    struct Shape;
+
+    struct Name : String {};
+    struct Values : Feature<std::vector<int> > {};
+    struct Tags : Feature<std::set<std::string> > {};
+    struct Weights : Feature<std::map<std::string, double> > {};
+    struct Range : Feature<std::pair<int, int> > {};
+    struct Count : Feature<std::shared_ptr<int> > {};
+    struct Main : Feature<std::shared_ptr<Shape> > {};
+    struct Shapes : Feature<std::vector<std::shared_ptr<Shape> > > {};
+    struct Parent : Feature<std::weak_ptr<Shape> > {};
+    struct Side : Feature<double> {};
+
+    struct Shape : Class<Shape, Features<Name, Parent> >
+    {
+    };
+
+    struct Square : Class<Square, Features<Side>, Shape>
+    {
+    };
+
+    struct Drawing
+        : Class<Drawing, Features<Name, Values, Tags, Weights, Range, Count,
+                                  Main, Shapes> >
+    {
+    };
+}  // namespace xml
+
+using namespace xml;
+
+int main(int argc, char **argv)
+{
+    // Pull parser
+    {
+        std::istringstream is(
+            "<?xml version=\"1.0\"?>\n"
+            "<!DOCTYPE a>\n"
+            "<a x='1' y=\"&lt;2&gt;\">\n"
+            "  <!-- comment --->\n"
+            "  <b>one &amp; <![CDATA[<two>]]>&#65;&#x42;<c/></b>\n"
+            "  <d/>\n"
+            "</a>\n");
+        XmlPullParser parser(is);
+
+        assert(parser.next() == XmlPullParser::kStartElement);
+        assert(parser.getName() == "a");
+        assert(parser.getAttributes().size() == 2);
+        assert(parser.getAttributes()[1].second == "<2>");
+
+        while (parser.next() != XmlPullParser::kStartElement)
+            ;
+        assert(parser.getName() == "b");
+        assert(parser.readText() == "one & <two>AB");
+        assert(parser.getDepth() == 1);
+
+        while (parser.next() != XmlPullParser::kStartElement)
+            ;
+        assert(parser.getName() == "d");
+        assert(parser.next() == XmlPullParser::kEndElement);
+        assert(parser.getName() == "d");
+
+        while (parser.next() != XmlPullParser::kEndElement)
+            ;
+        assert(parser.getName() == "a");
+        assert(parser.getDepth() == 0);
+        assert(parser.next() == XmlPullParser::kEndDocument);
+    }
+
+    // Malformed documents
+    {
+        const char *documents[] = {"<a><b></a>", "<a>", "<a>&unknown;</a>"};
+
+        for (const char *document : documents)
+        {
+            std::istringstream is(document);
+            XmlPullParser parser(is);
+
+            bool thrown = false;
+            try
+            {
+                while (parser.next() != XmlPullParser::kEndDocument)
+                    ;
+            }
+            catch (const std::runtime_error &)
+            {
+                thrown = true;
+            }
+            assert(thrown);
+        }
+    }
+
+    // Round trip
+    {
+        Drawing drawing;
+        drawing.set<Name>("a <b> & c");
+        drawing.set<Values>(std::vector<int>{1, 2, 3});
+        drawing.set<Tags>(std::set<std::string>{"x", "y"});
+        drawing.set<Weights>(
+            std::map<std::string, double>{{"a", 0.5}, {"b", 2}});
+        drawing.set<Range>(std::make_pair(-1, 1));
+        drawing.set<Count>(std::make_shared<int>(7));
+
+        auto square = std::make_shared<Square>();
+        square->set<Name>("square");
+        square->set<Side>(2.5);
+        drawing.set<Main>(square);
+
+        auto shape = std::make_shared<Shape>();
+        shape->set<Name>("shape");
+        shape->set<Parent>(square);
+        drawing.set<Shapes>(
+            std::vector<std::shared_ptr<Shape> >{shape, square, nullptr});
+
+        std::ostringstream os;
+        XmlSerializer(os).serialize(&drawing);
+
+        const std::string xml = os.str();
+        assert(xml.find("<drawing>") == 0);
+        assert(xml.find("<name>a &lt;b&gt; &amp; c</name>") !=
+               std::string::npos);
+        assert(xml.find("<square>") != std::string::npos);
+
+        // Into a new instance
+        std::istringstream is(xml);
+        Holder h = XmlDeserializer(is).deserialize();
+        assert(h.isValid());
+        assert(h.descriptor() == Drawing::getClassDescriptorInstance());
+
+        Drawing *res = h.get<Drawing>();
+        assert(res->get<Name>() == "a <b> & c");
+        assert(res->get<Values>() == drawing.get<Values>());
+        assert(res->get<Tags>() == drawing.get<Tags>());
+        assert(res->get<Weights>() == drawing.get<Weights>());
+        assert(res->get<Range>() == drawing.get<Range>());
+        assert(*res->get<Count>() == 7);
+
+        auto main = std::dynamic_pointer_cast<Square>(res->get<Main>());
+        assert(main && main != square);
+        assert(main->get<Name>() == "square");
+        assert(main->get<Side>() == 2.5);
+
+        const auto &shapes = res->get<Shapes>();
+        assert(shapes.size() == 3);
+        assert(!std::dynamic_pointer_cast<Square>(shapes[0]));
+        assert(shapes[0]->get<Name>() == "shape");
+        assert(shapes[0]->get<Parent>().expired());
+        assert(std::dynamic_pointer_cast<Square>(shapes[1]));
+        assert(!shapes[2]);
+
+        // Into an existing instance
+        Drawing other;
+        other.set<Count>(std::make_shared<int>(1));
+        other.set<Values>(std::vector<int>{4});
+
+        std::istringstream is2(xml);
+        XmlDeserializer(is2).deserialize(&other);
+        assert(other.get<Values>() == drawing.get<Values>());
+        assert(*other.get<Count>() == 7);
+    }
+
+    // Null pointers and unknown elements
+    {
+        Drawing drawing;
+        drawing.set<Count>(std::make_shared<int>(1));
+
+        std::istringstream is(
+            "<drawing><unknown><name>x</name></unknown>"
+            "<count><null/></count><name>y</name></drawing>");
+        XmlDeserializer(is).deserialize(&drawing);
+
+        assert(!drawing.get<Count>());
+        assert(drawing.get<Name>() == "y");
+    }
+
+    // Streaming
+    {
+        std::ostringstream os;
+        XmlSerializer serializer(os);
+        serializer.begin("shapes");
+
+        for (int i = 0; i < 100; i++)
+        {
+            Square square;
+            square.set<Side>(i);
+            serializer.serialize(&square);
+        }
+
+        serializer.end();
+
+        std::istringstream is(os.str());
+        XmlDeserializer deserializer(is);
+
+        int count = 0;
+        for (Holder h = deserializer.next(); h.isValid();
+             h = deserializer.next())
+        {
+            assert(h.descriptor() == Square::getClassDescriptorInstance());
+            assert(h.get<Square>()->get<Side>() == count);
+            ++count;
+        }
+        assert(count == 100);
+    }
+
+    // Invalid values
+    {
+        Drawing drawing;
+        std::istringstream is("<drawing><range><first>a</first></range>"
+                              "</drawing>");
+
+        bool thrown = false;
+        try
+        {
+            XmlDeserializer(is).deserialize(&drawing);
+        }
+        catch (const std::runtime_error &)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    return 0;
+}